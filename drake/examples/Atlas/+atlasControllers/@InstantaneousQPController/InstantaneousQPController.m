@@ -36,7 +36,7 @@ classdef InstantaneousQPController
         struct('debug', false,...
                'solver', 0),...
         struct('debug', @(x) typecheck(x, 'logical') && sizecheck(x, 1),...
-               'solver', @(x) x == 0 || x == 1));
+               'solver', @(x) x == 0 || x == 1 || x == 2)); % 0 = fastQP, 1 = gurobi active set, 2 = sparse ADMM
       for f = fieldnames(options)'
         obj.(f{1}) = options.(f{1});
       end
@@ -58,7 +58,7 @@ classdef InstantaneousQPController
                                                      'qp_active_set', [],...
                                                      'num_active_contact_pts', 0));
       obj.gurobi_options.outputflag = 0; % not verbose
-      if obj.solver==0
+      if obj.solver==0 || obj.solver==2
         obj.gurobi_options.method = 2; % -1=automatic, 0=primal simplex, 1=dual simplex, 2=barrier
       else
         obj.gurobi_options.method = 0; % -1=automatic, 0=primal simplex, 1=dual simplex, 2=barrier
@@ -88,7 +88,8 @@ classdef InstantaneousQPController
                                        obj.robot.umax,...
                                        obj.solver==0,...
                                        obj.gurobi_options,...
-                                       coordinate_names);
+                                       coordinate_names,...
+                                       obj.solver==2);
     end
 
     function [y, v_ref] = updateAndOutput(obj, t, x, qp_input_msg, foot_contact_sensor)
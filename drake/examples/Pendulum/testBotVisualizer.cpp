@@ -0,0 +1,65 @@
+#include <iostream>
+#include "Pendulum.h"
+#include "BotVisualizer.h"
+
+using namespace std;
+using namespace Drake;
+
+/*
+ * Checks that BotVisualizer sends at most one draw message per publish_period and none for an unchanged
+ * configuration. The messages go through an in-process lcm provider, so no other lcm traffic is involved.
+ */
+class DrawCounter {
+public:
+  DrawCounter() : num_draws(0), last_timestamp(-1) {};
+
+  void handleMessage(const lcm::ReceiveBuffer* rbuf, const std::string& channel, const drake::lcmt_viewer_draw* msg) {
+    num_draws++;
+    last_timestamp = msg->timestamp;
+  }
+
+  int num_draws;
+  int64_t last_timestamp;
+};
+
+int main(int argc, char* argv[]) {
+  shared_ptr<lcm::LCM> lcm = make_shared<lcm::LCM>("memq://");
+  if(!lcm->good())
+    return 1;
+
+  double publish_period = 0.1;
+  BotVisualizer<PendulumState> v(lcm,getDrakePath()+"/examples/Pendulum/Pendulum.urdf",DrakeJoint::FIXED,publish_period);
+
+  DrawCounter counter;
+  lcm->subscribe("DRAKE_VIEWER_DRAW",&DrawCounter::handleMessage,&counter);
+  auto checkDraws = [&](double t, double theta, double thetadot, int expected_draws) {
+    PendulumState<double> x;
+    x.theta = theta;
+    x.thetadot = thetadot;
+    v.outputImplementation(t,x);
+    while (lcm->handleTimeout(0) > 0) {}
+    if (counter.num_draws != expected_draws) {
+      cerr << "after the call at t = " << t << ", " << counter.num_draws << " draw messages were sent, expected " << expected_draws << endl;
+      return false;
+    }
+    return true;
+  };
+
+  if (!checkDraws(0.0, 0.1, 0.0, 1))   // the first call always draws
+    return 1;
+  if (!checkDraws(0.05, 0.2, 0.0, 1))  // within publish_period of the last draw
+    return 1;
+  if (!checkDraws(0.1, 0.2, 0.0, 2))   // a full period later
+    return 1;
+  if (!checkDraws(0.2, 0.2, 1.0, 2))   // only the velocity changed, the configuration is the same
+    return 1;
+  if (!checkDraws(0.3, 0.3, 1.0, 3))   // moved again
+    return 1;
+  if (!checkDraws(0.0, 0.3, 1.0, 4))   // time went backwards (a new simulation), both limits are reset
+    return 1;
+  if (counter.last_timestamp != 0) {
+    cerr << "the last draw message has timestamp " << counter.last_timestamp << ", expected 0" << endl;
+    return 1;
+  }
+  return 0;
+}
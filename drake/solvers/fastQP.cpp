@@ -0,0 +1,529 @@
+#include <math.h>
+#include <iostream>
+#include <algorithm>
+#include <Eigen/Cholesky>
+#include <Eigen/LU>
+#include <Eigen/SVD>
+
+#include "fastQP.h"
+
+#define _USE_MATH_DEFINES
+
+#define MAX_CONSTRS 1000
+#define MAX_STATE   1000
+#define MAX_ITER    10
+
+
+using namespace Eigen;
+using namespace std;
+
+
+//template <typename tA, typename tB, typename tC, typename tD, typename tE, typename tF, typename tG>
+//int fastQPThatTakesQinv(vector< MatrixBase<tA>* > QinvblkDiag, const MatrixBase<tB>& f, const MatrixBase<tC>& Aeq, const MatrixBase<tD>& beq, const MatrixBase<tE>& Ain, const MatrixBase<tF>& bin, set<int>& active, MatrixBase<tG>& x)
+int fastQPThatTakesQinv(vector< MatrixXd* > QinvblkDiag, const VectorXd& f, const MatrixXd& Aeq, const VectorXd& beq, const MatrixXd& Ain, const VectorXd& bin, set<int>& active, VectorXd& x)
+{
+  int i,d;
+  int iterCnt = 0;
+  
+  int M_in = bin.size();
+  int M = Aeq.rows();
+  int N = Aeq.cols();
+  
+  if (f.rows() != N) { cerr << "size of f (" << f.rows() << " by " << f.cols() << ") doesn't match cols of Aeq (" << Aeq.rows() << " by " << Aeq.cols() << ")" << endl; return 2; }
+  if (beq.rows() !=M) { cerr << "size of beq doesn't match rows of Aeq" << endl; return 2; }
+  if (Ain.cols() !=N) { cerr << "cols of Ain doesn't match cols of Aeq" << endl; return 2; };
+  if (bin.rows() != Ain.rows()) { cerr << "bin rows doesn't match Ain rows" << endl; return 2; };
+  if (x.rows() != N) { cerr << "x doesn't match Aeq" << endl; return 2; }
+  int n_active = active.size();
+
+  MatrixXd Aact = MatrixXd(n_active, N);
+  VectorXd bact = VectorXd(n_active);
+
+  MatrixXd QinvAteq(N,M);
+  VectorXd minusQinvf(N);
+
+  // calculate a bunch of stuff that is constant during each iteration
+  int startrow=0;
+//  for (typename vector< MatrixBase<tA>* >::iterator iterQinv=QinvblkDiag.begin(); iterQinv!=QinvblkDiag.end(); iterQinv++) {
+//  	MatrixBase<tA> *thisQinv = *iterQinv;
+  for (vector< MatrixXd* >::iterator iterQinv=QinvblkDiag.begin(); iterQinv!=QinvblkDiag.end(); iterQinv++) {
+  	MatrixXd *thisQinv = *iterQinv;
+  	int numRow = thisQinv->rows();
+  	int numCol = thisQinv->cols();
+
+  	if (numRow == 1 || numCol == 1) {  // it's a vector
+  		d = numRow*numCol;
+  		if (M>0) QinvAteq.block(startrow,0,d,M)= thisQinv->asDiagonal()*Aeq.block(0,startrow,M,d).transpose();  // Aeq.transpoODse().block(startrow,0,d,N)
+			minusQinvf.segment(startrow,d) = -thisQinv->cwiseProduct(f.segment(startrow,d));
+			startrow=startrow+d;
+  	} else { // potentially dense matrix
+			d = numRow;
+			if (numRow!=numCol) {
+					cerr << "Q is not square! " << numRow << "x" << numCol << "\n";
+					return -2;
+			}
+			if (M>0) QinvAteq.block(startrow,0,d,M) = thisQinv->operator*(Aeq.block(0,startrow,M,d).transpose());  // Aeq.transpose().block(startrow,0,d,N)
+			minusQinvf.segment(startrow,d) = -thisQinv->operator*(f.segment(startrow,d));
+			startrow=startrow+d;
+		}
+  	if (startrow>N) {
+			cerr << "Q is too big!" << endl;
+			return -2;
+		}
+  }
+  if (startrow!=N) { cerr << "Q is the wrong size.  Got " << startrow << "by" << startrow << " but needed " << N << "by" << N << endl; return -2; }
+
+  MatrixXd A;
+  VectorXd b;
+  MatrixXd QinvAt;
+  VectorXd lam, lamIneq;
+  VectorXd violated(M_in);
+  VectorXd violation;
+  
+  while(1) {
+    iterCnt++;
+
+    n_active = active.size();
+    Aact.resize(n_active,N);
+    bact.resize(n_active);
+
+    i=0;
+    for (set<int>::iterator iter=active.begin(); iter!=active.end(); iter++) {
+    	if (*iter<0 || *iter>=Ain.rows()) {
+    		return -3;  // active set is invalid.  exit quietly, because this is expected behavior in normal operation (e.g. it means I should immediately kick out to gurobi)
+    	}
+      Aact.row(i) = Ain.row(*iter);
+      bact(i++) = bin(*iter);
+    }
+
+    A.resize(Aeq.rows() + Aact.rows(),N);
+    b.resize(beq.size() + bact.size());
+    A << Aeq,Aact;
+    b << beq,bact;
+    
+    if (A.rows() > 0) {
+      //Solve H * [x;lam] = [-f;b] using Schur complements, H = [Q,At';A,0];
+      QinvAt.resize(QinvAteq.rows(), QinvAteq.cols() + Aact.rows());
+
+      if (n_active>0) {
+				int startrow=0;
+				for (vector< MatrixXd* >::iterator iterQinv=QinvblkDiag.begin(); iterQinv!=QinvblkDiag.end(); iterQinv++) {
+					MatrixXd* thisQinv = (*iterQinv);
+					d = thisQinv->rows();
+					int numCol = thisQinv->cols();
+
+					if (numCol == 1) {  // it's a vector
+						QinvAt.block(startrow,0,d,M+n_active) << QinvAteq.block(startrow,0,d,M), thisQinv->asDiagonal()*Aact.block(0,startrow,n_active,d).transpose();
+					} else { // it's a matrix
+						QinvAt.block(startrow,0,d,M+n_active) << QinvAteq.block(startrow,0,d,M), thisQinv->operator*(Aact.block(0,startrow,n_active,d).transpose());
+					}
+
+					startrow=startrow+d;
+				}
+      } else {
+      	QinvAt = QinvAteq;
+      }
+      
+      lam.resize(QinvAt.cols());
+      lam = -(A*QinvAt).ldlt().solve(b + (f.transpose()*QinvAt).transpose());
+      x = minusQinvf - QinvAt*lam;
+      lamIneq = lam.tail(lam.size() - M);
+    } else {
+      x = minusQinvf;
+      lamIneq.resize(0);
+    }
+  
+    if(Ain.rows() == 0) {
+      active.clear();
+      break;
+    }
+    
+    set<int> new_active;
+
+    violation = Ain*x - bin;
+    for (i=0; i<M_in; i++)
+      if (violation(i) >= 1e-6)
+      	new_active.insert(i);
+    
+    bool all_pos_mults = true;
+    for (i=0; i<n_active; i++) {
+    	if (lamIneq(i)<0) {
+    		all_pos_mults = false;
+    		break;
+    	}
+    }
+    if (new_active.empty() && all_pos_mults) {
+    	// existing active was AOK
+    	break;
+    }
+
+    i=0;
+    set<int>::iterator iter=active.begin(), tmp;
+    while (iter!=active.end()) { // to accomodating inloop erase
+  		tmp = iter++;
+    	if (lamIneq(i++)<0) {
+    		active.erase(tmp);
+    	}
+    }
+    active.insert(new_active.begin(),new_active.end());
+
+    if (iterCnt > MAX_ITER) {
+      //Default to calling this method
+//      cout << "FastQP max iter reached." << endl;
+//       mexErrMsgIdAndTxt("Drake:approximateIKmex:Error", "Max iter reached. Problem is likely infeasible");
+      return -1;
+    }
+  }  
+  return iterCnt;
+}
+
+#define REG 1e-13
+
+/*
+ * Regularizes and inverts the blocks of QblkDiag into Qinv (diagonal blocks are given as column vectors and stay
+ * vectors), and points Qinvmap at them. Dense blocks are inverted through a Cholesky factorization kept in Qllt, so
+ * that callers which keep Qinv and Qllt around don't reallocate them for blocks of the same size.
+ *
+ * @retval 0 on success, -2 if the blocks don't form an N by N block diagonal matrix
+ */
+static int invertQBlocks(const vector< MatrixXd* >& QblkDiag, int N, vector< MatrixXd >& Qinv, vector< LLT<MatrixXd> >& Qllt, vector< MatrixXd* >& Qinvmap)
+{
+  Qinv.resize(QblkDiag.size());
+  Qllt.resize(QblkDiag.size());
+  Qinvmap.clear();
+  int startrow=0;
+  for (size_t i=0; i<QblkDiag.size(); i++) {
+    const MatrixXd* thisQ = QblkDiag[i];
+    int numRow = thisQ->rows();
+    int numCol = thisQ->cols();
+
+    if (numCol == 1) {  // it's a vector
+      Qinv[i] = (thisQ->array() + REG).inverse().matrix();
+    } else { // potentially dense matrix
+      if (numRow!=numCol) {
+        if (numRow==1)
+          cerr << "diagonal Q's must be set as column vectors" << endl;
+        else
+          cerr << "Q is not square! " << numRow << "x" << numCol << endl;
+        return -2;
+      }
+      Qllt[i].compute(*thisQ + REG*MatrixXd::Identity(numRow,numRow));
+      if (Qllt[i].info() == Success) {
+        Qinv[i].setIdentity(numRow,numRow);
+        Qllt[i].solveInPlace(Qinv[i]);
+      } else {
+        Qinv[i] = (*thisQ + REG*MatrixXd::Identity(numRow,numRow)).inverse();
+      }
+    }
+    Qinvmap.push_back(&Qinv[i]);
+    startrow=startrow+numRow;
+    if (startrow>N) {
+      cerr << "Q is too big!" << endl;
+      return -2;
+    }
+  }
+  if (startrow!=N) { cerr << "Q is the wrong size.  Got " << startrow << "by" << startrow << " but needed " << N << "by" << N << endl; return -2; }
+  return 0;
+}
+
+//template <typename tA, typename tB, typename tC, typename tD, typename tE, typename tF, typename tG>
+//int fastQP(vector< MatrixBase<tA>* > QblkDiag, const MatrixBase<tB>& f, const MatrixBase<tC>& Aeq, const MatrixBase<tD>& beq, const MatrixBase<tE>& Ain, const MatrixBase<tF>& bin, set<int>& active, MatrixBase<tG>& x)
+int fastQP(vector< MatrixXd* > QblkDiag, const VectorXd& f, const MatrixXd& Aeq, const VectorXd& beq, const MatrixXd& Ain, const VectorXd& bin, set<int>& active, VectorXd& x)
+{
+  /* min 1/2 * x'QblkDiag'x + f'x s.t A x = b, Ain x <= bin
+   * using active set method.  Iterative solve a linearly constrained
+   * quadratic minimization problem where linear constraints include
+   * Ain(active,:)x == bin(active).  Quit if all dual variables associated
+   * with these equations are positive (i.e. they satisfy KKT conditions).
+   *
+   * Note:
+   * fails if QP is infeasible.
+   * active == initial rows of Ain to treat as equations.
+   * Frank Permenter - June 6th 2013
+   *
+   * @retval  if feasible then iterCnt, else -1 for infeasible, -2 for input error
+   */
+
+  vector< MatrixXd > Qinv;
+  vector< LLT<MatrixXd> > Qllt;
+  vector< MatrixXd* > Qinvmap;
+  if (invertQBlocks(QblkDiag, f.rows(), Qinv, Qllt, Qinvmap) < 0)
+    return -2;
+
+  return fastQPThatTakesQinv(Qinvmap,f,Aeq,beq,Ain,bin,active,x);
+}
+
+#define FASTQP_PIVOT_TOLERANCE 1e-10
+
+FastQP::FastQP() : N(-1), M(-1), M_in(-1), num_constraints(0), factor_valid(true) {}
+
+void FastQP::resize(int N, int M, int M_in)
+{
+  if (N == this->N && M == this->M && M_in == this->M_in)
+    return;
+
+  this->N = N;
+  this->M = M;
+  this->M_in = M_in;
+
+  At.resize(N, M + M_in);
+  QinvAt.resize(N, M + M_in);
+  // more than N rows of A can't be linearly independent
+  L.resize(min(M + M_in, N), min(M + M_in, N));
+  minusQinvf.resize(N);
+  c.resize(M + M_in);
+  lam.resize(M + M_in);
+  violation.resize(M_in);
+  constraints.resize(M + M_in);
+  is_active.resize(M_in);
+  new_active.reserve(M_in);
+}
+
+/*
+ * appends the constraint At.col(num_constraints)' * x = b.
+ */
+void FastQP::appendConstraint(const vector< MatrixXd* >& QinvblkDiag, double b, int constraint_index)
+{
+  int m = num_constraints;
+  int startrow = 0;
+  for (vector< MatrixXd* >::const_iterator iterQinv=QinvblkDiag.begin(); iterQinv!=QinvblkDiag.end(); iterQinv++) {
+    const MatrixXd* thisQinv = *iterQinv;
+    int numRow = thisQinv->rows();
+    int numCol = thisQinv->cols();
+    if (numRow == 1 || numCol == 1) {  // it's a vector
+      int d = numRow*numCol;
+      QinvAt.col(m).segment(startrow,d) = thisQinv->cwiseProduct(At.col(m).segment(startrow,d));
+      startrow=startrow+d;
+    } else { // it's a matrix
+      QinvAt.col(m).segment(startrow,numRow).noalias() = (*thisQinv)*At.col(m).segment(startrow,numRow);
+      startrow=startrow+numRow;
+    }
+  }
+  c(m) = b - At.col(m).dot(minusQinvf);
+
+  constraints[m] = constraint_index;
+  if (constraint_index >= 0)
+    is_active[constraint_index] = true;
+  num_constraints++;
+  if (factor_valid)
+    factor_valid = factorRow(m);
+}
+
+/*
+ * computes row m of L from rows 0..m-1. Returns false if constraint m is (numerically) linearly dependent on those.
+ */
+bool FastQP::factorRow(int m)
+{
+  if (m >= L.rows())
+    return false;
+
+  // solve L(0:m-1,0:m-1) * l = A(0:m-1,:) * Qinv * A(m,:)'
+  auto l = L.row(m).head(m);
+  l.noalias() = At.col(m).transpose()*QinvAt.leftCols(m);
+  L.topLeftCorner(m,m).triangularView<Lower>().solveInPlace(l.transpose());
+  double aQinva = At.col(m).dot(QinvAt.col(m));
+  double pivot_squared = aQinva - l.squaredNorm();
+  if (!(pivot_squared > FASTQP_PIVOT_TOLERANCE*aQinva))
+    return false;
+  L(m,m) = sqrt(pivot_squared);
+  return true;
+}
+
+/*
+ * removes the constraint at the given position. Its row and column are deleted from L and the trailing block is
+ * restored with a rank one update.
+ */
+void FastQP::removeConstraint(int position)
+{
+  int m = num_constraints;
+  int p = m - position - 1;
+  if (constraints[position] >= 0)
+    is_active[constraints[position]] = false;
+
+  auto v = lam.segment(position+1,p); // callers have already looked at the multipliers after position
+  if (factor_valid)
+    v = L.col(position).segment(position+1,p);
+  for (int i=position; i<m-1; i++) {
+    if (factor_valid) {
+      L.row(i).head(position) = L.row(i+1).head(position);
+      for (int j=position; j<=i; j++)
+        L(i,j) = L(i+1,j+1);
+    }
+    At.col(i) = At.col(i+1);
+    QinvAt.col(i) = QinvAt.col(i+1);
+    c(i) = c(i+1);
+    constraints[i] = constraints[i+1];
+  }
+  num_constraints--;
+
+  if (factor_valid) {
+    for (int i=0; i<p; i++) {
+      int k = position+i;
+      double r = sqrt(L(k,k)*L(k,k) + v(i)*v(i));
+      double cs = r/L(k,k);
+      double sn = v(i)/L(k,k);
+      L(k,k) = r;
+      for (int j=i+1; j<p; j++) {
+        L(position+j,k) = (L(position+j,k) + sn*v(j))/cs;
+        v(j) = cs*v(j) - sn*L(position+j,k);
+      }
+    }
+  }
+}
+
+void FastQP::setActive(set<int>& active) const
+{
+  // leave an unchanged active set alone instead of reallocating its nodes
+  if (active.size() == static_cast<size_t>(num_constraints - M)) {
+    bool same = true;
+    for (set<int>::const_iterator iter=active.begin(); iter!=active.end() && same; iter++)
+      same = is_active[*iter];
+    if (same)
+      return;
+  }
+  active.clear();
+  for (int j=M; j<num_constraints; j++)
+    active.insert(constraints[j]);
+}
+
+int FastQP::solveThatTakesQinv(const vector< MatrixXd* >& QinvblkDiag, const VectorXd& f, const MatrixXd& Aeq, const VectorXd& beq, const MatrixXd& Ain, const VectorXd& bin, set<int>& active, VectorXd& x)
+{
+  int M_in = bin.size();
+  int M = Aeq.rows();
+  int N = Aeq.cols();
+
+  if (f.rows() != N) { cerr << "size of f (" << f.rows() << " by " << f.cols() << ") doesn't match cols of Aeq (" << Aeq.rows() << " by " << Aeq.cols() << ")" << endl; return 2; }
+  if (beq.rows() !=M) { cerr << "size of beq doesn't match rows of Aeq" << endl; return 2; }
+  if (Ain.cols() !=N) { cerr << "cols of Ain doesn't match cols of Aeq" << endl; return 2; };
+  if (bin.rows() != Ain.rows()) { cerr << "bin rows doesn't match Ain rows" << endl; return 2; };
+  if (x.rows() != N) { cerr << "x doesn't match Aeq" << endl; return 2; }
+
+  resize(N, M, M_in);
+
+  int startrow=0;
+  for (vector< MatrixXd* >::const_iterator iterQinv=QinvblkDiag.begin(); iterQinv!=QinvblkDiag.end(); iterQinv++) {
+    const MatrixXd* thisQinv = *iterQinv;
+    int numRow = thisQinv->rows();
+    int numCol = thisQinv->cols();
+    int d;
+    if (numRow == 1 || numCol == 1) {  // it's a vector
+      d = numRow*numCol;
+      if (startrow+d<=N) minusQinvf.segment(startrow,d) = -thisQinv->cwiseProduct(f.segment(startrow,d));
+    } else { // potentially dense matrix
+      d = numRow;
+      if (numRow!=numCol) {
+        cerr << "Q is not square! " << numRow << "x" << numCol << "\n";
+        return -2;
+      }
+      if (startrow+d<=N) minusQinvf.segment(startrow,d).noalias() = -(*thisQinv)*f.segment(startrow,d);
+    }
+    startrow=startrow+d;
+    if (startrow>N) {
+      cerr << "Q is too big!" << endl;
+      return -2;
+    }
+  }
+  if (startrow!=N) { cerr << "Q is the wrong size.  Got " << startrow << "by" << startrow << " but needed " << N << "by" << N << endl; return -2; }
+
+  for (set<int>::const_iterator iter=active.begin(); iter!=active.end(); iter++) {
+    if (*iter<0 || *iter>=M_in) {
+      return -3;  // active set is invalid.  exit quietly, see fastQPThatTakesQinv
+    }
+  }
+
+  // equality constraints and the warm start active set
+  num_constraints = 0;
+  factor_valid = true;
+  fill(is_active.begin(), is_active.end(), false);
+  for (int i=0; i<M; i++) {
+    At.col(num_constraints) = Aeq.row(i).transpose();
+    appendConstraint(QinvblkDiag, beq(i), -1);
+  }
+  for (set<int>::const_iterator iter=active.begin(); iter!=active.end(); iter++) {
+    At.col(num_constraints) = Ain.row(*iter).transpose();
+    appendConstraint(QinvblkDiag, bin(*iter), *iter);
+  }
+
+  int iterCnt = 0;
+  while(1) {
+    iterCnt++;
+
+    // lam = -(A*Qinv*A')^-1 * (b + A*Qinv*f), x = -Qinv*(f + A'*lam)
+    int m = num_constraints;
+    if (!factor_valid) {
+      // constraints have been removed since the factorization last broke down, try again
+      factor_valid = true;
+      for (int j=0; j<m && factor_valid; j++)
+        factor_valid = factorRow(j);
+    }
+    auto lam_active = lam.head(m);
+    if (factor_valid) {
+      lam_active = -c.head(m);
+      L.topLeftCorner(m,m).triangularView<Lower>().solveInPlace(lam_active);
+      L.topLeftCorner(m,m).triangularView<Lower>().transpose().solveInPlace(lam_active);
+    } else {
+      lam_active = -(At.leftCols(m).transpose()*QinvAt.leftCols(m)).ldlt().solve(c.head(m));
+    }
+    x = minusQinvf;
+    x.noalias() -= QinvAt.leftCols(m)*lam_active;
+
+    if (M_in == 0) {
+      break;
+    }
+
+    violation.noalias() = Ain*x;
+    violation -= bin;
+    new_active.clear();
+    bool active_violated = false; // can happen when the active constraints are linearly dependent
+    for (int i=0; i<M_in; i++) {
+      if (violation(i) >= 1e-6) {
+        if (is_active[i])
+          active_violated = true;
+        else
+          new_active.push_back(i);
+      }
+    }
+
+    bool all_pos_mults = true;
+    for (int j=M; j<m; j++) {
+      if (lam(j)<0) {
+        all_pos_mults = false;
+        break;
+      }
+    }
+    if (new_active.empty() && !active_violated && all_pos_mults) {
+      // existing active was AOK
+      break;
+    }
+
+    // drop from the back so that the positions of the remaining constraints don't change. Like in fastQP, a violated
+    // constraint stays in the active set even if its multiplier is negative, so it is appended again
+    for (int j=m-1; j>=M; j--) {
+      if (lam(j)<0) {
+        int constraint_index = constraints[j];
+        removeConstraint(j);
+        if (violation(constraint_index) >= 1e-6)
+          new_active.push_back(constraint_index);
+      }
+    }
+    for (vector<int>::const_iterator iter=new_active.begin(); iter!=new_active.end(); iter++) {
+      At.col(num_constraints) = Ain.row(*iter).transpose();
+      appendConstraint(QinvblkDiag, bin(*iter), *iter);
+    }
+
+    if (iterCnt > MAX_ITER) {
+      setActive(active);
+      return -1;
+    }
+  }
+  setActive(active);
+  return iterCnt;
+}
+
+int FastQP::solve(const vector< MatrixXd* >& QblkDiag, const VectorXd& f, const MatrixXd& Aeq, const VectorXd& beq, const MatrixXd& Ain, const VectorXd& bin, set<int>& active, VectorXd& x)
+{
+  if (invertQBlocks(QblkDiag, f.rows(), Qinv, Qllt, Qinvmap) < 0)
+    return -2;
+
+  return solveThatTakesQinv(Qinvmap,f,Aeq,beq,Ain,bin,active,x);
+}
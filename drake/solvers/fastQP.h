@@ -10,6 +10,49 @@ int fastQPThatTakesQinv(std::vector< Eigen::MatrixXd* > QinvblkDiag, const Eigen
 int fastQP(std::vector< Eigen::MatrixXd* > QblkDiag, const Eigen::VectorXd& f, const Eigen::MatrixXd& Aeq, const Eigen::VectorXd& beq, const Eigen::MatrixXd& Ain, const Eigen::VectorXd& bin, std::set<int>& active, Eigen::VectorXd& x);
 //int fastQP(std::vector< Eigen::MatrixXd* > QblkDiag, const Eigen::VectorXd& f, const Eigen::MatrixXd& Aeq, const Eigen::VectorXd& beq, const Eigen::MatrixXd& Ain, const Eigen::VectorXd& bin, std::set<int>& active, Eigen::VectorXd& x, const Eigen::VectorXd& lb, const Eigen::VectorXd& ub);
 
+/*
+ * Active set engine behind fastQP/fastQPThatTakesQinv for solving a sequence of QPs of the same shape (e.g. one per
+ * controller tick). Takes the same arguments, runs the same iterations and honors the same warm start contract for
+ * active.
+ *
+ * Instead of refactoring A*Qinv*A' (A = [Aeq; Ain(active,:)]) on every active set iteration, the Cholesky factor of
+ * this matrix is updated when a constraint enters (append a row) or leaves (delete a row and column, followed by a
+ * rank one update) the active set. Workspaces are only reallocated when the problem shape changes. Iterations in
+ * which the active constraints are linearly dependent use a dense LDLT factorization instead, like fastQP does.
+ */
+class FastQP
+{
+public:
+  FastQP();
+
+  int solveThatTakesQinv(const std::vector< Eigen::MatrixXd* >& QinvblkDiag, const Eigen::VectorXd& f, const Eigen::MatrixXd& Aeq, const Eigen::VectorXd& beq, const Eigen::MatrixXd& Ain, const Eigen::VectorXd& bin, std::set<int>& active, Eigen::VectorXd& x);
+  int solve(const std::vector< Eigen::MatrixXd* >& QblkDiag, const Eigen::VectorXd& f, const Eigen::MatrixXd& Aeq, const Eigen::VectorXd& beq, const Eigen::MatrixXd& Ain, const Eigen::VectorXd& bin, std::set<int>& active, Eigen::VectorXd& x);
+
+private:
+  void resize(int N, int M, int M_in);
+  void appendConstraint(const std::vector< Eigen::MatrixXd* >& QinvblkDiag, double b, int constraint_index);
+  void removeConstraint(int position);
+  bool factorRow(int position);
+  void setActive(std::set<int>& active) const;
+
+  int N, M, M_in;
+  int num_constraints; // number of rows of A (equalities first)
+  bool factor_valid; // whether L holds the factor of all num_constraints rows
+  Eigen::MatrixXd At; // column j is A(j,:)'
+  Eigen::MatrixXd QinvAt; // column j is Qinv*A(j,:)'
+  Eigen::MatrixXd L; // lower triangular Cholesky factor of A*Qinv*A'
+  Eigen::VectorXd minusQinvf;
+  Eigen::VectorXd c; // c(j) = b(j) - A(j,:)*minusQinvf
+  Eigen::VectorXd lam;
+  Eigen::VectorXd violation;
+  std::vector<int> constraints; // index into Ain of each row of A, -1 for equalities
+  std::vector<bool> is_active;
+  std::vector<int> new_active;
+  std::vector< Eigen::MatrixXd > Qinv;
+  std::vector< Eigen::LLT<Eigen::MatrixXd> > Qllt;
+  std::vector< Eigen::MatrixXd* > Qinvmap;
+};
+
 /* TODO: restore templated versions
 template <typename tA, typename tB, typename tC, typename tD, typename tE, typename tF, typename tG>
 int fastQP(std::vector< Eigen::Map<tA> > QblkDiag, const Eigen::MatrixBase<tB>& f, const Eigen::MatrixBase<tC>& Aeq, const Eigen::MatrixBase<tD>& beq, const Eigen::MatrixBase<tE>& Ain, const Eigen::MatrixBase<tF>& bin, std::set<int>& active, Eigen::MatrixBase<tG>& x);
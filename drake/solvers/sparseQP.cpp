@@ -0,0 +1,203 @@
+#include "sparseQP.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Eigen;
+using namespace std;
+
+#define SPARSEQP_RHO_MIN 1e-6
+#define SPARSEQP_RHO_MAX 1e6
+#define SPARSEQP_RHO_EQ_SCALE 1e3
+#define SPARSEQP_RHO_ADAPT_RATIO 5.0
+#define SPARSEQP_DIVISION_TOLERANCE 1e-10
+
+SparseQP::SparseQP() : n(-1), m(-1), rho(0.0), pattern_analyzed(false)
+{
+}
+
+void SparseQP::updateRhoVector()
+{
+  for (int i = 0; i < m; i++) {
+    if (std::isinf(l(i)) && std::isinf(u(i)))
+      rho_vec(i) = SPARSEQP_RHO_MIN; // free row
+    else if (u(i) - l(i) < SPARSEQP_DIVISION_TOLERANCE)
+      rho_vec(i) = SPARSEQP_RHO_EQ_SCALE * rho; // equality row
+    else
+      rho_vec(i) = rho;
+  }
+}
+
+// index of the stored entry (row, col) of the compressed matrix M in its value array, -1 if there is none
+static int storedEntryIndex(const SparseMatrix<double>& M, int row, int col)
+{
+  const int* begin = M.innerIndexPtr() + M.outerIndexPtr()[col];
+  const int* end = M.innerIndexPtr() + M.outerIndexPtr()[col + 1];
+  const int* it = lower_bound(begin, end, row);
+  return (it != end && *it == row) ? static_cast<int>(it - M.innerIndexPtr()) : -1;
+}
+
+bool setValuesFromTriplets(SparseMatrix<double>& M, const vector<Triplet<double> >& triplets)
+{
+  if (!M.isCompressed())
+    return false;
+  for (auto it = triplets.begin(); it != triplets.end(); ++it) {
+    if (it->row() < 0 || it->row() >= M.rows() || it->col() < 0 || it->col() >= M.cols() || storedEntryIndex(M, it->row(), it->col()) < 0)
+      return false;
+  }
+  fill(M.valuePtr(), M.valuePtr() + M.nonZeros(), 0.0);
+  for (auto it = triplets.begin(); it != triplets.end(); ++it)
+    M.valuePtr()[storedEntryIndex(M, it->row(), it->col())] += it->value();
+  return true;
+}
+
+/*
+ * Computes the fill reducing ordering of KKT (like SimplicialLDLT::analyzePattern would), sets up the pattern of
+ * KKT_permuted with the map from the entries of KKT and does the symbolic analysis.
+ */
+void SparseQP::analyzePattern()
+{
+  SparseMatrix<double> KKT_full;
+  KKT_full = KKT.selfadjointView<Lower>();
+  AMDOrdering<int> ordering;
+  ordering(KKT_full, KKT_Pinv);
+  KKT_P = KKT_Pinv.inverse();
+  SparseMatrix<double> KKT_permuted_unsorted(KKT.rows(), KKT.cols());
+  KKT_permuted_unsorted.selfadjointView<Upper>() = KKT.selfadjointView<Lower>().twistedBy(KKT_P);
+  // the permutation leaves the row indices within a column unsorted, transposing twice sorts them for storedEntryIndex
+  SparseMatrix<double, RowMajor> KKT_permuted_row_major = KKT_permuted_unsorted;
+  KKT_permuted = KKT_permuted_row_major;
+
+  KKT_permuted_index.resize(KKT.nonZeros());
+  for (int j = 0; j < KKT.outerSize(); j++) {
+    for (SparseMatrix<double>::InnerIterator it(KKT, j); it; ++it) {
+      int row = KKT_P.indices()(it.row());
+      int col = KKT_P.indices()(it.col());
+      KKT_permuted_index[&it.value() - KKT.valuePtr()] = storedEntryIndex(KKT_permuted, min(row, col), max(row, col));
+    }
+  }
+  ldlt.analyzePattern(KKT_permuted);
+  pattern_analyzed = true;
+}
+
+/*
+ * Factors the lower triangle of [P + sigma*I, A_all'; A_all, -diag(1/rho_vec)]. The ordering and the symbolic analysis
+ * are only redone when the sparsity pattern changes.
+ */
+bool SparseQP::factor(const SparseMatrix<double>& P)
+{
+  KKT_triplets.clear();
+  for (int j = 0; j < P.outerSize(); j++) {
+    for (SparseMatrix<double>::InnerIterator it(P, j); it; ++it) {
+      if (it.row() >= it.col())
+        KKT_triplets.push_back(Triplet<double>(it.row(), it.col(), it.value()));
+    }
+  }
+  for (int i = 0; i < n; i++)
+    KKT_triplets.push_back(Triplet<double>(i, i, settings.sigma));
+  for (int j = 0; j < A_all.outerSize(); j++) {
+    for (SparseMatrix<double>::InnerIterator it(A_all, j); it; ++it)
+      KKT_triplets.push_back(Triplet<double>(n + it.row(), it.col(), it.value()));
+  }
+  for (int i = 0; i < m; i++)
+    KKT_triplets.push_back(Triplet<double>(n + i, n + i, -1.0 / rho_vec(i)));
+  if (!pattern_analyzed || KKT.rows() != n + m || !setValuesFromTriplets(KKT, KKT_triplets)) {
+    KKT.resize(n + m, n + m);
+    KKT.setFromTriplets(KKT_triplets.begin(), KKT_triplets.end());
+    analyzePattern();
+  }
+
+  const double* values = KKT.valuePtr();
+  double* permuted_values = KKT_permuted.valuePtr();
+  for (int k = 0; k < KKT.nonZeros(); k++)
+    permuted_values[KKT_permuted_index[k]] = values[k];
+  ldlt.factorizePermuted(KKT_permuted);
+  return ldlt.info() == Success;
+}
+
+int SparseQP::solve(const SparseMatrix<double>& P, const VectorXd& q, const SparseMatrix<double>& A, const VectorXd& lA, const VectorXd& uA, const VectorXd& lb, const VectorXd& ub, VectorXd& x)
+{
+  int N = static_cast<int>(q.size());
+  int M_A = static_cast<int>(A.rows());
+  if (P.rows() != N || P.cols() != N || A.cols() != N || lA.size() != M_A || uA.size() != M_A || lb.size() != N || ub.size() != N) {
+    return 2;
+  }
+
+  // warm start from the previous solve if the dimensions did not change
+  if (N != n || N + M_A != m) {
+    n = N;
+    m = N + M_A;
+    rho = settings.rho;
+    x_iter = VectorXd::Zero(n);
+    z = VectorXd::Zero(m);
+    y = VectorXd::Zero(m);
+    rho_vec.resize(m);
+    pattern_analyzed = false;
+  }
+
+  l.resize(m);
+  u.resize(m);
+  l << lA, lb;
+  u << uA, ub;
+  updateRhoVector();
+
+  // A_all = [A; I]
+  A_all.resize(m, n);
+  A_all.reserve(A.nonZeros() + n);
+  for (int j = 0; j < n; j++) {
+    A_all.startVec(j);
+    for (SparseMatrix<double>::InnerIterator it(A, j); it; ++it)
+      A_all.insertBack(it.row(), j) = it.value();
+    A_all.insertBack(M_A + j, j) = 1.0;
+  }
+  A_all.finalize();
+
+  if (!factor(P)) {
+    return -2;
+  }
+
+  rhs.resize(n + m);
+  double alpha = settings.alpha;
+  for (int iter = 1; iter <= settings.max_iter; iter++) {
+    rhs.head(n) = settings.sigma * x_iter - q;
+    rhs.tail(m) = z - y.cwiseQuotient(rho_vec);
+    rhs_permuted = KKT_P * rhs;
+    sol_permuted = ldlt.solve(rhs_permuted);
+    sol = KKT_Pinv * sol_permuted;
+    x_tilde = sol.head(n);
+    z_tilde = z + (sol.tail(m) - y).cwiseQuotient(rho_vec);
+
+    x_iter = alpha * x_tilde + (1.0 - alpha) * x_iter;
+    z_relaxed = alpha * z_tilde + (1.0 - alpha) * z;
+    z = (z_relaxed + y.cwiseQuotient(rho_vec)).cwiseMax(l).cwiseMin(u);
+    y += rho_vec.cwiseProduct(z_relaxed - z);
+
+    if (iter % settings.check_interval != 0 && iter != settings.max_iter)
+      continue;
+
+    Ax.noalias() = A_all * x_iter;
+    Px.noalias() = P.selfadjointView<Lower>() * x_iter;
+    Aty.noalias() = A_all.transpose() * y;
+    double prim_res = (Ax - z).lpNorm<Infinity>();
+    double dual_res = (Px + q + Aty).lpNorm<Infinity>();
+    double prim_scale = max(Ax.lpNorm<Infinity>(), z.lpNorm<Infinity>());
+    double dual_scale = max(max(Px.lpNorm<Infinity>(), Aty.lpNorm<Infinity>()), q.lpNorm<Infinity>());
+    if (prim_res <= settings.eps_abs + settings.eps_rel * prim_scale && dual_res <= settings.eps_abs + settings.eps_rel * dual_scale) {
+      x = x_iter;
+      return iter;
+    }
+
+    // balance the primal and dual residuals
+    double ratio = sqrt((prim_res / (prim_scale + SPARSEQP_DIVISION_TOLERANCE)) / (dual_res / (dual_scale + SPARSEQP_DIVISION_TOLERANCE) + SPARSEQP_DIVISION_TOLERANCE));
+    double rho_new = min(max(rho * ratio, SPARSEQP_RHO_MIN), SPARSEQP_RHO_MAX);
+    if (rho_new > SPARSEQP_RHO_ADAPT_RATIO * rho || rho_new < rho / SPARSEQP_RHO_ADAPT_RATIO) {
+      rho = rho_new;
+      updateRhoVector();
+      if (!factor(P)) {
+        return -2;
+      }
+    }
+  }
+
+  x = x_iter;
+  return -1;
+}
@@ -0,0 +1,89 @@
+#ifndef __SPARSE_QP__
+#define __SPARSE_QP__
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <vector>
+
+// SparseQP::PermutedLDLT calls SimplicialLDLT::factorize_preordered, an Eigen internal that exists from 3.1 to 3.4
+#if EIGEN_WORLD_VERSION != 3 || EIGEN_MAJOR_VERSION < 1 || EIGEN_MAJOR_VERSION > 4
+#error "SparseQP uses SimplicialLDLT::factorize_preordered, an Eigen internal only known to exist in Eigen 3.1 to 3.4; check that this Eigen version still has it before extending the range in sparseQP.h"
+#endif
+
+struct SparseQPSettings
+{
+  double rho = 0.1; // initial ADMM step size
+  double sigma = 1e-6; // regularization of the x update
+  double alpha = 1.6; // over-relaxation
+  double eps_abs = 1e-6;
+  double eps_rel = 1e-6;
+  int max_iter = 4000;
+  int check_interval = 10; // iterations between convergence checks and step size updates
+};
+
+/*
+ * Operator splitting (ADMM) solver for sparse convex QPs of the form
+ *   min 1/2 x'*P*x + q'*x  s.t.  lA <= A*x <= uA,  lb <= x <= ub
+ * following the OSQP iterations. Only the lower triangle of P is used. Equality constraints have lA == uA, and
+ * infinite entries of lA and uA are allowed. The bounds on x are kept separate from A and enter the quasi-definite
+ * KKT system as identity rows.
+ *
+ * The KKT matrix is refactored on every solve, but its fill reducing ordering and symbolic analysis are reused as long
+ * as the sparsity pattern of the problem does not change, and then a solve doesn't touch the heap. The primal and dual
+ * iterates (and the step size) of the previous solve are used as the warm start for the next one if the problem
+ * dimensions match.
+ *
+ * Returns the number of iterations on success, -1 if the iteration limit was reached, -2 on a factorization failure and
+ * 2 on a size mismatch.
+ */
+class SparseQP
+{
+public:
+  SparseQP();
+
+  int solve(const Eigen::SparseMatrix<double>& P, const Eigen::VectorXd& q, const Eigen::SparseMatrix<double>& A, const Eigen::VectorXd& lA, const Eigen::VectorXd& uA, const Eigen::VectorXd& lb, const Eigen::VectorXd& ub, Eigen::VectorXd& x);
+
+  SparseQPSettings settings;
+
+private:
+  /*
+   * SimplicialLDLT for a matrix that is already in its fill reducing order, factored where it is. This keeps a solve off
+   * the heap: SimplicialLDLT::factorize builds a new permuted copy of its argument on every call (from Eigen 3.3 on,
+   * it skips the copy for an upper triangle with the natural ordering, but still allocates the empty temporary). The
+   * protected factorize_preordered that does the actual work isn't part of the Eigen API, so the Eigen versions it is
+   * known to exist in are checked above.
+   */
+  class PermutedLDLT : public Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>, Eigen::Upper, Eigen::NaturalOrdering<int> >
+  {
+  public:
+    void factorizePermuted(const Eigen::SparseMatrix<double>& a) { factorize_preordered<true>(a); }
+  };
+
+  bool factor(const Eigen::SparseMatrix<double>& P);
+  void analyzePattern();
+  void updateRhoVector();
+
+  int n, m; // number of variables, number of constraints including the bounds
+  double rho;
+  Eigen::VectorXd l, u;
+  Eigen::VectorXd rho_vec;
+  Eigen::VectorXd x_iter, z, y;
+  Eigen::VectorXd rhs, sol, rhs_permuted, sol_permuted, x_tilde, z_tilde, z_relaxed, Ax, Px, Aty;
+  Eigen::SparseMatrix<double> A_all; // [A; I]
+  Eigen::SparseMatrix<double> KKT; // lower triangle
+  std::vector< Eigen::Triplet<double> > KKT_triplets;
+  Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> KKT_P, KKT_Pinv; // fill reducing ordering of KKT
+  Eigen::SparseMatrix<double> KKT_permuted; // upper triangle of KKT_P * KKT * KKT_P'
+  std::vector<int> KKT_permuted_index; // where each stored entry of KKT goes in KKT_permuted
+  PermutedLDLT ldlt;
+  bool pattern_analyzed;
+};
+
+/*
+ * Overwrites the values of the compressed matrix M with the sums of the triplets, like M.setFromTriplets, as long as
+ * every triplet falls on an entry that M already stores. Stored entries without a triplet become explicit zeros, so the
+ * sparsity pattern of M stays as it is and, unlike setFromTriplets, this doesn't touch the heap. Returns false and
+ * leaves M unchanged if a triplet is outside the pattern.
+ */
+bool setValuesFromTriplets(Eigen::SparseMatrix<double>& M, const std::vector< Eigen::Triplet<double> >& triplets);
+
+#endif
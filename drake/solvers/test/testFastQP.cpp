@@ -0,0 +1,95 @@
+#include "fastQP.h"
+#include "testUtil.h"
+#include <iostream>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Solves a sequence of random QPs of the same shape with one FastQP instance (warm starting each solve from the
+ * previous active set) and checks that it finds the same solutions and active sets as fastQP.
+ */
+int main()
+{
+  int N_dense = 20;
+  int N_diag = 10;
+  int N = N_dense + N_diag;
+  int M = 3;
+  int M_general = 15;
+
+  MatrixXd Q_dense = MatrixXd::Random(N_dense, N_dense);
+  Q_dense = Q_dense * Q_dense.transpose() + MatrixXd::Identity(N_dense, N_dense);
+  MatrixXd Q_diag = VectorXd::Random(N_diag).array().abs() + 0.1;
+  vector<MatrixXd*> QblkDiag {&Q_dense, &Q_diag};
+
+  MatrixXd Aeq = MatrixXd::Random(M, N);
+  VectorXd beq = VectorXd::Random(M);
+  MatrixXd Ain(M_general + 2 * N, N);
+  Ain << MatrixXd::Random(M_general, N), -MatrixXd::Identity(N, N), MatrixXd::Identity(N, N);
+
+  FastQP fastqp;
+  set<int> active, active_expected;
+  int num_problems = 50;
+  int num_nonempty_active = 0;
+  for (int i = 0; i < num_problems; i++) {
+    // slowly varying problem data, like consecutive controller ticks
+    VectorXd f = 2 * VectorXd::Random(N);
+    VectorXd bin(M_general + 2 * N);
+    bin << VectorXd::Random(M_general).array() + 1.0, VectorXd::Constant(N, 1.0), VectorXd::Constant(N, 1.0);
+
+    VectorXd x(N), x_expected(N);
+    int info = fastqp.solve(QblkDiag, f, Aeq, beq, Ain, bin, active, x);
+    int info_expected = fastQP(QblkDiag, f, Aeq, beq, Ain, bin, active_expected, x_expected);
+    if ((info < 0) != (info_expected < 0)) {
+      cerr << "problem " << i << ": FastQP returned " << info << ", fastQP returned " << info_expected << endl;
+      return 1;
+    }
+    if (info < 0) {
+      active.clear();
+      active_expected.clear();
+      continue;
+    }
+    valuecheckMatrix(x_expected, x, 1e-8);
+    if (active != active_expected) {
+      cerr << "problem " << i << ": active sets differ" << endl;
+      return 1;
+    }
+    num_nonempty_active += active.empty() ? 0 : 1;
+  }
+  if (num_nonempty_active == 0) {
+    cerr << "no inequality constraints were active in any of the problems" << endl;
+    return 1;
+  }
+
+  // a warm start with linearly dependent constraints (the third row is the sum of the first two, the fourth the
+  // negated first) makes the solver drop violated constraints with negative multipliers, which fastQP keeps in the
+  // active set. Both have to take the same iterations to the same solution
+  MatrixXd Q_small(3, 1);
+  Q_small << 1.2242521362957788, 0.61694615013755216, 0.55212389819888585;
+  vector<MatrixXd*> QblkDiag_small {&Q_small};
+  Vector3d f_small(-1.3943320114139151, 1.4256684297815281, -2.3389009848883844);
+  Matrix<double, 2, 3> G;
+  G << 0.42846598263292845, -0.72263289695728239, -0.62609867082261417,
+      0.5993559805673343, 0.63333483768316667, 0.82052310734080303;
+  MatrixXd Ain_small(4, 3);
+  Ain_small << G, G.row(0) + G.row(1), -G.row(0);
+  Vector4d bin_small(0.37901707895985659, -0.011365727061110387, -0.18317169099262531, 0.059836019324062351);
+  MatrixXd Aeq_small(0, 3);
+  VectorXd beq_small(0);
+  set<int> active_small {0, 1, 2, 3}, active_small_expected = active_small;
+  VectorXd x_small(3), x_small_expected(3);
+  FastQP fastqp_small;
+  int info_small = fastqp_small.solve(QblkDiag_small, f_small, Aeq_small, beq_small, Ain_small, bin_small, active_small, x_small);
+  int info_small_expected = fastQP(QblkDiag_small, f_small, Aeq_small, beq_small, Ain_small, bin_small, active_small_expected, x_small_expected);
+  if (info_small < 0 || info_small != info_small_expected) {
+    cerr << "dependent constraints: FastQP returned " << info_small << ", fastQP returned " << info_small_expected << endl;
+    return 1;
+  }
+  valuecheckMatrix(x_small_expected, x_small, 1e-8);
+  if (active_small != active_small_expected) {
+    cerr << "dependent constraints: active sets differ" << endl;
+    return 1;
+  }
+
+  return 0;
+}
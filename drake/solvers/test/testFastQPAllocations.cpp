@@ -0,0 +1,83 @@
+#include "fastQP.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Checks that once a FastQP instance has seen a problem, solving problems of the same shape with the same active set
+ * (the steady state of a controller) doesn't touch the heap. Eigen's allocations are caught with
+ * EIGEN_RUNTIME_NO_MALLOC (see CMakeLists.txt), everything else by counting calls to operator new.
+ */
+
+static bool count_allocations = false;
+static int num_allocations = 0;
+
+void* operator new(size_t size)
+{
+  if (count_allocations)
+    num_allocations++;
+  void* ptr = malloc(size);
+  if (!ptr)
+    throw bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+int main()
+{
+  int N_dense = 20;
+  int N_diag = 10;
+  int N = N_dense + N_diag;
+  int M = 3;
+  int M_general = 15;
+
+  MatrixXd Q_dense = MatrixXd::Random(N_dense, N_dense);
+  Q_dense = Q_dense * Q_dense.transpose() + MatrixXd::Identity(N_dense, N_dense);
+  MatrixXd Q_diag = VectorXd::Random(N_diag).array().abs() + 0.1;
+  vector<MatrixXd*> QblkDiag {&Q_dense, &Q_diag};
+
+  MatrixXd Aeq = MatrixXd::Random(M, N);
+  VectorXd beq = VectorXd::Random(M);
+  MatrixXd Ain(M_general + 2 * N, N);
+  Ain << MatrixXd::Random(M_general, N), -MatrixXd::Identity(N, N), MatrixXd::Identity(N, N);
+  VectorXd bin(M_general + 2 * N);
+  bin << VectorXd::Random(M_general).array() + 1.0, VectorXd::Constant(2 * N, 1.0);
+  VectorXd f = 2 * VectorXd::Random(N);
+  VectorXd x(N);
+
+  FastQP fastqp;
+  set<int> active;
+  int info = fastqp.solve(QblkDiag, f, Aeq, beq, Ain, bin, active, x);
+  if (info < 0) {
+    cerr << "FastQP returned " << info << endl;
+    return 1;
+  }
+
+  // slightly perturbed problems keep the active set
+  int num_steady_state_solves = 10;
+  for (int i = 0; i < num_steady_state_solves; i++) {
+    f(0) += 1e-6;
+    internal::set_is_malloc_allowed(false);
+    count_allocations = true;
+    info = fastqp.solve(QblkDiag, f, Aeq, beq, Ain, bin, active, x);
+    count_allocations = false;
+    internal::set_is_malloc_allowed(true);
+    if (info < 0) {
+      cerr << "FastQP returned " << info << endl;
+      return 1;
+    }
+  }
+  if (num_allocations > 0) {
+    cerr << num_allocations << " heap allocations in " << num_steady_state_solves << " steady state solves" << endl;
+    return 1;
+  }
+
+  return 0;
+}
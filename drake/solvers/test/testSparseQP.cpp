@@ -0,0 +1,92 @@
+#include "fastQP.h"
+#include "sparseQP.h"
+#include "testUtil.h"
+#include <iostream>
+#include <limits>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Solves a sequence of slowly varying random QPs of the same shape with one SparseQP instance (warm starting each solve
+ * from the previous one) and checks that it finds the same solutions as fastQP, which gets the bounds as dense
+ * inequality rows, and that the warm starts take fewer iterations than the first solve.
+ */
+int main()
+{
+  int N_dense = 20;
+  int N_diag = 10;
+  int N = N_dense + N_diag;
+  int M = 3;
+  int M_general = 15;
+
+  MatrixXd Q_dense = MatrixXd::Random(N_dense, N_dense);
+  Q_dense = Q_dense * Q_dense.transpose() + MatrixXd::Identity(N_dense, N_dense);
+  MatrixXd Q_diag = VectorXd::Random(N_diag).array().abs() + 0.1;
+  vector<MatrixXd*> QblkDiag {&Q_dense, &Q_diag};
+
+  MatrixXd Q = MatrixXd::Zero(N, N);
+  Q.topLeftCorner(N_dense, N_dense) = Q_dense;
+  Q.bottomRightCorner(N_diag, N_diag) = Q_diag.col(0).asDiagonal();
+  SparseMatrix<double> P = Q.triangularView<Lower>().toDenseMatrix().sparseView();
+
+  MatrixXd Aeq = MatrixXd::Random(M, N);
+  VectorXd beq = VectorXd::Random(M);
+  MatrixXd Ain_general = MatrixXd::Random(M_general, N);
+  MatrixXd Ain(M_general + 2 * N, N);
+  Ain << Ain_general, -MatrixXd::Identity(N, N), MatrixXd::Identity(N, N);
+  MatrixXd A(M + M_general, N);
+  A << Aeq, Ain_general;
+  SparseMatrix<double> A_sparse = A.sparseView();
+
+  SparseQP sparseqp;
+  set<int> active_expected;
+  VectorXd f = 2 * VectorXd::Random(N);
+  VectorXd bin_general = VectorXd::Random(M_general).array() + 1.0;
+  int num_problems = 50;
+  int first_num_iterations = 0;
+  int warm_num_iterations = 0;
+  int num_warm_solves = 0;
+  for (int i = 0; i < num_problems; i++) {
+    // slowly varying problem data, like consecutive controller ticks
+    if (i > 0) {
+      f += 0.01 * VectorXd::Random(N);
+      bin_general += 0.01 * VectorXd::Random(M_general);
+    }
+    VectorXd bin(M_general + 2 * N);
+    bin << bin_general, VectorXd::Constant(N, 1.0), VectorXd::Constant(N, 1.0);
+
+    VectorXd x_expected(N);
+    int info_expected = fastQP(QblkDiag, f, Aeq, beq, Ain, bin, active_expected, x_expected);
+    if (info_expected < 0) {
+      cerr << "problem " << i << ": fastQP returned " << info_expected << endl;
+      return 1;
+    }
+
+    VectorXd lA(M + M_general), uA(M + M_general);
+    lA << beq, VectorXd::Constant(M_general, -numeric_limits<double>::infinity());
+    uA << beq, bin_general;
+    VectorXd x(N);
+    int info = sparseqp.solve(P, f, A_sparse, lA, uA, VectorXd::Constant(N, -1.0), VectorXd::Constant(N, 1.0), x);
+    if (info < 0) {
+      cerr << "problem " << i << ": SparseQP returned " << info << endl;
+      return 1;
+    }
+    valuecheckMatrix(x_expected, x, 1e-4);
+    if (i == 0) {
+      first_num_iterations = info;
+    } else {
+      warm_num_iterations += info;
+      num_warm_solves++;
+    }
+  }
+
+  // warm starting from the previous solution should pay off on nearby problems
+  double mean_warm_num_iterations = static_cast<double>(warm_num_iterations) / num_warm_solves;
+  if (mean_warm_num_iterations >= first_num_iterations) {
+    cerr << "warm started solves take " << mean_warm_num_iterations << " iterations on average, the first (cold) solve took " << first_num_iterations << endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -3,62 +3,551 @@
 
 #include <thread>
 #include <chrono>
+#include <iostream>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <limits>
+#include <Eigen/Dense>
+#include "drakeGradientUtil.h"
 
 namespace Drake {
 
+  // numerical integration schemes for simulate
+  enum IntegratorType {
+    EULER,                // explicit Euler with a fixed step
+    SEMI_IMPLICIT_EULER,  // symplectic Euler with a fixed step, for second-order systems with state [q; v] (q and v of equal size)
+    RK4,                  // classical fourth-order Runge-Kutta with a fixed step
+    RK45,                 // Dormand-Prince 5(4) with error control, initial_step_size is only the first trial step
+    BACKWARD_EULER,       // implicit Euler with a fixed step, for stiff systems
+    BDF2                  // second-order backward differentiation formula with a fixed step, for stiff systems
+  };
+
+  // what simulate does when it falls behind the real-time factor by more than max_realtime_lag
+  enum RealtimeOverrunPolicy {
+    OVERRUN_THROW,         // throw a runtime_error
+    OVERRUN_SLOW_DOWN,     // drop the lag and continue in real time from there, i.e. the simulation ends late
+    OVERRUN_SKIP_OUTPUTS,  // catch up by simulating without calling output (e.g. without drawing) until back on time
+    OVERRUN_LOG            // report the lag on std::cerr and catch up, with outputs
+  };
+
   // simulation options
   struct SimulationOptions {
     double realtime_factor;  // 1 means try to run at realtime speed, < 0 is run as fast as possible
+    RealtimeOverrunPolicy realtime_overrun_policy;
+    double max_realtime_lag;  // (scaled) s
+    double output_period;  // simulation time between calls to output (e.g. visualizer publishes), <= 0 means at every step
+    bool skip_outputs;  // never call output, e.g. for batch runs that aren't drawn
     double initial_step_size;
+    IntegratorType integrator;
+    // error control (RK45), and convergence test of the Newton iteration (BACKWARD_EULER, BDF2)
+    double relative_tolerance;
+    double absolute_tolerance;
+    double min_step_size;  // steps are accepted at this size even if they don't meet the tolerances
+    double max_step_size;
+    int max_newton_iterations;  // per Jacobian, see solveImplicitStep
+    double zero_crossing_time_tolerance;  // s, accuracy to which the time of a zero crossing is located
 
     SimulationOptions() :
             realtime_factor(-1.0),
-            initial_step_size(0.01)
+            realtime_overrun_policy(OVERRUN_THROW),
+            max_realtime_lag(1.0),
+            output_period(0.0),
+            skip_outputs(false),
+            initial_step_size(0.01),
+            integrator(EULER),
+            relative_tolerance(1e-6),
+            absolute_tolerance(1e-8),
+            min_step_size(1e-8),
+            max_step_size(0.1),
+            max_newton_iterations(10),
+            zero_crossing_time_tolerance(1e-10)
     {};
   };
   const static SimulationOptions default_simulation_options;
 
-  typedef std::chrono::system_clock TimeClock;  // would love to use steady_clock, but it seems to not compile on all platforms (e.g. MSVC 2013 Win64)
+  typedef std::chrono::steady_clock TimeClock;  // monotonic, so that the real-time loop is immune to wall clock adjustments
   typedef std::chrono::duration<double> TimeDuration;
   typedef std::chrono::time_point<TimeClock,TimeDuration> TimePoint;
 
+  // timing of a simulate call
+  struct SimulationStats {
+    long num_steps;
+    long num_outputs;
+    long num_overrun_steps;  // steps started behind the real-time factor by more than max_realtime_lag
+    bool overrunning;  // whether the last step was one of those
+    double max_realtime_lag;  // (scaled) s, largest lag behind the real-time factor
+    // histogram of the wall clock time taken per step (excluding real-time sleeps): step_time_histogram[i] counts the
+    // steps that took less than step_time_bin_edges[i] (and at least step_time_bin_edges[i-1]); the last bin counts all
+    // the steps that took longer than the last edge
+    std::vector<double> step_time_bin_edges;  // s
+    std::vector<long> step_time_histogram;
+
+    SimulationStats() :
+            num_steps(0),
+            num_outputs(0),
+            num_overrun_steps(0),
+            overrunning(false),
+            max_realtime_lag(0.0),
+            step_time_bin_edges({1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1}),
+            step_time_histogram(step_time_bin_edges.size()+1, 0)
+    {};
+
+    void addStep(double step_time) {
+      num_steps++;
+      size_t bin = std::upper_bound(step_time_bin_edges.begin(),step_time_bin_edges.end(),step_time) - step_time_bin_edges.begin();
+      step_time_histogram[bin]++;
+    }
+  };
+
+  /// Sleeps until the wall clock catches up with sim_time (scaled by the real-time factor), and applies the overrun
+  /// policy if it is behind by more than max_realtime_lag instead.  OVERRUN_SLOW_DOWN moves wall_clock_start_time.
+  /// Returns false if the outputs should be skipped.
+  inline bool handle_realtime_factor(TimePoint& wall_clock_start_time, double sim_time, const SimulationOptions& options, SimulationStats& stats)
+  {
+    if (options.realtime_factor<=0.0)
+      return true;
+    TimePoint wall_time = TimeClock::now();
+    TimePoint desired_time = wall_clock_start_time + TimeDuration(sim_time/options.realtime_factor);
+    if (desired_time>wall_time) { // could probably just call sleep_until, but just in case
+      std::this_thread::sleep_until(desired_time);
+      stats.overrunning = false;
+      return true;
+    }
+
+    double lag = (wall_time - desired_time).count() * options.realtime_factor;
+    stats.max_realtime_lag = (std::max)(stats.max_realtime_lag,lag);
+    if (lag <= options.max_realtime_lag) {
+      stats.overrunning = false;
+      return true;
+    }
+    bool new_overrun = !stats.overrunning;
+    stats.overrunning = true;
+    stats.num_overrun_steps++;
+    switch (options.realtime_overrun_policy) {
+      case OVERRUN_SLOW_DOWN:
+        wall_clock_start_time += TimeDuration(lag/options.realtime_factor);
+        return true;
+      case OVERRUN_SKIP_OUTPUTS:
+        return false;
+      case OVERRUN_LOG:
+        if (new_overrun)
+          std::cerr << "Simulation is not keeping up with desired real-time factor -- behind by " << lag << " (scaled) seconds at simulation time " << sim_time << std::endl;
+        return true;
+      default:
+        throw std::runtime_error("Simulation is not keeping up with desired real-time factor -- behind by more than " + std::to_string(options.max_realtime_lag) + " (scaled) second(s) at simulation time " + std::to_string(sim_time));
+    }
+  }
+
   inline void handle_realtime_factor(const TimePoint& wall_clock_start_time, double sim_time, double realtime_factor)
   {
-    if (realtime_factor>0.0) {
-      TimePoint wall_time = TimeClock::now();
-      TimePoint desired_time = wall_clock_start_time + TimeDuration(sim_time/realtime_factor);
-      if (desired_time>wall_time) { // could probably just call sleep_until, but just in case
-        std::this_thread::sleep_until(desired_time);
-      } else if (wall_time>desired_time+TimeDuration(1.0/realtime_factor)) {
-        throw std::runtime_error("Simulation is not keeping up with desired real-time factor -- behind by more than 1 (scaled) second at simulation time " + std::to_string(sim_time));
+    SimulationOptions options;
+    options.realtime_factor = realtime_factor;
+    SimulationStats stats;
+    TimePoint start = wall_clock_start_time;
+    handle_realtime_factor(start,sim_time,options,stats);
+  }
+
+  // the integrator steps below work on Eigen vectors, and convert to and from the system's own vector types on every dynamics evaluation
+  template <typename System>
+  inline void evaluateDynamics(const System& sys, double t, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, Eigen::Matrix<double,System::num_states,1>& xdot) {
+    xdot = sys.template dynamics<double>(t,x,u);
+  }
+
+  template <typename System>
+  void eulerStep(const System& sys, double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, Eigen::Matrix<double,System::num_states,1>& x_next) {
+    Eigen::Matrix<double,System::num_states,1> xdot;
+    evaluateDynamics(sys,t,x,u,xdot);
+    x_next = x + h * xdot;
+  }
+
+  // v is advanced first, and q is then advanced with the rates the dynamics give for the new v
+  template <typename System>
+  void semiImplicitEulerStep(const System& sys, double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, Eigen::Matrix<double,System::num_states,1>& x_next) {
+    const int n = static_cast<int>(x.size()) / 2;
+    Eigen::Matrix<double,System::num_states,1> xdot;
+    evaluateDynamics(sys,t,x,u,xdot);
+    x_next = x;
+    x_next.tail(n) += h * xdot.tail(n);
+    evaluateDynamics(sys,t,x_next,u,xdot);
+    x_next.head(n) += h * xdot.head(n);
+  }
+
+  template <typename System>
+  void rk4Step(const System& sys, double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, Eigen::Matrix<double,System::num_states,1>& x_next) {
+    Eigen::Matrix<double,System::num_states,1> k1, k2, k3, k4, x_stage;
+    evaluateDynamics(sys,t,x,u,k1);
+    x_stage = x + (h/2) * k1;
+    evaluateDynamics(sys,t+h/2,x_stage,u,k2);
+    x_stage = x + (h/2) * k2;
+    evaluateDynamics(sys,t+h/2,x_stage,u,k3);
+    x_stage = x + h * k3;
+    evaluateDynamics(sys,t+h,x_stage,u,k4);
+    x_next = x + (h/6) * (k1 + 2*k2 + 2*k3 + k4);
+  }
+
+  // stage derivatives of a Dormand-Prince step.  k[0] must hold xdot at the start of the step; after the step, k[6] holds
+  // xdot at its end, which is k[0] of the next step if this one is accepted (first same as last)
+  template <typename System>
+  struct DormandPrinceStages {
+    Eigen::Matrix<double,System::num_states,1> k[7];
+  };
+
+  /// Takes a Dormand-Prince 5(4) step and returns its error estimate relative to the tolerances in options, i.e. the
+  /// step should be accepted if the return value is <= 1
+  template <typename System>
+  double dormandPrinceStep(const System& sys, double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, DormandPrinceStages<System>& stages, Eigen::Matrix<double,System::num_states,1>& x_next, const SimulationOptions& options) {
+    auto& k = stages.k;
+    Eigen::Matrix<double,System::num_states,1> x_stage;
+    x_stage = x + h * (1.0/5.0 * k[0]);
+    evaluateDynamics(sys,t+h/5.0,x_stage,u,k[1]);
+    x_stage = x + h * (3.0/40.0 * k[0] + 9.0/40.0 * k[1]);
+    evaluateDynamics(sys,t+3.0*h/10.0,x_stage,u,k[2]);
+    x_stage = x + h * (44.0/45.0 * k[0] - 56.0/15.0 * k[1] + 32.0/9.0 * k[2]);
+    evaluateDynamics(sys,t+4.0*h/5.0,x_stage,u,k[3]);
+    x_stage = x + h * (19372.0/6561.0 * k[0] - 25360.0/2187.0 * k[1] + 64448.0/6561.0 * k[2] - 212.0/729.0 * k[3]);
+    evaluateDynamics(sys,t+8.0*h/9.0,x_stage,u,k[4]);
+    x_stage = x + h * (9017.0/3168.0 * k[0] - 355.0/33.0 * k[1] + 46732.0/5247.0 * k[2] + 49.0/176.0 * k[3] - 5103.0/18656.0 * k[4]);
+    evaluateDynamics(sys,t+h,x_stage,u,k[5]);
+    x_next = x + h * (35.0/384.0 * k[0] + 500.0/1113.0 * k[2] + 125.0/192.0 * k[3] - 2187.0/6784.0 * k[4] + 11.0/84.0 * k[5]);
+    evaluateDynamics(sys,t+h,x_next,u,k[6]);
+
+    // difference between the fifth and the embedded fourth order solutions
+    Eigen::Matrix<double,System::num_states,1> error = h * (71.0/57600.0 * k[0] - 71.0/16695.0 * k[2] + 71.0/1920.0 * k[3] - 17253.0/339200.0 * k[4] + 22.0/525.0 * k[5] - 1.0/40.0 * k[6]);
+    double err = 0.0;
+    for (int i = 0; i < x.size(); i++) {
+      double scale = options.absolute_tolerance + options.relative_tolerance * (std::max)(std::abs(x(i)), std::abs(x_next(i)));
+      err = (std::max)(err, std::abs(error(i)) / scale);
+    }
+    return err;
+  }
+
+  template <typename System>
+  void evaluateDynamicsJacobian(const System& sys, double t, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, Eigen::Matrix<double,System::num_states,System::num_states>& dfdx) {
+    typedef TaylorVarX AutoDiffType;
+    const int num_states = System::num_states;
+    const int num_inputs = System::num_inputs;
+    Eigen::Matrix<AutoDiffType,num_states,1> x_taylor = initTaylorVecX(x);
+    Eigen::Matrix<AutoDiffType,num_inputs,1> u_taylor = u.template cast<AutoDiffType>();
+    typename System::template StateVectorType<AutoDiffType> x_vec(x_taylor);
+    typename System::template InputVectorType<AutoDiffType> u_vec(u_taylor);
+    AutoDiffType t_taylor(t);
+
+    auto xdot = static_cast< Eigen::Matrix<AutoDiffType,num_states,1> >(sys.template dynamics<AutoDiffType>(t_taylor,x_vec,u_vec));
+    dfdx = autoDiffToGradientMatrix(xdot,num_states);
+  }
+
+  // Newton iteration state of the implicit integrators.  The Jacobian and the factorization of the iteration matrix
+  // I - gamma*h*df/dx are kept across steps, and only recomputed when the iteration stops converging or gamma*h changes
+  template <typename System>
+  struct ImplicitIntegratorWorkspace {
+    Eigen::Matrix<double,System::num_states,System::num_states> dfdx;
+    Eigen::PartialPivLU< Eigen::Matrix<double,System::num_states,System::num_states> > iteration_matrix;
+    bool have_jacobian = false;
+    double factored_gamma_h = -1.0;  // gamma*h of the current factorization, < 0 if there is none
+    // previous step, for BDF2
+    Eigen::Matrix<double,System::num_states,1> x_previous;
+    double h_previous = -1.0;  // < 0 if there is no previous step
+  };
+
+  /// Solves x_next = c + gamma_h*f(t_next,x_next) by simplified Newton iterations, starting from the guess in x_next.
+  /// The Jacobian is reused from earlier steps when possible; if the iteration doesn't converge within
+  /// options.max_newton_iterations with an old Jacobian, it is restarted with a fresh one.  Returns false if it doesn't
+  /// converge with a fresh Jacobian either.
+  template <typename System>
+  bool solveImplicitStep(const System& sys, double t_next, double gamma_h, const Eigen::Matrix<double,System::num_states,1>& c, const Eigen::Matrix<double,System::num_inputs,1>& u, ImplicitIntegratorWorkspace<System>& workspace, Eigen::Matrix<double,System::num_states,1>& x_next, const SimulationOptions& options) {
+    const int num_states = System::num_states;
+    Eigen::Matrix<double,num_states,1> x_guess = x_next, xdot, residual, delta;
+    bool fresh_jacobian = false;
+    while (true) {
+      if (!workspace.have_jacobian) {
+        evaluateDynamicsJacobian(sys,t_next,x_next,u,workspace.dfdx);
+        workspace.have_jacobian = true;
+        workspace.factored_gamma_h = -1.0;
+        fresh_jacobian = true;
+      }
+      if (workspace.factored_gamma_h != gamma_h) {
+        workspace.iteration_matrix.compute(Eigen::Matrix<double,num_states,num_states>::Identity() - gamma_h * workspace.dfdx);
+        workspace.factored_gamma_h = gamma_h;
+      }
+
+      double previous_err = std::numeric_limits<double>::infinity();
+      for (int i = 0; i < options.max_newton_iterations; i++) {
+        evaluateDynamics(sys,t_next,x_next,u,xdot);
+        residual = x_next - c - gamma_h * xdot;
+        delta = workspace.iteration_matrix.solve(-residual);
+        x_next += delta;
+
+        double err = 0.0;
+        for (int j = 0; j < x_next.size(); j++)
+          err = (std::max)(err, std::abs(delta(j)) / (options.absolute_tolerance + options.relative_tolerance * std::abs(x_next(j))));
+        if (err <= 1.0)
+          return true;
+        if (!(err < previous_err))  // diverging (or nan)
+          break;
+        previous_err = err;
+      }
+
+      if (fresh_jacobian)
+        return false;
+      workspace.have_jacobian = false;
+      x_next = x_guess;
+    }
+  }
+
+  template <typename System>
+  void backwardEulerStep(const System& sys, double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, ImplicitIntegratorWorkspace<System>& workspace, Eigen::Matrix<double,System::num_states,1>& x_next, const SimulationOptions& options) {
+    x_next = x;
+    if (!solveImplicitStep(sys,t+h,h,x,u,workspace,x_next,options))
+      throw std::runtime_error("The Newton iteration of the implicit integrator did not converge at simulation time " + std::to_string(t));
+  }
+
+  // variable step BDF2, so that a step that is clipped at tf keeps the order.  The first step is a backward Euler step
+  template <typename System>
+  void bdf2Step(const System& sys, double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_inputs,1>& u, ImplicitIntegratorWorkspace<System>& workspace, Eigen::Matrix<double,System::num_states,1>& x_next, const SimulationOptions& options) {
+    if (workspace.h_previous < 0.0) {
+      backwardEulerStep(sys,t,h,x,u,workspace,x_next,options);
+    } else {
+      double omega = h / workspace.h_previous;
+      Eigen::Matrix<double,System::num_states,1> c = ((1+omega)*(1+omega) * x - omega*omega * workspace.x_previous) / (1+2*omega);
+      double gamma_h = h * (1+omega) / (1+2*omega);
+      x_next = x + omega * (x - workspace.x_previous);  // linear extrapolation as the initial guess
+      if (!solveImplicitStep(sys,t+h,gamma_h,c,u,workspace,x_next,options))
+        throw std::runtime_error("The Newton iteration of the implicit integrator did not converge at simulation time " + std::to_string(t));
+    }
+    workspace.x_previous = x;
+    workspace.h_previous = h;
+  }
+
+  // dense output within a step: cubic Hermite interpolation between the states and derivatives at both ends
+  template <typename System>
+  void interpolateStep(double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_states,1>& xdot, const Eigen::Matrix<double,System::num_states,1>& x_next, const Eigen::Matrix<double,System::num_states,1>& xdot_next, double t_interp, Eigen::Matrix<double,System::num_states,1>& x_interp) {
+    double s = (t_interp - t) / h;
+    double s2 = s*s, s3 = s2*s;
+    x_interp = (2*s3 - 3*s2 + 1) * x + ((s3 - 2*s2 + s) * h) * xdot + (3*s2 - 2*s3) * x_next + ((s3 - s2) * h) * xdot_next;
+  }
+
+  /// Locates the earliest of the zero crossings that are triggered in the step from (t,x) to (t+h,x_next), i.e. those
+  /// with zcs >= 0 and zcs_next < 0, by Illinois (modified regula falsi) iterations on the dense output of the step.
+  /// Returns the index of that zero crossing, and in t_event and x_event the time and state just before the crossing
+  /// (where it is still non-negative, so that it can be triggered again after the transition), at most
+  /// options.zero_crossing_time_tolerance before it.  Returns -1 if none is triggered.
+  template <typename System>
+  int locateZeroCrossing(const System& sys, double t, double h, const Eigen::Matrix<double,System::num_states,1>& x, const Eigen::Matrix<double,System::num_states,1>& x_next, const Eigen::Matrix<double,System::num_inputs,1>& u, const Eigen::VectorXd& zcs, const Eigen::VectorXd& zcs_next, double& t_event, Eigen::Matrix<double,System::num_states,1>& x_event, const SimulationOptions& options) {
+    Eigen::Matrix<double,System::num_states,1> xdot, xdot_next, x_interp;
+    bool have_derivatives = false;
+    int event_index = -1;
+    for (int i = 0; i < zcs.size(); i++) {
+      if (!(zcs(i) >= 0.0 && zcs_next(i) < 0.0))
+        continue;
+      if (!have_derivatives) {
+        evaluateDynamics(sys,t,x,u,xdot);
+        evaluateDynamics(sys,t+h,x_next,u,xdot_next);
+        have_derivatives = true;
+      }
+
+      double a = t, fa = zcs(i), b = t + h, fb = zcs_next(i);
+      int retained_side = 0;
+      for (int iter = 0; iter < 100 && b - a > options.zero_crossing_time_tolerance; iter++) {
+        double c = (a*fb - b*fa) / (fb - fa);
+        if (!(c > a && c < b))
+          c = (a + b) / 2;
+        interpolateStep<System>(t,h,x,xdot,x_next,xdot_next,c,x_interp);
+        double fc = sys.zeroCrossings(c,x_interp,u)(i);
+        if (fc < 0.0) {
+          b = c;  fb = fc;
+          if (retained_side == -1) fa /= 2;  // a was kept twice in a row
+          retained_side = -1;
+        } else {
+          a = c;  fa = fc;
+          if (retained_side == 1) fb /= 2;
+          retained_side = 1;
+        }
+      }
+
+      if (event_index < 0 || a < t_event) {
+        event_index = i;
+        t_event = a;
       }
     }
+    if (event_index >= 0)
+      interpolateStep<System>(t,h,x,xdot,x_next,xdot_next,t_event,x_event);
+    return event_index;
   }
 
+  /// simulates sys from x0 at t0 to tf (with zero input) and returns the final state.  The step timing and real-time
+  /// behavior are reported in stats
   template <typename Derived, template<typename> class StateVector, template<typename> class InputVector, template<typename> class OutputVector, bool isTimeVarying, bool isDirectFeedthrough>
-  void simulate(const System<Derived,StateVector,InputVector,OutputVector,isTimeVarying,isDirectFeedthrough>& sys, double t0, double tf, const Eigen::VectorXd& x0, const SimulationOptions& options) {
+  Eigen::Matrix<double,StateVector<double>::RowsAtCompileTime,1> simulate(const System<Derived,StateVector,InputVector,OutputVector,isTimeVarying,isDirectFeedthrough>& sys, double t0, double tf, const Eigen::VectorXd& x0, const SimulationOptions& options, SimulationStats& stats) {
+    typedef System<Derived,StateVector,InputVector,OutputVector,isTimeVarying,isDirectFeedthrough> SystemType;
     double t = t0, dt;
 //    std::cout << "x0 = " << x0.transpose() << std::endl;
     TimePoint start = TimeClock::now();
     Eigen::Matrix<double,StateVector<double>::RowsAtCompileTime,1> x = x0;
-    Eigen::Matrix<double,StateVector<double>::RowsAtCompileTime,1> xdot;
-    Eigen::Matrix<double,InputVector<double>::RowsAtCompileTime,1> u(sys.num_states); u.setConstant(0);
+    Eigen::Matrix<double,StateVector<double>::RowsAtCompileTime,1> x_next, x_event;
+    Eigen::Matrix<double,InputVector<double>::RowsAtCompileTime,1> u(sys.num_inputs); u.setConstant(0);
     Eigen::Matrix<double,OutputVector<double>::RowsAtCompileTime,1> y;
+
+    if (options.integrator==SEMI_IMPLICIT_EULER && x.size()%2!=0)
+      throw std::runtime_error("The semi-implicit Euler integrator needs a state of the form [q; v], but the state has an odd number of elements");
+
+    DormandPrinceStages<SystemType> stages;
+    ImplicitIntegratorWorkspace<SystemType> implicit_workspace;
+    double dt_next = (std::min)(options.initial_step_size,options.max_step_size);  // RK45 step size for the next step, before clipping at tf
+    bool have_xdot = false;
+
+    Eigen::VectorXd zcs = sys.zeroCrossings(t,x,u), zcs_next;
+    double next_output_time = t;
+
     while (t<tf) {
-      handle_realtime_factor(start, t, options.realtime_factor);
+      bool do_outputs = handle_realtime_factor(start, t, options, stats);
+      TimePoint step_start = TimeClock::now();
 
 //      std::cout << "t=" << t << ", x = " << x.transpose() << std::endl;
-      dt = (std::min)(options.initial_step_size,tf-t);
-      y = sys.template output<double>(t,x,u);
-      xdot = sys.template dynamics<double>(t,x,u);
-      x += dt * xdot;
-      t += dt;
+      if (do_outputs && !options.skip_outputs && t >= next_output_time) {
+        y = sys.template output<double>(t,x,u);
+        stats.num_outputs++;
+        if (options.output_period > 0.0) {
+          while (next_output_time <= t)
+            next_output_time += options.output_period;
+        }
+      }
+      switch (options.integrator) {
+        case EULER:
+          dt = (std::min)(options.initial_step_size,tf-t);
+          eulerStep(sys,t,dt,x,u,x_next);
+          break;
+        case SEMI_IMPLICIT_EULER:
+          dt = (std::min)(options.initial_step_size,tf-t);
+          semiImplicitEulerStep(sys,t,dt,x,u,x_next);
+          break;
+        case RK4:
+          dt = (std::min)(options.initial_step_size,tf-t);
+          rk4Step(sys,t,dt,x,u,x_next);
+          break;
+        case RK45:
+          if (!have_xdot)
+            evaluateDynamics(sys,t,x,u,stages.k[0]);
+          while (true) {
+            dt = (std::min)(dt_next,tf-t);
+            double err = dormandPrinceStep(sys,t,dt,x,u,stages,x_next,options);
+            // standard step size controller for a fifth order method, with the growth and shrinkage limited to 5x
+            double factor = err > 0.0 ? 0.9 * std::pow(err,-0.2) : 5.0;
+            factor = (std::min)(5.0,(std::max)(0.2,factor));
+            dt_next = (std::min)(options.max_step_size,(std::max)(options.min_step_size,dt * factor));
+            if (err <= 1.0 || dt <= options.min_step_size)
+              break;
+          }
+          stages.k[0] = stages.k[6];
+          have_xdot = true;
+          break;
+        case BACKWARD_EULER:
+          dt = (std::min)(options.initial_step_size,tf-t);
+          backwardEulerStep(sys,t,dt,x,u,implicit_workspace,x_next,options);
+          break;
+        case BDF2:
+          dt = (std::min)(options.initial_step_size,tf-t);
+          bdf2Step(sys,t,dt,x,u,implicit_workspace,x_next,options);
+          break;
+        default:
+          throw std::runtime_error("unknown integrator type");
+      }
+
+      int event_index = -1;
+      double t_event = t+dt;
+      if (zcs.size() > 0) {
+        zcs_next = sys.zeroCrossings(t+dt,x_next,u);
+        event_index = locateZeroCrossing(sys,t,dt,x,x_next,u,zcs,zcs_next,t_event,x_event,options);
+        if (event_index < 0)
+          zcs.swap(zcs_next);
+      }
+
+      if (event_index >= 0) {
+        // the step ends at the crossing, and the integrators can't carry derivatives or history across the jump
+        t = t_event;
+        x = sys.transitionUpdate(t,x_event,u,event_index);
+        zcs = sys.zeroCrossings(t,x,u);
+        have_xdot = false;
+        implicit_workspace.h_previous = -1.0;
+      } else {
+        x = x_next;
+        t += dt;
+      }
+      stats.addStep(TimeDuration(TimeClock::now() - step_start).count());
     }
+    return x;
+  }
+
+  template <typename Derived, template<typename> class StateVector, template<typename> class InputVector, template<typename> class OutputVector, bool isTimeVarying, bool isDirectFeedthrough>
+  Eigen::Matrix<double,StateVector<double>::RowsAtCompileTime,1> simulate(const System<Derived,StateVector,InputVector,OutputVector,isTimeVarying,isDirectFeedthrough>& sys, double t0, double tf, const Eigen::VectorXd& x0, const SimulationOptions& options) {
+    SimulationStats stats;
+    return simulate(sys,t0,tf,x0,options,stats);
+  }
+
+  template <typename System>
+  auto simulate(const System& sys, double t0, double tf, const Eigen::VectorXd& x0) -> decltype(simulate(sys,t0,tf,x0,default_simulation_options)) {
+    return simulate(sys,t0,tf,x0,default_simulation_options);
+  }
+
+  /// Simulates systems[i] from x0s.col(i) at t0 to tf for every column of x0s, spread over num_threads threads, and
+  /// returns the final states as the columns of the result.  The runs share nothing but the systems, whose const
+  /// dynamics and output methods are then called concurrently.  The same system may only be passed for several (or
+  /// all) runs if those methods are thread-safe: a const method that updates mutable members (a kinematics cache, the
+  /// last published state of a visualizer) has to guard them, as BotVisualizer does.  Runs with perturbed parameters
+  /// get their own system.  Set options.skip_outputs to leave output out of the runs altogether, e.g. when nothing
+  /// needs to be drawn or the output of a shared system isn't thread-safe.  options.realtime_factor is ignored.  If a run throws, the
+  /// remaining runs are still simulated and the first exception is rethrown at the end.
+  template <typename System>
+  Eigen::MatrixXd simulateBatch(const std::vector<std::shared_ptr<System>>& systems, double t0, double tf, const Eigen::MatrixXd& x0s, const SimulationOptions& options, int num_threads = -1) {
+    const int num_runs = static_cast<int>(x0s.cols());
+    if (static_cast<int>(systems.size()) != num_runs)
+      throw std::runtime_error("simulateBatch needs one system per initial state");
+
+    SimulationOptions batch_options = options;
+    batch_options.realtime_factor = -1.0;
+
+    Eigen::MatrixXd xf(x0s.rows(), num_runs);
+    std::atomic<int> next_run(0);
+    std::exception_ptr first_error;
+    std::mutex error_mutex;
+    auto simulateRuns = [&]() {
+      for (int i = next_run++; i < num_runs; i = next_run++) {
+        try {
+          Eigen::VectorXd x0 = x0s.col(i);
+          xf.col(i) = simulate(*systems[i],t0,tf,x0,batch_options);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!first_error)
+            first_error = std::current_exception();
+        }
+      }
+    };
+
+    if (num_threads < 1)
+      num_threads = static_cast<int>(std::thread::hardware_concurrency());
+    num_threads = (std::max)(1,(std::min)(num_threads,num_runs));
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; i++)
+      threads.push_back(std::thread(simulateRuns));
+    simulateRuns();
+    for (auto it = threads.begin(); it != threads.end(); ++it)
+      it->join();
+
+    if (first_error)
+      std::rethrow_exception(first_error);
+    return xf;
   }
 
   template <typename System>
-  void simulate(const System& sys, double t0, double tf, const Eigen::VectorXd& x0)  {
-    simulate(sys,t0,tf,x0,default_simulation_options);
+  Eigen::MatrixXd simulateBatch(const std::shared_ptr<System>& sys, double t0, double tf, const Eigen::MatrixXd& x0s, const SimulationOptions& options, int num_threads = -1) {
+    std::vector<std::shared_ptr<System>> systems(x0s.cols(), sys);
+    return simulateBatch(systems,t0,tf,x0s,options,num_threads);
   }
 
 }  // end namespace Drake
@@ -18,7 +18,8 @@
 ///   - time-varying dynamics and outputs
 ///   - input limits (c++ support coming soon)
 ///   - algebraic constraints (c++ support coming soon)
-///   - zero-crossings (c++ support coming soon) to inform the tools of discontinuities in the dynamics
+///   - zero-crossings to inform the tools of discontinuities in the dynamics, with a transition update of the state
+///     when one is crossed (e.g. impacts)
 
 
 namespace Drake {
@@ -98,6 +99,34 @@ namespace Drake {
     };
 */
 
+    /// zero crossings
+    /// @param t time in seconds
+    /// @param x state vector
+    /// @param u input vector
+    ///
+    /// derived classes with discontinuities may implement
+    ///   Eigen::VectorXd zeroCrossingsImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u) const;
+    ///   StateVector<double> transitionUpdateImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u, int zero_crossing_index) const;
+    /// (always with all arguments).  As for HybridDrakeSystem guards, a zero crossing is triggered when it goes from
+    /// non-negative to negative; the simulator then locates the time of the crossing and replaces the state with the
+    /// result of transitionUpdate.  The defaults below describe a system without zero crossings.
+
+    Eigen::VectorXd zeroCrossings(const double& t, const StateVector<double>& x, const InputVector<double>& u) const {
+      return static_cast<const Derived*>(this)->zeroCrossingsImplementation(t,x,u);
+    }
+
+    StateVector<double> transitionUpdate(const double& t, const StateVector<double>& x, const InputVector<double>& u, int zero_crossing_index) const {
+      return static_cast<const Derived*>(this)->transitionUpdateImplementation(t,x,u,zero_crossing_index);
+    }
+
+    Eigen::VectorXd zeroCrossingsImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u) const {
+      return Eigen::VectorXd();
+    }
+
+    StateVector<double> transitionUpdateImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u, int zero_crossing_index) const {
+      return x;
+    }
+
     // todo: add sparsity information about dynamics, update, and output methods
 
     template <typename ScalarType>
@@ -181,6 +210,34 @@ namespace Drake {
       }
     }
 
+    // the zero crossings of System1 followed by those of System2
+    Eigen::VectorXd zeroCrossingsImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u) const {
+      OutputVector<double> y1;
+      InputVector<double> y2;
+      subsystemOutputs(t,x.first(),x.second(),u,y1,y2);
+      Eigen::VectorXd zcs1 = sys1->zeroCrossings(t,x.first(),static_cast<InputVector<double> >( static_cast<EigenInput<double> >(y2)+static_cast<EigenInput<double> >(u)));
+      Eigen::VectorXd zcs2 = sys2->zeroCrossings(t,x.second(),y1);
+      Eigen::VectorXd zcs(zcs1.size()+zcs2.size());
+      zcs << zcs1, zcs2;
+      return zcs;
+    }
+
+    StateVector<double> transitionUpdateImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u, int zero_crossing_index) const {
+      OutputVector<double> y1;
+      InputVector<double> y2;
+      subsystemOutputs(t,x.first(),x.second(),u,y1,y2);
+      InputVector<double> u1 = static_cast<InputVector<double> >( static_cast<EigenInput<double> >(y2)+static_cast<EigenInput<double> >(u));
+      int num_zcs1 = static_cast<int>(sys1->zeroCrossings(t,x.first(),u1).size());
+      if (zero_crossing_index < num_zcs1) {
+        StateVector<double> xn(static_cast<Eigen::Matrix<double,System1::num_states,1> >(sys1->transitionUpdate(t,x.first(),u1,zero_crossing_index)),
+                               static_cast<Eigen::Matrix<double,System2::num_states,1> >(x.second()));
+        return xn;
+      }
+      StateVector<double> xn(static_cast<Eigen::Matrix<double,System1::num_states,1> >(x.first()),
+                             static_cast<Eigen::Matrix<double,System2::num_states,1> >(sys2->transitionUpdate(t,x.second(),y1,zero_crossing_index-num_zcs1)));
+      return xn;
+    }
+
   private:
     System1Ptr sys1;
     System2Ptr sys2;
@@ -247,6 +304,29 @@ namespace Drake {
       return outputImplementation(t,x,u);
     }
 
+    // the zero crossings of System1 followed by those of System2
+    Eigen::VectorXd zeroCrossingsImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u) const {
+      System1OutputVector<double> y1 = sys1->output(t,x.first(),u);
+      Eigen::VectorXd zcs1 = sys1->zeroCrossings(t,x.first(),u);
+      Eigen::VectorXd zcs2 = sys2->zeroCrossings(t,x.second(),y1);
+      Eigen::VectorXd zcs(zcs1.size()+zcs2.size());
+      zcs << zcs1, zcs2;
+      return zcs;
+    }
+
+    StateVector<double> transitionUpdateImplementation(const double& t, const StateVector<double>& x, const InputVector<double>& u, int zero_crossing_index) const {
+      int num_zcs1 = static_cast<int>(sys1->zeroCrossings(t,x.first(),u).size());
+      if (zero_crossing_index < num_zcs1) {
+        StateVector<double> xn(static_cast<Eigen::Matrix<double,System1::num_states,1> >(sys1->transitionUpdate(t,x.first(),u,zero_crossing_index)),
+                               static_cast<Eigen::Matrix<double,System2::num_states,1> >(x.second()));
+        return xn;
+      }
+      System1OutputVector<double> y1 = sys1->output(t,x.first(),u);
+      StateVector<double> xn(static_cast<Eigen::Matrix<double,System1::num_states,1> >(x.first()),
+                             static_cast<Eigen::Matrix<double,System2::num_states,1> >(sys2->transitionUpdate(t,x.second(),y1,zero_crossing_index-num_zcs1)));
+      return xn;
+    }
+
   private:
     System1Ptr sys1;
     System2Ptr sys2;
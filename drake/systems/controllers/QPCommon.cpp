@@ -2,6 +2,7 @@
 #include "controlUtil.h"
 #include <map>
 #include <memory>
+#include <limits>
 #include <lcm/lcm-cpp.hpp>
 #include "lcmUtil.h"
 #include "testUtil.h"
@@ -22,8 +23,13 @@ double logisticSigmoid(double L, double k, double x, double x0) {
 }
 
 PIDOutput wholeBodyPID(NewQPControllerData *pdata, double t, const Ref<const VectorXd> &q, const Ref<const VectorXd> &qd, const Ref<const VectorXd> &q_des, WholeBodyParams *params) {
-  // Run a PID controller on the whole-body state to produce desired accelerations and reference posture
   PIDOutput out;
+  wholeBodyPID(pdata, t, q, qd, q_des, params, out);
+  return out;
+}
+
+void wholeBodyPID(NewQPControllerData *pdata, double t, const Ref<const VectorXd> &q, const Ref<const VectorXd> &qd, const Ref<const VectorXd> &q_des, WholeBodyParams *params, PIDOutput &out) {
+  // Run a PID controller on the whole-body state to produce desired accelerations and reference posture
   double dt = 0;
   int nq = pdata->r->num_positions;
   assert(q.size() == nq);
@@ -45,19 +51,24 @@ PIDOutput wholeBodyPID(NewQPControllerData *pdata, double t, const Ref<const Vec
   pdata->state.q_integrator_state = pdata->state.q_integrator_state.array().max(-params->integrator.clamps.array());
   pdata->state.q_integrator_state = pdata->state.q_integrator_state.array().min(params->integrator.clamps.array());
 
-  VectorXd err_q;
-  err_q.resize(nq);
-  err_q.head<3>() = q_des.head<3>() - q.head<3>();
+  // the position error goes into qddot_des first
+  out.qddot_des.resize(nq);
+  out.qddot_des.head<3>() = q_des.head<3>() - q.head<3>();
   for (int j = 3; j < nq; j++) {
-    err_q(j) = angleDiff(q(j), q_des(j));
+    out.qddot_des(j) = angleDiff(q(j), q_des(j));
   }
-  out.qddot_des = params->Kp.cwiseProduct(err_q) - params->Kd.cwiseProduct(qd);
+  out.qddot_des = params->Kp.cwiseProduct(out.qddot_des) - params->Kd.cwiseProduct(qd);
   out.qddot_des = out.qddot_des.array().max(params->qdd_bounds.min.array());
   out.qddot_des = out.qddot_des.array().min(params->qdd_bounds.max.array());
-  return out;
 }
 
 VectorXd velocityReference(NewQPControllerData *pdata, double t, const Ref<VectorXd> &q, const Ref<VectorXd> &qd, const Ref<VectorXd> &qdd, bool foot_contact[2], VRefIntegratorParams *params, RobotPropertyCache *rpc) {
+  VectorXd qd_ref;
+  velocityReference(pdata, t, q, qd, qdd, foot_contact, params, rpc, qd_ref);
+  return qd_ref;
+}
+
+void velocityReference(NewQPControllerData *pdata, double t, const Ref<VectorXd> &q, const Ref<VectorXd> &qd, const Ref<VectorXd> &qdd, bool foot_contact[2], VRefIntegratorParams *params, RobotPropertyCache *rpc, VectorXd &qd_ref) {
   // Integrate expected accelerations to determine a target feed-forward velocity, which we can pass in to Atlas
   int i;
   assert(qdd.size() == pdata->r->num_velocities);
@@ -67,7 +78,8 @@ VectorXd velocityReference(NewQPControllerData *pdata, double t, const Ref<Vecto
     dt = t - pdata->state.t_prev;
   }
 
-  VectorXd qdd_limited = qdd;
+  VectorXd& qdd_limited = pdata->workspace.qdd_limited;
+  qdd_limited = qdd;
   // Do not wind the vref integrator up against the joint limits for the legs
   for (i=0; i < rpc->position_indices.at("r_leg").size(); i++) {
     int pos_ind = rpc->position_indices.at("r_leg")(i);
@@ -114,28 +126,34 @@ VectorXd velocityReference(NewQPControllerData *pdata, double t, const Ref<Vecto
   pdata->state.foot_contact_prev[0] = foot_contact[0];
   pdata->state.foot_contact_prev[1] = foot_contact[1];
 
-  VectorXd qd_err = pdata->state.vref_integrator_state - qd;
+  // the velocity error goes into qd_ref first
+  qd_ref = pdata->state.vref_integrator_state - qd;
 
   // do not velocity control ankles when in contact
   if (params->zero_ankles_on_contact && foot_contact[0] == 1) {
     for (i=0; i < rpc->position_indices.at("l_leg_ak").size(); i++) {
-      qd_err(rpc->position_indices.at("l_leg_ak")(i)) = 0;
+      qd_ref(rpc->position_indices.at("l_leg_ak")(i)) = 0;
     }
   }
   if (params->zero_ankles_on_contact && foot_contact[1] == 1) {
     for (i=0; i < rpc->position_indices.at("r_leg_ak").size(); i++) {
-      qd_err(rpc->position_indices.at("r_leg_ak")(i)) = 0;
+      qd_ref(rpc->position_indices.at("r_leg_ak")(i)) = 0;
     }
   }
 
-  VectorXd qd_ref = qd_err.array().max(-params->delta_max);
+  qd_ref = qd_ref.array().max(-params->delta_max);
   qd_ref = qd_ref.array().min(params->delta_max);
-  return qd_ref;
 }
 
 std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> loadAvailableSupports(std::shared_ptr<drake::lcmt_qp_controller_input> qp_input) {
-  // Parse a qp_input LCM message to extract its available supports as a vector of SupportStateElements
   std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> available_supports;
+  loadAvailableSupports(qp_input, available_supports);
+  return available_supports;
+}
+
+void loadAvailableSupports(std::shared_ptr<drake::lcmt_qp_controller_input> qp_input, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports) {
+  // Parse a qp_input LCM message to extract its available supports as a vector of SupportStateElements, reusing the
+  // storage of the elements already in available_supports
   available_supports.resize(qp_input->num_support_data);
   for (int i=0; i < qp_input->num_support_data; i++) {
     available_supports[i].body_idx = qp_input->support_data[i].body_id - 1;
@@ -150,11 +168,10 @@ std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> l
       }
     }
   }
-  return available_supports;
 }
 
-void addJointSoftLimits(const JointSoftLimitParams &params, const DrakeRobotState &robot_state, const VectorXd &q_des, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &supports, std::vector<drake::lcmt_joint_pd_override> &joint_pd_override) {
-  Matrix<bool, Dynamic, 1> has_joint_override = Matrix<bool, Dynamic, 1>::Zero(q_des.size());
+void addJointSoftLimits(const JointSoftLimitParams &params, const DrakeRobotState &robot_state, const Ref<const VectorXd> &q_des, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &supports, std::vector<drake::lcmt_joint_pd_override> &joint_pd_override, Matrix<bool, Dynamic, 1> &has_joint_override) {
+  has_joint_override.setZero(q_des.size());
   for (std::vector<drake::lcmt_joint_pd_override>::iterator it = joint_pd_override.begin(); it != joint_pd_override.end(); ++it) {
     has_joint_override(it->position_ind - 1) = true;
   }
@@ -335,6 +352,111 @@ void checkCentroidalMomentumMatchesTotalWrench(RigidBodyTree * r, KinematicsCach
   valuecheckMatrix(total_wrench_in_world, momentum_rate_of_change, 1e-6);
 }
 
+/*
+ * Receives the entries of the equality or the inequality constraint matrix of the controller QP, block by block. For
+ * the dense solvers they are written into Aeq or Ain, which have been zeroed. For the sparse solver the nonzero entries
+ * of each block are appended to the triplets of [Aeq; Ain] instead (the inequality rows come after the neq equality
+ * rows), so the zero blocks are never visited and the dense matrices are never formed.
+ */
+class QPConstraintMatrixWriter {
+public:
+  QPConstraintMatrixWriter(MatrixXd& dense, std::vector<Triplet<double>>* triplets, int row_offset) :
+      dense(dense), triplets(triplets), row_offset(row_offset) { }
+
+  template <typename Derived>
+  void setBlock(int row, int col, const MatrixBase<Derived>& block, double scale = 1.0) {
+    if (triplets) {
+      for (int j=0; j < block.cols(); j++) {
+        for (int i=0; i < block.rows(); i++) {
+          if (block(i,j) != 0) triplets->push_back(Triplet<double>(row_offset+row+i, col+j, scale*block(i,j)));
+        }
+      }
+    } else {
+      dense.block(row, col, block.rows(), block.cols()) = scale*block;
+    }
+  }
+
+  void setDiagonal(int row, int col, int n, double value) {
+    for (int i=0; i < n; i++) {
+      set(row+i, col+i, value);
+    }
+  }
+
+  void set(int row, int col, double value) {
+    if (triplets) {
+      triplets->push_back(Triplet<double>(row_offset+row, col, value));
+    } else {
+      dense(row, col) = value;
+    }
+  }
+
+private:
+  MatrixXd& dense;
+  std::vector<Triplet<double>>* triplets;
+  int row_offset;
+};
+
+void removeInfiniteInequalities(MatrixXd& Ain, VectorXd& bin) {
+  for (int i=0; i<bin.size(); i++) {
+    // remove inf constraints---needed by gurobi
+    if (std::isinf(double(bin(i)))) {
+      Ain.row(i).setZero();
+      bin(i)=0;
+    }
+  }
+}
+
+/*
+ * Solves the controller QP with the sparse ADMM solver. The constraint matrix [Aeq; Ain] is assembled from the triplets
+ * that setupAndSolveQP collected into pdata->workspace.A_triplets, and the variable bounds are passed separately instead
+ * of being appended to Ain as dense identity rows. Inequalities with an infinite bound are simply unbounded rows.
+ */
+int sparseControllerQP(NewQPControllerData *pdata, const std::vector<MatrixXd*>& QBlkDiag, const VectorXd& f, const VectorXd& beq, const VectorXd& bin, const VectorXd& lb, const VectorXd& ub, VectorXd& alpha) {
+  QPControllerWorkspace& workspace = pdata->workspace;
+  int nparams = static_cast<int>(f.size());
+  int neq = static_cast<int>(beq.size());
+  int n_ineq = static_cast<int>(bin.size());
+
+  // lower triangle of blkdiag(QBlkDiag); vector blocks hold the diagonal
+  std::vector<Triplet<double>>& P_triplets = workspace.P_triplets;
+  P_triplets.clear();
+  int offset = 0;
+  for (std::vector<MatrixXd*>::const_iterator Q = QBlkDiag.begin(); Q != QBlkDiag.end(); Q++) {
+    if ((*Q)->rows() == 1 || (*Q)->cols() == 1) {
+      for (int i=0; i < (*Q)->size(); i++) {
+        P_triplets.push_back(Triplet<double>(offset+i, offset+i, (**Q)(i)));
+      }
+      offset += static_cast<int>((*Q)->size());
+    } else {
+      for (int j=0; j < (*Q)->cols(); j++) {
+        for (int i=j; i < (*Q)->rows(); i++) {
+          if ((**Q)(i,j) != 0) P_triplets.push_back(Triplet<double>(offset+i, offset+j, (**Q)(i,j)));
+        }
+      }
+      offset += static_cast<int>((*Q)->rows());
+    }
+  }
+  // with the supports and tracked bodies of the last tick the patterns usually still fit, only the values are updated then
+  if (workspace.P_sparse.rows() != nparams || workspace.P_sparse.cols() != nparams || !setValuesFromTriplets(workspace.P_sparse, P_triplets)) {
+    workspace.P_sparse.resize(nparams, nparams);
+    workspace.P_sparse.setFromTriplets(P_triplets.begin(), P_triplets.end());
+  }
+
+  if (workspace.A_sparse.rows() != neq+n_ineq || workspace.A_sparse.cols() != nparams || !setValuesFromTriplets(workspace.A_sparse, workspace.A_triplets)) {
+    workspace.A_sparse.resize(neq+n_ineq, nparams);
+    workspace.A_sparse.setFromTriplets(workspace.A_triplets.begin(), workspace.A_triplets.end());
+  }
+
+  workspace.lA.resize(neq+n_ineq);
+  workspace.uA.resize(neq+n_ineq);
+  workspace.lA.head(neq) = beq;
+  workspace.lA.tail(n_ineq).setConstant(-std::numeric_limits<double>::infinity());
+  workspace.uA.head(neq) = beq;
+  workspace.uA.tail(n_ineq) = bin;
+
+  return pdata->sparseqp.solve(workspace.P_sparse, f, workspace.A_sparse, workspace.lA, workspace.uA, lb, ub, alpha);
+}
+
 int setupAndSolveQP(
 		NewQPControllerData *pdata, std::shared_ptr<drake::lcmt_qp_controller_input> qp_input, DrakeRobotState &robot_state,
 		const Ref<Matrix<bool, Dynamic, 1>> &b_contact_force, const std::map<Side, ForceTorqueMeasurement>& foot_force_torque_measurements,
@@ -379,9 +501,16 @@ int setupAndSolveQP(
   Map<Matrix<double, 4, 1>> s1(&qp_input->zmp_data.s1[0][0]);
   Map<Matrix<double, 4, 1>> s1dot(&qp_input->zmp_data.s1dot[0][0]);
 
+  // Kinematics for this tick, shared by support detection, body motion PD, the contact constraints and the dynamics terms
+  pdata->cache.initialize(robot_state.q, robot_state.qd);
+  pdata->r->doKinematics(pdata->cache, true);
+  auto& cache = pdata->cache;
+
   // Active supports
-  std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> available_supports = loadAvailableSupports(qp_input);
-  std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> active_supports = getActiveSupports(pdata->r, robot_state.q, robot_state.qd, available_supports, b_contact_force, params->contact_threshold);
+  std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& available_supports = pdata->workspace.available_supports;
+  std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& active_supports = pdata->workspace.active_supports;
+  loadAvailableSupports(qp_input, available_supports);
+  getActiveSupports(pdata->r, cache, available_supports, b_contact_force, params->contact_threshold, active_supports);
 
 
   // // whole_body_data
@@ -392,10 +521,12 @@ int setupAndSolveQP(
   }
   Map<VectorXi> condof(qp_input->whole_body_data.constrained_dofs.data(), qp_input->whole_body_data.num_constrained_dofs);
 
-  PIDOutput pid_out = wholeBodyPID(pdata, robot_state.t, robot_state.q, robot_state.qd, q_des, &params->whole_body);
-  VectorXd w_qdd = params->whole_body.w_qdd;
+  PIDOutput& pid_out = pdata->workspace.pid_out;
+  wholeBodyPID(pdata, robot_state.t, robot_state.q, robot_state.qd, q_des, &params->whole_body, pid_out);
+  VectorXd& w_qdd = pdata->workspace.w_qdd;
+  w_qdd = params->whole_body.w_qdd;
 
-  addJointSoftLimits(params->joint_soft_limits, robot_state, q_des, active_supports, qp_input->joint_pd_override);
+  addJointSoftLimits(params->joint_soft_limits, robot_state, q_des, active_supports, qp_input->joint_pd_override, pdata->workspace.has_joint_override);
   applyJointPDOverride(qp_input->joint_pd_override, robot_state, pid_out, w_qdd);
 
   qp_output->q_ref = pid_out.q_ref;
@@ -419,11 +550,12 @@ int setupAndSolveQP(
   
   assert(nu+6 == nq);
 
-  std::vector<DesiredBodyAcceleration> desired_body_accelerations;
+  std::vector<DesiredBodyAcceleration,Eigen::aligned_allocator<DesiredBodyAcceleration>>& desired_body_accelerations = pdata->workspace.desired_body_accelerations;
   desired_body_accelerations.resize(qp_input->num_tracked_bodies);
   Vector6d body_v_des, body_vdot_des;
   Vector6d body_vdot;
   Isometry3d body_pose_des;
+  Vector6d xyzexp, xyzexpdot, xyzexpddot;
 
   for (int i=0; i < qp_input->num_tracked_bodies; i++) {
     if (qp_input->body_motion_data[i].body_id == 0)
@@ -441,10 +573,13 @@ int setupAndSolveQP(
     double expmap_kp_multiplier = qp_input->body_motion_data[i].expmap_kp_multiplier;
     double expmap_damping_ratio_multiplier = qp_input->body_motion_data[i].expmap_damping_ratio_multiplier;
     memcpy(desired_body_accelerations[i].weight_multiplier.data(),qp_input->body_motion_data[i].weight_multiplier,sizeof(double)*6);
-    desired_body_accelerations[i].body_path = pdata->r->findKinematicPath(0, desired_body_accelerations[i].body_or_frame_id0);
 
-    auto spline = decodePiecewisePolynomial(qp_input->body_motion_data[i].spline);
-    evaluateXYZExpmapCubicSpline(robot_state.t, spline, body_pose_des, body_v_des, body_vdot_des);
+    // evaluated straight from the message, decodePiecewisePolynomial would build a PiecewisePolynomial on every tick
+    const drake::lcmt_piecewise_polynomial& spline = qp_input->body_motion_data[i].spline;
+    evaluatePiecewisePolynomial(spline, robot_state.t, 0, xyzexp);
+    evaluatePiecewisePolynomial(spline, robot_state.t, 1, xyzexpdot);
+    evaluatePiecewisePolynomial(spline, robot_state.t, 2, xyzexpddot);
+    evaluateXYZExpmap(xyzexp, xyzexpdot, xyzexpddot, body_pose_des, body_v_des, body_vdot_des);
 
     Vector6d body_Kp;
     body_Kp.head<3>() = (params->body_motion[true_body_id0].Kp.head<3>().array()*xyz_kp_multiplier.array()).matrix();
@@ -453,7 +588,7 @@ int setupAndSolveQP(
     body_Kd.head<3>() = (params->body_motion[true_body_id0].Kd.head<3>().array()*xyz_damping_ratio_multiplier.array()*xyz_kp_multiplier.array().sqrt()).matrix();
     body_Kd.tail<3>() = params->body_motion[true_body_id0].Kd.tail<3>()*sqrt(expmap_kp_multiplier)*expmap_damping_ratio_multiplier;
 
-    desired_body_accelerations[i].body_vdot = bodySpatialMotionPD(pdata->r, robot_state, body_or_frame_id0, body_pose_des, body_v_des, body_vdot_des, body_Kp, body_Kd,desired_body_accelerations[i].T_task_to_world);
+    desired_body_accelerations[i].body_vdot = bodySpatialMotionPD(pdata->r, cache, body_or_frame_id0, body_pose_des, body_v_des, body_vdot_des, body_Kp, body_Kd,desired_body_accelerations[i].T_task_to_world, pdata->workspace.Jb_compact);
     
     desired_body_accelerations[i].weight = weight;
     desired_body_accelerations[i].accel_bounds = params->body_motion[true_body_id0].accel_bounds;
@@ -466,10 +601,7 @@ int setupAndSolveQP(
       n_body_accel_eq_constraints++;
   }
 
-  MatrixXd R_DQyD_ls = R_ls + D_ls.transpose()*Qy*D_ls;
-
-  pdata->cache.initialize(robot_state.q, robot_state.qd);
-  pdata->r->doKinematics(pdata->cache, true);
+  Matrix2d R_DQyD_ls = R_ls + D_ls.transpose()*Qy*D_ls;
 
   //---------------------------------------------------------------------
 
@@ -479,7 +611,8 @@ int setupAndSolveQP(
   }
 
   // handle external wrenches to compensate for
-  eigen_aligned_unordered_map<RigidBody const *, Matrix<double, TWIST_SIZE, 1> > f_ext;
+  eigen_aligned_unordered_map<RigidBody const *, Matrix<double, TWIST_SIZE, 1> >& f_ext = pdata->workspace.f_ext;
+  f_ext.clear();
   for (auto it = qp_input->body_wrench_data.begin(); it != qp_input->body_wrench_data.end(); ++it) {
     const drake::lcmt_body_wrench_data& body_wrench_data = *it;
     int body_id = body_wrench_data.body_id - 1;
@@ -487,9 +620,8 @@ int setupAndSolveQP(
     f_ext.insert({pdata->r->bodies[body_id].get(), f_ext_i});
   }
 
-  auto& cache = pdata->cache;
-  pdata->H = pdata->r->massMatrix(cache);
-  pdata->C = pdata->r->dynamicsBiasTerm(cache, f_ext);
+  pdata->r->massMatrix(cache, pdata->H);
+  pdata->r->dynamicsBiasTerm(cache, f_ext, pdata->C);
 
   pdata->H_float = pdata->H.topRows(6);
   pdata->H_act = pdata->H.bottomRows(nu);
@@ -499,7 +631,7 @@ int setupAndSolveQP(
   bool include_angular_momentum = (params->W_kdot.array().maxCoeff() > 1e-10);
 
   if (include_angular_momentum) {
-    pdata->Ag = pdata->r->centroidalMomentumMatrix(cache);
+    pdata->r->centroidalMomentumMatrix(cache, RigidBodyTree::default_robot_num_set, false, pdata->Ag);
     pdata->Agdot_times_v = pdata->r->centroidalMomentumMatrixDotTimesV(cache);
     pdata->Ak = pdata->Ag.topRows<3>();
     pdata->Akdot_times_v = pdata->Agdot_times_v.topRows<3>();
@@ -508,13 +640,13 @@ int setupAndSolveQP(
   // consider making all J's into row-major
 
   xcom = pdata->r->centerOfMass(cache);
-  pdata->J = pdata->r->centerOfMassJacobian(cache);
+  pdata->r->centerOfMassJacobian(cache, RigidBodyTree::default_robot_num_set, false, pdata->J);
   pdata->Jdotv = pdata->r->centerOfMassJacobianDotTimesV(cache);
   pdata->J_xy = pdata->J.topRows(2);
   pdata->Jdotv_xy = pdata->Jdotv.head<2>();
 
-  MatrixXd Jcom;
-  VectorXd Jcomdotv;
+  MatrixXd& Jcom = pdata->workspace.Jcom;
+  VectorXd& Jcomdotv = pdata->workspace.Jcomdotv;
 
   if (x0.size()==6) {
     Jcom = pdata->J;
@@ -525,11 +657,13 @@ int setupAndSolveQP(
     Jcomdotv = pdata->Jdotv_xy;
   }
 
-  Vector3d xcomdot = pdata->J * robot_state.qd;
+  Vector3d xcomdot;
+  xcomdot.noalias() = pdata->J * robot_state.qd;
 
-  MatrixXd B,JB,Jp,normals;
-  VectorXd Jpdotv;
-  std::vector<double> adjusted_mus(active_supports.size());
+  MatrixXd &B = pdata->workspace.B, &JB = pdata->workspace.JB, &Jp = pdata->workspace.Jp, &normals = pdata->workspace.normals;
+  VectorXd& Jpdotv = pdata->workspace.Jpdotv;
+  std::vector<double>& adjusted_mus = pdata->workspace.adjusted_mus;
+  adjusted_mus.resize(active_supports.size());
   // std::cout << "contact force: " << b_contact_force.transpose() << std::endl;
   // std::cout << "adjusted mu: ";
   for (int i=0; i < active_supports.size(); ++i) {
@@ -542,15 +676,17 @@ int setupAndSolveQP(
     // std::cout << adjusted_mus[i] << " ";
   }
   // std::cout << std::endl;
-  int nc = contactConstraintsBV(pdata->r, pdata->cache, num_active_contact_pts, adjusted_mus, active_supports, B, JB, Jp, Jpdotv, normals);
+  int nc = contactConstraintsBV(pdata->r, pdata->cache, num_active_contact_pts, adjusted_mus, active_supports, B, JB, Jp, Jpdotv, normals, pdata->workspace.Jp_compact);
   int neps = nc*dim;
 
   if (params->use_center_of_mass_observer && foot_force_torque_measurements.size() > 0) {
     estimateCoMBasedOnMeasuredZMP(pdata, params, active_supports, nc, foot_force_torque_measurements, dt, xcom, xcomdot);
   }
 
-  VectorXd x_bar,xlimp;
-  MatrixXd D_float(6,JB.cols()), D_act(nu,JB.cols());
+  VectorXd &xlimp = pdata->workspace.xlimp, &x_bar = pdata->workspace.x_bar;
+  MatrixXd &D_float = pdata->workspace.D_float, &D_act = pdata->workspace.D_act;
+  D_float.resize(6,JB.cols());
+  D_act.resize(nu,JB.cols());
   if (nc>0) {
     if (x0.size()==6) {
       // x,y,z com 
@@ -574,7 +710,8 @@ int setupAndSolveQP(
 
   Vector3d kdot_des; 
   if (include_angular_momentum) {
-    VectorXd k = pdata->Ak*robot_state.qd;
+    Vector3d k;
+    k.noalias() = pdata->Ak*robot_state.qd;
     kdot_des = -params->Kp_ang*k; // TODO: parameterize
   }
   
@@ -584,64 +721,76 @@ int setupAndSolveQP(
   //  min: ybar*Qy*ybar + ubar*R*ubar + (2*S*xbar + s1)*(A*x + B*u) +
   //    w_qdd*quad(qddot_ref - qdd) + w_eps*quad(epsilon) +
   //    w_grf*quad(beta) + quad(kdot_des - (A*qdd + Adot*qd))  
-  VectorXd f(nparams);
+  VectorXd& f = pdata->workspace.f;
+  f.resize(nparams);
   {      
     if (nc > 0) {
       // NOTE: moved Hqp calcs below, because I compute the inverse directly for FastQP (and sparse Hqp for gurobi)
-      VectorXd tmp = C_ls*xlimp;
-      VectorXd tmp1 = Jcomdotv;
-      MatrixXd tmp2 = R_DQyD_ls*Jcom;
+      // the row vectors in front of Jcom and Ak are fixed size, so none of these products needs a temporary on the heap
+      Vector2d tmp = C_ls*xlimp;
 
-      pdata->fqp = tmp.transpose()*Qy*D_ls*Jcom;
+      pdata->fqp.noalias() = (tmp.transpose()*Qy*D_ls).eval()*Jcom;
       // mexPrintf("fqp head: %f %f %f\n", pdata->fqp(0), pdata->fqp(1), pdata->fqp(2));
-      pdata->fqp += tmp1.transpose()*tmp2;
-      pdata->fqp += (S*x_bar + 0.5*s1).transpose()*B_ls*Jcom;
-      pdata->fqp -= u0.transpose()*tmp2;
-      pdata->fqp -= y0.transpose()*Qy*D_ls*Jcom;
+      pdata->fqp.noalias() += (Jcomdotv.transpose()*R_DQyD_ls).eval()*Jcom;
+      pdata->fqp.noalias() += ((S*x_bar + 0.5*s1).transpose()*B_ls).eval()*Jcom;
+      pdata->fqp.noalias() -= (u0.transpose()*R_DQyD_ls).eval()*Jcom;
+      pdata->fqp.noalias() -= (y0.transpose()*Qy*D_ls).eval()*Jcom;
       pdata->fqp -= (w_qdd.array()*pid_out.qddot_des.array()).matrix().transpose();
       if (include_angular_momentum) {
-        pdata->fqp += pdata->Akdot_times_v.transpose()*params->W_kdot*pdata->Ak;
-        pdata->fqp -= kdot_des.transpose()*params->W_kdot*pdata->Ak;
+        pdata->fqp.noalias() += (pdata->Akdot_times_v.transpose()*params->W_kdot).eval()*pdata->Ak;
+        pdata->fqp.noalias() -= (kdot_des.transpose()*params->W_kdot).eval()*pdata->Ak;
       }
       f.head(nq) = pdata->fqp.transpose();
      } else {
       f.head(nq) = -pid_out.qddot_des;
     } 
   }
-  f.tail(nf+neps) = VectorXd::Zero(nf+neps);
+  f.tail(nf+neps).setZero();
 
   int neq = 6+neps+6*n_body_accel_eq_constraints+qp_input->whole_body_data.num_constrained_dofs;
-  MatrixXd Aeq = MatrixXd::Zero(neq,nparams);
-  VectorXd beq = VectorXd::Zero(neq);
+  MatrixXd& Aeq = pdata->workspace.Aeq;
+  VectorXd& beq = pdata->workspace.beq;
+  // the sparse solver gets the nonzero entries of [Aeq; Ain] as triplets, the other solvers the dense matrices
+  std::vector<Triplet<double>>* A_triplets = nullptr;
+  if (pdata->use_sparse_qp) {
+    A_triplets = &pdata->workspace.A_triplets;
+    A_triplets->clear();
+  } else {
+    Aeq.setZero(neq,nparams);
+  }
+  beq.setZero(neq);
+  QPConstraintMatrixWriter Aeq_writer(Aeq, A_triplets, 0);
   
   // constrained floating base dynamics
   //  H_float*qdd - J_float'*lambda - Dbar_float*beta = -C_float
-  Aeq.topLeftCorner(6,nq) = pdata->H_float;
+  Aeq_writer.setBlock(0,0,pdata->H_float);
   beq.topRows(6) = -pdata->C_float;
     
   if (nc>0) {
-    Aeq.block(0,nq,6,nc*nd) = -D_float;
+    Aeq_writer.setBlock(0,nq,D_float,-1.0);
   }
   
   if (nc > 0) {
     // relative acceleration constraint
-    Aeq.block(6,0,neps,nq) = Jp;
-    Aeq.block(6,nq,neps,nf) = MatrixXd::Zero(neps,nf);  // note: obvious sparsity here
-    Aeq.block(6,nq+nf,neps,neps) = MatrixXd::Identity(neps,neps);             // note: obvious sparsity here
-    beq.segment(6,neps) = -Jpdotv -params->Kp_accel*Jp*robot_state.qd; 
+    Aeq_writer.setBlock(6,0,Jp);
+    Aeq_writer.setDiagonal(6,nq+nf,neps,1.0);
+    beq.segment(6,neps).noalias() = -params->Kp_accel*Jp*robot_state.qd;
+    beq.segment(6,neps) -= Jpdotv;
   }    
   
   // add in body spatial equality constraints
   // VectorXd body_vdot;
   int equality_ind = 6+neps;
-  MatrixXd Jb(6,nq);
+  MatrixXd& Jb = pdata->workspace.Jb;
+  Jb.resize(6,nq);
+  CompactJacobian<double,TWIST_SIZE>& Jb_compact = pdata->workspace.Jb_compact;
   Vector6d Jbdotv;	
   for (int i=0; i<desired_body_accelerations.size(); i++) {
     if (desired_body_accelerations[i].weight < 0) { // negative implies constraint
       int body_id0 = pdata->r->parseBodyOrFrameID(desired_body_accelerations[i].body_or_frame_id0);
       if (desired_body_accelerations[i].control_pose_when_in_contact || !inSupport(active_supports,body_id0)) {
-        Matrix<double,6,Dynamic> Jb_compact = pdata->r->geometricJacobian(cache, 0,desired_body_accelerations[i].body_or_frame_id0, desired_body_accelerations[i].body_or_frame_id0, true);
-        Jb = pdata->r->compactToFull<Matrix<double,6,Dynamic>>(Jb_compact,desired_body_accelerations[i].body_path.joint_path,true);
+        pdata->r->geometricJacobian(cache, 0,desired_body_accelerations[i].body_or_frame_id0, desired_body_accelerations[i].body_or_frame_id0, true, Jb_compact);
+        Jb_compact.toFull(Jb);
         Jbdotv = pdata->r->geometricJacobianDotTimesV(cache, 0,desired_body_accelerations[i].body_or_frame_id0,desired_body_accelerations[i].body_or_frame_id0);
 
         if (qp_input->body_motion_data[i].in_floating_base_nullspace) {
@@ -650,7 +799,7 @@ int setupAndSolveQP(
         }
         for (int j=0; j<6; j++) {
           if (!std::isnan(desired_body_accelerations[i].body_vdot(j))) {
-            Aeq.block(equality_ind,0,1,nq) = Jb.row(j);
+            Aeq_writer.setBlock(equality_ind,0,Jb.row(j));
             beq[equality_ind++] = -Jbdotv(j) + desired_body_accelerations[i].body_vdot(j);
           }
         }
@@ -661,56 +810,65 @@ int setupAndSolveQP(
   if (qp_input->whole_body_data.num_constrained_dofs>0) {
     // add joint acceleration constraints
     for (int i=0; i<qp_input->whole_body_data.num_constrained_dofs; i++) {
-      Aeq(equality_ind,(int)condof[i]-1) = 1;
+      Aeq_writer.set(equality_ind,(int)condof[i]-1,1.0);
       beq[equality_ind++] = pid_out.qddot_des[(int)condof[i]-1];
     }
   }  
   
   int n_ineq = 2*nu+2*6*desired_body_accelerations.size();
-  MatrixXd Ain = MatrixXd::Zero(n_ineq,nparams);  // note: obvious sparsity here
-  VectorXd bin = VectorXd::Zero(n_ineq);
+  MatrixXd& Ain = pdata->workspace.Ain;  // note: obvious sparsity here
+  VectorXd& bin = pdata->workspace.bin;
+  if (!pdata->use_sparse_qp) {
+    Ain.setZero(n_ineq,nparams);
+  }
+  bin.setZero(n_ineq);
+  QPConstraintMatrixWriter Ain_writer(Ain, A_triplets, neq);
 
   // linear input saturation constraints
   // u=B_act'*(H_act*qdd + C_act - Jz_act'*z - Dbar_act*beta)
   // using transpose instead of inverse because B is orthogonal
-  Ain.topLeftCorner(nu,nq) = pdata->B_act.transpose()*pdata->H_act;
-  Ain.block(0,nq,nu,nc*nd) = -pdata->B_act.transpose()*D_act;
-  bin.head(nu) = -pdata->B_act.transpose()*pdata->C_act + pdata->umax;
-
-  Ain.block(nu,0,nu,nparams) = -1*Ain.block(0,0,nu,nparams);
-  bin.segment(nu,nu) = pdata->B_act.transpose()*pdata->C_act - pdata->umin;
+  MatrixXd &B_act_H_act = pdata->workspace.B_act_H_act, &B_act_D_act = pdata->workspace.B_act_D_act;
+  B_act_H_act.noalias() = pdata->B_act.transpose()*pdata->H_act;
+  B_act_D_act.noalias() = pdata->B_act.transpose()*D_act;
+  Ain_writer.setBlock(0,0,B_act_H_act);
+  Ain_writer.setBlock(0,nq,B_act_D_act,-1.0);
+  VectorXd& B_act_C_act = pdata->workspace.B_act_C_act;
+  B_act_C_act.noalias() = pdata->B_act.transpose()*pdata->C_act;
+  bin.head(nu) = -B_act_C_act + pdata->umax;
+
+  Ain_writer.setBlock(nu,0,B_act_H_act,-1.0);
+  Ain_writer.setBlock(nu,nq,B_act_D_act);
+  bin.segment(nu,nu) = B_act_C_act - pdata->umin;
 
   int constraint_start_index = 2*nu;
   for (int i=0; i<desired_body_accelerations.size(); i++) {
-    Matrix<double,6,Dynamic>Jb_compact = pdata->r->geometricJacobian(cache, 0,desired_body_accelerations[i].body_or_frame_id0, desired_body_accelerations[i].body_or_frame_id0, true);
-    Jb = pdata->r->compactToFull<Matrix<double,6,Dynamic>>(Jb_compact,desired_body_accelerations[i].body_path.joint_path,true);
+    pdata->r->geometricJacobian(cache, 0,desired_body_accelerations[i].body_or_frame_id0, desired_body_accelerations[i].body_or_frame_id0, true, Jb_compact);
+    Jb_compact.toFull(Jb);
     Jbdotv = pdata->r->geometricJacobianDotTimesV(cache, 0,desired_body_accelerations[i].body_or_frame_id0,desired_body_accelerations[i].body_or_frame_id0);
 
     if (qp_input->body_motion_data[i].in_floating_base_nullspace) {
       Jb.block(0,0,6,6) = MatrixXd::Zero(6,6);
       // Jbdot.block(0,0,6,6) = MatrixXd::Zero(6,6);
     }
-    Ain.block(constraint_start_index,0,6,pdata->r->num_positions) = Jb;
+    Ain_writer.setBlock(constraint_start_index,0,Jb);
     bin.segment(constraint_start_index,6) = -Jbdotv + desired_body_accelerations[i].accel_bounds.max;
     constraint_start_index += 6;
-    Ain.block(constraint_start_index,0,6,pdata->r->num_positions) = -Jb;
+    Ain_writer.setBlock(constraint_start_index,0,Jb,-1.0);
     bin.segment(constraint_start_index,6) = Jbdotv - desired_body_accelerations[i].accel_bounds.min;
     constraint_start_index += 6;
   }
-       
-  for (int i=0; i<n_ineq; i++) {
-    // remove inf constraints---needed by gurobi
-    if (std::isinf(double(bin(i)))) {
-      Ain.row(i) = 0*Ain.row(i);
-      bin(i)=0;
-    }  
+
+  if (!pdata->use_sparse_qp) {
+    removeInfiniteInequalities(Ain, bin);
   }
 
   GRBmodel * model = nullptr;
   int info=-1;
   
   // set obj,lb,up
-  VectorXd lb(nparams), ub(nparams);
+  VectorXd &lb = pdata->workspace.lb, &ub = pdata->workspace.ub;
+  lb.resize(nparams);
+  ub.resize(nparams);
   lb.head(nq) = pdata->qdd_lb;
   ub.head(nq) = pdata->qdd_ub;
   lb.segment(nq,nf) = VectorXd::Zero(nf);
@@ -718,12 +876,12 @@ int setupAndSolveQP(
   lb.tail(neps) = -params->slack_limit*VectorXd::Ones(neps);
   ub.tail(neps) = params->slack_limit*VectorXd::Ones(neps);
 
-  VectorXd alpha(nparams);
+  VectorXd& alpha = pdata->workspace.alpha;
+  alpha.resize(nparams);
 
-  MatrixXd Qnfdiag(nf,1), Qneps(neps,1);
-  std::vector<MatrixXd*> QBlkDiag( nc>0 ? 3 : 1 );  // nq, nf, neps   // this one is for gurobi
-  
-  VectorXd w = (w_qdd.array() + REG).matrix();
+  MatrixXd &Qnfdiag = pdata->workspace.Qnfdiag, &Qneps = pdata->workspace.Qneps;
+  std::vector<MatrixXd*>& QBlkDiag = pdata->workspace.QBlkDiag;
+  QBlkDiag.resize( nc>0 ? 3 : 1 );  // nq, nf, neps   // this one is for gurobi
 
   if (nc != pdata->state.num_active_contact_pts) {
     // Number of contact points has changed, so our active set is invalid
@@ -737,7 +895,7 @@ int setupAndSolveQP(
     max_body_accel_weight = max(max_body_accel_weight, desired_body_accelerations[i].weight);
   }
   bool include_body_accel_cost_terms = desired_body_accelerations.size() > 0 && max_body_accel_weight > 1e-10;
-  if (pdata->use_fast_qp > 0 && !include_angular_momentum && !include_body_accel_cost_terms)
+  if (pdata->use_fast_qp > 0 && !pdata->use_sparse_qp && !include_angular_momentum && !include_body_accel_cost_terms)
   { 
     // TODO: update to include angular momentum, body accel objectives.
 
@@ -757,7 +915,7 @@ int setupAndSolveQP(
     #ifdef TEST_FAST_QP
       if (nc>0) {
         MatrixXd Hqp_test(nq,nq);
-        MatrixXd W = w.asDiagonal();
+        MatrixXd W = (w_qdd.array() + REG).matrix().asDiagonal();
         Hqp_test = (Jcom.transpose()*R_DQyD_ls*Jcom + W).inverse();
         if (((Hqp_test-pdata->Hqp).array().abs()).maxCoeff() > 1e-6) {
           throw std::runtime_error("Q submatrix inverse from matrix inversion lemma does not match direct Q inverse.");
@@ -774,8 +932,10 @@ int setupAndSolveQP(
       QBlkDiag[2] = &Qneps;     // quadratic slack var cost, Q(nparams-neps:end,nparams-neps:end)=eye(neps)
     }
 
-    MatrixXd Ain_lb_ub(n_ineq+2*nparams,nparams);
-    VectorXd bin_lb_ub(n_ineq+2*nparams);
+    MatrixXd& Ain_lb_ub = pdata->workspace.Ain_lb_ub;
+    VectorXd& bin_lb_ub = pdata->workspace.bin_lb_ub;
+    Ain_lb_ub.resize(n_ineq+2*nparams,nparams);
+    bin_lb_ub.resize(n_ineq+2*nparams);
     Ain_lb_ub << Ain,            // note: obvious sparsity here
     -MatrixXd::Identity(nparams,nparams),
     MatrixXd::Identity(nparams,nparams);
@@ -788,7 +948,7 @@ int setupAndSolveQP(
       }
     }
 
-    info = fastQPThatTakesQinv(QBlkDiag, f, Aeq, beq, Ain_lb_ub, bin_lb_ub, pdata->state.active, alpha);
+    info = pdata->fastqp.solveThatTakesQinv(QBlkDiag, f, Aeq, beq, Ain_lb_ub, bin_lb_ub, pdata->state.active, alpha);
 
     //if (info<0)   mexPrintf("fastQP info = %d.  Calling gurobi.\n", info);
   }
@@ -796,9 +956,13 @@ int setupAndSolveQP(
   #endif
 
     if (nc>0) {
-      pdata->Hqp = Jcom.transpose()*R_DQyD_ls*Jcom;
-      if (include_angular_momentum) {
-        pdata->Hqp += pdata->Ak.transpose()*params->W_kdot*pdata->Ak;
+      // a column at a time, so that R_DQyD_ls*Jcom and W_kdot*Ak are fixed size
+      pdata->Hqp.resize(nq,nq);
+      for (int j=0; j<nq; j++) {
+        pdata->Hqp.col(j).noalias() = Jcom.transpose()*(R_DQyD_ls*Jcom.col(j)).eval();
+        if (include_angular_momentum) {
+          pdata->Hqp.col(j).noalias() += pdata->Ak.transpose()*(params->W_kdot*pdata->Ak.col(j)).eval();
+        }
       }
       pdata->Hqp += w_qdd.asDiagonal();
       pdata->Hqp += REG*MatrixXd::Identity(nq,nq);
@@ -811,20 +975,27 @@ int setupAndSolveQP(
       if (desired_body_accelerations[i].weight > 0) {
         int body_id0 = pdata->r->parseBodyOrFrameID(desired_body_accelerations[i].body_or_frame_id0);
         if (desired_body_accelerations[i].control_pose_when_in_contact || !inSupport(active_supports,body_id0)) {
-          Matrix<double,6,Dynamic> Jb_compact = pdata->r->geometricJacobian(cache, 0,desired_body_accelerations[i].body_or_frame_id0,desired_body_accelerations[i].body_or_frame_id0,true);
-          Jb = pdata->r->compactToFull<Matrix<double,6,Dynamic>>(Jb_compact,desired_body_accelerations[i].body_path.joint_path,true);
+          // only the columns of the joints between the world and the body are touched
+          pdata->r->geometricJacobian(cache, 0,desired_body_accelerations[i].body_or_frame_id0,desired_body_accelerations[i].body_or_frame_id0,true,Jb_compact);
           Jbdotv = pdata->r->geometricJacobianDotTimesV(cache, 0, desired_body_accelerations[i].body_or_frame_id0, desired_body_accelerations[i].body_or_frame_id0);
 
           if (qp_input->body_motion_data[i].in_floating_base_nullspace) {
-            Jb.block(0,0,6,6) = MatrixXd::Zero(6,6);
+            for (size_t k=0; k<Jb_compact.indices.size(); k++) {
+              if (Jb_compact.indices[k] < 6)
+                Jb_compact.value.col(k).setZero();
+            }
             // Jbdot.block(0,0,6,6) = MatrixXd::Zero(6,6);
           }
+          Vector6d w_body = Vector6d::Zero();
+          Vector6d f_body = Vector6d::Zero();
           for (int j=0; j<6; j++) {
             if (!std::isnan(desired_body_accelerations[i].body_vdot[j])) {
-              pdata->Hqp += desired_body_accelerations[i].weight*desired_body_accelerations[i].weight_multiplier(j)*(Jb.row(j)).transpose()*Jb.row(j);
-              f.head(nq).noalias() += desired_body_accelerations[i].weight*desired_body_accelerations[i].weight_multiplier(j)*(Jbdotv(j) - desired_body_accelerations[i].body_vdot[j])*Jb.row(j).transpose();
+              w_body(j) = desired_body_accelerations[i].weight*desired_body_accelerations[i].weight_multiplier(j);
+              f_body(j) = w_body(j)*(Jbdotv(j) - desired_body_accelerations[i].body_vdot[j]);
             }
           }
+          Jb_compact.addTransposeTimesWTimes(w_body.asDiagonal(), pdata->Hqp, pdata->workspace.JbTWJb);
+          Jb_compact.addTransposeTimes(f_body, f);
         }
       }
     }
@@ -839,23 +1010,34 @@ int setupAndSolveQP(
     }
 
 
-    MatrixXd Ain_lb_ub(n_ineq+2*nparams,nparams);
-    VectorXd bin_lb_ub(n_ineq+2*nparams);
-    Ain_lb_ub << Ain,            // note: obvious sparsity here
-    -MatrixXd::Identity(nparams,nparams),
-    MatrixXd::Identity(nparams,nparams);
-    bin_lb_ub << bin, -lb, ub;
-
-    for (std::set<int>::iterator it = pdata->state.active.begin(); it != pdata->state.active.end(); it++) {
-      if (std::isnan(bin_lb_ub(*it)) || std::isinf(bin_lb_ub(*it))) {
-        pdata->state.active.clear();
-        break;
+    MatrixXd& Ain_lb_ub = pdata->workspace.Ain_lb_ub;
+    VectorXd& bin_lb_ub = pdata->workspace.bin_lb_ub;
+    if (!pdata->use_sparse_qp) {
+      Ain_lb_ub.resize(n_ineq+2*nparams,nparams);
+      bin_lb_ub.resize(n_ineq+2*nparams);
+      Ain_lb_ub << Ain,            // note: obvious sparsity here
+      -MatrixXd::Identity(nparams,nparams),
+      MatrixXd::Identity(nparams,nparams);
+      bin_lb_ub << bin, -lb, ub;
+
+      for (std::set<int>::iterator it = pdata->state.active.begin(); it != pdata->state.active.end(); it++) {
+        if (std::isnan(bin_lb_ub(*it)) || std::isinf(bin_lb_ub(*it))) {
+          pdata->state.active.clear();
+          break;
+        }
       }
+    } else {
+      Ain_lb_ub.resize(0,nparams);
+      bin_lb_ub.resize(0);
     }
 
-    if (pdata->use_fast_qp > 0)
+    if (pdata->use_sparse_qp)
+    { // sparse formulation, warm started from the previous tick
+      info = sparseControllerQP(pdata, QBlkDiag, f, beq, bin, lb, ub, alpha);
+    }
+    else if (pdata->use_fast_qp > 0)
     { // set up and call fastqp
-      info = fastQP(QBlkDiag, f, Aeq, beq, Ain_lb_ub, bin_lb_ub, pdata->state.active, alpha);
+      info = pdata->fastqp.solve(QBlkDiag, f, Aeq, beq, Ain_lb_ub, bin_lb_ub, pdata->state.active, alpha);
       //if (info<0)    mexPrintf("fastQP info=%d... calling Gurobi.\n", info);
     }
     else {
@@ -867,6 +1049,14 @@ int setupAndSolveQP(
       //info = -1;
     }
 
+    if (pdata->use_sparse_qp && (info<0 || debug)) {
+      // gurobi and the debug output need the dense constraints, which the sparse formulation skipped
+      MatrixXd A_dense(pdata->workspace.A_sparse);
+      Aeq = A_dense.topRows(neq);
+      Ain = A_dense.bottomRows(n_ineq);
+      removeInfiniteInequalities(Ain, bin);
+    }
+
     if (info<0) {
       model = gurobiQP(pdata->env,QBlkDiag,f,Aeq,beq,Ain,bin,lb,ub,pdata->state.active,alpha);
       int status; CGE(GRBgetintattr(model, "Status", &status), pdata->env);
@@ -879,10 +1069,12 @@ int setupAndSolveQP(
   //----------------------------------------------------------------------
   // Solve for inputs ----------------------------------------------------
   qp_output->qdd = alpha.head(nq);
-  VectorXd beta = alpha.segment(nq,nc*nd);
+  VectorXd& beta = pdata->workspace.beta;
+  beta = alpha.segment(nq,nc*nd);
 
   if (params->use_center_of_mass_observer) {
-    pdata->state.last_com_ddot = pdata->Jdotv + pdata->J*qp_output->qdd;
+    pdata->state.last_com_ddot.noalias() = pdata->J*qp_output->qdd;
+    pdata->state.last_com_ddot += pdata->Jdotv;
   }
 
   if (CHECK_CENTROIDAL_MOMENTUM_RATE_MATCHES_TOTAL_WRENCH) {
@@ -890,7 +1082,11 @@ int setupAndSolveQP(
   }
 
   // use transpose because B_act is orthogonal
-  qp_output->u = pdata->B_act.transpose()*(pdata->H_act*qp_output->qdd + pdata->C_act - D_act*beta);
+  VectorXd& u_before_B_act = pdata->workspace.u_before_B_act;
+  u_before_B_act.noalias() = pdata->H_act*qp_output->qdd;
+  u_before_B_act += pdata->C_act;
+  u_before_B_act.noalias() -= D_act*beta;
+  qp_output->u.noalias() = pdata->B_act.transpose()*u_before_B_act;
   for (int i=0; i < qp_output->u.size(); i++) {
       if (std::isnan(qp_output->u(i))) qp_output->u(i) = 0;
   }
@@ -899,7 +1095,7 @@ int setupAndSolveQP(
   bool foot_contact[2];
   foot_contact[0] = b_contact_force(pdata->rpc.body_ids.l_foot) == 1;
   foot_contact[1] = b_contact_force(pdata->rpc.body_ids.r_foot) == 1;
-  qp_output->qd_ref = velocityReference(pdata, robot_state.t, robot_state.q, robot_state.qd, qp_output->qdd, foot_contact, &(params->vref_integrator), &(pdata->rpc));
+  velocityReference(pdata, robot_state.t, robot_state.q, robot_state.qd, qp_output->qdd, foot_contact, &(params->vref_integrator), &(pdata->rpc), qp_output->qd_ref);
 
   // Remember t for next time around
   pdata->state.t_prev = robot_state.t;
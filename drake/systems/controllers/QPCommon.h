@@ -4,6 +4,7 @@
 #include "controlUtil.h"
 #include "drakeUtil.h"
 #include "fastQP.h"
+#include "sparseQP.h"
 #include "lcmtypes/drake/lcmt_qp_controller_input.hpp"
 #include "ExponentialPlusPiecewisePolynomial.h"
 #include <vector>
@@ -174,6 +175,73 @@ struct AtlasParams {
   Eigen::Matrix4d center_of_mass_observer_gain;
 };
 
+struct DesiredBodyAcceleration {
+  int body_or_frame_id0;
+  Vector6d body_vdot;
+  double weight;
+  Bounds accel_bounds;
+  bool control_pose_when_in_contact;
+  bool use_spatial_velocity;
+  Eigen::Isometry3d T_task_to_world;
+  Vector6d weight_multiplier;
+};
+
+struct PIDOutput {
+  Eigen::VectorXd q_ref;
+  Eigen::VectorXd qddot_des;
+};
+
+/*
+ * Storage for everything that setupAndSolveQP computes on every tick, from the support lists and the PD terms to the QP
+ * matrices. Buffers keep their capacity from one tick to the next, so they are only reallocated when the supports, the
+ * tracked bodies or the number of contact points change. A steady-state tick doesn't touch the heap, with the dense and
+ * with the sparse formulation (checked by testQPControllerAllocations).
+ */
+struct QPControllerWorkspace {
+  std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> available_supports;
+  std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> active_supports;
+  std::vector<double> adjusted_mus;
+  std::vector<DesiredBodyAcceleration,Eigen::aligned_allocator<DesiredBodyAcceleration>> desired_body_accelerations;
+  PIDOutput pid_out;
+  Eigen::VectorXd qdd_limited; // velocityReference
+  Eigen::Matrix<bool, Eigen::Dynamic, 1> has_joint_override; // addJointSoftLimits
+  eigen_aligned_unordered_map<RigidBody const *, Eigen::Matrix<double, TWIST_SIZE, 1>> f_ext;
+  Eigen::VectorXd w_qdd;
+  Eigen::MatrixXd Jcom;
+  Eigen::VectorXd Jcomdotv;
+  Eigen::VectorXd xlimp, x_bar;
+  Eigen::MatrixXd B, JB, Jp, normals;
+  Eigen::VectorXd Jpdotv;
+  CompactJacobian<double> Jp_compact; // of a single contact point
+  Eigen::MatrixXd D_float, D_act;
+  Eigen::MatrixXd Jb;
+  CompactJacobian<double,TWIST_SIZE> Jb_compact;
+  Eigen::MatrixXd JbTWJb; // compact J^T * W * J of a body acceleration cost term
+  Eigen::VectorXd f;
+  Eigen::MatrixXd Aeq, Ain, Ain_lb_ub;
+  Eigen::VectorXd beq, bin, bin_lb_ub;
+  Eigen::MatrixXd B_act_H_act, B_act_D_act;
+  Eigen::VectorXd B_act_C_act;
+  Eigen::VectorXd lb, ub, alpha, beta;
+  Eigen::VectorXd u_before_B_act; // H_act*qdd + C_act - D_act*beta
+  Eigen::MatrixXd Qnfdiag, Qneps;
+  std::vector<Eigen::MatrixXd*> QBlkDiag;
+
+  // sparse formulation: the nonzero entries of blkdiag(QBlkDiag) (lower triangle) and of [Aeq; Ain], collected block by
+  // block without forming Aeq and Ain
+  std::vector<Eigen::Triplet<double>> P_triplets, A_triplets;
+  Eigen::SparseMatrix<double> P_sparse, A_sparse;
+  Eigen::VectorXd lA, uA;
+
+  void reserve(int max_num_supports) {
+    available_supports.reserve(max_num_supports);
+    active_supports.reserve(max_num_supports);
+    adjusted_mus.reserve(max_num_supports);
+    desired_body_accelerations.reserve(max_num_supports);
+    QBlkDiag.reserve(3);
+  }
+};
+
 class NewQPControllerData {
 public:
   GRBenv *env;
@@ -183,6 +251,7 @@ public:
   void* map_ptr;
   Eigen::VectorXd umin,umax;
   int use_fast_qp;
+  bool use_sparse_qp; // solve with SparseQP (falling back to gurobi) instead of fastQP or the gurobi active set solver, see constructQPDataPointerMex
   JointNames input_joint_names;
   std::vector<std::string> state_coordinate_names;
 
@@ -191,7 +260,7 @@ public:
   Eigen::MatrixXd H, H_float, H_act;
   Eigen::VectorXd C, C_float, C_act;
   Eigen::MatrixXd B, B_act;
-  Eigen::MatrixXd J;
+  Eigen::Matrix<double, SPACE_DIMENSION, Eigen::Dynamic> J;
   Eigen::Vector3d Jdotv;
   Eigen::MatrixXd J_xy;
   Eigen::Vector2d Jdotv_xy;
@@ -199,9 +268,12 @@ public:
   Eigen::RowVectorXd fqp;
   Eigen::VectorXd qdd_lb;
   Eigen::VectorXd qdd_ub;
+  FastQP fastqp;
+  SparseQP sparseqp;
+  QPControllerWorkspace workspace;
   
   // momentum controller-specific
-  Eigen::MatrixXd Ag; // centroidal momentum matrix
+  Eigen::Matrix<double, TWIST_SIZE, Eigen::Dynamic> Ag; // centroidal momentum matrix
   Vector6d Agdot_times_v; // centroidal momentum velocity-dependent bias
   Eigen::MatrixXd Ak; // centroidal angular momentum matrix
   Eigen::Vector3d Akdot_times_v; // centroidal angular momentum velocity-dependent bias
@@ -211,24 +283,12 @@ public:
   QPControllerState state;
 
   NewQPControllerData(RigidBodyTree * r) :
-      r(r), cache(r->bodies)
+      r(r), use_sparse_qp(false), cache(r->bodies)
   {
-    // empty
+    workspace.reserve(static_cast<int>(r->bodies.size()));
   }
 };
 
-struct DesiredBodyAcceleration {
-  int body_or_frame_id0;
-  Vector6d body_vdot;
-  double weight;
-  Bounds accel_bounds;
-  bool control_pose_when_in_contact;
-  bool use_spatial_velocity;
-  KinematicPath body_path;
-  Eigen::Isometry3d T_task_to_world;
-  Vector6d weight_multiplier;
-};
-
 struct QPControllerOutput {
   Eigen::VectorXd q_ref;
   Eigen::VectorXd qd_ref;
@@ -261,20 +321,23 @@ struct QPControllerDebugData {
   Eigen::VectorXd beta;
 };
 
-struct PIDOutput {
-  Eigen::VectorXd q_ref;
-  Eigen::VectorXd qddot_des;
-};
-
 //enum PlanShiftMode {NONE, XYZ, Z_ONLY, Z_AND_ZMP};
 
 
 PIDOutput wholeBodyPID(NewQPControllerData *pdata, double t, const Eigen::Ref<const Eigen::VectorXd> &q, const Eigen::Ref<const Eigen::VectorXd> &qd, const Eigen::Ref<const Eigen::VectorXd> &q_des, WholeBodyParams *params);
 
+// wholeBodyPID writing into out, whose vectors are only reallocated if their size changes
+void wholeBodyPID(NewQPControllerData *pdata, double t, const Eigen::Ref<const Eigen::VectorXd> &q, const Eigen::Ref<const Eigen::VectorXd> &qd, const Eigen::Ref<const Eigen::VectorXd> &q_des, WholeBodyParams *params, PIDOutput &out);
+
 Eigen::VectorXd velocityReference(NewQPControllerData *pdata, double t, const Eigen::Ref<Eigen::VectorXd> &q, const Eigen::Ref<Eigen::VectorXd> &qd, const Eigen::Ref<Eigen::VectorXd> &qdd, bool foot_contact[2], VRefIntegratorParams *params, RobotPropertyCache *rpc);
 
+// velocityReference writing into qd_ref, which is only reallocated if its size changes
+void velocityReference(NewQPControllerData *pdata, double t, const Eigen::Ref<Eigen::VectorXd> &q, const Eigen::Ref<Eigen::VectorXd> &qd, const Eigen::Ref<Eigen::VectorXd> &qdd, bool foot_contact[2], VRefIntegratorParams *params, RobotPropertyCache *rpc, Eigen::VectorXd &qd_ref);
+
 std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> loadAvailableSupports(std::shared_ptr<drake::lcmt_qp_controller_input> qp_input);
 
+void loadAvailableSupports(std::shared_ptr<drake::lcmt_qp_controller_input> qp_input, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports);
+
 int setupAndSolveQP(
 		NewQPControllerData *pdata, std::shared_ptr<drake::lcmt_qp_controller_input> qp_input, DrakeRobotState &robot_state,
 		const Eigen::Ref<Eigen::Matrix<bool, Eigen::Dynamic, 1>> &b_contact_force, const std::map<Side, ForceTorqueMeasurement>& foot_force_torque_measurements,
@@ -0,0 +1,264 @@
+#include "QPControllerService.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <pthread.h>
+#include <sys/select.h>
+
+using namespace std;
+using namespace Eigen;
+
+typedef chrono::steady_clock Clock;
+
+QPControllerService::QPControllerService(const shared_ptr<lcm::LCM>& lcm, NewQPControllerData* pdata, const QPControllerServiceOptions& options) :
+    lcm(lcm), pdata(pdata), options(options), running(false),
+    robot_states(initialRobotState(pdata->r)), foot_contacts(FootContactSample {false, false}),
+    num_ticks(0), num_deadline_misses(0), num_errors(0), num_qp_fallbacks(0), num_stale_ticks(0), max_solve_time(0.0), total_solve_time(0.0), max_latency(0.0)
+{
+  if (!lcm->good())
+    throw runtime_error("QPControllerService: LCM is not initialized");
+  if (options.control_rate <= 0.0)
+    throw runtime_error("QPControllerService: control_rate must be positive");
+
+  RigidBodyTree* r = pdata->r;
+  int nq = r->num_positions;
+  if (pdata->state_coordinate_names.size() >= static_cast<size_t>(nq)) {
+    position_names.assign(pdata->state_coordinate_names.begin(), pdata->state_coordinate_names.begin() + nq);
+  } else {
+    position_names.reserve(nq);
+    for (int i = 0; i < nq; i++)
+      position_names.push_back(r->getPositionName(i));
+  }
+
+  // q and v are only laid out alike for joints whose velocities are the time derivatives of their positions
+  position_to_velocity_index.assign(nq, -1);
+  for (auto it = r->bodies.begin(); it != r->bodies.end(); ++it) {
+    const RigidBody& body = **it;
+    if (!body.hasParent())
+      continue;
+    const DrakeJoint& joint = body.getJoint();
+    if (joint.getNumPositions() != joint.getNumVelocities())
+      continue;
+    for (int j = 0; j < joint.getNumPositions(); j++)
+      position_to_velocity_index[body.position_num_start + j] = body.velocity_num_start + j;
+  }
+}
+
+QPControllerService::RobotStateSample QPControllerService::initialRobotState(RigidBodyTree* r)
+{
+  // all slots are allocated up front, so the LCM thread only writes into existing storage
+  RobotStateSample sample;
+  sample.state.t = 0.0;
+  sample.state.q = VectorXd::Zero(r->num_positions);
+  sample.state.qd = VectorXd::Zero(r->num_velocities);
+  for (auto it = r->bodies.begin(); it != r->bodies.end(); ++it) {
+    const RigidBody& body = **it;
+    // the positions of a quaternion floating base that no message fills in must still be a valid orientation
+    if (body.hasParent() && body.getJoint().isFloating() && body.getJoint().getNumPositions() == 7)
+      sample.state.q(body.position_num_start + 3) = 1.0;
+  }
+  sample.valid = false;
+  return sample;
+}
+
+QPControllerService::~QPControllerService()
+{
+  stop();
+}
+
+void QPControllerService::start()
+{
+  if (running)
+    return;
+  running = true;
+
+  subscriptions.push_back(lcm->subscribe(options.input_channel, &QPControllerService::handleInput, this));
+  subscriptions.push_back(lcm->subscribe(options.robot_state_channel, &QPControllerService::handleRobotState, this));
+  subscriptions.push_back(lcm->subscribe(options.foot_contact_channel, &QPControllerService::handleFootContact, this));
+
+  lcm_thread = thread(&QPControllerService::lcmLoop, this);
+  control_thread = thread(&QPControllerService::controlLoop, this);
+}
+
+void QPControllerService::stop()
+{
+  if (!running)
+    return;
+  running = false;
+
+  if (control_thread.joinable())
+    control_thread.join();
+  if (lcm_thread.joinable())
+    lcm_thread.join();
+
+  for (auto it = subscriptions.begin(); it != subscriptions.end(); ++it)
+    lcm->unsubscribe(*it);
+  subscriptions.clear();
+}
+
+QPControllerServiceStats QPControllerService::getStats() const
+{
+  QPControllerServiceStats stats;
+  stats.num_ticks = num_ticks;
+  stats.num_deadline_misses = num_deadline_misses;
+  stats.num_errors = num_errors;
+  stats.num_qp_fallbacks = num_qp_fallbacks;
+  stats.num_stale_ticks = num_stale_ticks;
+  stats.max_solve_time = max_solve_time;
+  stats.mean_solve_time = stats.num_ticks > 0 ? total_solve_time / stats.num_ticks : 0.0;
+  stats.max_latency = max_latency;
+  return stats;
+}
+
+void QPControllerService::handleInput(const lcm::ReceiveBuffer* rbuf, const string& channel, const drake::lcmt_qp_controller_input* msg)
+{
+  // the message is handed over as a whole, the control thread only ever reads it
+  inputs.back() = make_shared<drake::lcmt_qp_controller_input>(*msg);
+  inputs.publish();
+}
+
+void QPControllerService::handleRobotState(const lcm::ReceiveBuffer* rbuf, const string& channel, const drake::lcmt_robot_state* msg)
+{
+  if (joint_to_position_index.size() != static_cast<size_t>(msg->num_joints)) {
+    // the joint list of a state publisher doesn't change, so the name lookup is only done when a new one shows up
+    map<string, int> position_index_by_name;
+    for (int i = 0; i < static_cast<int>(position_names.size()); i++)
+      position_index_by_name[position_names[i]] = i;
+
+    joint_to_position_index.resize(msg->num_joints);
+    joint_to_velocity_index.resize(msg->num_joints);
+    for (int i = 0; i < msg->num_joints; i++) {
+      auto it = position_index_by_name.find(msg->joint_name[i]);
+      joint_to_position_index[i] = it == position_index_by_name.end() ? -1 : it->second;
+      joint_to_velocity_index[i] = it == position_index_by_name.end() ? -1 : position_to_velocity_index[it->second];
+    }
+  }
+
+  RobotStateSample& sample = robot_states.back();
+  sample.receive_time = Clock::now();
+  sample.state.t = static_cast<double>(msg->timestamp) * 1e-6;
+  for (int i = 0; i < msg->num_joints; i++) {
+    if (joint_to_position_index[i] >= 0)
+      sample.state.q(joint_to_position_index[i]) = msg->joint_position[i];
+    if (joint_to_velocity_index[i] >= 0)
+      sample.state.qd(joint_to_velocity_index[i]) = msg->joint_velocity[i];
+  }
+  sample.valid = true;
+  robot_states.publish();
+}
+
+void QPControllerService::handleFootContact(const lcm::ReceiveBuffer* rbuf, const string& channel, const drake::lcmt_foot_flag* msg)
+{
+  FootContactSample& sample = foot_contacts.back();
+  sample.left = msg->left;
+  sample.right = msg->right;
+  foot_contacts.publish();
+}
+
+void QPControllerService::lcmLoop()
+{
+  int fd = lcm->getFileno();
+  while (running) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    struct timeval timeout = { 0, 100000 };  // so that stop() is noticed
+    int status = select(fd + 1, &fds, 0, 0, &timeout);
+    if (status > 0 && FD_ISSET(fd, &fds))
+      lcm->handle();
+  }
+}
+
+void QPControllerService::controlLoop()
+{
+  if (options.realtime_priority > 0) {
+    struct sched_param param;
+    param.sched_priority = options.realtime_priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+      cerr << "QPControllerService: could not set the real-time priority of the control thread, running with the default scheduling" << endl;
+  }
+
+  const Clock::duration period = chrono::duration_cast<Clock::duration>(chrono::duration<double>(1.0 / options.control_rate));
+  int nbodies = pdata->r->bodies.size();
+  Matrix<bool, Dynamic, 1> b_contact_force = Matrix<bool, Dynamic, 1>::Zero(nbodies);
+  const map<Side, ForceTorqueMeasurement> foot_force_torque_measurements;
+  QPControllerOutput qp_output;
+
+  drake::lcmt_drake_signal output_msg;
+  output_msg.dim = static_cast<int32_t>(pdata->input_joint_names.drake.size());
+  output_msg.val.resize(output_msg.dim);
+  output_msg.coord = pdata->input_joint_names.drake;
+
+  // setupAndSolveQP modifies its input (it appends the joint soft limit overrides), so every tick works on a fresh copy
+  // of the latest input. Copying into the same message reuses its storage
+  shared_ptr<drake::lcmt_qp_controller_input> tick_input = make_shared<drake::lcmt_qp_controller_input>();
+
+  bool have_input = false;
+  int ticks_since_robot_state = 0;
+  Clock::time_point next_tick = Clock::now() + period;
+  while (running) {
+    this_thread::sleep_until(next_tick);
+    next_tick += period;
+
+    have_input = inputs.update() || have_input;
+    bool new_robot_state = robot_states.update();
+    foot_contacts.update();
+
+    const RobotStateSample& state_sample = robot_states.front();
+    if (!have_input || !state_sample.valid)
+      continue;
+
+    // an output computed from an old state is worse than none, so the service goes quiet until the state is fresh again
+    if (new_robot_state) {
+      ticks_since_robot_state = 0;
+    } else if (options.max_stale_ticks > 0 && ticks_since_robot_state >= options.max_stale_ticks) {
+      num_stale_ticks++;
+      continue;
+    } else if (options.max_stale_ticks > 0) {
+      ticks_since_robot_state++;
+    }
+
+    const FootContactSample& contact = foot_contacts.front();
+    b_contact_force(pdata->rpc.body_ids.l_foot) = contact.left;
+    b_contact_force(pdata->rpc.body_ids.r_foot) = contact.right;
+
+    // setupAndSolveQP takes a non-const state, so the control thread works on its front slot directly
+    DrakeRobotState& robot_state = robot_states.front().state;
+
+    Clock::time_point solve_start = Clock::now();
+    *tick_input = *inputs.front();
+    int info;
+    try {
+      info = setupAndSolveQP(pdata, tick_input, robot_state, b_contact_force, foot_force_torque_measurements, &qp_output, nullptr);
+    } catch (const exception&) {
+      // no logging on the control thread, console output can block; the errors are counted in the stats instead
+      num_errors++;
+      continue;
+    }
+    Clock::time_point solve_end = Clock::now();
+    // a negative info is the code of the first solver (fastQP or SparseQP), which then handed the QP to gurobi
+    if (info < 0)
+      num_qp_fallbacks++;
+
+    for (int i = 0; i < output_msg.dim && i < qp_output.u.size(); i++)
+      output_msg.val[i] = qp_output.u(i);
+    output_msg.timestamp = static_cast<int64_t>(robot_state.t * 1e6);
+    lcm->publish(options.output_channel, &output_msg);
+    Clock::time_point publish_time = Clock::now();
+
+    double solve_time = chrono::duration<double>(solve_end - solve_start).count();
+    double latency = chrono::duration<double>(publish_time - state_sample.receive_time).count();
+    total_solve_time = total_solve_time + solve_time;
+    max_solve_time = max(static_cast<double>(max_solve_time), solve_time);
+    max_latency = max(static_cast<double>(max_latency), latency);
+    num_ticks++;
+
+    if (publish_time > next_tick) {
+      num_deadline_misses++;
+      // skip the periods that have already passed instead of running a burst of late ticks
+      while (next_tick < publish_time)
+        next_tick += period;
+    }
+  }
+}
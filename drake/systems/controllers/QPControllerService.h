@@ -0,0 +1,124 @@
+#ifndef _QP_CONTROLLER_SERVICE_H_
+#define _QP_CONTROLLER_SERVICE_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <lcm/lcm-cpp.hpp>
+#include "QPCommon.h"
+#include "TripleBuffer.h"
+#include "lcmtypes/drake/lcmt_qp_controller_input.hpp"
+#include "lcmtypes/drake/lcmt_robot_state.hpp"
+#include "lcmtypes/drake/lcmt_foot_flag.hpp"
+#include "lcmtypes/drake/lcmt_drake_signal.hpp"
+
+struct QPControllerServiceOptions {
+  std::string input_channel = "QP_CONTROLLER_INPUT";
+  std::string robot_state_channel = "EST_ROBOT_STATE";
+  std::string foot_contact_channel = "FOOT_CONTACT_ESTIMATE";
+  std::string output_channel = "QP_CONTROLLER_OUTPUT"; // lcmt_drake_signal with the actuator efforts, named after pdata->input_joint_names.drake
+  double control_rate = 1000.0; // Hz
+  int realtime_priority = 0; // SCHED_FIFO priority of the control thread, 0 keeps the default scheduling
+  int max_stale_ticks = 50; // ticks without a new robot state after which the service stops publishing until one arrives, <= 0 never stops
+};
+
+struct QPControllerServiceStats {
+  long num_ticks; // ticks in which the QP was solved and an output was published
+  long num_deadline_misses; // ticks that ran past the start of the next period
+  long num_errors; // ticks in which setupAndSolveQP threw
+  long num_qp_fallbacks; // ticks in which fastQP or SparseQP failed and the QP was solved by gurobi instead
+  long num_stale_ticks; // ticks in which nothing was published because the robot state was older than max_stale_ticks ticks
+  double max_solve_time; // s
+  double mean_solve_time; // s
+  double max_latency; // from receiving a robot state to publishing the output computed from it, s
+};
+
+/*
+ * Runs the QP controller (setupAndSolveQP) as a standalone service, without MATLAB in the loop.
+ *
+ * Plan input (lcmt_qp_controller_input), robot state (lcmt_robot_state) and foot contact (lcmt_foot_flag) messages are
+ * received on an LCM thread and handed to a dedicated control thread through lock-free triple buffers, so the control
+ * thread never waits on the LCM thread. The control thread ticks at a fixed rate, solves the QP for the latest input
+ * and state, and publishes the actuator efforts. A tick that doesn't finish before the next one is due counts as a
+ * deadline miss, and the missed periods are skipped rather than made up for. If no new robot state arrives for more than
+ * max_stale_ticks ticks, e.g. because the state estimator died, the service stops publishing, so that whatever listens
+ * to the output can fall back to a safe behavior instead of tracking efforts computed from an old state. Publishing
+ * resumes with the next robot state. The control thread doesn't write to the console, which could block it; deadline
+ * misses, exceptions, gurobi fallbacks and stale ticks are only counted, see getStats().
+ *
+ * pdata has to be fully set up (param sets, robot property cache, joint names), e.g. the way
+ * constructQPDataPointerMex does it, and must not be used by anyone else while the service is running.
+ *
+ * The joints of lcmt_robot_state are matched to the positions of the robot by name. Joint velocities go to the
+ * velocity of the same joint. Positions that no message names, such as a floating base that the state publisher
+ * leaves out, keep the zero configuration (with an identity quaternion for a quaternion floating base) and a zero
+ * velocity.
+ */
+class QPControllerService {
+public:
+  QPControllerService(const std::shared_ptr<lcm::LCM>& lcm, NewQPControllerData* pdata, const QPControllerServiceOptions& options = QPControllerServiceOptions());
+  ~QPControllerService();
+
+  void start();
+  void stop();
+  bool isRunning() const { return running; }
+
+  QPControllerServiceStats getStats() const;
+
+private:
+  struct RobotStateSample {
+    DrakeRobotState state;
+    std::chrono::steady_clock::time_point receive_time;
+    bool valid;
+  };
+
+  struct FootContactSample {
+    bool left;
+    bool right;
+  };
+
+  static RobotStateSample initialRobotState(RigidBodyTree* r);
+
+  void handleInput(const lcm::ReceiveBuffer* rbuf, const std::string& channel, const drake::lcmt_qp_controller_input* msg);
+  void handleRobotState(const lcm::ReceiveBuffer* rbuf, const std::string& channel, const drake::lcmt_robot_state* msg);
+  void handleFootContact(const lcm::ReceiveBuffer* rbuf, const std::string& channel, const drake::lcmt_foot_flag* msg);
+
+  void lcmLoop();
+  void controlLoop();
+
+  std::shared_ptr<lcm::LCM> lcm;
+  NewQPControllerData* pdata;
+  QPControllerServiceOptions options;
+
+  std::vector<lcm::Subscription*> subscriptions;
+  std::thread lcm_thread;
+  std::thread control_thread;
+  std::atomic<bool> running;
+
+  // set up by the constructor
+  std::vector<std::string> position_names;
+  std::vector<int> position_to_velocity_index; // -1 for positions whose time derivative isn't a velocity, e.g. quaternions
+
+  // written by the LCM thread only
+  std::vector<int> joint_to_position_index; // for the joints of the last lcmt_robot_state, -1 if not in the model
+  std::vector<int> joint_to_velocity_index; // for the joints of the last lcmt_robot_state, -1 if qd has no matching entry
+
+  TripleBuffer<std::shared_ptr<drake::lcmt_qp_controller_input>> inputs;
+  TripleBuffer<RobotStateSample> robot_states;
+  TripleBuffer<FootContactSample> foot_contacts;
+
+  // written by the control thread only
+  std::atomic<long> num_ticks;
+  std::atomic<long> num_deadline_misses;
+  std::atomic<long> num_errors;
+  std::atomic<long> num_qp_fallbacks;
+  std::atomic<long> num_stale_ticks;
+  std::atomic<double> max_solve_time;
+  std::atomic<double> total_solve_time;
+  std::atomic<double> max_latency;
+};
+
+#endif
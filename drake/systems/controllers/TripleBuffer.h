@@ -0,0 +1,63 @@
+#ifndef _TRIPLE_BUFFER_H_
+#define _TRIPLE_BUFFER_H_
+
+#include <atomic>
+
+/*
+ * Lock-free handoff of the most recent value from a single producer thread to a single consumer thread.
+ *
+ * The producer writes into back() and then calls publish(). The consumer calls update(), which returns true if a
+ * value was published since its last update, and then reads front(). Neither side ever blocks or waits on the other.
+ * Values that are published while the consumer isn't looking are overwritten, so the consumer always sees the latest
+ * one.
+ *
+ * The three slots are exchanged rather than copied, so their storage is reused: a producer that assigns into back()
+ * without changing sizes doesn't allocate, and whatever a slot owns is released by the producer when it overwrites the
+ * slot, not by the consumer.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() : middle(1), back_index(2), front_index(0) { }
+
+  explicit TripleBuffer(const T& initial_value) : middle(1), back_index(2), front_index(0)
+  {
+    for (int i = 0; i < 3; i++)
+      slots[i] = initial_value;
+  }
+
+  // producer side
+  T& back() { return slots[back_index]; }
+
+  void publish()
+  {
+    back_index = middle.exchange(back_index | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  // consumer side
+  bool update()
+  {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH))
+      return false;
+    front_index = middle.exchange(front_index, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+
+  T& front() { return slots[front_index]; }
+  const T& front() const { return slots[front_index]; }
+
+private:
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  static const unsigned INDEX_MASK = 3;
+  static const unsigned FRESH = 4; // set in middle when it holds a value the consumer hasn't seen yet
+
+  T slots[3];
+  std::atomic<unsigned> middle; // index of the slot that is in neither thread's hands, plus the FRESH flag
+  unsigned back_index; // only touched by the producer
+  unsigned front_index; // only touched by the consumer
+};
+
+#endif
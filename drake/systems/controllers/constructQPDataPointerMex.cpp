@@ -287,7 +287,7 @@ void parseRobotJointNames(const mxArray *input_names, JointNames *joint_names) {
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
 {
-  if (nrhs<1) mexErrMsgTxt("usage: ptr = constructQPDataPointerMex(robot_obj, params_sets, robot_property_cache, B, umin, umax, gurobi_opts);");
+  if (nrhs<1) mexErrMsgTxt("usage: ptr = constructQPDataPointerMex(robot_obj, params_sets, robot_property_cache, B, umin, umax, use_fast_qp, gurobi_opts, coordinate_names, use_sparse_qp);");
 
   if (nrhs == 1) {
     // By convention, calling the constructor with just one argument (the pointer) should delete the pointer
@@ -343,6 +343,12 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   pdata->state_coordinate_names = get_strings(myGetField(prhs[narg], "state"));
   narg++;
 
+  // use_sparse_qp (optional): solve with the sparse ADMM solver, falling back to gurobi
+  if (narg < nrhs) {
+    pdata->use_sparse_qp = mxGetScalar(prhs[narg]) != 0;
+    narg++;
+  }
+
   // Done parsing inputs
 
   pdata->B_act.resize(nu,nu);
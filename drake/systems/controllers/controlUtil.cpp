@@ -81,16 +81,40 @@ int contactPhi(RigidBodyTree * r, const KinematicsCache<double>& cache, SupportS
 
   if (nc<1) return nc;
 
+  Isometry3d T_body_to_world = r->relativeTransform(cache, 0, supp.body_idx);
   int i=0;
   for (auto pt_iter = supp.contact_pts.begin(); pt_iter != supp.contact_pts.end(); pt_iter++) {
-    Vector3d contact_pos = r->forwardKin(cache, *pt_iter, supp.body_idx, 0, 0);
+    Vector3d contact_pos = T_body_to_world * (*pt_iter);
     phi(i) = supp.support_surface.head<3>().dot(contact_pos) + supp.support_surface(3);
     i++;
   }
   return nc;
 }
 
-int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache, int nc, std::vector<double> support_mus, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& supp, MatrixXd &B, MatrixXd &JB, MatrixXd &Jp, VectorXd &Jpdotv, MatrixXd &normals)
+/*
+ * true if any of the contact points of supp is within contact_threshold of its support surface, like
+ * contactPhi(...).minCoeff() <= contact_threshold, without the vector of distances.
+ */
+static bool kinematicContactDetected(RigidBodyTree * r, const KinematicsCache<double>& cache, const SupportStateElement& supp, double contact_threshold)
+{
+  if (supp.contact_pts.empty()) return false;
+
+  Isometry3d T_body_to_world = r->relativeTransform(cache, 0, supp.body_idx);
+  for (auto pt_iter = supp.contact_pts.begin(); pt_iter != supp.contact_pts.end(); pt_iter++) {
+    Vector3d contact_pos = T_body_to_world * (*pt_iter);
+    if (supp.support_surface.head<3>().dot(contact_pos) + supp.support_surface(3) <= contact_threshold)
+      return true;
+  }
+  return false;
+}
+
+int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache, int nc, const std::vector<double>& support_mus, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& supp, MatrixXd &B, MatrixXd &JB, MatrixXd &Jp, VectorXd &Jpdotv, MatrixXd &normals)
+{
+  CompactJacobian<double> J;
+  return contactConstraintsBV(r, cache, nc, support_mus, supp, B, JB, Jp, Jpdotv, normals, J);
+}
+
+int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache, int nc, const std::vector<double>& support_mus, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& supp, MatrixXd &B, MatrixXd &JB, MatrixXd &Jp, VectorXd &Jpdotv, MatrixXd &normals, CompactJacobian<double> &J)
 {
   int j, k=0, nq = r->num_positions;
 
@@ -100,8 +124,7 @@ int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache,
   Jpdotv.resize(3*nc);
   normals.resize(3, nc);
   
-  Vector3d contact_pos,pos,normal; 
-  MatrixXd J(3,nq);
+  Vector3d normal;
   Matrix<double,3,m_surface_tangents> d;
   
   for (std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>::iterator iter = supp.begin(); iter!=supp.end(); iter++) {
@@ -109,8 +132,12 @@ int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache,
     double norm = sqrt(1+mu*mu); // because normals and ds are orthogonal, the norm has a simple form
     if (nc>0) {
       for (auto pt_iter=iter->contact_pts.begin(); pt_iter!=iter->contact_pts.end(); pt_iter++) {
-        contact_pos = r->forwardKin(cache, *pt_iter, iter->body_idx, 0, 0);
-        J = r->forwardKinJacobian(cache, *pt_iter, iter->body_idx, 0, 0, true);
+        // store away kin sols into Jp and Jpdotv
+        // NOTE: I'm cheating and using a slightly different ordering of J and Jdot here
+        r->forwardKinJacobian(cache, *pt_iter, iter->body_idx, 0, 0, true, J);
+        auto Jp_block = Jp.block(3*k,0,3,nq);
+        J.toFull(Jp_block);
+        r->forwardJacDotTimesV<double>(cache, *pt_iter, iter->body_idx, 0, 0, Jpdotv.segment(3*k,3));
 
         normal = iter->support_surface.head(3);
         surfaceTangents(normal,d);
@@ -118,15 +145,10 @@ int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache,
           B.col(2*k*m_surface_tangents+j) = (normal + mu*d.col(j)) / norm; 
           B.col((2*k+1)*m_surface_tangents+j) = (normal - mu*d.col(j)) / norm; 
     
-          JB.col(2 * k * m_surface_tangents + j) = J.transpose() * B.col(2 * k * m_surface_tangents + j);
-          JB.col((2 * k + 1) * m_surface_tangents + j) = J.transpose() * B.col((2*k+1)*m_surface_tangents+j);
+          JB.col(2 * k * m_surface_tangents + j).noalias() = Jp_block.transpose() * B.col(2 * k * m_surface_tangents + j);
+          JB.col((2 * k + 1) * m_surface_tangents + j).noalias() = Jp_block.transpose() * B.col((2*k+1)*m_surface_tangents+j);
         }
 
-        // store away kin sols into Jp and Jpdotv
-        // NOTE: I'm cheating and using a slightly different ordering of J and Jdot here
-        Jp.block(3*k,0,3,nq) = J;
-        Vector3d pt = (*pt_iter).head(3);
-        Jpdotv.block(3*k,0,3,1) = r->forwardJacDotTimesV(cache, pt,iter->body_idx,0,0);
         normals.col(k) = normal;
         
         k++;
@@ -207,62 +229,80 @@ bool isSupportElementActive(SupportStateElement* se, bool contact_force_detected
   return is_active;
 }
 
-Matrix<bool, Dynamic, 1> getActiveSupportMask(RigidBodyTree * r, VectorXd q, VectorXd qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold) {
-  KinematicsCache<double> cache = r->doKinematics(q, qd);
+static bool isSupportActive(RigidBodyTree * r, const KinematicsCache<double>& cache, SupportStateElement& se, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold) {
+  bool force_contact = (contact_force_detected(se.body_idx) != 0);
+  // Determine if the body needs to be checked for kinematic contact. We only
+  // need to check for kin contact if the logic map indicates that the
+  // presence or absence of such contact would  affect the decision about
+  // whether to use that body as a support.
+  bool needs_kin_check = (((se.support_logic_map[1] != se.support_logic_map[0]) && (contact_force_detected(se.body_idx) == 0)) ||
+                          ((se.support_logic_map[3] != se.support_logic_map[2]) && (contact_force_detected(se.body_idx) == 1)));
 
-  size_t nsupp = available_supports.size();
-  Matrix<bool, Dynamic, 1> active_supp_mask = Matrix<bool, Dynamic, 1>::Zero(nsupp);
-  VectorXd phi;
-  SupportStateElement se;
-  bool needs_kin_check;
   bool kin_contact;
-  bool force_contact;
-
-  for (size_t i = 0; i < nsupp; i++) {
-    // mexPrintf("evaluating support: %d\n", i);
-    se = available_supports[i];
-
-    force_contact = (contact_force_detected(se.body_idx) != 0);
-    // Determine if the body needs to be checked for kinematic contact. We only
-    // need to check for kin contact if the logic map indicates that the
-    // presence or absence of such contact would  affect the decision about
-    // whether to use that body as a support.
-    needs_kin_check = (((se.support_logic_map[1] != se.support_logic_map[0]) && (contact_force_detected(se.body_idx) == 0)) ||
-                       ((se.support_logic_map[3] != se.support_logic_map[2]) && (contact_force_detected(se.body_idx) == 1)));
-
-
-    if (needs_kin_check) {
-      if (contact_threshold == -1) {
-        kin_contact = true;
-      } else {
-        contactPhi(r, cache, se, phi);
-        kin_contact = (phi.minCoeff()<=contact_threshold);
-      }
+  if (needs_kin_check) {
+    if (contact_threshold == -1) {
+      kin_contact = true;
     } else {
-      kin_contact = false; // we've determined already that kin contact doesn't matter for this support element
+      kin_contact = kinematicContactDetected(r, cache, se, contact_threshold);
     }
-
-    active_supp_mask(i) = isSupportElementActive(&se, force_contact, kin_contact);
-    // mexPrintf("needs check: %d force contact: %d kin_contact: %d is_active: %d\n", needs_kin_check, force_contact, kin_contact, active_supp_mask(i));
+  } else {
+    kin_contact = false; // we've determined already that kin contact doesn't matter for this support element
   }
-  return active_supp_mask;
+  return isSupportElementActive(&se, force_contact, kin_contact);
 }
 
-std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> getActiveSupports(RigidBodyTree * r, VectorXd q, VectorXd qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold) {
+Matrix<bool, Dynamic, 1> getActiveSupportMask(RigidBodyTree * r, const Ref<const VectorXd> &q, const Ref<const VectorXd> &qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold) {
+  KinematicsCache<double> cache = r->doKinematics(q, qd);
+  return getActiveSupportMask(r, cache, available_supports, contact_force_detected, contact_threshold);
+}
 
-  Matrix<bool, Dynamic, 1> active_supp_mask = getActiveSupportMask(r, q, qd, available_supports, contact_force_detected, contact_threshold);
+Matrix<bool, Dynamic, 1> getActiveSupportMask(RigidBodyTree * r, const KinematicsCache<double>& cache, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold) {
+  size_t nsupp = available_supports.size();
+  Matrix<bool, Dynamic, 1> active_supp_mask = Matrix<bool, Dynamic, 1>::Zero(nsupp);
+  for (size_t i = 0; i < nsupp; i++) {
+    active_supp_mask(i) = isSupportActive(r, cache, available_supports[i], contact_force_detected, contact_threshold);
+  }
+  return active_supp_mask;
+}
 
+std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> getActiveSupports(RigidBodyTree * r, const Ref<const VectorXd> &q, const Ref<const VectorXd> &qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold) {
   std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> active_supports;
+  getActiveSupports(r, q, qd, available_supports, contact_force_detected, contact_threshold, active_supports);
+  return active_supports;
+}
 
+void getActiveSupports(RigidBodyTree * r, const Ref<const VectorXd> &q, const Ref<const VectorXd> &qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &active_supports) {
+  KinematicsCache<double> cache = r->doKinematics(q, qd);
+  getActiveSupports(r, cache, available_supports, contact_force_detected, contact_threshold, active_supports);
+}
+
+void getActiveSupports(RigidBodyTree * r, const KinematicsCache<double>& cache, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Ref<const Matrix<bool, Dynamic, 1>> &contact_force_detected, double contact_threshold, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &active_supports) {
+  size_t num_active = 0;
   for (size_t i=0; i < available_supports.size(); i++) {
-    if (active_supp_mask(i)) {
-      active_supports.push_back(available_supports[i]);
+    if (isSupportActive(r, cache, available_supports[i], contact_force_detected, contact_threshold)) {
+      if (num_active < active_supports.size())
+        active_supports[num_active] = available_supports[i]; // reuses the contact_pts storage
+      else
+        active_supports.push_back(available_supports[i]);
+      num_active++;
     }
   }
-  return active_supports;
+  active_supports.resize(num_active);
 }
 
 Vector6d bodySpatialMotionPD(RigidBodyTree *r, DrakeRobotState &robot_state, const int body_index, const Isometry3d &body_pose_des, const Ref<const Vector6d> &body_v_des, const Ref<const Vector6d> &body_vdot_des, const Ref<const Vector6d> &Kp, const Ref<const Vector6d> &Kd, const Isometry3d &T_task_to_world)
+{
+  KinematicsCache<double> cache = r->doKinematics(robot_state.q, robot_state.qd);
+  return bodySpatialMotionPD(r, cache, body_index, body_pose_des, body_v_des, body_vdot_des, Kp, Kd, T_task_to_world);
+}
+
+Vector6d bodySpatialMotionPD(RigidBodyTree *r, const KinematicsCache<double>& cache, const int body_index, const Isometry3d &body_pose_des, const Ref<const Vector6d> &body_v_des, const Ref<const Vector6d> &body_vdot_des, const Ref<const Vector6d> &Kp, const Ref<const Vector6d> &Kd, const Isometry3d &T_task_to_world)
+{
+  CompactJacobian<double, TWIST_SIZE> J_geometric;
+  return bodySpatialMotionPD(r, cache, body_index, body_pose_des, body_v_des, body_vdot_des, Kp, Kd, T_task_to_world, J_geometric);
+}
+
+Vector6d bodySpatialMotionPD(RigidBodyTree *r, const KinematicsCache<double>& cache, const int body_index, const Isometry3d &body_pose_des, const Ref<const Vector6d> &body_v_des, const Ref<const Vector6d> &body_vdot_des, const Ref<const Vector6d> &Kp, const Ref<const Vector6d> &Kd, const Isometry3d &T_task_to_world, CompactJacobian<double, TWIST_SIZE> &J_geometric)
 {
   // @param body_pose_des  desired pose in the task frame, this is the homogeneous transformation from desired body frame to task frame 
   // @param body_v_des    desired [xyzdot;angular_velocity] in task frame
@@ -273,22 +313,17 @@ Vector6d bodySpatialMotionPD(RigidBodyTree *r, DrakeRobotState &robot_state, con
   // @retval twist_dot, [angular_acceleration, xyz_acceleration] in body frame
 
   Isometry3d T_world_to_task = T_task_to_world.inverse();
-  KinematicsCache<double> cache = r->doKinematics(robot_state.q, robot_state.qd);
 
-  Vector3d origin = Vector3d::Zero();
-  auto body_pose = r->forwardKin(cache, origin, body_index, 0, 2);
-  Vector3d body_xyz = body_pose.head<3>();
-  Vector3d body_xyz_task = T_world_to_task * body_xyz.colwise().homogeneous();
-  Vector4d body_quat = body_pose.tail<4>();
-  std::vector<int> v_indices;
-  auto J_geometric = r->geometricJacobian(cache, 0, body_index, body_index, true, &v_indices);
-  VectorXd v_compact(v_indices.size());
-  for(size_t i = 0;i<v_indices.size();i++)
+  Isometry3d T_body_to_world = r->relativeTransform(cache, 0, body_index);
+  Vector3d body_xyz = T_body_to_world.translation();
+  Vector3d body_xyz_task = T_world_to_task * body_xyz;
+  r->geometricJacobian(cache, 0, body_index, body_index, true, J_geometric);
+  Vector6d body_twist = Vector6d::Zero();
+  for(size_t i = 0;i<J_geometric.indices.size();i++)
   {
-    v_compact(i) = robot_state.qd(v_indices[i]);
+    body_twist.noalias() += J_geometric.value.col(i) * cache.getV()(J_geometric.indices[i]);
   }
-  Vector6d body_twist = J_geometric * v_compact;
-  Matrix3d R_body_to_world = quat2rotmat(body_quat);
+  Matrix3d R_body_to_world = T_body_to_world.linear();
   Matrix3d R_world_to_body = R_body_to_world.transpose();
   Matrix3d R_body_to_task = T_world_to_task.linear() * R_body_to_world;
   Vector3d body_angular_vel = R_body_to_world * body_twist.head<3>();// body_angular velocity in world frame
@@ -327,22 +362,27 @@ Vector6d bodySpatialMotionPD(RigidBodyTree *r, DrakeRobotState &robot_state, con
 
 void evaluateXYZExpmapCubicSpline(double t, const PiecewisePolynomial<double> &spline, Isometry3d &body_pose_des, Vector6d &xyzdot_angular_vel, Vector6d &xyzddot_angular_accel) {
   Vector6d xyzexp = spline.value(t);
-  auto derivative = spline.derivative();
-  Vector6d xyzexpdot = derivative.value(t);
-  Vector6d xyzexpddot = derivative.derivative().value(t);
+  Vector6d xyzexpdot = spline.derivativeValue(t, 1);
+  Vector6d xyzexpddot = spline.derivativeValue(t, 2);
+  evaluateXYZExpmap(xyzexp, xyzexpdot, xyzexpddot, body_pose_des, xyzdot_angular_vel, xyzddot_angular_accel);
+}
+
+void evaluateXYZExpmap(const Vector6d &xyzexp, const Vector6d &xyzexpdot, const Vector6d &xyzexpddot, Isometry3d &body_pose_des, Vector6d &xyzdot_angular_vel, Vector6d &xyzddot_angular_accel) {
   xyzdot_angular_vel.head<3>() = xyzexpdot.head<3>();
   xyzddot_angular_accel.head<3>() = xyzexpddot.head<3>();
   Vector3d expmap = xyzexp.tail<3>();
-  auto quat_grad = expmap2quat(expmap,2);
-  Vector4d quat = quat_grad.value();
+  // what expmap2quat(expmap,2) computes, without the dynamically sized gradients of GradientVar
+  double theta = expmap.norm();
+  bool degenerate = theta < pow(std::numeric_limits<double>::epsilon(), 0.25);
+  Vector4d quat = degenerate ? expmap2quatDegenerate(expmap, theta) : expmap2quatNonDegenerate(expmap, theta);
+  Matrix<double,4,3> dquat = degenerate ? dexpmap2quatDegenerate(expmap, theta) : dexpmap2quatNonDegenerate(expmap, theta);
+  Matrix<double,12,3> dE = degenerate ? ddexpmap2quatDegenerate(expmap, theta) : ddexpmap2quatNonDegenerate(expmap, theta);
   body_pose_des.linear() = quat2rotmat(quat);
   body_pose_des.translation() = xyzexp.head<3>();
-  Vector4d quat_dot = quat_grad.gradient().value() * xyzexpdot.tail<3>();
-  quat_grad.gradient().gradient().value().resize(12,3);
-  Matrix<double,12,3> dE = quat_grad.gradient().gradient().value();
+  Vector4d quat_dot = dquat * xyzexpdot.tail<3>();
   Vector3d expdot = xyzexpdot.tail<3>();
   Matrix<double,4,3> Edot = matGradMult(dE,expdot);
-  Vector4d quat_ddot = quat_grad.gradient().value()*xyzexpddot.tail<3>() + Edot*expdot;
+  Vector4d quat_ddot = dquat*xyzexpddot.tail<3>() + Edot*expdot;
   Matrix<double,3,4> M;
   Matrix<double,12,4> dM;
   quatdot2angularvelMatrix(quat,M,&dM);
@@ -48,9 +48,16 @@ struct DrakeRobotState {
 
 drakeControlUtilEXPORT bool isSupportElementActive(SupportStateElement* se, bool contact_force_detected, bool kinematic_contact_detected);
 
-drakeControlUtilEXPORT Eigen::Matrix<bool, Eigen::Dynamic, 1> getActiveSupportMask(RigidBodyTree * r, Eigen::VectorXd q, Eigen::VectorXd qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Eigen::Ref<const Eigen::Matrix<bool, Eigen::Dynamic, 1>> &contact_force_detected, double contact_threshold);
+drakeControlUtilEXPORT Eigen::Matrix<bool, Eigen::Dynamic, 1> getActiveSupportMask(RigidBodyTree * r, const Eigen::Ref<const Eigen::VectorXd> &q, const Eigen::Ref<const Eigen::VectorXd> &qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Eigen::Ref<const Eigen::Matrix<bool, Eigen::Dynamic, 1>> &contact_force_detected, double contact_threshold);
 
-drakeControlUtilEXPORT std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> getActiveSupports(RigidBodyTree * r, Eigen::VectorXd q, Eigen::VectorXd qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Eigen::Ref<const Eigen::Matrix<bool, Eigen::Dynamic, 1>> &contact_force_detected, double contact_threshold);
+drakeControlUtilEXPORT std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> getActiveSupports(RigidBodyTree * r, const Eigen::Ref<const Eigen::VectorXd> &q, const Eigen::Ref<const Eigen::VectorXd> &qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Eigen::Ref<const Eigen::Matrix<bool, Eigen::Dynamic, 1>> &contact_force_detected, double contact_threshold);
+
+// same as above, but overwrites the elements of active_supports in place so that their storage is reused
+drakeControlUtilEXPORT void getActiveSupports(RigidBodyTree * r, const Eigen::Ref<const Eigen::VectorXd> &q, const Eigen::Ref<const Eigen::VectorXd> &qd, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Eigen::Ref<const Eigen::Matrix<bool, Eigen::Dynamic, 1>> &contact_force_detected, double contact_threshold, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &active_supports);
+
+// versions that use kinematics the caller has already computed for the current state
+drakeControlUtilEXPORT Eigen::Matrix<bool, Eigen::Dynamic, 1> getActiveSupportMask(RigidBodyTree * r, const KinematicsCache<double>& cache, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Eigen::Ref<const Eigen::Matrix<bool, Eigen::Dynamic, 1>> &contact_force_detected, double contact_threshold);
+drakeControlUtilEXPORT void getActiveSupports(RigidBodyTree * r, const KinematicsCache<double>& cache, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &available_supports, const Eigen::Ref<const Eigen::Matrix<bool, Eigen::Dynamic, 1>> &contact_force_detected, double contact_threshold, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &active_supports);
 
 template <typename DerivedA, typename DerivedB>
 drakeControlUtilEXPORT void getRows(std::set<int> &rows, Eigen::MatrixBase<DerivedA> const &M, Eigen::MatrixBase<DerivedB> &Msub);
@@ -64,11 +71,18 @@ drakeControlUtilEXPORT void angleDiff(Eigen::MatrixBase<DerivedPhi1> const &phi1
 drakeControlUtilEXPORT bool inSupport(std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>> &supports, int body_idx);
 drakeControlUtilEXPORT void surfaceTangents(const Eigen::Vector3d & normal, Eigen::Matrix<double,3,m_surface_tangents> & d);
 drakeControlUtilEXPORT int contactPhi(RigidBodyTree * r, const KinematicsCache<double>& cache, SupportStateElement& supp, Eigen::VectorXd &phi);
-drakeControlUtilEXPORT int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache, int nc, std::vector<double> support_mus, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& supp, Eigen::MatrixXd &B, Eigen::MatrixXd &JB, Eigen::MatrixXd &Jp, Eigen::VectorXd &Jpdotv, Eigen::MatrixXd &normals);
+drakeControlUtilEXPORT int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache, int nc, const std::vector<double>& support_mus, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& supp, Eigen::MatrixXd &B, Eigen::MatrixXd &JB, Eigen::MatrixXd &Jp, Eigen::VectorXd &Jpdotv, Eigen::MatrixXd &normals);
+// contactConstraintsBV with the Jacobian of each contact point computed in J, so that a J kept across calls saves the allocations
+drakeControlUtilEXPORT int contactConstraintsBV(RigidBodyTree *r, const KinematicsCache<double>& cache, int nc, const std::vector<double>& support_mus, std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& supp, Eigen::MatrixXd &B, Eigen::MatrixXd &JB, Eigen::MatrixXd &Jp, Eigen::VectorXd &Jpdotv, Eigen::MatrixXd &normals, CompactJacobian<double> &J);
 drakeControlUtilEXPORT Eigen::MatrixXd individualSupportCOPs(RigidBodyTree * r, const KinematicsCache<double>& cache, const std::vector<SupportStateElement,Eigen::aligned_allocator<SupportStateElement>>& active_supports, const Eigen::MatrixXd& normals, const Eigen::MatrixXd& B, const Eigen::VectorXd& beta);
 drakeControlUtilEXPORT Vector6d bodySpatialMotionPD(RigidBodyTree *r, DrakeRobotState &robot_state, const int body_index, const Eigen::Isometry3d &body_pose_des, const Eigen::Ref<const Vector6d> &body_v_des, const Eigen::Ref<const Vector6d> &body_vdot_des, const Eigen::Ref<const Vector6d> &Kp, const Eigen::Ref<const Vector6d> &Kd, const Eigen::Isometry3d &T_task_to_world=Eigen::Isometry3d::Identity());
+drakeControlUtilEXPORT Vector6d bodySpatialMotionPD(RigidBodyTree *r, const KinematicsCache<double>& cache, const int body_index, const Eigen::Isometry3d &body_pose_des, const Eigen::Ref<const Vector6d> &body_v_des, const Eigen::Ref<const Vector6d> &body_vdot_des, const Eigen::Ref<const Vector6d> &Kp, const Eigen::Ref<const Vector6d> &Kd, const Eigen::Isometry3d &T_task_to_world=Eigen::Isometry3d::Identity());
+// bodySpatialMotionPD with the geometric Jacobian of the body computed in J_geometric, so that a J_geometric kept across calls saves the allocations
+drakeControlUtilEXPORT Vector6d bodySpatialMotionPD(RigidBodyTree *r, const KinematicsCache<double>& cache, const int body_index, const Eigen::Isometry3d &body_pose_des, const Eigen::Ref<const Vector6d> &body_v_des, const Eigen::Ref<const Vector6d> &body_vdot_des, const Eigen::Ref<const Vector6d> &Kp, const Eigen::Ref<const Vector6d> &Kd, const Eigen::Isometry3d &T_task_to_world, CompactJacobian<double, TWIST_SIZE> &J_geometric);
 
 drakeControlUtilEXPORT void evaluateXYZExpmapCubicSpline(double t, const PiecewisePolynomial<double> &spline, Eigen::Isometry3d &body_pose_des, Vector6d &xyzdot_angular_vel, Vector6d &xyzddot_angular_accel);
+// evaluateXYZExpmapCubicSpline for a [xyz; expmap] value and its first two time derivatives that are already evaluated
+drakeControlUtilEXPORT void evaluateXYZExpmap(const Vector6d &xyzexp, const Vector6d &xyzexpdot, const Vector6d &xyzexpddot, Eigen::Isometry3d &body_pose_des, Vector6d &xyzdot_angular_vel, Vector6d &xyzddot_angular_accel);
 
 struct RobotJointIndexMap {
   Eigen::VectorXi drake_to_robot;
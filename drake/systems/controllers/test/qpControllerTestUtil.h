@@ -0,0 +1,299 @@
+#ifndef _QP_CONTROLLER_TEST_UTIL_H_
+#define _QP_CONTROLLER_TEST_UTIL_H_
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "../QPCommon.h"
+#include "lcmtypes/drake/lcmt_qp_controller_input.hpp"
+
+/*
+ * Sets up the QP controller for examples/Atlas/urdf/atlas_minimal_contact.urdf without MATLAB, the way
+ * constructQPDataPointerMex does it from the MATLAB controller, with a single "standing" param set. Every body has body
+ * motion params, so any body can be tracked. The gurobi environment is created here and freed by
+ * freeAtlasQPControllerData.
+ */
+inline std::unique_ptr<NewQPControllerData> createAtlasQPControllerData(RigidBodyTree* r, bool use_sparse_qp)
+{
+  using namespace Eigen;
+  const double inf = std::numeric_limits<double>::infinity();
+  int nq = r->num_positions;
+  int nv = r->num_velocities;
+  int nu = static_cast<int>(r->B.cols());
+  if (nq != nv || nu + 6 != nq)
+    throw std::runtime_error("expected a robot with a roll-pitch-yaw floating base and fully actuated joints");
+
+  std::unique_ptr<NewQPControllerData> pdata(new NewQPControllerData(r));
+
+  AtlasParams params;
+  params.whole_body.Kp = VectorXd::Constant(nq, 10.0);
+  params.whole_body.Kp.head<6>().setZero();
+  params.whole_body.Kd = 2.0 * params.whole_body.Kp.cwiseSqrt();
+  params.whole_body.w_qdd = VectorXd::Constant(nv, 1e-3);
+  params.whole_body.damping_ratio = 1.0;
+  params.whole_body.integrator.gains = VectorXd::Zero(nq);
+  params.whole_body.integrator.clamps = VectorXd::Zero(nq);
+  params.whole_body.integrator.eta = 0.0;
+  params.whole_body.qdd_bounds.min = VectorXd::Constant(nv, -100.0);
+  params.whole_body.qdd_bounds.max = VectorXd::Constant(nv, 100.0);
+
+  BodyMotionParams body_motion;
+  body_motion.Kp = VectorXd::Constant(6, 100.0);
+  body_motion.Kd = VectorXd::Constant(6, 20.0);
+  body_motion.accel_bounds.min = VectorXd::Constant(6, -100.0);
+  body_motion.accel_bounds.max = VectorXd::Constant(6, 100.0);
+  body_motion.weight = 0.01;
+  params.body_motion.assign(r->bodies.size(), body_motion);
+
+  params.vref_integrator.zero_ankles_on_contact = true;
+  params.vref_integrator.eta = 0.001;
+  params.vref_integrator.delta_max = 10.0;
+
+  params.joint_soft_limits.enabled = Matrix<bool, Dynamic, 1>::Zero(nq);
+  params.joint_soft_limits.disable_when_body_in_support = VectorXi::Zero(nq);
+  params.joint_soft_limits.lb = VectorXd::Constant(nq, -inf);
+  params.joint_soft_limits.ub = VectorXd::Constant(nq, inf);
+  params.joint_soft_limits.kp = VectorXd::Zero(nq);
+  params.joint_soft_limits.kd = VectorXd::Zero(nq);
+  params.joint_soft_limits.weight = VectorXd::Zero(nq);
+  params.joint_soft_limits.k_logistic = VectorXd::Zero(nq);
+
+  params.W_kdot = Matrix3d::Zero();
+  params.Kp_ang = 1.0;
+  params.w_slack = 0.05;
+  params.slack_limit = 30.0;
+  params.w_grf = 0.0;
+  params.Kp_accel = 1.0;
+  params.contact_threshold = 0.002;
+  params.min_knee_angle = 0.7;
+  params.use_center_of_mass_observer = false;
+  params.center_of_mass_observer_gain = Matrix4d::Zero();
+  pdata->param_sets["standing"] = params;
+
+  RobotPropertyCache& rpc = pdata->rpc;
+  rpc.body_ids.l_foot = r->findLinkId("l_foot");
+  rpc.body_ids.r_foot = r->findLinkId("r_foot");
+  rpc.body_ids.pelvis = r->findLinkId("pelvis");
+  rpc.num_bodies = static_cast<int>(r->bodies.size());
+  const char* position_groups[] = {"l_leg", "r_leg", "l_leg_ak", "r_leg_ak"};
+  for (const char* group : position_groups) {
+    std::vector<int> indices;
+    for (int i = 0; i < nq; i++) {
+      if (r->getPositionName(i).compare(0, std::string(group).size(), group) == 0)
+        indices.push_back(i);
+    }
+    rpc.position_indices[group] = Map<VectorXi>(indices.data(), indices.size());
+  }
+  rpc.actuated_indices.resize(nu);
+  for (int i = 0; i < nu; i++)
+    rpc.actuated_indices(i) = i + 6;
+
+  pdata->B = r->B;
+  pdata->B_act = pdata->B.bottomRows(nu);
+  pdata->umin = VectorXd::Constant(nu, -1000.0);
+  pdata->umax = VectorXd::Constant(nu, 1000.0);
+  pdata->use_fast_qp = 1;
+  pdata->use_sparse_qp = use_sparse_qp;
+  for (auto it = r->actuators.begin(); it != r->actuators.end(); ++it)
+    pdata->input_joint_names.drake.push_back(it->name);
+  pdata->input_joint_names.robot = pdata->input_joint_names.drake;
+
+  pdata->qdd_lb = VectorXd::Constant(nq, -inf);
+  pdata->qdd_ub = VectorXd::Constant(nq, inf);
+
+  if (GRBloadenv(&(pdata->env), NULL))
+    throw std::runtime_error("cannot load gurobi environment");
+  CGE(GRBsetintparam(pdata->env, "outputflag", 0), pdata->env);
+  CGE(GRBsetintparam(pdata->env, "method", 2), pdata->env);
+  CGE(GRBsetintparam(pdata->env, "presolve", 0), pdata->env);
+  CGE(GRBsetintparam(pdata->env, "bariterlimit", 20), pdata->env);
+  CGE(GRBsetintparam(pdata->env, "barhomogeneous", 0), pdata->env);
+  CGE(GRBsetdblparam(pdata->env, "barconvtol", 0.0005), pdata->env);
+
+  pdata->H.resize(nq, nq);
+  pdata->H_float.resize(6, nq);
+  pdata->H_act.resize(nu, nq);
+  pdata->C.resize(nq);
+  pdata->C_float.resize(6);
+  pdata->C_act.resize(nu);
+  pdata->J.resize(3, nq);
+  pdata->J_xy.resize(2, nq);
+  pdata->Hqp.resize(nq, nq);
+  pdata->fqp.resize(nq);
+  pdata->Ag.resize(6, nq);
+  pdata->Ak.resize(3, nq);
+
+  pdata->state.vbasis_len = 0;
+  pdata->state.cbasis_len = 0;
+  pdata->state.vbasis = NULL;
+  pdata->state.cbasis = NULL;
+  pdata->state.t_prev = 0;
+  pdata->state.vref_integrator_state = VectorXd::Zero(nv);
+  pdata->state.q_integrator_state = VectorXd::Zero(nq);
+  pdata->state.foot_contact_prev[0] = false;
+  pdata->state.foot_contact_prev[1] = false;
+  pdata->state.num_active_contact_pts = 0;
+  pdata->state.center_of_mass_observer_state = Vector4d::Zero();
+  pdata->state.last_com_ddot = Vector3d::Zero();
+
+  return pdata;
+}
+
+inline void freeAtlasQPControllerData(std::unique_ptr<NewQPControllerData>& pdata)
+{
+  GRBfreeenv(pdata->env);
+  pdata.reset();
+}
+
+/*
+ * A standing plan for the robot at configuration q: both feet are supports (through their four corner contact points),
+ * the ZMP data keeps the center of mass over its current position, the posture is held at q, and the pelvis tracks its
+ * current pose through a constant cubic spline.
+ */
+inline drake::lcmt_qp_controller_input createStandingQPControllerInput(NewQPControllerData* pdata, const Eigen::VectorXd& q)
+{
+  using namespace Eigen;
+  RigidBodyTree* r = pdata->r;
+  int nq = r->num_positions;
+  KinematicsCache<double> cache = r->doKinematics(q);
+
+  drake::lcmt_qp_controller_input msg;
+  msg.be_silent = false;
+  msg.timestamp = 0;
+  msg.param_set_name = "standing";
+
+  // linear inverted pendulum with the center of mass at its current height
+  Vector3d com = r->centerOfMass(cache);
+  double com_height = com(2) - r->forwardKin(cache, Vector3d::Zero().eval(), pdata->rpc.body_ids.l_foot, 0, 0)(2);
+  Matrix4d A = Matrix4d::Zero();
+  A.topRightCorner<2, 2>() = Matrix2d::Identity();
+  Matrix<double, 4, 2> B = Matrix<double, 4, 2>::Zero();
+  B.bottomRows<2>() = Matrix2d::Identity();
+  Matrix<double, 2, 4> C = Matrix<double, 2, 4>::Zero();
+  C.leftCols<2>() = Matrix2d::Identity();
+  Matrix2d D = -com_height / 9.81 * Matrix2d::Identity();
+  Matrix4d S = Matrix4d::Identity();
+  drake::lcmt_zmp_data& zmp_data = msg.zmp_data;
+  zmp_data.timestamp = 0;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      zmp_data.A[i][j] = A(i, j);
+      zmp_data.S[i][j] = S(i, j);
+    }
+    for (int j = 0; j < 2; j++) {
+      zmp_data.B[i][j] = B(i, j);
+      zmp_data.C[j][i] = C(j, i);
+    }
+    zmp_data.x0[i][0] = i < 2 ? com(i) : 0.0;
+    zmp_data.s1[i][0] = 0.0;
+    zmp_data.s1dot[i][0] = 0.0;
+  }
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      zmp_data.D[i][j] = D(i, j);
+      zmp_data.R[i][j] = 0.0;
+      zmp_data.Qy[i][j] = i == j ? 1.0 : 0.0;
+    }
+    zmp_data.y0[i][0] = com(i);
+    zmp_data.u0[i][0] = 0.0;
+  }
+  zmp_data.s2 = 0.0;
+  zmp_data.s2dot = 0.0;
+
+  int feet[] = {pdata->rpc.body_ids.l_foot, pdata->rpc.body_ids.r_foot};
+  for (int foot : feet) {
+    const Matrix3Xd& contact_pts = r->bodies[foot]->contact_pts;
+    drake::lcmt_support_data support;
+    support.timestamp = 0;
+    support.body_id = foot + 1;
+    support.num_contact_pts = 4;
+    support.contact_pts.resize(3);
+    for (int j = 0; j < 4; j++) {
+      for (int k = 0; k < 3; k++)
+        support.contact_pts[k].push_back(contact_pts(k, j));
+    }
+    for (int j = 0; j < 4; j++)
+      support.support_logic_map[j] = true;
+    support.use_support_surface = true;
+    support.support_surface[0] = 0.0f;
+    support.support_surface[1] = 0.0f;
+    support.support_surface[2] = 1.0f;
+    support.support_surface[3] = 0.0f;
+    support.mu = 1.0;
+    msg.support_data.push_back(support);
+  }
+  msg.num_support_data = static_cast<int32_t>(msg.support_data.size());
+
+  drake::lcmt_body_motion_data body_motion;
+  body_motion.timestamp = 0;
+  body_motion.body_id = pdata->rpc.body_ids.pelvis + 1;
+  Matrix<double, 7, 1> pelvis_pose = r->forwardKin(cache, Vector3d::Zero().eval(), pdata->rpc.body_ids.pelvis, 0, 2);
+  Vector3d pelvis_expmap = quat2expmap(pelvis_pose.tail<4>(), 0).value();
+  drake::lcmt_piecewise_polynomial& spline = body_motion.spline;
+  spline.timestamp = 0;
+  spline.num_breaks = 2;
+  spline.breaks.push_back(0.0);
+  spline.breaks.push_back(1e6);
+  spline.num_segments = 1;
+  spline.polynomial_matrices.resize(1);
+  drake::lcmt_polynomial_matrix& polynomial_matrix = spline.polynomial_matrices[0];
+  polynomial_matrix.timestamp = 0;
+  polynomial_matrix.rows = 6;
+  polynomial_matrix.cols = 1;
+  polynomial_matrix.polynomials.resize(6);
+  for (int i = 0; i < 6; i++) {
+    drake::lcmt_polynomial polynomial;
+    polynomial.timestamp = 0;
+    polynomial.num_coefficients = 4;
+    polynomial.coefficients.assign(4, 0.0);
+    polynomial.coefficients[0] = i < 3 ? pelvis_pose(i) : pelvis_expmap(i - 3);
+    polynomial_matrix.polynomials[i].push_back(polynomial);
+  }
+  body_motion.in_floating_base_nullspace = false;
+  body_motion.control_pose_when_in_contact = false;
+  body_motion.quat_task_to_world[0] = 1.0;
+  for (int i = 1; i < 4; i++)
+    body_motion.quat_task_to_world[i] = 0.0;
+  for (int i = 0; i < 3; i++) {
+    body_motion.translation_task_to_world[i] = 0.0;
+    body_motion.xyz_kp_multiplier[i] = 1.0;
+    body_motion.xyz_damping_ratio_multiplier[i] = 1.0;
+  }
+  body_motion.expmap_kp_multiplier = 1.0;
+  body_motion.expmap_damping_ratio_multiplier = 1.0;
+  for (int i = 0; i < 6; i++)
+    body_motion.weight_multiplier[i] = 1.0;
+  msg.body_motion_data.push_back(body_motion);
+  msg.num_tracked_bodies = 1;
+
+  msg.num_external_wrenches = 0;
+
+  msg.whole_body_data.timestamp = 0;
+  msg.whole_body_data.num_positions = nq;
+  msg.whole_body_data.q_des.assign(q.data(), q.data() + nq);
+  msg.whole_body_data.num_constrained_dofs = 0;
+
+  msg.num_joint_pd_overrides = 0;
+  return msg;
+}
+
+/*
+ * A standing configuration: floating base at the pelvis height of the nominal Atlas pose, knees slightly bent.
+ */
+inline Eigen::VectorXd atlasStandingConfiguration(RigidBodyTree* r)
+{
+  Eigen::VectorXd q = Eigen::VectorXd::Zero(r->num_positions);
+  q(2) = 0.85;
+  for (int i = 6; i < r->num_positions; i++) {
+    std::string name = r->getPositionName(i);
+    if (name == "l_leg_hpy" || name == "r_leg_hpy" || name == "l_leg_aky" || name == "r_leg_aky")
+      q(i) = -0.3;
+    else if (name == "l_leg_kny" || name == "r_leg_kny")
+      q(i) = 0.6;
+  }
+  return q;
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "../QPCommon.h"
+#include "qpControllerTestUtil.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Checks that once setupAndSolveQP has run a few ticks of a problem, further ticks with the same supports and tracked
+ * bodies (the steady state of the controller) don't touch the heap, both with the dense and with the sparse QP
+ * formulation. Calls to operator new are counted everywhere. With glibc, malloc, calloc and realloc are counted as
+ * well, since that is where Eigen gets the storage of dynamic matrices.
+ */
+
+static bool count_allocations = false;
+static int num_allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t num, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+  if (count_allocations)
+    num_allocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t num, size_t size)
+{
+  if (count_allocations)
+    num_allocations++;
+  return __libc_calloc(num, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+  if (count_allocations)
+    num_allocations++;
+  return __libc_realloc(ptr, size);
+}
+
+static void* allocate(size_t size)
+{
+  return __libc_malloc(size);
+}
+#else
+static void* allocate(size_t size)
+{
+  return malloc(size);
+}
+#endif
+
+void* operator new(size_t size)
+{
+  if (count_allocations)
+    num_allocations++;
+  void* ptr = allocate(size);
+  if (!ptr)
+    throw bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+int countSteadyStateAllocations(RigidBodyTree* robot, bool use_sparse_qp)
+{
+  unique_ptr<NewQPControllerData> pdata = createAtlasQPControllerData(robot, use_sparse_qp);
+  VectorXd q = atlasStandingConfiguration(robot);
+  shared_ptr<drake::lcmt_qp_controller_input> qp_input = make_shared<drake::lcmt_qp_controller_input>(createStandingQPControllerInput(pdata.get(), q));
+
+  DrakeRobotState robot_state;
+  robot_state.t = 1.0;
+  robot_state.q = q;
+  robot_state.qd = VectorXd::Zero(robot->num_velocities);
+  Matrix<bool, Dynamic, 1> b_contact_force = Matrix<bool, Dynamic, 1>::Zero(robot->bodies.size());
+  b_contact_force(pdata->rpc.body_ids.l_foot) = true;
+  b_contact_force(pdata->rpc.body_ids.r_foot) = true;
+  map<Side, ForceTorqueMeasurement> foot_force_torque_measurements;
+  QPControllerOutput qp_output;
+
+  int num_warm_up_ticks = 3;
+  int num_steady_state_ticks = 10;
+  int allocations = 0;
+  for (int i = 0; i < num_warm_up_ticks + num_steady_state_ticks; i++) {
+    robot_state.t += 1e-3;
+    num_allocations = 0;
+    count_allocations = i >= num_warm_up_ticks;
+    int info = setupAndSolveQP(pdata.get(), qp_input, robot_state, b_contact_force, foot_force_torque_measurements, &qp_output, nullptr);
+    count_allocations = false;
+    allocations += num_allocations;
+    if (info < 0) {
+      cerr << "setupAndSolveQP returned " << info << " (use_sparse_qp = " << use_sparse_qp << ")" << endl;
+      allocations = -1;
+      break;
+    }
+  }
+  freeAtlasQPControllerData(pdata);
+  if (allocations > 0) {
+    cerr << allocations << " heap allocations in " << num_steady_state_ticks << " steady state ticks (use_sparse_qp = " << use_sparse_qp << ")" << endl;
+  }
+  return allocations;
+}
+
+int main()
+{
+  RigidBodyTree robot("examples/Atlas/urdf/atlas_minimal_contact.urdf");
+
+  bool failed = false;
+  for (bool use_sparse_qp : {false, true}) {
+    if (countSteadyStateAllocations(&robot, use_sparse_qp) != 0)
+      failed = true;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+#include "../QPControllerService.h"
+#include "qpControllerTestUtil.h"
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Runs QPControllerService on Atlas over an in-process (memq://) LCM:
+ * - a robot state that lists the joints in a different order than the model has to end up in the right entries of q
+ *   and qd, which are checked against the kinematics cache that the last tick ran with
+ * - with a period far shorter than a solve, every tick overruns and has to be counted as a deadline miss
+ * - without new robot states, the service has to stop publishing after max_stale_ticks ticks and resume with the next
+ *   robot state
+ * - a SparseQP that can't converge hands every tick to gurobi, which has to be counted as a fallback, not as an error
+ */
+
+namespace {
+
+template <typename Condition>
+bool waitForStats(const QPControllerService& service, Condition condition)
+{
+  auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+  while (!condition(service.getStats())) {
+    if (chrono::steady_clock::now() > deadline)
+      return false;
+    this_thread::sleep_for(chrono::milliseconds(1));
+  }
+  return true;
+}
+
+bool waitForTicks(const QPControllerService& service, long num_ticks)
+{
+  return waitForStats(service, [num_ticks](const QPControllerServiceStats& stats) { return stats.num_ticks >= num_ticks; });
+}
+
+drake::lcmt_robot_state reversedRobotState(RigidBodyTree* r, const VectorXd& q, const VectorXd& qd)
+{
+  drake::lcmt_robot_state msg;
+  msg.timestamp = 1000000;
+  msg.num_robots = 1;
+  msg.robot_name.push_back("atlas");
+  msg.num_joints = r->num_positions;
+  for (int i = r->num_positions - 1; i >= 0; i--) {
+    msg.joint_robot.push_back(0);
+    msg.joint_name.push_back(r->getPositionName(i));
+    msg.joint_position.push_back(static_cast<float>(q(i)));
+    msg.joint_velocity.push_back(static_cast<float>(qd(i)));
+  }
+  return msg;
+}
+
+}  // namespace
+
+int main()
+{
+  RigidBodyTree robot("examples/Atlas/urdf/atlas_minimal_contact.urdf");
+  int nq = robot.num_positions;
+  shared_ptr<lcm::LCM> lcm = make_shared<lcm::LCM>("memq://");
+  if (!lcm->good()) {
+    cerr << "could not create the memq LCM provider" << endl;
+    return 1;
+  }
+
+  VectorXd q = atlasStandingConfiguration(&robot);
+  // distinct values for every joint, so that a mixed up joint shows
+  VectorXd qd(nq);
+  for (int i = 0; i < nq; i++) {
+    q(i) += 1e-3 * i;
+    qd(i) = 1e-2 * (i + 1);
+  }
+  drake::lcmt_qp_controller_input input;
+  drake::lcmt_robot_state robot_state = reversedRobotState(&robot, q, qd);
+
+  bool failed = false;
+
+  // joint order
+  {
+    unique_ptr<NewQPControllerData> pdata = createAtlasQPControllerData(&robot, false);
+    input = createStandingQPControllerInput(pdata.get(), atlasStandingConfiguration(&robot));
+    QPControllerServiceOptions options;
+    options.control_rate = 200.0;
+    QPControllerService service(lcm, pdata.get(), options);
+    service.start();
+    lcm->publish(options.input_channel, &input);
+    lcm->publish(options.robot_state_channel, &robot_state);
+    bool ticked = waitForTicks(service, 3);
+    service.stop();
+
+    if (!ticked) {
+      cerr << "the service did not tick with an input and a robot state available" << endl;
+      failed = true;
+    } else {
+      for (int i = 0; i < nq; i++) {
+        double q_expected = static_cast<float>(q(i));
+        double qd_expected = static_cast<float>(qd(i));
+        if (pdata->cache.getQ()(i) != q_expected || pdata->cache.getV()(i) != qd_expected) {
+          cerr << robot.getPositionName(i) << ": got q = " << pdata->cache.getQ()(i) << ", qd = " << pdata->cache.getV()(i) << ", expected q = " << q_expected << ", qd = " << qd_expected << endl;
+          failed = true;
+        }
+      }
+    }
+    if (service.getStats().num_errors > 0) {
+      cerr << service.getStats().num_errors << " ticks threw" << endl;
+      failed = true;
+    }
+    freeAtlasQPControllerData(pdata);
+  }
+
+  // deadline misses
+  {
+    unique_ptr<NewQPControllerData> pdata = createAtlasQPControllerData(&robot, false);
+    QPControllerServiceOptions options;
+    options.control_rate = 1e5; // a 10 us period, far shorter than any solve
+    QPControllerService service(lcm, pdata.get(), options);
+    service.start();
+    QPControllerServiceStats stats_before = service.getStats();
+    lcm->publish(options.input_channel, &input);
+    lcm->publish(options.robot_state_channel, &robot_state);
+    bool ticked = waitForTicks(service, 5);
+    service.stop();
+
+    QPControllerServiceStats stats = service.getStats();
+    if (!ticked) {
+      cerr << "the service did not tick with an input and a robot state available" << endl;
+      failed = true;
+    } else if (stats.num_deadline_misses <= stats_before.num_deadline_misses || stats.num_deadline_misses != stats.num_ticks) {
+      cerr << "expected every one of the " << stats.num_ticks << " ticks to miss its deadline, counted " << stats.num_deadline_misses << " misses" << endl;
+      failed = true;
+    }
+    freeAtlasQPControllerData(pdata);
+  }
+
+  // stale robot state
+  {
+    unique_ptr<NewQPControllerData> pdata = createAtlasQPControllerData(&robot, false);
+    QPControllerServiceOptions options;
+    options.control_rate = 1000.0;
+    options.max_stale_ticks = 5;
+    QPControllerService service(lcm, pdata.get(), options);
+    service.start();
+    lcm->publish(options.input_channel, &input);
+    lcm->publish(options.robot_state_channel, &robot_state);
+    bool went_stale = waitForStats(service, [](const QPControllerServiceStats& stats) { return stats.num_stale_ticks >= 10; });
+    QPControllerServiceStats stats_stale = service.getStats();
+    lcm->publish(options.robot_state_channel, &robot_state);
+    bool resumed = waitForTicks(service, stats_stale.num_ticks + 1);
+    service.stop();
+
+    if (!went_stale) {
+      cerr << "the service did not stop publishing without new robot states" << endl;
+      failed = true;
+    } else if (stats_stale.num_ticks < 1 || stats_stale.num_ticks > options.max_stale_ticks + 1) {
+      cerr << "expected at most " << options.max_stale_ticks + 1 << " ticks from one robot state, counted " << stats_stale.num_ticks << endl;
+      failed = true;
+    }
+    if (!resumed) {
+      cerr << "the service did not resume publishing with a new robot state" << endl;
+      failed = true;
+    }
+    freeAtlasQPControllerData(pdata);
+  }
+
+  // gurobi fallbacks
+  {
+    unique_ptr<NewQPControllerData> pdata = createAtlasQPControllerData(&robot, true);
+    pdata->sparseqp.settings.max_iter = 1;
+    QPControllerServiceOptions options;
+    options.control_rate = 200.0;
+    QPControllerService service(lcm, pdata.get(), options);
+    service.start();
+    lcm->publish(options.input_channel, &input);
+    lcm->publish(options.robot_state_channel, &robot_state);
+    bool ticked = waitForTicks(service, 3);
+    service.stop();
+
+    QPControllerServiceStats stats = service.getStats();
+    if (!ticked) {
+      cerr << "the service did not tick with an input and a robot state available, " << stats.num_errors << " ticks threw" << endl;
+      failed = true;
+    } else if (stats.num_qp_fallbacks != stats.num_ticks || stats.num_errors != 0) {
+      cerr << "expected every one of the " << stats.num_ticks << " ticks to fall back to gurobi, counted " << stats.num_qp_fallbacks << " fallbacks and " << stats.num_errors << " errors" << endl;
+      failed = true;
+    }
+    freeAtlasQPControllerData(pdata);
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+#include "../TripleBuffer.h"
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+/*
+ * Hands a stream of numbered messages from a producer thread to a consumer thread and checks that the consumer never
+ * sees a partially written message or an older message after a newer one, and that it ends up with the last one.
+ */
+
+struct Message {
+  static const int size = 64;
+  long sequence[size];
+};
+
+int main()
+{
+  const long num_messages = 200000;
+  TripleBuffer<Message> buffer;
+  for (int i = 0; i < Message::size; i++)
+    buffer.front().sequence[i] = -1;
+
+  thread producer([&buffer, num_messages]() {
+    for (long n = 0; n < num_messages; n++) {
+      Message& message = buffer.back();
+      for (int i = 0; i < Message::size; i++)
+        message.sequence[i] = n;
+      buffer.publish();
+    }
+  });
+
+  long last_seen = -1;
+  long num_updates = 0;
+  bool failed = false;
+  while (last_seen < num_messages - 1 && !failed) {
+    if (!buffer.update())
+      continue;
+    num_updates++;
+    const Message& message = buffer.front();
+    for (int i = 1; i < Message::size; i++) {
+      if (message.sequence[i] != message.sequence[0]) {
+        cerr << "torn message: entries " << message.sequence[0] << " and " << message.sequence[i] << endl;
+        failed = true;
+        break;
+      }
+    }
+    if (message.sequence[0] <= last_seen) {
+      cerr << "message " << message.sequence[0] << " received after message " << last_seen << endl;
+      failed = true;
+    }
+    last_seen = message.sequence[0];
+  }
+  producer.join();
+
+  if (failed)
+    return 1;
+  if (buffer.update()) {
+    cerr << "update reported a new message after the last one was consumed" << endl;
+    return 1;
+  }
+  cout << num_updates << " updates for " << num_messages << " messages" << endl;
+  return 0;
+}
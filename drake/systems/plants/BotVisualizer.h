@@ -3,6 +3,8 @@
 
 #include <lcm/lcm-cpp.hpp>
 #include <Eigen/Dense>
+#include <limits>
+#include <mutex>
 #include "System.h"
 #include "RigidBodyTree.h"
 
@@ -13,14 +15,24 @@
 
 namespace Drake {
 
+  /// Publishes the robot's link poses to the viewer.  Draw messages are sent at most once per publish_period of
+  /// simulation time (0 means on every output call), and only if the configuration changed since the last one.
+  /// Output calls are serialized, so one visualizer can be shared by concurrent simulations (e.g. simulateBatch),
+  /// although their draws then interleave.
   template <template <typename> class InputVector>
   class BotVisualizer : public System<BotVisualizer<InputVector>,UnusedVector,InputVector,UnusedVector,true,true> {
   public:
     BotVisualizer(const std::shared_ptr<lcm::LCM> &_lcm, const std::string &urdf_filename,
-                  const DrakeJoint::FloatingBaseType floating_base_type) :
+                  const DrakeJoint::FloatingBaseType floating_base_type, double publish_period = 0.0) :
             manip(urdf_filename, floating_base_type),
-            lcm(_lcm)
+            lcm(_lcm),
+            cache(manip.bodies),
+            publish_period(publish_period),
+            last_publish_time(-std::numeric_limits<double>::infinity())
     {
+      // draws usually come from a simulation that moves only some of the joints between calls
+      cache.setIncrementalKinematics(true);
+
       publishLoadRobot();
 
       draw_msg.num_links = manip.bodies.size();
@@ -109,20 +121,35 @@ namespace Drake {
     }
 
     UnusedVector<double> outputImplementation(const double& t, const InputVector<double> &u) const {
-      draw_msg.timestamp = static_cast<int64_t>(t * 1000.0);
-
       Eigen::Matrix<double,InputVector<double>::RowsAtCompileTime,1> uvec(u);
       auto q = uvec.head(manip.num_positions);
-      KinematicsCache<double> cache = manip.doKinematics(q);
 
-      Eigen::Vector3d points = Eigen::Vector3d::Zero();
+      std::lock_guard<std::mutex> lock(output_mutex);
+      if (t < last_publish_time) {  // time went backwards, e.g. a new simulation
+        last_publish_time = -std::numeric_limits<double>::infinity();
+        last_published_q.resize(0);
+      }
+      if (t < last_publish_time + publish_period)
+        return Eigen::VectorXd::Zero(0);
+      if (last_published_q.size() == q.size() && last_published_q == q)
+        return Eigen::VectorXd::Zero(0);
+      last_publish_time = t;
+      last_published_q = q;
+
+      draw_msg.timestamp = static_cast<int64_t>(t * 1000.0);
+
+      // the cache is kept between calls, so bodies whose joints didn't move aren't recomputed
+      cache.initialize(q);
+      manip.doKinematics(cache);
+
       int i, j;
       for (i = 0; i < manip.bodies.size(); i++) {
-        auto pose = manip.forwardKin(cache, points, i, 0, 2);
+        const Eigen::Isometry3d& transform_to_world = cache.getElement(*manip.bodies[i]).transform_to_world;
         std::vector<float> &position = draw_msg.position[i];
-        for (j = 0; j < 3; j++) position[j] = static_cast<float>(pose(j));
+        for (j = 0; j < 3; j++) position[j] = static_cast<float>(transform_to_world.translation()(j));
+        Eigen::Vector4d quat = rotmat2quat(transform_to_world.linear());
         std::vector<float> &quaternion = draw_msg.quaternion[i];
-        for (j = 0; j < 4; j++) quaternion[j] = static_cast<float>(pose(j + 3));
+        for (j = 0; j < 4; j++) quaternion[j] = static_cast<float>(quat(j));
       }
 
       lcm->publish("DRAKE_VIEWER_DRAW", &draw_msg);
@@ -135,6 +162,12 @@ namespace Drake {
     mutable RigidBodyTree manip;  // todo: remove mutable tag after RBM cleanup
     std::shared_ptr<lcm::LCM> lcm;
     mutable drake::lcmt_viewer_draw draw_msg;
+
+    mutable KinematicsCache<double> cache;
+    double publish_period;  // s
+    mutable double last_publish_time;
+    mutable Eigen::VectorXd last_published_q;
+    mutable std::mutex output_mutex;  // guards the mutable members above, which every output call updates
   };
 
 
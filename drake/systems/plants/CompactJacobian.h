@@ -0,0 +1,127 @@
+#ifndef DRAKE_COMPACTJACOBIAN_H
+#define DRAKE_COMPACTJACOBIAN_H
+
+#include <Eigen/Core>
+#include <vector>
+#include <cassert>
+
+/*
+ * Jacobian with respect to q (or v) that is zero except for a subset of its columns, as is the case for Jacobians of
+ * points or frames on a body, which only depend on the joints on the path from the base to the body.
+ *
+ * value holds the nonzero columns; column k of value is column indices[k] of the full Jacobian, which has cols()
+ * columns. The indices have to be distinct, but need not be sorted. For a point on a foot of a humanoid, this stores
+ * about 12 of 36+ columns, and the products below only touch those.
+ */
+template <typename Scalar, int Rows = Eigen::Dynamic>
+class CompactJacobian
+{
+public:
+  typedef Eigen::Matrix<Scalar, Rows, Eigen::Dynamic> ValueType;
+
+  ValueType value;
+  std::vector<int> indices;
+  int full_cols;
+
+  CompactJacobian() : full_cols(0) { }
+
+  CompactJacobian(const ValueType& value, const std::vector<int>& indices, int full_cols) :
+      value(value), indices(indices), full_cols(full_cols)
+  {
+    assert(static_cast<int>(indices.size()) == value.cols());
+  }
+
+  int rows() const { return static_cast<int>(value.rows()); }
+  int cols() const { return full_cols; }
+
+  Eigen::Matrix<Scalar, Rows, Eigen::Dynamic> toFull() const
+  {
+    Eigen::Matrix<Scalar, Rows, Eigen::Dynamic> full(value.rows(), full_cols);
+    toFull(full);
+    return full;
+  }
+
+  /*
+   * writes the full Jacobian into full, which has to be rows() x cols() already.
+   */
+  template <typename DerivedFull>
+  void toFull(Eigen::MatrixBase<DerivedFull>& full) const
+  {
+    assert(full.rows() == value.rows() && full.cols() == full_cols);
+    full.setZero();
+    for (size_t k = 0; k < indices.size(); k++) {
+      full.col(indices[k]) = value.col(k);
+    }
+  }
+
+  /*
+   * computes J * x, where x has cols() rows.
+   */
+  template <typename Derived>
+  Eigen::Matrix<Scalar, Rows, Derived::ColsAtCompileTime> times(const Eigen::MatrixBase<Derived>& x) const
+  {
+    assert(x.rows() == full_cols);
+    Eigen::Matrix<Scalar, Rows, Derived::ColsAtCompileTime> ret = Eigen::Matrix<Scalar, Rows, Derived::ColsAtCompileTime>::Zero(value.rows(), x.cols());
+    for (size_t k = 0; k < indices.size(); k++) {
+      ret.noalias() += value.col(k) * x.row(indices[k]).template cast<Scalar>();
+    }
+    return ret;
+  }
+
+  /*
+   * computes J^T * f, which has cols() rows.
+   */
+  template <typename Derived>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> transposeTimes(const Eigen::MatrixBase<Derived>& f) const
+  {
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> ret = Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime>::Zero(full_cols, f.cols());
+    addTransposeTimes(f, ret);
+    return ret;
+  }
+
+  /*
+   * result += J^T * f. result may have more than cols() rows, the ones beyond are left alone.
+   */
+  template <typename Derived, typename DerivedResult>
+  void addTransposeTimes(const Eigen::MatrixBase<Derived>& f, Eigen::MatrixBase<DerivedResult>& result) const
+  {
+    assert(f.rows() == value.rows());
+    assert(result.rows() >= full_cols && result.cols() == f.cols());
+    for (size_t k = 0; k < indices.size(); k++) {
+      result.row(indices[k]).noalias() += value.col(k).transpose() * f;
+    }
+  }
+
+  /*
+   * H += J^T * W * J. W can be anything that multiplies a matrix with rows() rows, e.g. a dense weight matrix or
+   * w.asDiagonal(). H may be larger than cols() x cols(), the rest of it is left alone.
+   */
+  template <typename WeightType, typename DerivedH>
+  void addTransposeTimesWTimes(const WeightType& W, Eigen::MatrixBase<DerivedH>& H) const
+  {
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> JTWJ;
+    addTransposeTimesWTimes(W, H, JTWJ);
+  }
+
+  /*
+   * addTransposeTimesWTimes with the compact product J^T * W * J going into JTWJ, which is only reallocated if the
+   * number of nonzero columns changes. W * J is formed a column at a time, so with a fixed number of rows, this
+   * doesn't touch the heap.
+   */
+  template <typename WeightType, typename DerivedH>
+  void addTransposeTimesWTimes(const WeightType& W, Eigen::MatrixBase<DerivedH>& H, Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& JTWJ) const
+  {
+    assert(H.rows() >= full_cols && H.cols() >= full_cols);
+    JTWJ.resize(value.cols(), value.cols());
+    for (int j = 0; j < value.cols(); j++) {
+      JTWJ.col(j).noalias() = value.transpose() * (W * value.col(j));
+    }
+    for (size_t j = 0; j < indices.size(); j++) {
+      for (size_t i = 0; i < indices.size(); i++) {
+        H(indices[i], indices[j]) += JTWJ(i, j);
+      }
+    }
+  }
+};
+
+#endif
@@ -18,6 +18,9 @@ IKoptions::IKoptions(const IKoptions &rhs)
   this->Qv = rhs.Qv;
   this->debug_mode = rhs.debug_mode;
   this->sequentialSeedFlag = rhs.sequentialSeedFlag;
+  this->solver = rhs.solver;
+  this->num_threads = rhs.num_threads;
+  this->sequential_seed_block_size = rhs.sequential_seed_block_size;
   this->SNOPT_MajorFeasibilityTolerance = rhs.SNOPT_MajorFeasibilityTolerance;
   this->SNOPT_MajorIterationsLimit = rhs.SNOPT_MajorIterationsLimit;
   this->SNOPT_IterationsLimit = rhs.SNOPT_IterationsLimit;
@@ -45,6 +48,9 @@ void IKoptions::setDefaultParams(RigidBodyTree * robot)
   this->Qv = MatrixXd::Zero(this->nq,this->nq);
   this->debug_mode = true;
   this->sequentialSeedFlag = false;
+  this->solver = SNOPT;
+  this->num_threads = 1;
+  this->sequential_seed_block_size = 0;
   this->SNOPT_MajorFeasibilityTolerance = 1E-6;
   this->SNOPT_MajorIterationsLimit = 200;
   this->SNOPT_IterationsLimit = 10000;
@@ -153,6 +159,44 @@ bool IKoptions::getSequentialSeedFlag() const
   return this->sequentialSeedFlag;
 }
 
+void IKoptions::setSolver(Solver solver)
+{
+  this->solver = solver;
+}
+
+IKoptions::Solver IKoptions::getSolver() const
+{
+  return this->solver;
+}
+
+void IKoptions::setNumThreads(int num_threads)
+{
+  if(num_threads<=0)
+  {
+    cerr<<"Number of threads must be positive"<<endl;
+  }
+  this->num_threads = num_threads;
+}
+
+int IKoptions::getNumThreads() const
+{
+  return this->num_threads;
+}
+
+void IKoptions::setSequentialSeedBlockSize(int block_size)
+{
+  if(block_size<0)
+  {
+    cerr<<"Sequential seed block size must be non-negative"<<endl;
+  }
+  this->sequential_seed_block_size = block_size;
+}
+
+int IKoptions::getSequentialSeedBlockSize() const
+{
+  return this->sequential_seed_block_size;
+}
+
 void IKoptions::setMajorOptimalityTolerance(double tol)
 {
   if(tol<=0)
@@ -20,6 +20,22 @@ class RigidBodyTree;
 
 class drakeIKoptions_DLLEXPORT IKoptions
 {
+  public:
+    /*
+     * SNOPT is the default. SQP is a sequential quadratic programming solver built on eiquadprog. Only SQP solves run
+     * concurrently: the SNOPT library isn't reentrant, so SNOPT solves from different threads are serialized. Collision
+     * constraints (MinDistanceConstraint, AllBodiesClosestDistanceConstraint) query a copy of the collision model of
+     * the RigidBodyTree that no other thread uses while the query runs, so they don't serialize concurrent solves on
+     * the same tree. inverseKin and inverseKinPointwise fall back to SQP when drake is built without SNOPT.
+     * inverseKinTraj always uses SNOPT.
+     *
+     * With the SQP solver, inverseKinPointwise solves the time samples on up to num_threads threads. When the
+     * sequential seed flag is set, each sample is seeded from the solution of its predecessor, as with SNOPT, so the
+     * samples are solved in order on one thread. Setting a positive sequential seed block size restarts the seed
+     * chain every sequential_seed_block_size samples, the first sample of every block uses its own seed, and the
+     * blocks are solved in parallel. The solution then depends on the block size but not on num_threads.
+     */
+    enum Solver {SNOPT, SQP};
   private:
     RigidBodyTree * robot;
     int nq;
@@ -28,6 +44,9 @@ class drakeIKoptions_DLLEXPORT IKoptions
     Eigen::MatrixXd Qv;
     bool debug_mode;
     bool sequentialSeedFlag;
+    Solver solver;
+    int num_threads;
+    int sequential_seed_block_size;
     double SNOPT_MajorFeasibilityTolerance;
     int SNOPT_MajorIterationsLimit;
     int SNOPT_IterationsLimit;
@@ -53,6 +72,9 @@ class drakeIKoptions_DLLEXPORT IKoptions
     void setQv(const Eigen::MatrixXd &Qv);
     void setDebug(bool flag);
     void setSequentialSeedFlag(bool flag);
+    void setSolver(Solver solver);
+    void setNumThreads(int num_threads);
+    void setSequentialSeedBlockSize(int block_size);
     void setMajorOptimalityTolerance(double tol);
     void setMajorFeasibilityTolerance(double tol);
     void setSuperbasicsLimit(int limit);
@@ -69,6 +91,9 @@ class drakeIKoptions_DLLEXPORT IKoptions
     void getQv(Eigen::MatrixXd &Qv) const;
     bool getDebug() const;
     bool getSequentialSeedFlag() const;
+    Solver getSolver() const;
+    int getNumThreads() const;
+    int getSequentialSeedBlockSize() const;
     double getMajorOptimalityTolerance() const;
     double getMajorFeasibilityTolerance() const;
     int getSuperbasicsLimit() const;
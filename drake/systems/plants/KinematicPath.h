@@ -11,5 +11,13 @@ struct KinematicPath
   std::vector<int> body_path;
 };
 
+// a kinematic path together with the columns of the geometric Jacobian along it, as cached by RigidBodyTree
+struct CachedKinematicPath
+{
+  KinematicPath path;
+  std::vector<int> v_indices;
+  std::vector<int> qdot_indices;
+};
+
 
 #endif /* KINEMATICPATH_H_ */
@@ -3,8 +3,8 @@
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
-#include <unordered_map>
 #include <vector>
+#include <algorithm>
 #include <cassert>
 #include <numeric>
 #include <type_traits>
@@ -37,6 +37,11 @@ public:
   Eigen::Matrix<Scalar, TWIST_SIZE, 1> motion_subspace_in_body_dot_times_v; // gradient w.r.t. q_i and v_i only
   Eigen::Matrix<Scalar, TWIST_SIZE, 1> motion_subspace_in_world_dot_times_v; // gradient w.r.t. q and v
 
+  /*
+   * Scratch space for inverseDynamics, which accumulates the net wrenches from the leaves to the root
+   */
+  Eigen::Matrix<Scalar, TWIST_SIZE, 1> net_wrench_in_world;
+
 public:
   KinematicsCacheElement(int num_positions_joint, int num_velocities_joint) :
       motion_subspace_in_body(TWIST_SIZE, num_velocities_joint),
@@ -55,7 +60,9 @@ template <typename Scalar>
 class KinematicsCache
 {
 private:
-  std::unordered_map<RigidBody const *, KinematicsCacheElement<Scalar>, std::hash<RigidBody const *>, std::equal_to<RigidBody const *>, Eigen::aligned_allocator<std::pair<RigidBody const* const, KinematicsCacheElement<Scalar> > > > elements;
+  // one element per body, stored contiguously and addressed by RigidBody::body_index
+  std::vector<KinematicsCacheElement<Scalar>, Eigen::aligned_allocator<KinematicsCacheElement<Scalar> > > elements;
+  std::vector<RigidBody const *> element_bodies; // to catch bodies of other trees, which the unordered_map did for free
   Eigen::Matrix<Scalar, Eigen::Dynamic, 1> q;
   Eigen::Matrix<Scalar, Eigen::Dynamic, 1> v;
   bool velocity_vector_valid;
@@ -63,29 +70,60 @@ private:
   bool jdotV_cached;
   bool inertias_cached;
 
+  /*
+   * Incremental kinematics: the q and v for which the elements were last computed, so that doKinematics only needs
+   * to recompute the bodies whose joint state (or whose ancestors' joint state) has changed since then.
+   */
+  bool incremental_kinematics;
+  bool previous_kinematics_valid;
+  bool previous_velocity_vector_valid;
+  bool previous_jdotV_cached;
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> previous_q;
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> previous_v;
+  std::vector<bool> body_updated;
+
 public:
   KinematicsCache(const std::vector<std::shared_ptr<RigidBody>>& bodies) :
       q(Eigen::Matrix<Scalar, Eigen::Dynamic, 1>::Zero(getNumPositions(bodies), 1)),
       v(Eigen::Matrix<Scalar, Eigen::Dynamic, 1>::Zero(getNumVelocities(bodies), 1)),
-      velocity_vector_valid(false)
+      velocity_vector_valid(false),
+      incremental_kinematics(false),
+      previous_kinematics_valid(false),
+      previous_velocity_vector_valid(false),
+      previous_jdotV_cached(false),
+      body_updated(bodies.size(), true)
   {
+    elements.reserve(bodies.size());
+    element_bodies.reserve(bodies.size());
     for (const auto& body_shared_ptr : bodies) {
       const RigidBody& body = *body_shared_ptr;
+      assert(body.body_index == static_cast<int>(elements.size())); // body indices are assigned in RigidBodyTree::compile
       int num_positions_joint = body.hasParent() ? body.getJoint().getNumPositions() : 0;
       int num_velocities_joint = body.hasParent() ? body.getJoint().getNumVelocities() : 0;
-      elements.insert({&body, KinematicsCacheElement<Scalar>(num_positions_joint, num_velocities_joint)});
+      elements.push_back(KinematicsCacheElement<Scalar>(num_positions_joint, num_velocities_joint));
+      element_bodies.push_back(&body);
     }
     invalidate();
   }
 
   KinematicsCacheElement<Scalar>& getElement(const RigidBody& body)
   {
-    return elements.at(&body);
+    return elements[checkBody(body)];
   }
 
   const KinematicsCacheElement<Scalar>& getElement(const RigidBody& body) const
   {
-    return elements.at(&body);
+    return elements[checkBody(body)];
+  }
+
+  KinematicsCacheElement<Scalar>& getElement(int body_index)
+  {
+    return elements.at(body_index);
+  }
+
+  const KinematicsCacheElement<Scalar>& getElement(int body_index) const
+  {
+    return elements.at(body_index);
   }
 
   template <typename Derived>
@@ -108,16 +146,17 @@ public:
     velocity_vector_valid = true;
   }
 
-  void checkCachedKinematicsSettings(bool velocity_kinematics_required, bool jdot_times_v_required, const std::string& method_name) const
+  // method_name is only turned into a std::string on failure, so that the checks don't allocate
+  void checkCachedKinematicsSettings(bool velocity_kinematics_required, bool jdot_times_v_required, const char* method_name) const
   {
     if (!position_kinematics_cached) {
-      throw std::runtime_error(method_name + " requires position kinematics, which have not been cached. Please call doKinematics.");
+      throw std::runtime_error(std::string(method_name) + " requires position kinematics, which have not been cached. Please call doKinematics.");
     }
     if (velocity_kinematics_required && !hasV()) {
-      throw std::runtime_error(method_name + " requires velocity kinematics, which have not been cached. Please call doKinematics with a velocity vector.");
+      throw std::runtime_error(std::string(method_name) + " requires velocity kinematics, which have not been cached. Please call doKinematics with a velocity vector.");
     }
     if (jdot_times_v_required && !jdotV_cached) {
-      throw std::runtime_error(method_name + " requires Jdot times v, which has not been cached. Please call doKinematics with a velocity vector and compute_JdotV set to true.");
+      throw std::runtime_error(std::string(method_name) + " requires Jdot times v, which has not been cached. Please call doKinematics with a velocity vector and compute_JdotV set to true.");
     }
   }
 
@@ -156,6 +195,65 @@ public:
     this->jdotV_cached = jdotV_cached;
   }
 
+  /*
+   * When enabled, doKinematics reuses the elements of bodies whose joint positions and velocities (and those of all
+   * their ancestors) are unchanged since the previous call to doKinematics.
+   */
+  void setIncrementalKinematics(bool incremental_kinematics) {
+    this->incremental_kinematics = incremental_kinematics;
+    previous_kinematics_valid = false;
+  }
+
+  bool isIncrementalKinematics() const {
+    return incremental_kinematics;
+  }
+
+  /*
+   * Whether the elements computed in the previous call to doKinematics can serve as a starting point for the current one.
+   */
+  bool canReusePreviousKinematics(bool compute_JdotV) const {
+    return incremental_kinematics && previous_kinematics_valid && previous_velocity_vector_valid == velocity_vector_valid && (previous_jdotV_cached || !compute_JdotV);
+  }
+
+  /*
+   * Whether the joint positions or velocities of body differ from the ones used in the previous call to doKinematics.
+   */
+  bool jointStateChanged(const RigidBody& body) const {
+    if (!body.hasParent())
+      return false;
+    const DrakeJoint& joint = body.getJoint();
+    if (!segmentsEqual(q, previous_q, body.position_num_start, joint.getNumPositions()))
+      return true;
+    return velocity_vector_valid && !segmentsEqual(v, previous_v, body.velocity_num_start, joint.getNumVelocities());
+  }
+
+  void setBodyUpdated(const RigidBody& body, bool updated) {
+    body_updated[body.body_index] = updated;
+  }
+
+  bool wasBodyUpdated(const RigidBody& body) const {
+    return body_updated[body.body_index];
+  }
+
+  /*
+   * Number of bodies whose elements the last call to doKinematics recomputed. All of them, unless incremental
+   * kinematics let it reuse the previous elements.
+   */
+  int getNumUpdatedBodies() const {
+    return static_cast<int>(std::count(body_updated.begin(), body_updated.end(), true));
+  }
+
+  void setPreviousKinematics() {
+    if (!incremental_kinematics)
+      return;
+    previous_q = q;
+    if (velocity_vector_valid)
+      previous_v = v;
+    previous_velocity_vector_valid = velocity_vector_valid;
+    previous_jdotV_cached = jdotV_cached;
+    previous_kinematics_valid = true;
+  }
+
 private:
   void invalidate()
   {
@@ -164,6 +262,32 @@ private:
     inertias_cached = false;
   }
 
+  int checkBody(const RigidBody& body) const
+  {
+    int index = body.body_index;
+    if (index < 0 || index >= static_cast<int>(element_bodies.size()) || element_bodies[index] != &body)
+      throw std::out_of_range("KinematicsCache::getElement: body " + body.linkname + " is not part of the tree this cache was created for");
+    return index;
+  }
+
+  static bool scalarsEqual(double a, double b) {
+    return a == b;
+  }
+
+  template <typename DerType>
+  static bool scalarsEqual(const Eigen::AutoDiffScalar<DerType>& a, const Eigen::AutoDiffScalar<DerType>& b) {
+    // gradients matter too: the cached elements carry derivatives with respect to q and v
+    return a.value() == b.value() && a.derivatives().size() == b.derivatives().size() && a.derivatives() == b.derivatives();
+  }
+
+  static bool segmentsEqual(const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& a, const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& b, int start, int size) {
+    for (int i = start; i < start + size; i++) {
+      if (!scalarsEqual(a[i], b[i]))
+        return false;
+    }
+    return true;
+  }
+
   static int getNumPositions(const std::vector<std::shared_ptr<RigidBody>>& bodies) {
     auto add_num_positions = [] (int result, std::shared_ptr<RigidBody> body_ptr) -> int {
       return body_ptr->hasParent() ? result + body_ptr->getJoint().getNumPositions() : result;
@@ -10,6 +10,8 @@
 #include <string>
 #include <regex>
 #include <limits>
+#include <thread>
+#include <atomic>
 #include "RigidBodyConstraint.h"
 #include "KinematicsCache.h"
 
@@ -38,7 +40,7 @@ std::ostream& operator<<(std::ostream& os, const RigidBodyLoop& obj)
 }
 
 RigidBodyTree::RigidBodyTree(const std::string &urdf_filename, const DrakeJoint::FloatingBaseType floating_base_type)
-  :  collision_model(DrakeCollision::newModel())
+  :  collision_model_generation(0), collision_model(DrakeCollision::newModel())
 {
   a_grav << 0, 0, 0, 0, 0, -9.81;
 
@@ -55,7 +57,7 @@ RigidBodyTree::RigidBodyTree(const std::string &urdf_filename, const DrakeJoint:
 }
 
 RigidBodyTree::RigidBodyTree(void) :
-    collision_model(DrakeCollision::newModel())
+    collision_model_generation(0), collision_model(DrakeCollision::newModel())
 {
   a_grav << 0, 0, 0, 0, 0, -9.81;
 
@@ -136,6 +138,15 @@ void RigidBodyTree::compile(void)
     bodies[i]->body_index = static_cast<int>(i);
   }
 
+  {
+    // body indices may have changed
+    lock_guard<mutex> lock(kinematic_path_cache_mutex);
+    kinematic_path_cache = vector<atomic<const CachedKinematicPath*>>(bodies.size() * bodies.size());
+    for (auto it = kinematic_path_cache.begin(); it != kinematic_path_cache.end(); ++it)
+      it->store(nullptr);
+    kinematic_path_cache_entries.clear();
+  }
+
   B.resize(num_velocities,actuators.size());
   B = MatrixXd::Zero(num_velocities,actuators.size());
   for (size_t ia=0; ia<actuators.size(); ia++)
@@ -216,40 +227,86 @@ map<string, int> RigidBodyTree::computePositionNameToIndexMap() const
 
 DrakeCollision::ElementId RigidBodyTree::addCollisionElement(const RigidBody::CollisionElement& element, const shared_ptr<RigidBody>& body, string group_name)
 {
+  lock_guard<mutex> lock(collision_model_pool_mutex);
   DrakeCollision::ElementId id(collision_model->addElement(element));
   if (id != 0) {
     body->collision_element_ids.push_back(id);
     body->collision_element_groups[group_name].push_back(id);
   }
+  invalidateCollisionModelPool();
   return id;
 }
 
 void RigidBodyTree::updateCollisionElements(const RigidBody& body, const Eigen::Transform<double, 3, Eigen::Isometry>& transform_to_world)
+{
+  lock_guard<mutex> lock(collision_model_pool_mutex);
+  updateCollisionElements(body, transform_to_world, *collision_model);
+  invalidateCollisionModelPool();
+}
+
+void RigidBodyTree::updateCollisionElements(const RigidBody& body, const Eigen::Transform<double, 3, Eigen::Isometry>& transform_to_world, DrakeCollision::Model& model)
 {
   for (auto id_iter = body.collision_element_ids.begin(); id_iter != body.collision_element_ids.end(); ++id_iter) {
-    collision_model->updateElementWorldTransform(*id_iter, transform_to_world.matrix());
+    model.updateElementWorldTransform(*id_iter, transform_to_world.matrix());
   }
 }
 
 void RigidBodyTree::updateStaticCollisionElements()
 {
+  lock_guard<mutex> lock(collision_model_pool_mutex);
   for (auto it = bodies.begin(); it != bodies.end(); ++it) {
     RigidBody& body = **it;
     if (!body.hasParent()) {
-      updateCollisionElements(body, Isometry3d::Identity());
+      updateCollisionElements(body, Isometry3d::Identity(), *collision_model);
     }
   }
+  invalidateCollisionModelPool();
 }
 
 void RigidBodyTree::updateDynamicCollisionElements(const KinematicsCache<double>& cache)
+{
+  // the queries move the dynamic elements of their copy to their own cache, so the copies don't need to be redone
+  lock_guard<mutex> lock(collision_model_pool_mutex);
+  updateDynamicCollisionElements(cache, *collision_model);
+}
+
+void RigidBodyTree::updateDynamicCollisionElements(const KinematicsCache<double>& cache, DrakeCollision::Model& model)
 {
   for (auto it = bodies.begin(); it != bodies.end(); ++it) {
     const RigidBody& body = **it;
     if (body.hasParent()) {
-      updateCollisionElements(body, cache.getElement(body).transform_to_world);
+      updateCollisionElements(body, cache.getElement(body).transform_to_world, model);
     }
   }
-  collision_model->updateModel();
+  model.updateModel();
+}
+
+void RigidBodyTree::invalidateCollisionModelPool()
+{
+  collision_model_pool.clear();
+  collision_model_generation++;
+}
+
+RigidBodyTree::CollisionModelLease::CollisionModelLease(RigidBodyTree& tree) : tree(tree)
+{
+  lock_guard<mutex> lock(tree.collision_model_pool_mutex);
+  generation = tree.collision_model_generation;
+  if (tree.collision_model_pool.empty()) {
+    leased_model = DrakeCollision::newModel();
+    leased_model->addElementsFrom(*tree.collision_model);
+  } else {
+    leased_model = move(tree.collision_model_pool.back());
+    tree.collision_model_pool.pop_back();
+  }
+}
+
+RigidBodyTree::CollisionModelLease::~CollisionModelLease()
+{
+  static const size_t max_pool_size = max(1u, thread::hardware_concurrency());
+  lock_guard<mutex> lock(tree.collision_model_pool_mutex);
+  if (generation == tree.collision_model_generation && tree.collision_model_pool.size() < max_pool_size) {
+    tree.collision_model_pool.push_back(move(leased_model));
+  }
 }
 
 void RigidBodyTree::getTerrainContactPoints(const RigidBody& body, Eigen::Matrix3Xd &terrain_points) const
@@ -272,10 +329,13 @@ bool RigidBodyTree::collisionRaycast(const KinematicsCache<double>& cache,
                                      const Matrix3Xd &origins,
                                      const Matrix3Xd &ray_endpoints,
                                      VectorXd &distances,
-                                     bool use_margins )
+                                     bool use_margins,
+                                     int num_threads)
 {
-  updateDynamicCollisionElements(cache);
-  return collision_model->collisionRaycast(origins, ray_endpoints, use_margins, distances);
+  CollisionModelLease lease(*this);
+  DrakeCollision::Model& model = lease.model();
+  updateDynamicCollisionElements(cache, model);
+  return model.collisionRaycast(origins, ray_endpoints, use_margins, distances, num_threads);
 }
 
 
@@ -287,15 +347,23 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
                                     vector<int>& bodyA_idx,
                                     vector<int>& bodyB_idx,
                                     const vector<DrakeCollision::ElementId>& ids_to_check,
-                                    bool use_margins)
+                                    bool use_margins,
+                                    double max_distance)
 {
-  updateDynamicCollisionElements(cache);
+  CollisionModelLease lease(*this);
+  DrakeCollision::Model& model = lease.model();
+  updateDynamicCollisionElements(cache, model);
 
   vector<DrakeCollision::PointPair> points;
   //DEBUG
   //cout << "RigidBodyTree::collisionDetect: calling collision_model->closestPointsAllToAll" << endl;
   //END_DEBUG
-  bool points_found = collision_model->closestPointsAllToAll(ids_to_check, use_margins, points);
+  bool points_found;
+  if (max_distance < std::numeric_limits<double>::infinity()) {
+    points_found = model.closestPointsAllToAll(ids_to_check, use_margins, max_distance, points);
+  } else {
+    points_found = model.closestPointsAllToAll(ids_to_check, use_margins, points);
+  }
   //DEBUG
   //cout << "RigidBodyTree::collisionDetect: points.size() = " << points.size() << endl;
   //END_DEBUG
@@ -313,7 +381,7 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
     xB.col(i) = ptB;
     normal.col(i) = n;
     phi[i] = distance;
-    const RigidBody::CollisionElement* elementA = dynamic_cast<const RigidBody::CollisionElement*>(collision_model->readElement(points[i].getIdA()));
+    const RigidBody::CollisionElement* elementA = dynamic_cast<const RigidBody::CollisionElement*>(model.readElement(points[i].getIdA()));
     //DEBUG
     //cout << "RigidBodyTree::collisionDetect: points[i].getIdA() = " << points[i].getIdA() << endl;
     //cout << "RigidBodyTree::collisionDetect: collision_model->readElement(points[i].getIdA()) = " << collision_model->readElement(points[i].getIdA()) << endl;
@@ -321,7 +389,7 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
     //cout << "RigidBodyTree::collisionDetect: elementA = " << elementA << endl;
     //END_DEBUG
     bodyA_idx.push_back(elementA->getBody()->body_index);
-    const RigidBody::CollisionElement* elementB = dynamic_cast<const RigidBody::CollisionElement*>(collision_model->readElement(points[i].getIdB()));
+    const RigidBody::CollisionElement* elementB = dynamic_cast<const RigidBody::CollisionElement*>(model.readElement(points[i].getIdB()));
     bodyB_idx.push_back(elementB->getBody()->body_index);
   }
   return points_found;
@@ -336,7 +404,8 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
                                     vector<int>& bodyB_idx,
                                     const vector<int>& bodies_idx,
                                     const set<string>& active_element_groups,
-                                    bool use_margins)
+                                    bool use_margins,
+                                    double max_distance)
 {
   vector<DrakeCollision::ElementId> ids_to_check;
   for (auto body_idx_iter = bodies_idx.begin();
@@ -350,7 +419,7 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
       }
     }
   }
-  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins);
+  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins, max_distance);
 }
 
 bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
@@ -361,7 +430,8 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
                                     vector<int>& bodyA_idx,
                                     vector<int>& bodyB_idx,
                                     const vector<int>& bodies_idx,
-                                    bool use_margins)
+                                    bool use_margins,
+                                    double max_distance)
 {
   vector<DrakeCollision::ElementId> ids_to_check;
   for (auto body_idx_iter = bodies_idx.begin();
@@ -371,7 +441,7 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
       bodies[*body_idx_iter]->appendCollisionElementIdsFromThisBody(ids_to_check);
     }
   }
-  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins);
+  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins, max_distance);
 }
 
 bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
@@ -382,7 +452,8 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
                                     vector<int>& bodyA_idx,
                                     vector<int>& bodyB_idx,
                                     const set<string>& active_element_groups,
-                                    bool use_margins)
+                                    bool use_margins,
+                                    double max_distance)
 {
   vector<DrakeCollision::ElementId> ids_to_check;
   for (auto body_iter = bodies.begin();
@@ -394,7 +465,7 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
       (*body_iter)->appendCollisionElementIdsFromThisBody(*group_iter, ids_to_check);
     }
   }
-  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins);
+  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins, max_distance);
 }
 
 bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
@@ -404,7 +475,8 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
                                     Matrix3Xd& xB,
                                     vector<int>& bodyA_idx,
                                     vector<int>& bodyB_idx,
-                                    bool use_margins)
+                                    bool use_margins,
+                                    double max_distance)
 {
   vector<DrakeCollision::ElementId> ids_to_check;
   for (auto body_iter = bodies.begin();
@@ -412,7 +484,7 @@ bool RigidBodyTree::collisionDetect(const KinematicsCache<double>& cache,
        ++body_iter) {
     (*body_iter)->appendCollisionElementIdsFromThisBody(ids_to_check);
   }
-  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins);
+  return collisionDetect(cache, phi, normal, xA, xB, bodyA_idx, bodyB_idx, ids_to_check, use_margins, max_distance);
 }
 
 void RigidBodyTree::potentialCollisions(const KinematicsCache<double>& cache, VectorXd& phi,
@@ -423,9 +495,11 @@ void RigidBodyTree::potentialCollisions(const KinematicsCache<double>& cache, Ve
                                         vector<int>& bodyB_idx,
                                         bool use_margins)
 {
-  updateDynamicCollisionElements(cache);
+  CollisionModelLease lease(*this);
+  DrakeCollision::Model& model = lease.model();
+  updateDynamicCollisionElements(cache, model);
   vector<DrakeCollision::PointPair> potential_collisions;
-  potential_collisions = collision_model->potentialCollisionPoints(use_margins);
+  potential_collisions = model.potentialCollisionPoints(use_margins);
   size_t num_potential_collisions = potential_collisions.size();
 
   phi = VectorXd::Zero(num_potential_collisions);
@@ -440,8 +514,8 @@ void RigidBodyTree::potentialCollisions(const KinematicsCache<double>& cache, Ve
   double distance;
 
   for (size_t i = 0; i < num_potential_collisions; i++) {
-    const RigidBody::CollisionElement* elementA = dynamic_cast<const RigidBody::CollisionElement*>(collision_model->readElement(potential_collisions[i].getIdA()));
-    const RigidBody::CollisionElement* elementB = dynamic_cast<const RigidBody::CollisionElement*>(collision_model->readElement(potential_collisions[i].getIdB()));
+    const RigidBody::CollisionElement* elementA = dynamic_cast<const RigidBody::CollisionElement*>(model.readElement(potential_collisions[i].getIdA()));
+    const RigidBody::CollisionElement* elementB = dynamic_cast<const RigidBody::CollisionElement*>(model.readElement(potential_collisions[i].getIdB()));
     potential_collisions[i].getResults(ptA, ptB, n, distance);
     xA.col(i) = ptA;
     xB.col(i) = ptB;
@@ -454,10 +528,13 @@ void RigidBodyTree::potentialCollisions(const KinematicsCache<double>& cache, Ve
 
 vector<size_t> RigidBodyTree::collidingPoints(const KinematicsCache<double>& cache,
                                               const vector<Vector3d>& points,
-                                              double collision_threshold)
+                                              double collision_threshold,
+                                              int num_threads)
 {
-  updateDynamicCollisionElements(cache);
-  return collision_model->collidingPoints(points, collision_threshold);
+  CollisionModelLease lease(*this);
+  DrakeCollision::Model& model = lease.model();
+  updateDynamicCollisionElements(cache, model);
+  return model.collidingPoints(points, collision_threshold, num_threads);
 }
 
 bool RigidBodyTree::allCollisions(const KinematicsCache<double>& cache, vector<int>& bodyA_idx,
@@ -465,10 +542,12 @@ bool RigidBodyTree::allCollisions(const KinematicsCache<double>& cache, vector<i
                                   Matrix3Xd& xA_in_world, Matrix3Xd& xB_in_world,
                                   bool use_margins)
 {
-  updateDynamicCollisionElements(cache);
+  CollisionModelLease lease(*this);
+  DrakeCollision::Model& model = lease.model();
+  updateDynamicCollisionElements(cache, model);
 
   vector<DrakeCollision::PointPair> points;
-  bool points_found = collision_model->collisionPointsAllToAll(use_margins, points);
+  bool points_found = model.collisionPointsAllToAll(use_margins, points);
 
   xA_in_world = Matrix3Xd::Zero(3,points.size());
   xB_in_world = Matrix3Xd::Zero(3,points.size());
@@ -480,9 +559,9 @@ bool RigidBodyTree::allCollisions(const KinematicsCache<double>& cache, vector<i
     xA_in_world.col(i) = ptA;
     xB_in_world.col(i) = ptB;
 
-    const RigidBody::CollisionElement* elementA = dynamic_cast<const RigidBody::CollisionElement*>(collision_model->readElement(points[i].getIdA()));
+    const RigidBody::CollisionElement* elementA = dynamic_cast<const RigidBody::CollisionElement*>(model.readElement(points[i].getIdA()));
     bodyA_idx.push_back(elementA->getBody()->body_index);
-    const RigidBody::CollisionElement* elementB = dynamic_cast<const RigidBody::CollisionElement*>(collision_model->readElement(points[i].getIdB()));
+    const RigidBody::CollisionElement* elementB = dynamic_cast<const RigidBody::CollisionElement*>(model.readElement(points[i].getIdB()));
     bodyB_idx.push_back(elementB->getBody()->body_index);
   }
   return points_found;
@@ -536,6 +615,15 @@ void RigidBodyTree::updateCompositeRigidBodyInertias(KinematicsCache<Scalar>& ca
 template <typename Scalar>
 Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> RigidBodyTree::worldMomentumMatrix(KinematicsCache<Scalar>& cache,
                                                                               const std::set<int>& robotnum, bool in_terms_of_qdot) const
+{
+  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> ret;
+  worldMomentumMatrix(cache, robotnum, in_terms_of_qdot, ret);
+  return ret;
+}
+
+template <typename Scalar>
+void RigidBodyTree::worldMomentumMatrix(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot,
+                                        Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic>& ret) const
 {
   cache.checkCachedKinematicsSettings(false, false, "worldMomentumMatrix");
   updateCompositeRigidBodyInertias(cache);
@@ -543,7 +631,7 @@ Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> RigidBodyTree::worldMomentumMatrix(Ki
   int nq = num_positions;
   int nv = num_velocities;
   int ncols = in_terms_of_qdot ? nq : nv;
-  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> ret(TWIST_SIZE, ncols);
+  ret.resize(TWIST_SIZE, ncols);
   ret.setZero();
   int gradient_row_start = 0;
   for (int i = 0; i < bodies.size(); i++) {
@@ -568,7 +656,6 @@ Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> RigidBodyTree::worldMomentumMatrix(Ki
       gradient_row_start += TWIST_SIZE * ncols_joint;
     }
   }
-  return ret;
 }
 
 template <typename Scalar>
@@ -597,21 +684,30 @@ Matrix<Scalar, TWIST_SIZE, 1> RigidBodyTree::worldMomentumMatrixDotTimesV(Kinema
 
 template <typename Scalar>
 Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> RigidBodyTree::centroidalMomentumMatrix(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot) const
+{
+  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> ret;
+  centroidalMomentumMatrix(cache, robotnum, in_terms_of_qdot, ret);
+  return ret;
+}
+
+template <typename Scalar>
+void RigidBodyTree::centroidalMomentumMatrix(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot,
+                                             Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic>& ret) const
 {
   // kinematics cache checks already being done in worldMomentumMatrix.
-  auto ret = worldMomentumMatrix(cache, robotnum, in_terms_of_qdot);
+  worldMomentumMatrix(cache, robotnum, in_terms_of_qdot, ret);
 
-  // transform from world frame to COM frame
+  // transform from world frame to COM frame, column by column so that the cross products are fixed size
   auto com = centerOfMass(cache, robotnum);
-  auto angular_momentum_matrix = ret.template topRows<SPACE_DIMENSION>();
-  auto linear_momentum_matrix = ret.template bottomRows<SPACE_DIMENSION>();
-  angular_momentum_matrix += linear_momentum_matrix.colwise().cross(com);
+  for (int i = 0; i < ret.cols(); i++) {
+    auto angular_momentum_column = ret.col(i).template topRows<SPACE_DIMENSION>();
+    Matrix<Scalar, SPACE_DIMENSION, 1> linear_momentum_column = ret.col(i).template bottomRows<SPACE_DIMENSION>();
+    angular_momentum_column += linear_momentum_column.cross(com);
+  }
 
   //  Valid for more general frame transformations but slower:
   //  Eigen::Transform<Scalar, SPACE_DIMENSION, Eigen::Isometry> T(Translation<Scalar, SPACE_DIMENSION>(-com.value()));
   //  ret.value() = transformSpatialForce(T, ret.value());
-
-  return ret;
 }
 
 template <typename Scalar>
@@ -671,7 +767,7 @@ Eigen::Matrix<Scalar, SPACE_DIMENSION, 1> RigidBodyTree::centerOfMass(Kinematics
     if (isBodyPartOfRobot(body, robotnum))
     {
       if (body.mass > 0) {
-        auto body_com = forwardKin(cache, body.com.cast<Scalar>(), i, 0, 0);
+        Matrix<Scalar, SPACE_DIMENSION, 1> body_com = cache.getElement(body).transform_to_world * body.com.cast<Scalar>();
         com.noalias() += body.mass * body_com;
       }
       m += body.mass;
@@ -685,11 +781,38 @@ Eigen::Matrix<Scalar, SPACE_DIMENSION, 1> RigidBodyTree::centerOfMass(Kinematics
 
 template <typename Scalar>
 Matrix<Scalar, SPACE_DIMENSION, Eigen::Dynamic> RigidBodyTree::centerOfMassJacobian(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot) const
+{
+  Matrix<Scalar, SPACE_DIMENSION, Eigen::Dynamic> J;
+  centerOfMassJacobian(cache, robotnum, in_terms_of_qdot, J);
+  return J;
+}
+
+template <typename Scalar>
+void RigidBodyTree::centerOfMassJacobian(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot,
+                                         Matrix<Scalar, SPACE_DIMENSION, Eigen::Dynamic>& J) const
 {
   cache.checkCachedKinematicsSettings(false, false, "centerOfMassJacobian");
-  auto A = worldMomentumMatrix(cache, robotnum, in_terms_of_qdot);
-  double total_mass = getMass(robotnum);
-  return A.template bottomRows<SPACE_DIMENSION>() / total_mass;
+  updateCompositeRigidBodyInertias(cache);
+
+  // the linear momentum rows of worldMomentumMatrix, without forming the angular momentum rows
+  J.resize(SPACE_DIMENSION, in_terms_of_qdot ? num_positions : num_velocities);
+  J.setZero();
+  for (int i = 0; i < bodies.size(); i++) {
+    RigidBody& body = *bodies[i];
+    if (body.hasParent() && isBodyPartOfRobot(body, robotnum)) {
+      const auto& element = cache.getElement(body);
+      const DrakeJoint& joint = body.getJoint();
+      auto crb_linear = element.crb_in_world.template bottomRows<SPACE_DIMENSION>();
+      if (in_terms_of_qdot) {
+        auto crb = (crb_linear * element.motion_subspace_in_world).eval();
+        J.middleCols(body.position_num_start, joint.getNumPositions()).noalias() = crb * element.qdot_to_v;
+      }
+      else {
+        J.middleCols(body.velocity_num_start, joint.getNumVelocities()).noalias() = crb_linear * element.motion_subspace_in_world;
+      }
+    }
+  }
+  J /= getMass(robotnum);
 }
 
 template <typename Scalar>
@@ -864,30 +987,61 @@ KinematicPath RigidBodyTree::findKinematicPath(int start_body_or_frame_idx, int
   return path;
 }
 
+const CachedKinematicPath& RigidBodyTree::cachedKinematicPath(int start_body_or_frame_idx, int end_body_or_frame_idx) const
+{
+  int start_body = parseBodyOrFrameID(start_body_or_frame_idx);
+  int end_body = parseBodyOrFrameID(end_body_or_frame_idx);
+  if (kinematic_path_cache.size() != bodies.size() * bodies.size())
+    throw runtime_error("RigidBodyTree::cachedKinematicPath: call compile first.");
+  atomic<const CachedKinematicPath*>& cached = kinematic_path_cache[start_body * bodies.size() + end_body];
+  const CachedKinematicPath* found = cached.load(memory_order_acquire);
+  if (found)
+    return *found;
+
+  // computed without the lock; if another thread gets there first, its entry is kept
+  unique_ptr<CachedKinematicPath> entry(new CachedKinematicPath());
+  entry->path = findKinematicPath(start_body, end_body);
+  for (auto it = entry->path.joint_path.begin(); it != entry->path.joint_path.end(); ++it) {
+    const RigidBody& body = *bodies[*it];
+    const DrakeJoint& joint = body.getJoint();
+    for (int j = 0; j < joint.getNumVelocities(); j++)
+      entry->v_indices.push_back(body.velocity_num_start + j);
+    for (int j = 0; j < joint.getNumPositions(); j++)
+      entry->qdot_indices.push_back(body.position_num_start + j);
+  }
+
+  lock_guard<mutex> lock(kinematic_path_cache_mutex);
+  if (cached.compare_exchange_strong(found, entry.get(), memory_order_acq_rel, memory_order_acquire))
+    kinematic_path_cache_entries.push_back(move(entry));
+  return *cached.load(memory_order_acquire);
+}
+
 template<typename Scalar>
 Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> RigidBodyTree::geometricJacobian(const KinematicsCache<Scalar>& cache,
                                                                             int base_body_or_frame_ind, int end_effector_body_or_frame_ind, int expressed_in_body_or_frame_ind, bool in_terms_of_qdot, std::vector<int>* v_or_qdot_indices) const
 {
-  cache.checkCachedKinematicsSettings(false, false, "geometricJacobian");
+  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> J;
+  geometricJacobian(cache, base_body_or_frame_ind, end_effector_body_or_frame_ind, expressed_in_body_or_frame_ind, in_terms_of_qdot, J, v_or_qdot_indices);
+  return J;
+}
 
-  KinematicPath kinematic_path = findKinematicPath(base_body_or_frame_ind, end_effector_body_or_frame_ind);
+template<typename Scalar>
+void RigidBodyTree::geometricJacobian(const KinematicsCache<Scalar>& cache,
+                                      int base_body_or_frame_ind, int end_effector_body_or_frame_ind, int expressed_in_body_or_frame_ind, bool in_terms_of_qdot, Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic>& J, std::vector<int>* v_or_qdot_indices) const
+{
+  cache.checkCachedKinematicsSettings(false, false, "geometricJacobian");
 
-  int cols = 0;
-  int body_index;
-  for (size_t i = 0; i < kinematic_path.joint_path.size(); i++) {
-    body_index = kinematic_path.joint_path[i];
-    const std::shared_ptr<RigidBody>& body = bodies[body_index];
-    const DrakeJoint& joint = body->getJoint();
-    cols += in_terms_of_qdot ? joint.getNumPositions() : joint.getNumVelocities();
-  }
+  const CachedKinematicPath& cached_path = cachedKinematicPath(base_body_or_frame_ind, end_effector_body_or_frame_ind);
+  const KinematicPath& kinematic_path = cached_path.path;
+  const std::vector<int>& indices = in_terms_of_qdot ? cached_path.qdot_indices : cached_path.v_indices;
 
-  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> J(TWIST_SIZE, cols);
+  J.resize(TWIST_SIZE, indices.size());
 
   if (v_or_qdot_indices != nullptr) {
-    v_or_qdot_indices->clear();
-    v_or_qdot_indices->reserve(cols);
+    v_or_qdot_indices->assign(indices.begin(), indices.end());
   }
 
+  int body_index;
   int col_start = 0;
   for (size_t i = 0; i < kinematic_path.joint_path.size(); i++) {
     body_index = kinematic_path.joint_path[i];
@@ -903,22 +1057,16 @@ Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> RigidBodyTree::geometricJacobian(cons
     else {
       J_block.noalias() = sign * element.motion_subspace_in_world;
     }
-
-    if (v_or_qdot_indices != nullptr) {
-      int cols_block_start = in_terms_of_qdot ? body.position_num_start : body.velocity_num_start;
-      for (int j = 0; j < ncols_block; j++) {
-        v_or_qdot_indices->push_back(cols_block_start + j);
-      }
-    }
     col_start += ncols_block;
   }
 
   if (expressed_in_body_or_frame_ind != 0) {
     auto T_world_to_frame = relativeTransform(cache, expressed_in_body_or_frame_ind, 0);
-    J = transformSpatialMotion(T_world_to_frame, J);
+    // column by column, so that the temporaries are fixed size
+    for (int i = 0; i < J.cols(); i++) {
+      J.col(i) = transformSpatialMotion(T_world_to_frame, J.col(i));
+    }
   }
-
-  return J;
 }
 
 template <typename Scalar>
@@ -999,12 +1147,19 @@ Transform<Scalar, 3, Isometry> RigidBodyTree::relativeTransform(const Kinematics
 
 template<typename Scalar>
 Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> RigidBodyTree::massMatrix(KinematicsCache<Scalar>& cache) const
+{
+  Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> ret;
+  massMatrix(cache, ret);
+  return ret;
+}
+
+template<typename Scalar>
+void RigidBodyTree::massMatrix(KinematicsCache<Scalar>& cache, Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& H) const
 {
   cache.checkCachedKinematicsSettings(false, false, "massMatrix");
 
   int nv = num_velocities;
-  Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> ret(nv, nv);
-  ret.setZero();
+  H.setZero(nv, nv);
 
   updateCompositeRigidBodyInertias(cache);
 
@@ -1017,7 +1172,7 @@ Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> RigidBodyTree::massMatrix(Kinemat
       auto F = (element_i.crb_in_world * element_i.motion_subspace_in_world).eval();
 
       // Hii
-      ret.block(v_start_i, v_start_i, nv_i, nv_i).noalias() = (element_i.motion_subspace_in_world.transpose() * F).eval();
+      H.block(v_start_i, v_start_i, nv_i, nv_i).noalias() = (element_i.motion_subspace_in_world.transpose() * F).eval();
 
       // Hij
       shared_ptr<RigidBody> body_j(body_i.parent);
@@ -1026,15 +1181,47 @@ Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> RigidBodyTree::massMatrix(Kinemat
         int v_start_j = body_j->velocity_num_start;
         int nv_j = body_j->getJoint().getNumVelocities();
         auto Hji = (element_j.motion_subspace_in_world.transpose() * F).eval();
-        ret.block(v_start_j, v_start_i, nv_j, nv_i) = Hji;
-        ret.block(v_start_i, v_start_j, nv_i, nv_j) = Hji.transpose();
+        H.block(v_start_j, v_start_i, nv_j, nv_i) = Hji;
+        H.block(v_start_i, v_start_j, nv_i, nv_j) = Hji.transpose();
 
         body_j = body_j->parent;
       }
     }
   }
+}
 
-  return ret;
+std::vector<int> RigidBodyTree::velocityParents() const
+{
+  std::vector<int> velocity_parents(num_velocities, -1);
+  for (int i = 0; i < bodies.size(); i++) {
+    RigidBody& body = *bodies[i];
+    if (body.hasParent()) {
+      int nv_joint = body.getJoint().getNumVelocities();
+      if (nv_joint == 0)
+        continue;
+
+      // first velocity of the joint: last velocity of the closest ancestor that has any
+      const RigidBody* ancestor = body.parent.get();
+      while (ancestor->hasParent() && ancestor->getJoint().getNumVelocities() == 0) {
+        ancestor = ancestor->parent.get();
+      }
+      if (ancestor->hasParent()) {
+        velocity_parents[body.velocity_num_start] = ancestor->velocity_num_start + ancestor->getJoint().getNumVelocities() - 1;
+      }
+
+      // remaining velocities of the joint form a chain
+      for (int j = 1; j < nv_joint; j++) {
+        velocity_parents[body.velocity_num_start + j] = body.velocity_num_start + j - 1;
+      }
+    }
+  }
+  return velocity_parents;
+}
+
+template <typename Scalar>
+TreeSparseLTDL<Scalar> RigidBodyTree::massMatrixLTDL(KinematicsCache<Scalar>& cache) const
+{
+  return TreeSparseLTDL<Scalar>(massMatrix(cache), velocityParents());
 }
 
 /**
@@ -1045,11 +1232,17 @@ Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> RigidBodyTree::massMatrix(Kinemat
 template <typename Scalar>
 Matrix<Scalar, Eigen::Dynamic, 1> RigidBodyTree::dynamicsBiasTerm(KinematicsCache<Scalar>& cache, const eigen_aligned_unordered_map<RigidBody const *, Matrix<Scalar, TWIST_SIZE, 1> >& f_ext) const
 {
-  Matrix<Scalar, Eigen::Dynamic, 1> vd(num_velocities, 1);
-  vd.setZero();
-  return inverseDynamics(cache, f_ext, vd);
+  Matrix<Scalar, Eigen::Dynamic, 1> ret;
+  dynamicsBiasTerm(cache, f_ext, ret);
+  return ret;
 };
 
+template <typename Scalar>
+void RigidBodyTree::dynamicsBiasTerm(KinematicsCache<Scalar>& cache, const eigen_aligned_unordered_map<RigidBody const *, Matrix<Scalar, TWIST_SIZE, 1> >& f_ext, Matrix<Scalar, Eigen::Dynamic, 1>& C) const
+{
+  inverseDynamics<Scalar>(cache, f_ext, nullptr, C);
+}
+
 /*
  * Note that the wrenches in f_ext are expressed in body frame.
  */
@@ -1057,6 +1250,16 @@ template <typename Scalar>
 Matrix<Scalar, Eigen::Dynamic, 1> RigidBodyTree::inverseDynamics(KinematicsCache<Scalar>& cache,
                                                                  const eigen_aligned_unordered_map<RigidBody const *, Matrix<Scalar, TWIST_SIZE, 1> >& f_ext,
                                                                  const Matrix<Scalar, Eigen::Dynamic, 1>& vd) const
+{
+  Matrix<Scalar, Eigen::Dynamic, 1> ret;
+  inverseDynamics(cache, f_ext, &vd, ret);
+  return ret;
+}
+
+template <typename Scalar>
+void RigidBodyTree::inverseDynamics(KinematicsCache<Scalar>& cache,
+                                    const eigen_aligned_unordered_map<RigidBody const *, Matrix<Scalar, TWIST_SIZE, 1> >& f_ext,
+                                    const Matrix<Scalar, Eigen::Dynamic, 1>* vd, Matrix<Scalar, Eigen::Dynamic, 1>& tau) const
 {
   cache.checkCachedKinematicsSettings(true, true, "inverseDynamics");
 
@@ -1065,48 +1268,162 @@ Matrix<Scalar, Eigen::Dynamic, 1> RigidBodyTree::inverseDynamics(KinematicsCache
   typedef typename Eigen::Matrix<Scalar, TWIST_SIZE, 1> Vector6;
 
   Vector6 root_accel = -a_grav.cast<Scalar>();
-  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> net_wrenches(TWIST_SIZE, bodies.size());
-  net_wrenches.col(0).setZero();
+  cache.getElement(*bodies[0]).net_wrench_in_world.setZero();
 
   for (int i = 0; i < bodies.size(); i++) {
     RigidBody& body = *bodies[i];
     if (body.hasParent()) {
-      const auto& element = cache.getElement(body);
+      auto& element = cache.getElement(body);
       Vector6 spatial_accel = root_accel + element.motion_subspace_in_world_dot_times_v;
-      int nv_joint = body.getJoint().getNumVelocities();
-      auto vdJoint = vd.middleRows(body.velocity_num_start, nv_joint);
-      spatial_accel.noalias() += element.motion_subspace_in_world * vdJoint;
+      if (vd) {
+        int nv_joint = body.getJoint().getNumVelocities();
+        auto vdJoint = vd->middleRows(body.velocity_num_start, nv_joint);
+        spatial_accel.noalias() += element.motion_subspace_in_world * vdJoint;
+      }
 
       auto I_times_twist = (element.inertia_in_world * element.twist_in_world).eval();
-      net_wrenches.col(i).noalias() = element.inertia_in_world * spatial_accel;
-      net_wrenches.col(i).noalias() += crossSpatialForce(element.twist_in_world, I_times_twist);
+      element.net_wrench_in_world.noalias() = element.inertia_in_world * spatial_accel;
+      element.net_wrench_in_world.noalias() += crossSpatialForce(element.twist_in_world, I_times_twist);
 
       auto f_ext_iterator = f_ext.find(bodies[i].get());
       if (f_ext_iterator != f_ext.end()) {
         const auto& f_ext_i = f_ext_iterator->second;
-        net_wrenches.col(i) -= transformSpatialForce(element.transform_to_world, f_ext_i);
+        element.net_wrench_in_world -= transformSpatialForce(element.transform_to_world, f_ext_i);
       }
     }
   }
 
-  Matrix<Scalar, Eigen::Dynamic, 1> ret(num_velocities, 1);
+  tau.resize(num_velocities, 1);
+  const auto& v = cache.getV();
 
   for (int i = static_cast<int>(bodies.size()) - 1; i >= 0; i--) {
     RigidBody& body = *bodies[i];
     if (body.hasParent()) {
       const auto& element = cache.getElement(body);
-      const auto& net_wrenches_const = net_wrenches; // eliminates the need for another explicit instantiation
-      auto joint_wrench = net_wrenches_const.col(i);
-      int nv_joint = body.getJoint().getNumVelocities();
+      const auto& joint_wrench = element.net_wrench_in_world;
+      const DrakeJoint& joint = body.getJoint();
+      int nv_joint = joint.getNumVelocities();
       auto J_transpose = element.motion_subspace_in_world.transpose();
-      ret.middleRows(body.velocity_num_start, nv_joint).noalias() = J_transpose * joint_wrench;
-      auto parent_net_wrench = net_wrenches.col(body.parent->body_index);
-      parent_net_wrench += joint_wrench;
+      auto tau_joint = tau.middleRows(body.velocity_num_start, nv_joint);
+      tau_joint.noalias() = J_transpose * joint_wrench;
+      tau_joint += joint.frictionTorque(v.middleRows(body.velocity_num_start, nv_joint));
+      cache.getElement(*body.parent).net_wrench_in_world += joint_wrench;
     }
   }
+}
 
-  ret += frictionTorques(cache.getV());
-  return ret;
+/*
+ * Computes vd = H^-1 * (tau - C) using the articulated-body algorithm, i.e. without forming the mass matrix.
+ * All spatial quantities are expressed in world frame, so no transformations are needed when propagating articulated
+ * inertias from child to parent. As in inverseDynamics, the wrenches in f_ext are expressed in body frame.
+ */
+template <typename Scalar>
+Matrix<Scalar, Eigen::Dynamic, 1> RigidBodyTree::forwardDynamics(KinematicsCache<Scalar>& cache,
+                                                                 const Matrix<Scalar, Eigen::Dynamic, 1>& tau,
+                                                                 const eigen_aligned_unordered_map<RigidBody const *, Matrix<Scalar, TWIST_SIZE, 1> >& f_ext) const
+{
+  cache.checkCachedKinematicsSettings(true, true, "forwardDynamics");
+
+  updateCompositeRigidBodyInertias(cache);
+
+  typedef typename Eigen::Matrix<Scalar, TWIST_SIZE, 1> Vector6;
+  typedef typename Eigen::Matrix<Scalar, TWIST_SIZE, TWIST_SIZE> Matrix6;
+  typedef typename Eigen::Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic, 0, TWIST_SIZE, DrakeJoint::MAX_NUM_VELOCITIES> MatrixU;
+  typedef typename Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, 0, DrakeJoint::MAX_NUM_VELOCITIES, DrakeJoint::MAX_NUM_VELOCITIES> MatrixD;
+  typedef typename Eigen::Matrix<Scalar, Eigen::Dynamic, 1, 0, DrakeJoint::MAX_NUM_VELOCITIES, 1> VectorJoint;
+
+  int nbodies = static_cast<int>(bodies.size());
+  std::vector<Matrix6, Eigen::aligned_allocator<Matrix6> > articulated_inertias(nbodies);
+  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> bias_forces(TWIST_SIZE, nbodies);
+  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> bias_accels(TWIST_SIZE, nbodies);
+  std::vector<MatrixU, Eigen::aligned_allocator<MatrixU> > U(nbodies);
+  std::vector<MatrixD, Eigen::aligned_allocator<MatrixD> > D_inverse(nbodies);
+  std::vector<VectorJoint, Eigen::aligned_allocator<VectorJoint> > u(nbodies);
+
+  Matrix<Scalar, Eigen::Dynamic, 1> tau_net = tau - frictionTorques(cache.getV());
+
+  // rigid body inertias and velocity product / external forces
+  for (int i = 0; i < nbodies; i++) {
+    RigidBody& body = *bodies[i];
+    articulated_inertias[i].setZero();
+    bias_forces.col(i).setZero();
+    bias_accels.col(i).setZero();
+    if (body.hasParent()) {
+      const auto& element = cache.getElement(body);
+      const auto& parent_element = cache.getElement(*body.parent);
+      articulated_inertias[i] = element.inertia_in_world;
+
+      auto I_times_twist = (element.inertia_in_world * element.twist_in_world).eval();
+      bias_forces.col(i) = crossSpatialForce(element.twist_in_world, I_times_twist);
+
+      auto f_ext_iterator = f_ext.find(bodies[i].get());
+      if (f_ext_iterator != f_ext.end()) {
+        const auto& f_ext_i = f_ext_iterator->second;
+        bias_forces.col(i) -= transformSpatialForce(element.transform_to_world, f_ext_i);
+      }
+
+      // velocity product acceleration of the joint (Sdot * v in world frame)
+      bias_accels.col(i) = element.motion_subspace_in_world_dot_times_v - parent_element.motion_subspace_in_world_dot_times_v;
+    }
+  }
+
+  // articulated body inertias and bias forces, from leaves to root
+  for (int i = nbodies - 1; i >= 0; i--) {
+    RigidBody& body = *bodies[i];
+    if (body.hasParent()) {
+      const auto& element = cache.getElement(body);
+      const auto& S = element.motion_subspace_in_world;
+      int nv_joint = body.getJoint().getNumVelocities();
+      int parent_index = body.parent->body_index;
+
+      Matrix6 Ia = articulated_inertias[i];
+      Vector6 pa = bias_forces.col(i);
+      pa.noalias() += Ia * bias_accels.col(i);
+
+      if (nv_joint > 0) {
+        U[i].noalias() = articulated_inertias[i] * S;
+        MatrixD D = (S.transpose() * U[i]).eval();
+        D_inverse[i] = D.inverse();
+        u[i] = tau_net.middleRows(body.velocity_num_start, nv_joint);
+        u[i].noalias() -= S.transpose() * bias_forces.col(i);
+
+        auto U_times_D_inverse = (U[i] * D_inverse[i]).eval();
+        Ia.noalias() -= U_times_D_inverse * U[i].transpose();
+        pa.noalias() -= U_times_D_inverse * (U[i].transpose() * bias_accels.col(i));
+        pa.noalias() += U_times_D_inverse * u[i];
+      }
+
+      articulated_inertias[parent_index] += Ia;
+      bias_forces.col(parent_index) += pa;
+    }
+  }
+
+  // accelerations, from root to leaves
+  Matrix<Scalar, Eigen::Dynamic, 1> vd(num_velocities, 1);
+  Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> spatial_accels(TWIST_SIZE, nbodies);
+  spatial_accels.col(0) = -a_grav.cast<Scalar>();
+
+  for (int i = 0; i < nbodies; i++) {
+    RigidBody& body = *bodies[i];
+    if (body.hasParent()) {
+      const auto& element = cache.getElement(body);
+      int nv_joint = body.getJoint().getNumVelocities();
+      Vector6 spatial_accel = spatial_accels.col(body.parent->body_index) + bias_accels.col(i);
+      if (nv_joint > 0) {
+        VectorJoint vd_joint = u[i];
+        vd_joint.noalias() -= U[i].transpose() * spatial_accel;
+        vd_joint = (D_inverse[i] * vd_joint).eval();
+        spatial_accel.noalias() += element.motion_subspace_in_world * vd_joint;
+        vd.middleRows(body.velocity_num_start, nv_joint) = vd_joint;
+      }
+      spatial_accels.col(i) = spatial_accel;
+    }
+    else {
+      spatial_accels.col(i) = -a_grav.cast<Scalar>();
+    }
+  }
+
+  return vd;
 }
 
 template <typename DerivedV>
@@ -1128,63 +1445,167 @@ Matrix<typename DerivedV::Scalar, Dynamic, 1> RigidBodyTree::frictionTorques(Eig
   return ret;
 }
 
-template <typename Scalar, typename DerivedPoints>
-Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> RigidBodyTree::forwardKinJacobian(const KinematicsCache<Scalar>& cache,
-                                                                                 const MatrixBase<DerivedPoints> &points, int current_body_or_frame_ind, int new_body_or_frame_ind, int rotation_type, bool in_terms_of_qdot) const
+void RigidBodyTree::forwardKinBatch(const Eigen::Ref<const Eigen::MatrixXd>& qs, std::vector<Eigen::Matrix<double, Eigen::Dynamic, 12>>& body_transforms, int num_threads) const
 {
-  cache.checkCachedKinematicsSettings(false, false, "forwardKinJacobian");
+  if (!initialized)
+    throw runtime_error("RigidBodyTree::forwardKinBatch: call compile first.");
+  if (qs.rows() != num_positions)
+    throw runtime_error("RigidBodyTree::forwardKinBatch: qs must have num_positions rows.");
+
+  typedef Matrix<double, Eigen::Dynamic, 12> TransformBatch;
+  int nsamples = static_cast<int>(qs.cols());
+  body_transforms.resize(bodies.size());
+  for (auto& transforms : body_transforms) {
+    transforms.resize(nsamples, 12);
+  }
 
-  // possibly slightly wasteful if we needed x anyway, but not terrible
-  auto x = forwardKin(cache, points, current_body_or_frame_ind, new_body_or_frame_ind, rotation_type);
+  // computes the transforms of all bodies for samples [start, start + count)
+  auto compute_chunk = [&](int start, int count) {
+    TransformBatch joint_transforms(count, 12);
+    for (int i = 0; i < bodies.size(); i++) {
+      const RigidBody& body = *bodies[i];
+      auto world_block = body_transforms[i].middleRows(start, count);
+      if (!body.hasParent()) {
+        world_block.setZero();
+        world_block.col(0).setOnes();
+        world_block.col(4).setOnes();
+        world_block.col(8).setOnes();
+        continue;
+      }
 
-  int nq = num_positions;
-  int nv = num_velocities;
-  int cols = in_terms_of_qdot ? nq : nv;
-  int npoints = static_cast<int>(x.cols());
+      // joint transforms, one sample at a time
+      const DrakeJoint& joint = body.getJoint();
+      const Isometry3d& T_joint_to_parent = joint.getTransformToParentBody();
+      for (int j = 0; j < count; j++) {
+        auto q_body = qs.col(start + j).segment(body.position_num_start, joint.getNumPositions());
+        Isometry3d T_body_to_parent = T_joint_to_parent * joint.jointTransform(q_body);
+        for (int entry = 0; entry < 12; entry++) {
+          joint_transforms(j, entry) = T_body_to_parent.matrix()(entry % 3, entry / 3);
+        }
+      }
 
-  // compute geometric Jacobian
-  int body_ind = parseBodyOrFrameID(current_body_or_frame_ind);
-  int base_ind = parseBodyOrFrameID(new_body_or_frame_ind);
-  std::vector<int> v_or_q_indices;
-  auto J_geometric = geometricJacobian(cache, base_ind, body_ind, new_body_or_frame_ind, in_terms_of_qdot, &v_or_q_indices);
+      // compose with the parent transforms; every operation below acts on all samples in the chunk at once
+      auto parent_block = body_transforms[body.parent->body_index].middleRows(start, count);
+      for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 3; row++) {
+          auto out = world_block.col(row + 3 * col).array();
+          out = parent_block.col(row).array() * joint_transforms.col(3 * col).array();
+          out += parent_block.col(row + 3).array() * joint_transforms.col(3 * col + 1).array();
+          out += parent_block.col(row + 6).array() * joint_transforms.col(3 * col + 2).array();
+          if (col == 3)
+            out += parent_block.col(row + 9).array();
+        }
+      }
+    }
+  };
 
-  // split up into rotational and translational parts
-  auto Jomega = J_geometric.template topRows<SPACE_DIMENSION>();
-  auto Jv = J_geometric.template bottomRows<SPACE_DIMENSION>();
+  num_threads = std::max(1, std::min(num_threads, nsamples));
+  if (num_threads == 1) {
+    compute_chunk(0, nsamples);
+    return;
+  }
 
-  // compute rotation Jacobian
-  DenseIndex rotation_representation_size = x.rows() - SPACE_DIMENSION;
-  auto qrot = x.template block<Eigen::Dynamic, 1>(SPACE_DIMENSION, 0, rotation_representation_size, 1);
-  auto Phi = angularvel2RepresentationDotMatrix(rotation_type, qrot, 0);
-  auto Jrot = (Phi.value() * Jomega).eval();
+  std::vector<std::thread> threads;
+  int chunk_size = nsamples / num_threads;
+  int remainder = nsamples % num_threads;
+  int start = 0;
+  for (int t = 0; t < num_threads; t++) {
+    int count = chunk_size + (t < remainder ? 1 : 0);
+    threads.push_back(std::thread(compute_chunk, start, count));
+    start += count;
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
 
-  Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> J(x.size(), cols);
-  J.setZero();
-  int row_start = 0;
-  for (int i = 0; i < npoints; i++) {
-    // translation part
-    int col = 0;
-    const auto point = x.template block<SPACE_DIMENSION, 1>(0, i);
-    for (std::vector<int>::iterator it = v_or_q_indices.begin(); it != v_or_q_indices.end(); ++it) {
-      J.template block<SPACE_DIMENSION, 1>(row_start, *it) = Jv.col(col);
-      const auto Jomega_col = Jomega.col(col);
-      J.template block<SPACE_DIMENSION, 1>(row_start, *it).noalias() += Jomega_col.cross(point);
-      col++;
+Matrix<double, Eigen::Dynamic, SPACE_DIMENSION> RigidBodyTree::forwardKinBatchPoint(const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 12>>& body_transforms, int body_index, const Eigen::Vector3d& point) const
+{
+  const auto& transforms = body_transforms.at(body_index);
+  Matrix<double, Eigen::Dynamic, SPACE_DIMENSION> ret(transforms.rows(), SPACE_DIMENSION);
+  for (int row = 0; row < SPACE_DIMENSION; row++) {
+    ret.col(row) = transforms.col(row + 9);
+    for (int k = 0; k < SPACE_DIMENSION; k++) {
+      ret.col(row) += point(k) * transforms.col(row + 3 * k);
     }
-    row_start += SPACE_DIMENSION;
+  }
+  return ret;
+}
+
+template <typename Scalar, typename DerivedPoints>
+Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> RigidBodyTree::forwardKinJacobian(const KinematicsCache<Scalar>& cache,
+                                                                                 const MatrixBase<DerivedPoints> &points, int current_body_or_frame_ind, int new_body_or_frame_ind, int rotation_type, bool in_terms_of_qdot) const
+{
+  CompactJacobian<Scalar> J;
+  forwardKinJacobian(cache, points.derived(), current_body_or_frame_ind, new_body_or_frame_ind, rotation_type, in_terms_of_qdot, J);
+  return J.toFull();
+}
 
-    // rotation part
-    if (Jrot.rows() > 0) {
-      col = 0;
-      for (std::vector<int>::iterator it = v_or_q_indices.begin(); it != v_or_q_indices.end(); ++it) {
-        J.template block<Eigen::Dynamic, 1>(row_start, *it, Jrot.rows(), 1) = Jrot.col(col);
-        col++;
+template <typename Scalar>
+void RigidBodyTree::forwardKinJacobian(const KinematicsCache<Scalar>& cache,
+                                       const Eigen::Ref<const Matrix3Xd>& points, int current_body_or_frame_ind, int new_body_or_frame_ind, int rotation_type, bool in_terms_of_qdot, CompactJacobian<Scalar>& J) const
+{
+  cache.checkCachedKinematicsSettings(false, false, "forwardKinJacobian");
+
+  int npoints = static_cast<int>(points.cols());
+  int body_ind = parseBodyOrFrameID(current_body_or_frame_ind);
+  int base_ind = parseBodyOrFrameID(new_body_or_frame_ind);
+  const CachedKinematicPath& cached_path = cachedKinematicPath(base_ind, body_ind);
+  const KinematicPath& kinematic_path = cached_path.path;
+  const std::vector<int>& indices = in_terms_of_qdot ? cached_path.qdot_indices : cached_path.v_indices;
+  J.indices.assign(indices.begin(), indices.end());
+  J.full_cols = in_terms_of_qdot ? num_positions : num_velocities;
+
+  auto T = relativeTransform(cache, new_body_or_frame_ind, current_body_or_frame_ind);
+  auto T_world_to_new = relativeTransform(cache, new_body_or_frame_ind, 0);
+
+  // maps the angular velocity to the derivative of the rotation representation, which is the same for all points
+  int rotation_representation_size = rotationRepresentationSize(rotation_type);
+  Matrix<Scalar, Eigen::Dynamic, SPACE_DIMENSION> Phi;
+  if (rotation_representation_size > 0) {
+    auto qrot = rotmat2Representation(T.linear(), rotation_type);
+    Phi = angularvel2RepresentationDotMatrix(rotation_type, qrot, 0).value();
+  }
+
+  // the columns of the geometric Jacobian are formed one at a time, as in geometricJacobian, so that no temporary has
+  // a dynamic size
+  J.value.resize((SPACE_DIMENSION + rotation_representation_size) * npoints, J.indices.size());
+  int col = 0;
+  for (size_t i = 0; i < kinematic_path.joint_path.size(); i++) {
+    RigidBody& body = *bodies[kinematic_path.joint_path[i]];
+    const auto& element = cache.getElement(body);
+    const DrakeJoint& joint = body.getJoint();
+    int ncols_joint = in_terms_of_qdot ? joint.getNumPositions() : joint.getNumVelocities();
+    int sign = kinematic_path.joint_direction_signs[i];
+    for (int j = 0; j < ncols_joint; j++, col++) {
+      Matrix<Scalar, TWIST_SIZE, 1> twist;
+      if (in_terms_of_qdot) {
+        twist.noalias() = sign * element.motion_subspace_in_world * element.qdot_to_v.col(j);
+      }
+      else {
+        twist = sign * element.motion_subspace_in_world.col(j);
+      }
+      if (new_body_or_frame_ind != 0) {
+        twist = transformSpatialMotion(T_world_to_new, twist);
+      }
+      const auto omega = twist.template topRows<SPACE_DIMENSION>();
+
+      int row_start = 0;
+      for (int k = 0; k < npoints; k++) {
+        // translation part
+        Matrix<Scalar, SPACE_DIMENSION, 1> point = T * points.col(k).template cast<Scalar>();
+        J.value.template block<SPACE_DIMENSION, 1>(row_start, col) = twist.template bottomRows<SPACE_DIMENSION>();
+        J.value.template block<SPACE_DIMENSION, 1>(row_start, col).noalias() += omega.cross(point);
+        row_start += SPACE_DIMENSION;
+
+        // rotation part
+        if (rotation_representation_size > 0) {
+          J.value.block(row_start, col, rotation_representation_size, 1).noalias() = Phi * omega;
+          row_start += rotation_representation_size;
+        }
       }
-      row_start += static_cast<int>(qrot.rows());
     }
   }
-
-  return J;
 }
 
 template <typename Scalar>
@@ -1205,15 +1626,23 @@ Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> RigidBodyTree::forwardKinPosition
 template <typename Scalar, typename DerivedPoints>
 Matrix<Scalar, Eigen::Dynamic, 1> RigidBodyTree::forwardJacDotTimesV(const KinematicsCache<Scalar>& cache, const MatrixBase<DerivedPoints>& points,
                                                                      int body_or_frame_ind, int base_or_frame_ind, int rotation_type) const
+{
+  Matrix<Scalar, Eigen::Dynamic, 1> ret((SPACE_DIMENSION + rotationRepresentationSize(rotation_type)) * points.cols(), 1);
+  forwardJacDotTimesV<Scalar>(cache, points.derived(), body_or_frame_ind, base_or_frame_ind, rotation_type, ret);
+  return ret;
+}
+
+template <typename Scalar>
+void RigidBodyTree::forwardJacDotTimesV(const KinematicsCache<Scalar>& cache, const Eigen::Ref<const Matrix3Xd>& points,
+                                        int body_or_frame_ind, int base_or_frame_ind, int rotation_type, Eigen::Ref<Matrix<Scalar, Eigen::Dynamic, 1>> Jdot_times_v) const
 {
   cache.checkCachedKinematicsSettings(true, true, "forwardJacDotTimesV");
 
   int npoints = static_cast<int>(points.cols());
+  int rotation_representation_size = rotationRepresentationSize(rotation_type);
+  assert(Jdot_times_v.rows() == (SPACE_DIMENSION + rotation_representation_size) * npoints);
 
-  auto x = forwardKin(cache, points, body_or_frame_ind, base_or_frame_ind, rotation_type);
-  auto r = x.template topRows<SPACE_DIMENSION>();
-  auto qrot = x.template bottomLeftCorner<Eigen::Dynamic, 1>(rotationRepresentationSize(rotation_type), 1);
-  GradientVar<Scalar, Eigen::Dynamic, SPACE_DIMENSION> Phi = angularvel2RepresentationDotMatrix(rotation_type, qrot, 1);
+  auto T = relativeTransform(cache, base_or_frame_ind, body_or_frame_ind);
 
   int expressed_in = base_or_frame_ind;
   const auto twist = relativeTwist(cache, base_or_frame_ind, body_or_frame_ind, expressed_in);
@@ -1221,30 +1650,33 @@ Matrix<Scalar, Eigen::Dynamic, 1> RigidBodyTree::forwardJacDotTimesV(const Kinem
 
   auto omega_twist = twist.template topRows<SPACE_DIMENSION>();
   auto v_twist = twist.template bottomRows<SPACE_DIMENSION>();
-  auto qrotdot = (Phi.value() * omega_twist).eval();
-  Matrix<Scalar, Dynamic, 1> Phid_vector = Phi.gradient().value() * qrotdot;
-  Map<Matrix<Scalar, Eigen::Dynamic, SPACE_DIMENSION>> Phid(Phid_vector.data(), Phi.value().rows(), Phi.value().cols());
-
-  auto Jrotdot_times_v = (Phid * omega_twist).eval();
-  Jrotdot_times_v.noalias() += Phi.value() * J_geometric_dot_times_v.template topRows<SPACE_DIMENSION>();
 
-  auto rdots = (-r.colwise().cross(omega_twist)).eval();
-  rdots.colwise() += v_twist;
-  auto Jposdot_times_v_mat = (-rdots.colwise().cross(omega_twist)).eval();
-  Jposdot_times_v_mat -= (r.colwise().cross(J_geometric_dot_times_v.template topRows<SPACE_DIMENSION>())).eval();
-  Jposdot_times_v_mat.colwise() += J_geometric_dot_times_v.template bottomRows<SPACE_DIMENSION>();
+  // rotation part, which is the same for all points
+  Matrix<Scalar, Eigen::Dynamic, 1> Jrotdot_times_v;
+  if (rotation_representation_size > 0) {
+    auto qrot = rotmat2Representation(T.linear(), rotation_type);
+    GradientVar<Scalar, Eigen::Dynamic, SPACE_DIMENSION> Phi = angularvel2RepresentationDotMatrix(rotation_type, qrot, 1);
+    auto qrotdot = (Phi.value() * omega_twist).eval();
+    Matrix<Scalar, Dynamic, 1> Phid_vector = Phi.gradient().value() * qrotdot;
+    Map<Matrix<Scalar, Eigen::Dynamic, SPACE_DIMENSION>> Phid(Phid_vector.data(), Phi.value().rows(), Phi.value().cols());
+
+    Jrotdot_times_v = Phid * omega_twist;
+    Jrotdot_times_v.noalias() += Phi.value() * J_geometric_dot_times_v.template topRows<SPACE_DIMENSION>();
+  }
 
-  Matrix<Scalar, Dynamic, 1> ret(x.size(), 1);
   DenseIndex row_start = 0;
   for (int i = 0; i < npoints; i++) {
-    ret.template middleRows<SPACE_DIMENSION>(row_start) = Jposdot_times_v_mat.col(i);
+    Matrix<Scalar, SPACE_DIMENSION, 1> r = T * points.col(i).template cast<Scalar>();
+    Matrix<Scalar, SPACE_DIMENSION, 1> rdot = v_twist - r.cross(omega_twist);
+    auto Jposdot_times_v = Jdot_times_v.template middleRows<SPACE_DIMENSION>(row_start);
+    Jposdot_times_v = -rdot.cross(omega_twist);
+    Jposdot_times_v -= r.cross(J_geometric_dot_times_v.template topRows<SPACE_DIMENSION>());
+    Jposdot_times_v += J_geometric_dot_times_v.template bottomRows<SPACE_DIMENSION>();
     row_start += SPACE_DIMENSION;
 
-    ret.middleRows(row_start, Jrotdot_times_v.rows()) = Jrotdot_times_v;
-    row_start += Jrotdot_times_v.rows();
+    Jdot_times_v.middleRows(row_start, rotation_representation_size) = Jrotdot_times_v;
+    row_start += rotation_representation_size;
   }
-
-  return ret;
 }
 
 shared_ptr<RigidBody> RigidBodyTree::findLink(std::string linkname, int robot) const
@@ -1461,15 +1893,22 @@ void RigidBodyTree::addFrame(const std::shared_ptr<RigidBodyFrame>& frame)
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1, -1, 0, -1, -1> RigidBodyTree::massMatrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >&) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1, -1, 0, -1, -1> RigidBodyTree::massMatrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >&) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, -1, -1, 0, -1, -1> RigidBodyTree::massMatrix<double>(KinematicsCache<double>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::massMatrix<double>(KinematicsCache<double>&, Eigen::Matrix<double, -1, -1, 0, -1, -1>&) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 3, 1, 0, 3, 1> RigidBodyTree::centerOfMass<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >&, set<int, less<int>, allocator<int> > const&) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 3, 1, 0, 3, 1> RigidBodyTree::centerOfMass<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >&, set<int, less<int>, allocator<int> > const&) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, 3, 1, 0, 3, 1> RigidBodyTree::centerOfMass<double>(KinematicsCache<double>&, set<int, less<int>, allocator<int> > const&) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1, 1, 0, -1, 1> RigidBodyTree::dynamicsBiasTerm<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >&, unordered_map<RigidBody const*, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 6, 1, 0, 6, 1> > > > const&) const;
+template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1, 1, 0, -1, 1> RigidBodyTree::forwardDynamics<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >&, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1, 1, 0, -1, 1> const&, unordered_map<RigidBody const*, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 6, 1, 0, 6, 1> > > > const&) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1, 1, 0, -1, 1> RigidBodyTree::dynamicsBiasTerm<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >&, unordered_map<RigidBody const*, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 6, 1, 0, 6, 1> > > > const&) const;
+template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1, 1, 0, -1, 1> RigidBodyTree::forwardDynamics<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >&, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1, 1, 0, -1, 1> const&, unordered_map<RigidBody const*, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 6, 1, 0, 6, 1> > > > const&) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, -1, 1, 0, -1, 1> RigidBodyTree::dynamicsBiasTerm<double>(KinematicsCache<double>&, unordered_map<RigidBody const*, Eigen::Matrix<double, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<double, 6, 1, 0, 6, 1> > > > const&) const;
+template DLLEXPORT_RBM Eigen::Matrix<double, -1, 1, 0, -1, 1> RigidBodyTree::forwardDynamics<double>(KinematicsCache<double>&, Eigen::Matrix<double, -1, 1, 0, -1, 1> const&, unordered_map<RigidBody const*, Eigen::Matrix<double, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<double, 6, 1, 0, 6, 1> > > > const&) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 6, -1, 0, 6, -1> RigidBodyTree::geometricJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > const&, int, int, int, bool, vector<int, allocator<int> >*) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 6, -1, 0, 6, -1> RigidBodyTree::geometricJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > const&, int, int, int, bool, vector<int, allocator<int> >*) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, 6, -1, 0, 6, -1> RigidBodyTree::geometricJacobian<double>(KinematicsCache<double> const&, int, int, int, bool, vector<int, allocator<int> >*) const;
+template DLLEXPORT_RBM void RigidBodyTree::geometricJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > const&, int, int, int, bool, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 6, -1, 0, 6, -1>&, vector<int, allocator<int> >*) const;
+template DLLEXPORT_RBM void RigidBodyTree::geometricJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > const&, int, int, int, bool, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 6, -1, 0, 6, -1>&, vector<int, allocator<int> >*) const;
+template DLLEXPORT_RBM void RigidBodyTree::geometricJacobian<double>(KinematicsCache<double> const&, int, int, int, bool, Eigen::Matrix<double, 6, -1, 0, 6, -1>&, vector<int, allocator<int> >*) const;
 template DLLEXPORT_RBM Eigen::Transform<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, 3, 1, 0> RigidBodyTree::relativeTransform<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > const&, int, int) const;
 template DLLEXPORT_RBM Eigen::Transform<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, 3, 1, 0> RigidBodyTree::relativeTransform<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > const&, int, int) const;
 template DLLEXPORT_RBM Eigen::Transform<double, 3, 1, 0> RigidBodyTree::relativeTransform<double>(KinematicsCache<double> const&, int, int) const;
@@ -1507,10 +1946,22 @@ template DLLEXPORT_RBM Eigen::Matrix<double, 6, -1, 0, 6, -1> RigidBodyTree::wor
 template DLLEXPORT_RBM Eigen::Matrix<double, 6, 1, 0, 6, 1> RigidBodyTree::transformSpatialAcceleration<double>(KinematicsCache<double> const&, Eigen::Matrix<double, 6, 1, 0, 6, 1> const&, int, int, int, int) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, 6, 1, 0, 6, 1> RigidBodyTree::worldMomentumMatrixDotTimesV<double>(KinematicsCache<double>&, set<int, less<int>, allocator<int> > const&) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, -1, -1, 0, -1, -1> RigidBodyTree::forwardKinJacobian<double, Eigen::Matrix<double, 3, 1, 0, 3, 1> >(KinematicsCache<double> const&, Eigen::MatrixBase<Eigen::Matrix<double, 3, 1, 0, 3, 1> > const&, int, int, int, bool) const;
+template DLLEXPORT_RBM void RigidBodyTree::forwardKinJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, int, int, int, bool, CompactJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::forwardKinJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, int, int, int, bool, CompactJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::forwardKinJacobian<double>(KinematicsCache<double> const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, int, int, int, bool, CompactJacobian<double, -1>&) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, -1, 1, 0, -1, 1> RigidBodyTree::forwardJacDotTimesV<double, Eigen::Matrix<double, 3, 1, 0, 3, 1> >(KinematicsCache<double> const&, Eigen::MatrixBase<Eigen::Matrix<double, 3, 1, 0, 3, 1> > const&, int, int, int) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, -1, 1, 0, -1, 1> RigidBodyTree::inverseDynamics<double>(KinematicsCache<double>&, unordered_map<RigidBody const*, Eigen::Matrix<double, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<double, 6, 1, 0, 6, 1> > > > const&, Eigen::Matrix<double, -1, 1, 0, -1, 1> const&) const;
+template DLLEXPORT_RBM void RigidBodyTree::inverseDynamics<double>(KinematicsCache<double>&, unordered_map<RigidBody const*, Eigen::Matrix<double, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<double, 6, 1, 0, 6, 1> > > > const&, Eigen::Matrix<double, -1, 1, 0, -1, 1> const*, Eigen::Matrix<double, -1, 1, 0, -1, 1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::dynamicsBiasTerm<double>(KinematicsCache<double>&, unordered_map<RigidBody const*, Eigen::Matrix<double, 6, 1, 0, 6, 1>, hash<RigidBody const*>, equal_to<RigidBody const*>, Eigen::aligned_allocator<pair<RigidBody const* const, Eigen::Matrix<double, 6, 1, 0, 6, 1> > > > const&, Eigen::Matrix<double, -1, 1, 0, -1, 1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::worldMomentumMatrix<double>(KinematicsCache<double>&, set<int, less<int>, allocator<int> > const&, bool, Eigen::Matrix<double, 6, -1, 0, 6, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::centroidalMomentumMatrix<double>(KinematicsCache<double>&, set<int, less<int>, allocator<int> > const&, bool, Eigen::Matrix<double, 6, -1, 0, 6, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::centerOfMassJacobian<double>(KinematicsCache<double>&, set<int, less<int>, allocator<int> > const&, bool, Eigen::Matrix<double, 3, -1, 0, 3, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::forwardJacDotTimesV<double>(KinematicsCache<double> const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, int, int, int, Eigen::Ref<Eigen::Matrix<double, -1, 1, 0, -1, 1>, 0, Eigen::InnerStride<1> >) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1, -1, 0, -1, -1> RigidBodyTree::forwardKinJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, Eigen::Matrix<double, 3, -1, 0, 3, -1> >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > const&, Eigen::MatrixBase<Eigen::Matrix<double, 3, -1, 0, 3, -1> > const&, int, int, int, bool) const;
 template DLLEXPORT_RBM Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1, -1, 0, -1, -1> RigidBodyTree::forwardKinJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, Eigen::Matrix<double, 3, -1, 0, 3, -1> >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > const&, Eigen::MatrixBase<Eigen::Matrix<double, 3, -1, 0, 3, -1> > const&, int, int, int, bool) const;
 template DLLEXPORT_RBM void RigidBodyTree::jointLimitConstraints<Eigen::Map<Eigen::Matrix<double, -1, 1, 0, -1, 1>, 0, Eigen::Stride<0, 0> >, Eigen::Map<Eigen::Matrix<double, -1, 1, 0, -1, 1>, 0, Eigen::Stride<0, 0> >, Eigen::Map<Eigen::Matrix<double, -1, -1, 0, -1, -1>, 0, Eigen::Stride<0, 0> > >(Eigen::MatrixBase<Eigen::Map<Eigen::Matrix<double, -1, 1, 0, -1, 1>, 0, Eigen::Stride<0, 0> > > const&, Eigen::MatrixBase<Eigen::Map<Eigen::Matrix<double, -1, 1, 0, -1, 1>, 0, Eigen::Stride<0, 0> > >&, Eigen::MatrixBase<Eigen::Map<Eigen::Matrix<double, -1, -1, 0, -1, -1>, 0, Eigen::Stride<0, 0> > >&) const;
 template DLLEXPORT_RBM Eigen::Matrix<double, -1, -1, 0, -1, -1> RigidBodyTree::forwardKinJacobian<double, Eigen::Block<Eigen::Matrix<double, 3, -1, 0, 3, -1>, 3, 1, true> >(KinematicsCache<double> const&, Eigen::MatrixBase<Eigen::Block<Eigen::Matrix<double, 3, -1, 0, 3, -1>, 3, 1, true> > const&, int, int, int, bool) const;
 template DLLEXPORT_RBM pair<Eigen::Matrix<double, 3, 1, 0, 3, 1>, double> RigidBodyTree::resolveCenterOfPressure<Eigen::Matrix<double, 3, 1, 0, 3, 1>, Eigen::Matrix<double, 3, 1, 0, 3, 1> >(KinematicsCache<double> const&, vector<ForceTorqueMeasurement, allocator<ForceTorqueMeasurement> > const&, Eigen::MatrixBase<Eigen::Matrix<double, 3, 1, 0, 3, 1> > const&, Eigen::MatrixBase<Eigen::Matrix<double, 3, 1, 0, 3, 1> > const&) const;
+template DLLEXPORT_RBM TreeSparseLTDL<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > RigidBodyTree::massMatrixLTDL<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >&) const;
+template DLLEXPORT_RBM TreeSparseLTDL<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > RigidBodyTree::massMatrixLTDL<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >&) const;
+template DLLEXPORT_RBM TreeSparseLTDL<double> RigidBodyTree::massMatrixLTDL<double>(KinematicsCache<double>&) const;
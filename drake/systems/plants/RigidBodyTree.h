@@ -3,8 +3,13 @@
 
 #include <Eigen/Dense>
 #include <Eigen/LU>
+#include <atomic>
 #include <set>
+#include <limits>
 #include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <memory>
 #include <Eigen/StdVector>
 
 #include "collision/DrakeCollision.h"
@@ -29,6 +34,8 @@
 #include "RigidBody.h"
 #include "RigidBodyFrame.h"
 #include "KinematicsCache.h"
+#include "TreeSparseLTDL.h"
+#include "CompactJacobian.h"
 
 #define BASIS_VECTOR_HALF_COUNT 2  //number of basis vectors over 2 (i.e. 4 basis vectors in this case)
 #define EPSILON 10e-8
@@ -116,12 +123,25 @@ public:
 
     compute_JdotV = compute_JdotV && cache.hasV(); // no sense in computing Jdot times v if v is not passed in
 
+    bool reuse_previous_kinematics = cache.canReusePreviousKinematics(compute_JdotV);
+
     cache.setPositionKinematicsCached(); // doing this here because there is a geometricJacobian call within doKinematics below which checks for this
 
     for (int i = 0; i < bodies.size(); i++) {
       RigidBody& body = *bodies[i];
       KinematicsCacheElement<Scalar>& element = cache.getElement(body);
 
+      if (reuse_previous_kinematics) {
+        // the body's transform and twist only depend on its own joint state and the state of its ancestors
+        bool update = cache.jointStateChanged(body) || (body.hasParent() && cache.wasBodyUpdated(*body.parent));
+        cache.setBodyUpdated(body, update);
+        if (!update)
+          continue;
+      }
+      else {
+        cache.setBodyUpdated(body, true);
+      }
+
       if (body.hasParent()) {
         const KinematicsCacheElement<Scalar>& parent_element = cache.getElement(*body.parent);
         const DrakeJoint& joint = body.getJoint();
@@ -191,6 +211,7 @@ public:
     }
 
     cache.setJdotVCached(compute_JdotV && cache.hasV());
+    cache.setPreviousKinematics();
   };
 
   bool isBodyPartOfRobot(const RigidBody& body, const std::set<int>& robotnum) const;
@@ -203,18 +224,36 @@ public:
   template <typename Scalar>
   Eigen::Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> worldMomentumMatrix(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum = default_robot_num_set, bool in_terms_of_qdot = false) const;
 
+  /*
+   * worldMomentumMatrix writing into A, which is only reallocated if its number of columns changes.
+   */
+  template <typename Scalar>
+  void worldMomentumMatrix(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot, Eigen::Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic>& A) const;
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, TWIST_SIZE, 1> worldMomentumMatrixDotTimesV(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum = default_robot_num_set) const;
 
   template <typename Scalar>
   Eigen::Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> centroidalMomentumMatrix(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum = default_robot_num_set, bool in_terms_of_qdot = false) const;
 
+  /*
+   * centroidalMomentumMatrix writing into A, which is only reallocated if its number of columns changes.
+   */
+  template <typename Scalar>
+  void centroidalMomentumMatrix(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot, Eigen::Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic>& A) const;
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, TWIST_SIZE, 1> centroidalMomentumMatrixDotTimesV(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum = default_robot_num_set) const;
 
   template <typename Scalar>
   Eigen::Matrix<Scalar, SPACE_DIMENSION, Eigen::Dynamic> centerOfMassJacobian(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum = default_robot_num_set, bool in_terms_of_qdot = false) const;
 
+  /*
+   * centerOfMassJacobian writing into J, which is only reallocated if its number of columns changes.
+   */
+  template <typename Scalar>
+  void centerOfMassJacobian(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum, bool in_terms_of_qdot, Eigen::Matrix<Scalar, SPACE_DIMENSION, Eigen::Dynamic>& J) const;
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, SPACE_DIMENSION, 1> centerOfMassJacobianDotTimesV(KinematicsCache<Scalar>& cache, const std::set<int>& robotnum = default_robot_num_set) const;
 
@@ -245,15 +284,55 @@ public:
 
   KinematicPath findKinematicPath(int start_body_or_frame_idx, int end_body_or_frame_idx) const;
 
+  /*
+   * Same as findKinematicPath, but the path is only computed the first time it is asked for and then kept until the
+   * next compile(), along with the v and qdot indices of the columns of the geometric Jacobian from start to end.
+   * Safe to call from multiple threads; only the first lookup of a path takes a lock.
+   */
+  const CachedKinematicPath& cachedKinematicPath(int start_body_or_frame_idx, int end_body_or_frame_idx) const;
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> massMatrix(KinematicsCache<Scalar>& cache) const;
 
+  /*
+   * massMatrix writing into H instead of returning a new matrix. H is only reallocated if it isn't num_velocities x
+   * num_velocities already.
+   */
+  template <typename Scalar>
+  void massMatrix(KinematicsCache<Scalar>& cache, Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>& H) const;
+
+  /*
+   * Index of the velocity that precedes each velocity on the path to the root, or -1 if there is none.
+   * Defines the branch-induced sparsity pattern of the mass matrix.
+   */
+  std::vector<int> velocityParents() const;
+
+  template <typename Scalar>
+  TreeSparseLTDL<Scalar> massMatrixLTDL(KinematicsCache<Scalar>& cache) const;
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, Eigen::Dynamic, 1> dynamicsBiasTerm(KinematicsCache<Scalar>& cache, const eigen_aligned_unordered_map<RigidBody const *, Eigen::Matrix<Scalar, TWIST_SIZE, 1> >& f_ext) const;
 
+  /*
+   * dynamicsBiasTerm writing into C instead of returning a new vector. C is only reallocated if it doesn't have
+   * num_velocities rows already.
+   */
+  template <typename Scalar>
+  void dynamicsBiasTerm(KinematicsCache<Scalar>& cache, const eigen_aligned_unordered_map<RigidBody const *, Eigen::Matrix<Scalar, TWIST_SIZE, 1> >& f_ext, Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& C) const;
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, Eigen::Dynamic, 1> inverseDynamics(KinematicsCache<Scalar>& cache, const eigen_aligned_unordered_map<RigidBody const *, Eigen::Matrix<Scalar, TWIST_SIZE, 1> >& f_ext, const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& vd) const;
 
+  /*
+   * inverseDynamics writing into tau, which is only reallocated if it doesn't have num_velocities rows already.
+   * vd == nullptr stands for zero joint accelerations.
+   */
+  template <typename Scalar>
+  void inverseDynamics(KinematicsCache<Scalar>& cache, const eigen_aligned_unordered_map<RigidBody const *, Eigen::Matrix<Scalar, TWIST_SIZE, 1> >& f_ext, const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>* vd, Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& tau) const;
+
+  template <typename Scalar>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> forwardDynamics(KinematicsCache<Scalar>& cache, const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& tau, const eigen_aligned_unordered_map<RigidBody const *, Eigen::Matrix<Scalar, TWIST_SIZE, 1> >& f_ext) const;
+
   template <typename DerivedV>
   Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1> frictionTorques(Eigen::MatrixBase<DerivedV> const & v) const;
 
@@ -279,18 +358,63 @@ public:
     return x;
   };
 
+  /*
+   * Batched forward kinematics for many configurations at once (e.g. for sampling-based planners).
+   * qs has one configuration per column. On return, body_transforms[i] holds the transforms to world of body i for all
+   * configurations: row j corresponds to column j of qs, and the 12 columns are the entries of the 3 x 4 matrix
+   * [R, p] in column-major order. Storing each entry contiguously across configurations lets the composition of
+   * transforms along the tree vectorize over samples. The configurations are split over num_threads threads.
+   */
+  void forwardKinBatch(const Eigen::Ref<const Eigen::MatrixXd>& qs, std::vector<Eigen::Matrix<double, Eigen::Dynamic, 12>>& body_transforms, int num_threads = 1) const;
+
+  /*
+   * Positions in world of a point fixed in body body_index, for all configurations used to compute body_transforms
+   * in forwardKinBatch. Row j of the result corresponds to configuration j.
+   */
+  Eigen::Matrix<double, Eigen::Dynamic, SPACE_DIMENSION> forwardKinBatchPoint(const std::vector<Eigen::Matrix<double, Eigen::Dynamic, 12>>& body_transforms, int body_index, const Eigen::Vector3d& point) const;
+
   template <typename Scalar, typename DerivedPoints>
   Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> forwardKinJacobian(const KinematicsCache<Scalar>& cache, const Eigen::MatrixBase<DerivedPoints>& points, int current_body_or_frame_ind, int new_body_or_frame_ind, int rotation_type, bool in_terms_of_qdot) const;
 
+  /*
+   * forwardKinJacobian with only the columns of the joints between new_body_or_frame_ind and current_body_or_frame_ind.
+   * J is only reallocated if its size changes, so for rotation_type 0 and a J that is reused for the same path, this
+   * doesn't touch the heap.
+   */
+  template <typename Scalar>
+  void forwardKinJacobian(const KinematicsCache<Scalar>& cache, const Eigen::Ref<const Eigen::Matrix3Xd>& points, int current_body_or_frame_ind, int new_body_or_frame_ind, int rotation_type, bool in_terms_of_qdot, CompactJacobian<Scalar>& J) const;
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> forwardKinPositionGradient(const KinematicsCache<Scalar>& cache, int npoints, int current_body_or_frame_ind, int new_body_or_frame_ind) const;
 
   template <typename Scalar, typename DerivedPoints>
   Eigen::Matrix<Scalar, Eigen::Dynamic, 1> forwardJacDotTimesV(const KinematicsCache<Scalar>& cache, const Eigen::MatrixBase<DerivedPoints>& points, int body_or_frame_ind, int base_or_frame_ind, int rotation_type) const;
 
+  /*
+   * forwardJacDotTimesV writing into Jdot_times_v, which has to have the size of the result already. For rotation_type
+   * 0, this doesn't touch the heap.
+   */
+  template <typename Scalar>
+  void forwardJacDotTimesV(const KinematicsCache<Scalar>& cache, const Eigen::Ref<const Eigen::Matrix3Xd>& points, int body_or_frame_ind, int base_or_frame_ind, int rotation_type, Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> Jdot_times_v) const;
+
   template<typename Scalar>
   Eigen::Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> geometricJacobian(const KinematicsCache<Scalar>& cache, int base_body_or_frame_ind, int end_effector_body_or_frame_ind, int expressed_in_body_or_frame_ind, bool in_terms_of_qdot = false, std::vector<int>* v_indices = nullptr) const;
 
+  /*
+   * geometricJacobian writing into J (and v_indices) instead of returning a new matrix. J and v_indices are only
+   * reallocated if the number of columns changes, so with buffers that are reused for the same path (or reserved
+   * up front) and Scalar = double, this doesn't touch the heap.
+   */
+  template<typename Scalar>
+  void geometricJacobian(const KinematicsCache<Scalar>& cache, int base_body_or_frame_ind, int end_effector_body_or_frame_ind, int expressed_in_body_or_frame_ind, bool in_terms_of_qdot, Eigen::Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic>& J, std::vector<int>* v_indices = nullptr) const;
+
+  template<typename Scalar>
+  void geometricJacobian(const KinematicsCache<Scalar>& cache, int base_body_or_frame_ind, int end_effector_body_or_frame_ind, int expressed_in_body_or_frame_ind, bool in_terms_of_qdot, CompactJacobian<Scalar, TWIST_SIZE>& J) const
+  {
+    geometricJacobian(cache, base_body_or_frame_ind, end_effector_body_or_frame_ind, expressed_in_body_or_frame_ind, in_terms_of_qdot, J.value, &J.indices);
+    J.full_cols = in_terms_of_qdot ? num_positions : num_velocities;
+  }
+
   template <typename Scalar>
   Eigen::Matrix<Scalar, TWIST_SIZE, 1> geometricJacobianDotTimesV(const KinematicsCache<Scalar>& cache, int base_body_or_frame_ind, int end_effector_body_or_frame_ind, int expressed_in_body_or_frame_ind) const;
 
@@ -306,6 +430,9 @@ public:
   template <typename Scalar>
   void computeContactJacobians(const KinematicsCache<Scalar>& cache, Eigen::Ref<const Eigen::VectorXi> const & idxA, Eigen::Ref<const Eigen::VectorXi> const & idxB, Eigen::Ref<const Eigen::Matrix3Xd> const & xA, Eigen::Ref<const Eigen::Matrix3Xd> const & xB, Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> & J) const;
 
+  template <typename Scalar>
+  void computeContactJacobians(const KinematicsCache<Scalar>& cache, Eigen::Ref<const Eigen::VectorXi> const & idxA, Eigen::Ref<const Eigen::VectorXi> const & idxB, Eigen::Ref<const Eigen::Matrix3Xd> const & xA, Eigen::Ref<const Eigen::Matrix3Xd> const & xB, CompactJacobian<Scalar> & J) const;
+
   DrakeCollision::ElementId addCollisionElement(const RigidBody::CollisionElement& element, const std::shared_ptr<RigidBody>& body, std::string group_name);
 
   void updateCollisionElements(const RigidBody& body, const Eigen::Transform<double, 3, Eigen::Isometry>& transform_to_world);
@@ -316,8 +443,19 @@ public:
 
   void getTerrainContactPoints(const RigidBody& body, Eigen::Matrix3Xd &terrain_points) const;
 
-  bool collisionRaycast(const KinematicsCache<double>& cache, const Eigen::Matrix3Xd &origins, const Eigen::Matrix3Xd &ray_endpoints, Eigen::VectorXd &distances, bool use_margins=false);
+  bool collisionRaycast(const KinematicsCache<double>& cache, const Eigen::Matrix3Xd &origins, const Eigen::Matrix3Xd &ray_endpoints, Eigen::VectorXd &distances, bool use_margins=false, int num_threads=1);
 
+  /*
+   * collisionDetect reports the closest points between all pairs of the selected collision elements. Pairs that are
+   * farther apart than max_distance may be omitted, which lets callers that only care about nearby pairs skip the
+   * narrowphase for distant ones.
+   *
+   * collisionDetect, collisionRaycast, allCollisions, potentialCollisions and collidingPoints move the collision
+   * elements to the configuration in cache before querying. Every calling thread queries its own copy of the collision
+   * model, so these can run concurrently from several threads. The copies come from a small pool that is refilled
+   * from the tree's collision model after addCollisionElement, updateCollisionElements or
+   * updateStaticCollisionElements change it.
+   */
   bool collisionDetect(const KinematicsCache<double>& cache,
                        Eigen::VectorXd& phi,
                        Eigen::Matrix3Xd& normal,
@@ -326,7 +464,8 @@ public:
                        std::vector<int>& bodyA_idx,
                        std::vector<int>& bodyB_idx,
                        const std::vector<DrakeCollision::ElementId>& ids_to_check,
-                       bool use_margins);
+                       bool use_margins,
+                       double max_distance = std::numeric_limits<double>::infinity());
 
   bool collisionDetect(const KinematicsCache<double>& cache,
                        Eigen::VectorXd& phi,
@@ -336,7 +475,8 @@ public:
                        std::vector<int>& bodyB_idx,
                        const std::vector<int>& bodies_idx,
                        const std::set<std::string>& active_element_groups,
-                       bool use_margins = true);
+                       bool use_margins = true,
+                       double max_distance = std::numeric_limits<double>::infinity());
 
   bool collisionDetect(const KinematicsCache<double>& cache,
                        Eigen::VectorXd& phi, Eigen::Matrix3Xd& normal,
@@ -344,7 +484,8 @@ public:
                        std::vector<int>& bodyA_idx,
                        std::vector<int>& bodyB_idx,
                        const std::vector<int>& bodies_idx,
-                       bool use_margins = true);
+                       bool use_margins = true,
+                       double max_distance = std::numeric_limits<double>::infinity());
 
   bool collisionDetect(const KinematicsCache<double>& cache,
                        Eigen::VectorXd& phi, Eigen::Matrix3Xd& normal,
@@ -352,14 +493,16 @@ public:
                        std::vector<int>& bodyA_idx,
                        std::vector<int>& bodyB_idx,
                        const std::set<std::string>& active_element_groups,
-                       bool use_margins = true);
+                       bool use_margins = true,
+                       double max_distance = std::numeric_limits<double>::infinity());
 
   bool collisionDetect(const KinematicsCache<double>& cache,
                        Eigen::VectorXd& phi, Eigen::Matrix3Xd& normal,
                        Eigen::Matrix3Xd& xA, Eigen::Matrix3Xd& xB,
                        std::vector<int>& bodyA_idx,
                        std::vector<int>& bodyB_idx,
-                        bool use_margins = true);
+                        bool use_margins = true,
+                       double max_distance = std::numeric_limits<double>::infinity());
 
 
   bool allCollisions(const KinematicsCache<double>& cache,
@@ -379,7 +522,7 @@ public:
 
   virtual std::vector<size_t> collidingPoints(const KinematicsCache<double>& cache,
                                               const std::vector<Eigen::Vector3d>& points,
-        double collision_threshold);
+        double collision_threshold, int num_threads = 1);
 
   void warnOnce(const std::string& id, const std::string& msg);
 
@@ -483,13 +626,49 @@ private:
   //helper functions for contactConstraints
   template <typename Scalar>
   void accumulateContactJacobian(const KinematicsCache<Scalar> &cache, const int bodyInd, Eigen::Matrix3Xd const &bodyPoints, std::vector<size_t> const &cindA, std::vector<size_t> const &cindB,
-                                 Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &J) const;
+                                 std::vector<int> const &compact_col, CompactJacobian<Scalar> &J) const;
 
   template <typename Scalar>
   void updateCompositeRigidBodyInertias(KinematicsCache<Scalar>& cache) const;
 
   bool initialized;
 
+  // filled in by cachedKinematicPath, indexed by start_body * bodies.size() + end_body and reset by compile(). An entry
+  // is set once, by a compare-and-swap from nullptr, so lookups of paths that are already there don't lock. The
+  // entries are owned by kinematic_path_cache_entries, which only the first lookup of a path locks to add to
+  mutable std::vector<std::atomic<const CachedKinematicPath*>> kinematic_path_cache;
+  mutable std::vector<std::unique_ptr<const CachedKinematicPath>> kinematic_path_cache_entries;
+  mutable std::mutex kinematic_path_cache_mutex;
+
+  // a copy of collision_model, which keeps its element ids, checked out of collision_model_pool for one collision query
+  // and handed back to the pool when the lease goes out of scope
+  class CollisionModelLease {
+  public:
+    explicit CollisionModelLease(RigidBodyTree& tree);
+    ~CollisionModelLease();
+    DrakeCollision::Model& model() { return *leased_model; }
+  private:
+    RigidBodyTree& tree;
+    std::unique_ptr<DrakeCollision::Model> leased_model;
+    unsigned long generation;
+  };
+
+  // drops the copies of collision_model in the pool and makes the leased ones stale; call with collision_model_pool_mutex
+  // held, after every change to collision_model
+  void invalidateCollisionModelPool();
+
+  void updateCollisionElements(const RigidBody& body, const Eigen::Transform<double, 3, Eigen::Isometry>& transform_to_world, DrakeCollision::Model& model);
+
+  void updateDynamicCollisionElements(const KinematicsCache<double>& kin_cache, DrakeCollision::Model& model);
+
+  // the copies of collision_model that aren't leased, at most max(1, hardware_concurrency) of them. A leased copy is
+  // owned by its lease, so it is never freed while a query uses it; copies made before the last change to
+  // collision_model (an older generation) are freed when they are handed back. collision_model_pool_mutex guards the
+  // pool, collision_model_generation and changes to collision_model.
+  std::vector<std::unique_ptr<DrakeCollision::Model>> collision_model_pool;
+  unsigned long collision_model_generation;
+  std::mutex collision_model_pool_mutex;
+
 
   // collision_model and collision_model_no_margins both maintain
   // a collection of the collision geometry in the RBM for use in
@@ -118,32 +118,37 @@ void getBodyPoints(std::vector<size_t> const & cindA, std::vector<size_t> const
 //   bodyPoints: (3 x n) matrix where each column is a point on the body
 //   cindA: indexes into the original set of m contact pairs where the body appears as Body A
 //   cindB: indexes into the original set of m contact pairs where the body appears as Body B
+//   compact_col: (nq x 1) the column of J that each column of the full Jacobian is stored in
 // NOTE 
 //   cindA and cindB are gotten by calling findContactIndexes in drakeContactConstraintsUtil
 //   cols(bodyPoints) = size(cindA) + size(cindB)
 // OUTPUTS:
-//   J: (3m x nq) The partial contact Jacobian matrix
+//   J: (3m x nq) The partial contact Jacobian matrix, in compact form
 // NOTE
 //  After one call to the function, the n rows of the Jacobian matrix corresponding to bodyInd will be completed
 //  This function must be called with all bodyInds to finish the total accumulation of the contact Jacobian
 template <typename Scalar>
 void RigidBodyTree::accumulateContactJacobian(const KinematicsCache<Scalar> &cache, const int bodyInd, Matrix3Xd const &bodyPoints, std::vector<size_t> const &cindA,
-                                              std::vector<size_t> const &cindB, Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &J) const {
-  const auto nq = J.cols();
+                                              std::vector<size_t> const &cindB, std::vector<int> const &compact_col, CompactJacobian<Scalar> &J) const {
   const size_t numCA = cindA.size();
   const size_t numCB = cindB.size();
   const size_t offset = 3*numCA;
 
-  auto J_tmp = forwardKinJacobian(cache, bodyPoints, bodyInd, 0, 0, true);
+  CompactJacobian<Scalar> J_tmp;
+  forwardKinJacobian(cache, bodyPoints, bodyInd, 0, 0, true, J_tmp);
 
-  //add contributions from points in xA
-  for (int x = 0 ; x < numCA ; x++) {
-    J.block(3*cindA[x], 0, 3, nq) += J_tmp.block(3*x, 0, 3, nq);
-  }
+  for (size_t k = 0 ; k < J_tmp.indices.size() ; k++) {
+    const int col = compact_col[J_tmp.indices[k]];
+
+    //add contributions from points in xA
+    for (int x = 0 ; x < numCA ; x++) {
+      J.value.template block<3, 1>(3*cindA[x], col) += J_tmp.value.template block<3, 1>(3*x, k);
+    }
 
-  //subtract contributions from points in xB
-  for (int x = 0 ; x < numCB ; x++) {
-    J.block(3*cindB[x], 0, 3, nq) -= J_tmp.block(offset + 3*x, 0, 3, nq);
+    //subtract contributions from points in xB
+    for (int x = 0 ; x < numCB ; x++) {
+      J.value.template block<3, 1>(3*cindB[x], col) -= J_tmp.value.template block<3, 1>(offset + 3*x, k);
+    }
   }
 }
 
@@ -165,19 +170,42 @@ void RigidBodyTree::accumulateContactJacobian(const KinematicsCache<Scalar> &cac
 template <typename Scalar>
 void RigidBodyTree::computeContactJacobians(const KinematicsCache<Scalar> &cache, Ref<const VectorXi> const &idxA, Ref<const VectorXi> const &idxB, Ref<const Matrix3Xd> const &xA, Ref<const Matrix3Xd> const &xB,
                                             Matrix<Scalar, Dynamic, Dynamic> &J) const
+{
+  CompactJacobian<Scalar> J_compact;
+  computeContactJacobians(cache, idxA, idxB, xA, xB, J_compact);
+  J = J_compact.toFull();
+}
+
+// Same as above, but only stores the columns of the joints between the world and the bodies in contact
+template <typename Scalar>
+void RigidBodyTree::computeContactJacobians(const KinematicsCache<Scalar> &cache, Ref<const VectorXi> const &idxA, Ref<const VectorXi> const &idxB, Ref<const Matrix3Xd> const &xA, Ref<const Matrix3Xd> const &xB,
+                                            CompactJacobian<Scalar> &J) const
 {
   std::vector<int> bodyInds;
   const size_t nq = num_positions;
   const size_t numContactPairs = xA.cols();
 
-  typedef Matrix<Scalar, Dynamic, Dynamic> MatrixX;
-
-  J = MatrixX::Zero(3*numContactPairs, nq);
-
   getUniqueBodiesSorted(idxA, idxB, bodyInds);
   
   const size_t numUniqueBodies = bodyInds.size();
 
+  // the columns are the union of the joints on the paths from the world to the bodies, in increasing order
+  std::vector<int> compact_col(nq, -1);
+  for (size_t i = 0; i < numUniqueBodies ; i++) {
+    const std::vector<int>& qdot_indices = cachedKinematicPath(0, bodyInds[i]).qdot_indices;
+    for (auto it = qdot_indices.begin(); it != qdot_indices.end(); ++it)
+      compact_col[*it] = 0;
+  }
+  J.indices.clear();
+  for (int col = 0; col < static_cast<int>(nq); col++) {
+    if (compact_col[col] >= 0) {
+      compact_col[col] = static_cast<int>(J.indices.size());
+      J.indices.push_back(col);
+    }
+  }
+  J.full_cols = static_cast<int>(nq);
+  J.value = Matrix<Scalar, Dynamic, Dynamic>::Zero(3*numContactPairs, J.indices.size());
+
   for (size_t i = 0; i < numUniqueBodies ; i++) {
     const int bodyInd = bodyInds[i];
     vector<size_t> cindA, cindB;
@@ -185,7 +213,7 @@ void RigidBodyTree::computeContactJacobians(const KinematicsCache<Scalar> &cache
     findContactIndexes(idxA, bodyInd, cindA);
     findContactIndexes(idxB, bodyInd, cindB);
     getBodyPoints(cindA, cindB, xA, xB, bodyPoints);
-    accumulateContactJacobian(cache, bodyInd, bodyPoints, cindA, cindB, J);
+    accumulateContactJacobian(cache, bodyInd, bodyPoints, cindA, cindB, compact_col, J);
   } 
 }
 
@@ -211,5 +239,8 @@ void RigidBodyTree::surfaceTangents(Map<Matrix3Xd> const & normals, std::vector<
 }
 
 template DLLEXPORT_RBM void RigidBodyTree::computeContactJacobians<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1, -1, 0, -1, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::computeContactJacobians<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> > > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, CompactJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, 73, 1> >, -1>&) const;
 template DLLEXPORT_RBM void RigidBodyTree::computeContactJacobians<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Matrix<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1, -1, 0, -1, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::computeContactJacobians<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > >(KinematicsCache<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> > > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, CompactJacobian<Eigen::AutoDiffScalar<Eigen::Matrix<double, -1, 1, 0, -1, 1> >, -1>&) const;
 template DLLEXPORT_RBM void RigidBodyTree::computeContactJacobians<double>(KinematicsCache<double> const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Matrix<double, -1, -1, 0, -1, -1>&) const;
+template DLLEXPORT_RBM void RigidBodyTree::computeContactJacobians<double>(KinematicsCache<double> const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<int, -1, 1, 0, -1, 1> const, 0, Eigen::InnerStride<1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, Eigen::Ref<Eigen::Matrix<double, 3, -1, 0, 3, -1> const, 0, Eigen::OuterStride<-1> > const&, CompactJacobian<double, -1>&) const;
@@ -0,0 +1,161 @@
+#ifndef DRAKE_TREESPARSELTDL_H
+#define DRAKE_TREESPARSELTDL_H
+
+#include <Eigen/Core>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <stdexcept>
+
+/*
+ * Factorization H = L^T * D * L of a joint space inertia matrix, where L is unit lower triangular and D is diagonal.
+ * Exploits branch-induced sparsity (see Featherstone, "Efficient Factorization of the Joint-Space Inertia Matrix for
+ * Branched Kinematic Trees"): row k of L only has nonzeros in the columns given by the chain
+ * velocity_parents[k], velocity_parents[velocity_parents[k]], ..., so no fill-in occurs and the cost of factorization
+ * and solves scales with the depth of the tree rather than with the number of velocities.
+ *
+ * velocity_parents[k] is the index of the velocity that precedes velocity k on the path to the root of the tree, or
+ * -1 if there is none. It is required that velocity_parents[k] < k.
+ */
+template <typename Scalar>
+class TreeSparseLTDL
+{
+private:
+  std::vector<int> velocity_parents;
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> LD; // strictly lower triangular part stores L, diagonal stores D
+
+public:
+  template <typename DerivedH>
+  TreeSparseLTDL(const Eigen::MatrixBase<DerivedH>& H, const std::vector<int>& velocity_parents) :
+      velocity_parents(velocity_parents), LD(H)
+  {
+    assert(H.rows() == H.cols());
+    assert(static_cast<int>(velocity_parents.size()) == H.rows());
+    factor();
+  }
+
+  /*
+   * solves H * x = b in place.
+   */
+  template <typename Derived>
+  void solveInPlace(Eigen::MatrixBase<Derived>& b) const
+  {
+    multiplyByLInverseTransposeInPlace(b);
+    for (int k = 0; k < size(); k++) {
+      b.row(k) /= LD(k, k);
+    }
+    multiplyByLInverseInPlace(b);
+  }
+
+  template <typename Derived>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> solve(const Eigen::MatrixBase<Derived>& b) const
+  {
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> x = b.template cast<Scalar>();
+    solveInPlace(x);
+    return x;
+  }
+
+  /*
+   * computes L^-1 * D^-1/2 * b, i.e. the product with a matrix M satisfying M * M^T = H^-1.
+   */
+  template <typename Derived>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> inverseSqrtTimes(const Eigen::MatrixBase<Derived>& b) const
+  {
+    using std::sqrt;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> x = b.template cast<Scalar>();
+    for (int k = 0; k < size(); k++) {
+      x.row(k) /= sqrt(LD(k, k));
+    }
+    multiplyByLInverseInPlace(x);
+    return x;
+  }
+
+  /*
+   * computes D^-1/2 * L^-T * b, i.e. the product with the transpose of the matrix used in inverseSqrtTimes.
+   */
+  template <typename Derived>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> inverseSqrtTransposeTimes(const Eigen::MatrixBase<Derived>& b) const
+  {
+    using std::sqrt;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Derived::ColsAtCompileTime> x = b.template cast<Scalar>();
+    multiplyByLInverseTransposeInPlace(x);
+    for (int k = 0; k < size(); k++) {
+      x.row(k) /= sqrt(LD(k, k));
+    }
+    return x;
+  }
+
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> matrixL() const
+  {
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> L = LD.template triangularView<Eigen::StrictlyLower>();
+    L.diagonal().setConstant(Scalar(1));
+    return L;
+  }
+
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> vectorD() const
+  {
+    return LD.diagonal();
+  }
+
+  int size() const
+  {
+    return static_cast<int>(LD.rows());
+  }
+
+private:
+  void factor()
+  {
+    for (int k = size() - 1; k >= 0; k--) {
+      if (LD(k, k) <= Scalar(0)) {
+        throw std::runtime_error("TreeSparseLTDL: matrix is not positive definite.");
+      }
+      int i = velocity_parents[k];
+      while (i >= 0) {
+        Scalar a = LD(k, i) / LD(k, k);
+        int j = i;
+        while (j >= 0) {
+          LD(i, j) -= a * LD(k, j);
+          j = velocity_parents[j];
+        }
+        LD(k, i) = a;
+        i = velocity_parents[i];
+      }
+    }
+
+    // clear the (structurally zero) strictly upper triangular part so that LD only holds the factors
+    for (int k = 0; k < size(); k++) {
+      LD.row(k).tail(size() - k - 1).setZero();
+    }
+  }
+
+  // b <- L^-T * b
+  template <typename Derived>
+  void multiplyByLInverseTransposeInPlace(Eigen::MatrixBase<Derived>& b) const
+  {
+    for (int i = size() - 1; i >= 0; i--) {
+      int j = velocity_parents[i];
+      while (j >= 0) {
+        b.row(j) -= LD(i, j) * b.row(i);
+        j = velocity_parents[j];
+      }
+    }
+  }
+
+  // b <- L^-1 * b
+  template <typename Derived>
+  void multiplyByLInverseInPlace(Eigen::MatrixBase<Derived>& b) const
+  {
+    for (int i = 0; i < size(); i++) {
+      int j = velocity_parents[i];
+      while (j >= 0) {
+        b.row(i) -= LD(i, j) * b.row(j);
+        j = velocity_parents[j];
+      }
+    }
+  }
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+#endif //DRAKE_TREESPARSELTDL_H
@@ -1,4 +1,7 @@
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <thread>
 
 #include "DrakeCollision.h"
 #include "BulletModel.h"
@@ -146,9 +149,24 @@ namespace DrakeCollision
     return bt_shape;
   }
 
-  ElementId BulletModel::addElement(const Element& element)
+  static btTransform toBtTransform(const Matrix4d& T)
   {
-    ElementId id =  Model::addElement(element);
+    btMatrix3x3 rot;
+    btVector3 pos;
+    btTransform btT;
+
+    rot.setValue( T(0,0), T(0,1), T(0,2),
+                  T(1,0), T(1,1), T(1,2),
+                  T(2,0), T(2,1), T(2,2) );
+    btT.setBasis(rot);
+    pos.setValue( T(0,3), T(1,3), T(2,3) );
+    btT.setOrigin(pos);
+    return btT;
+  }
+
+  ElementId BulletModel::insertElement(unique_ptr<Element> element)
+  {
+    ElementId id =  Model::insertElement(move(element));
 
     if (id != 0) {
       unique_ptr<btCollisionShape> bt_shape;
@@ -209,6 +227,10 @@ namespace DrakeCollision
         bt_obj_no_margin->setCollisionShape(bt_shape_no_margin.get());
         bt_obj->setUserPointer(elements[id].get());
         bt_obj_no_margin->setUserPointer(elements[id].get());
+        // copies made by addElementsFrom start out where the originals are
+        const btTransform btT = toBtTransform(elements[id]->getWorldTransform());
+        bt_obj->setWorldTransform(btT);
+        bt_obj_no_margin->setWorldTransform(btT);
 
         // Add the collision objects to the collision worlds
         bullet_world.bt_collision_world->addCollisionObject(bt_obj.get());
@@ -299,38 +321,108 @@ namespace DrakeCollision
     return c.getResults();
   }
 
-  vector<size_t> BulletModel::collidingPoints(const vector<Vector3d>& points, 
-                                              double collision_threshold)
+  struct OverlappingObjectsCallback : public btBroadphaseAabbCallback
   {
-    // Create sphere geometry
-    btSphereShape bt_shape(collision_threshold);
+    virtual bool process(const btBroadphaseProxy* proxy)
+    {
+      objects.push_back(static_cast<btCollisionObject*>(proxy->m_clientObject));
+      return true;
+    }
 
-    // Create Bullet collision object
-    btCollisionObject bt_obj;
-    btCollisionObject* bt_obj_ptr = static_cast<btCollisionObject*>(&bt_obj);
-    bt_obj.setCollisionShape(static_cast<btCollisionShape*>(&bt_shape));
+    vector<btCollisionObject*> objects;
+  };
 
-    btTransform btT;
-    btT.setIdentity();
+  vector<size_t> BulletModel::collidingPoints(const vector<Vector3d>& points, 
+                                              double collision_threshold,
+                                              int num_threads)
+  {
+    /* Instead of running a full contactTest (broadphase query plus narrowphase
+     * against every overlapping object) for each point, points outside the
+     * bounding box of the whole model are rejected outright, the broadphase
+     * tree is queried directly and the narrowphase stops at the first object
+     * in collision. The narrowphase tests themselves are the same as in
+     * contactTest.
+     */
     BulletCollisionWorldWrapper& bt_world = getBulletWorld(false);
-    vector<size_t> in_collision_indices;
-
-    for (size_t i = 0; i < points.size(); ++i) {
-      BinaryContactResultCallback c;
+    btBroadphaseInterface* broadphase = bt_world.bt_collision_world->getBroadphase();
+
+    btVector3 model_aabb_min(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+    btVector3 model_aabb_max(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+    for (auto iter = bt_world.bt_collision_objects.begin(); iter != bt_world.bt_collision_objects.end(); ++iter) {
+      const btBroadphaseProxy* proxy = iter->second->getBroadphaseHandle();
+      model_aabb_min.setMin(proxy->m_aabbMin);
+      model_aabb_max.setMax(proxy->m_aabbMax);
+    }
+    const btVector3 threshold(collision_threshold, collision_threshold, collision_threshold);
+    model_aabb_min -= threshold;
+    model_aabb_max += threshold;
 
-      btVector3 pos(static_cast<btScalar>(points[i](0)), 
-                    static_cast<btScalar>(points[i](1)),
-                    static_cast<btScalar>(points[i](2)));
-      btT.setOrigin(pos);
-      bt_obj.setWorldTransform(btT);
+    // Create sphere geometry, shared by all threads
+    btSphereShape bt_shape(collision_threshold);
 
-      bt_world.bt_collision_world->contactTest(bt_obj_ptr, c);
+    auto colliding_points_in_range = [&](size_t start, size_t count, vector<size_t>& in_collision_indices) {
+      // each thread needs its own dispatcher for the narrowphase
+      BulletCollisionWorldWrapper narrowphase_world;
+      btCollisionObject bt_obj;
+      bt_obj.setCollisionShape(static_cast<btCollisionShape*>(&bt_shape));
+      btTransform btT;
+      btT.setIdentity();
+      OverlappingObjectsCallback overlapping;
+
+      for (size_t i = start; i < start + count; ++i) {
+        btVector3 pos(static_cast<btScalar>(points[i](0)), 
+                      static_cast<btScalar>(points[i](1)),
+                      static_cast<btScalar>(points[i](2)));
+        if (pos.x() < model_aabb_min.x() || pos.x() > model_aabb_max.x() ||
+            pos.y() < model_aabb_min.y() || pos.y() > model_aabb_max.y() ||
+            pos.z() < model_aabb_min.z() || pos.z() > model_aabb_max.z()) {
+          continue;
+        }
+        overlapping.objects.clear();
+        broadphase->aabbTest(pos - threshold, pos + threshold, overlapping);
+        if (overlapping.objects.empty()) {
+          continue;
+        }
 
-      if (c.isInCollision()) {
-        in_collision_indices.push_back(i);
+        btT.setOrigin(pos);
+        bt_obj.setWorldTransform(btT);
+        for (auto obj_iter = overlapping.objects.begin(); obj_iter != overlapping.objects.end(); ++obj_iter) {
+          BinaryContactResultCallback c;
+          if (!c.needsCollision((*obj_iter)->getBroadphaseHandle())) {
+            continue;
+          }
+          narrowphase_world.bt_collision_world->contactPairTest(&bt_obj, *obj_iter, c);
+          if (c.isInCollision()) {
+            in_collision_indices.push_back(i);
+            break;
+          }
+        }
       }
+    };
+
+    num_threads = max(1, min(num_threads, static_cast<int>(points.size())));
+    vector< vector<size_t> > in_collision_indices_per_thread(num_threads);
+    if (num_threads == 1) {
+      colliding_points_in_range(0, points.size(), in_collision_indices_per_thread[0]);
+      return in_collision_indices_per_thread[0];
     }
 
+    vector<thread> threads;
+    size_t chunk_size = points.size() / num_threads;
+    size_t remainder = points.size() % num_threads;
+    size_t start = 0;
+    for (int t = 0; t < num_threads; ++t) {
+      size_t count = chunk_size + (static_cast<size_t>(t) < remainder ? 1 : 0);
+      threads.push_back(thread(colliding_points_in_range, start, count, ref(in_collision_indices_per_thread[t])));
+      start += count;
+    }
+    vector<size_t> in_collision_indices;
+    for (int t = 0; t < num_threads; ++t) {
+      threads[t].join();
+      in_collision_indices.insert(in_collision_indices.end(),
+                                  in_collision_indices_per_thread[t].begin(),
+                                  in_collision_indices_per_thread[t].end());
+    }
     return in_collision_indices;
   }
 
@@ -339,17 +431,7 @@ namespace DrakeCollision
   {
     const bool element_exists(Model::updateElementWorldTransform(id, T_local_to_world));
     if (element_exists) {
-      const Matrix4d& T = elements[id]->getWorldTransform();
-      btMatrix3x3 rot;
-      btVector3 pos;
-      btTransform btT;
-
-      rot.setValue( T(0,0), T(0,1), T(0,2),
-                    T(1,0), T(1,1), T(1,2),
-                    T(2,0), T(2,1), T(2,2) );
-      btT.setBasis(rot);
-      pos.setValue( T(0,3), T(1,3), T(2,3) );
-      btT.setOrigin(pos);
+      const btTransform btT = toBtTransform(elements[id]->getWorldTransform());
 
       auto bt_obj_iter = bullet_world.bt_collision_objects.find(id);
       auto bt_obj_no_margin_iter = bullet_world_no_margin.bt_collision_objects.find(id);
@@ -458,35 +540,83 @@ namespace DrakeCollision
   }
 
   
-  bool BulletModel::collisionRaycast(const Matrix3Xd &origins, const Matrix3Xd &ray_endpoints, bool use_margins, VectorXd &distances)
+  bool BulletModel::collisionRaycast(const Matrix3Xd &origins, const Matrix3Xd &ray_endpoints, bool use_margins, VectorXd &distances, int num_threads)
   {
     
     distances.resize(origins.cols());
     BulletCollisionWorldWrapper& bt_world = getBulletWorld(use_margins);
-    
-    for (int i = 0; i < origins.cols(); i ++)
-    {
-    
-        btVector3 ray_from_world(origins(0,i), origins(1,i), origins(2,i));
-        btVector3 ray_to_world(ray_endpoints(0,i), ray_endpoints(1,i), ray_endpoints(2,i));
-        
-        btCollisionWorld::ClosestRayResultCallback ray_callback(ray_from_world, ray_to_world);
-        
-        bt_world.bt_collision_world->rayTest(ray_from_world, ray_to_world, ray_callback);
-        
-        if (ray_callback.hasHit()) {
-            
-            // compute distance to hit
-            
-            btVector3 end = ray_callback.m_hitPointWorld;
-            
-            Vector3d end_eigen(end.getX(), end.getY(), end.getZ());
-            
-            distances(i) = (end_eigen - origins.col(i)).norm();
+
+    auto raycast_range = [&](btCollisionWorld* world, int start, int count) {
+      // one callback per thread, reset before every ray
+      btCollisionWorld::ClosestRayResultCallback ray_callback(btVector3(0, 0, 0), btVector3(0, 0, 0));
+
+      for (int i = start; i < start + count; i ++)
+      {
+      
+          btVector3 ray_from_world(origins(0,i), origins(1,i), origins(2,i));
+          btVector3 ray_to_world(ray_endpoints(0,i), ray_endpoints(1,i), ray_endpoints(2,i));
           
-        } else {
-            distances(i) = -1;
-        }
+          ray_callback.m_rayFromWorld = ray_from_world;
+          ray_callback.m_rayToWorld = ray_to_world;
+          ray_callback.m_closestHitFraction = btScalar(1.);
+          ray_callback.m_collisionObject = nullptr;
+          
+          world->rayTest(ray_from_world, ray_to_world, ray_callback);
+          
+          if (ray_callback.hasHit()) {
+              
+              // compute distance to hit
+              
+              btVector3 end = ray_callback.m_hitPointWorld;
+              
+              Vector3d end_eigen(end.getX(), end.getY(), end.getZ());
+              
+              distances(i) = (end_eigen - origins.col(i)).norm();
+            
+          } else {
+              distances(i) = -1;
+          }
+      }
+    };
+
+    num_threads = max(1, min(num_threads, static_cast<int>(origins.cols())));
+    if (num_threads == 1) {
+      raycast_range(bt_world.bt_collision_world.get(), 0, static_cast<int>(origins.cols()));
+      return true;
+    }
+
+    /* The broadphase keeps its ray traversal stack as a member, so rays can't
+     * be cast into the same world from several threads. The first chunk uses
+     * the model's world; every other thread builds a world of its own with
+     * copies of the collision objects (sharing their shapes).
+     */
+    auto raycast_range_in_own_world = [&](int start, int count) {
+      BulletCollisionWorldWrapper thread_world;
+      for (auto iter = bt_world.bt_collision_objects.begin(); iter != bt_world.bt_collision_objects.end(); ++iter) {
+        const btCollisionObject* bt_obj = iter->second.get();
+        unique_ptr<btCollisionObject> bt_obj_copy(new btCollisionObject());
+        bt_obj_copy->setCollisionShape(const_cast<btCollisionShape*>(bt_obj->getCollisionShape()));
+        bt_obj_copy->setWorldTransform(bt_obj->getWorldTransform());
+        bt_obj_copy->setUserPointer(bt_obj->getUserPointer());
+        thread_world.bt_collision_world->addCollisionObject(bt_obj_copy.get());
+        bt_obj_copy->setCollisionFlags(bt_obj->getCollisionFlags());
+        thread_world.bt_collision_objects.insert(make_pair(iter->first, move(bt_obj_copy)));
+      }
+      raycast_range(thread_world.bt_collision_world.get(), start, count);
+    };
+
+    vector<thread> threads;
+    int chunk_size = static_cast<int>(origins.cols()) / num_threads;
+    int remainder = static_cast<int>(origins.cols()) % num_threads;
+    int start = chunk_size + (remainder > 0 ? 1 : 0);
+    for (int t = 1; t < num_threads; t++) {
+      int count = chunk_size + (t < remainder ? 1 : 0);
+      threads.push_back(thread(raycast_range_in_own_world, start, count));
+      start += count;
+    }
+    raycast_range(bt_world.bt_collision_world.get(), 0, chunk_size + (remainder > 0 ? 1 : 0));
+    for (auto& thread : threads) {
+      thread.join();
     }
     
     return true;
@@ -518,6 +648,78 @@ namespace DrakeCollision
     return closestPointsPairwise(id_pairs, use_margins, closest_points);
   }
 
+  bool BulletModel::closestPointsAllToAll(const vector<ElementId>& ids_to_check,
+      const bool use_margins,
+      const double max_distance,
+      vector<PointPair>& closest_points)
+  {
+    /* Sweep and prune on world frame bounding boxes: sort the boxes along x and
+     * only pair up elements whose boxes are within max_distance of each other.
+     * The distance between two boxes is a lower bound on the distance between
+     * the elements they contain, so no pair closer than max_distance is dropped.
+     */
+    BulletCollisionWorldWrapper& bt_world = getBulletWorld(use_margins);
+    struct ElementAabb {
+      size_t index;
+      ElementId id;
+      btVector3 aabb_min;
+      btVector3 aabb_max;
+    };
+    vector<ElementAabb> aabbs;
+    aabbs.reserve(ids_to_check.size());
+    for (size_t i = 0; i < ids_to_check.size(); ++i) {
+      auto bt_obj_iter = bt_world.bt_collision_objects.find(ids_to_check[i]);
+      if (bt_obj_iter != bt_world.bt_collision_objects.end()) {
+        const btCollisionObject* bt_obj = bt_obj_iter->second.get();
+        ElementAabb aabb;
+        aabb.index = i;
+        aabb.id = ids_to_check[i];
+        bt_obj->getCollisionShape()->getAabb(bt_obj->getWorldTransform(), aabb.aabb_min, aabb.aabb_max);
+        aabbs.push_back(aabb);
+      }
+    }
+    sort(aabbs.begin(), aabbs.end(), [](const ElementAabb& a, const ElementAabb& b) {
+      return a.aabb_min.x() < b.aabb_min.x();
+    });
+
+    const double max_distance_squared = max_distance*max_distance;
+    vector< pair<size_t, size_t> > index_pairs;
+    for (size_t i = 0; i < aabbs.size(); ++i) {
+      for (size_t j = i+1; j < aabbs.size(); ++j) {
+        if (aabbs[j].aabb_min.x() - aabbs[i].aabb_max.x() > max_distance) {
+          break;
+        }
+        double distance_squared = 0;
+        for (int k = 0; k < 3; ++k) {
+          double gap = max(aabbs[i].aabb_min[k] - aabbs[j].aabb_max[k],
+                           aabbs[j].aabb_min[k] - aabbs[i].aabb_max[k]);
+          if (gap > 0) {
+            distance_squared += gap*gap;
+          }
+        }
+        if (distance_squared > max_distance_squared) {
+          continue;
+        }
+        const ElementAabb& first = aabbs[i].index < aabbs[j].index ? aabbs[i] : aabbs[j];
+        const ElementAabb& second = aabbs[i].index < aabbs[j].index ? aabbs[j] : aabbs[i];
+        if (elements[first.id]->collidesWith(elements[second.id].get())) {
+          index_pairs.push_back(make_pair(first.index, second.index));
+        }
+      }
+    }
+
+    // report the pairs in the same order as the exhaustive query
+    sort(index_pairs.begin(), index_pairs.end());
+    vector<ElementIdPair> id_pairs;
+    id_pairs.reserve(index_pairs.size());
+    for (auto index_pair_iter = index_pairs.begin();
+         index_pair_iter != index_pairs.end();
+         ++index_pair_iter) {
+      id_pairs.push_back(make_pair(ids_to_check[index_pair_iter->first], ids_to_check[index_pair_iter->second]));
+    }
+    return closestPointsPairwise(id_pairs, use_margins, closest_points);
+  }
+
   bool BulletModel::closestPointsPairwise(const vector<ElementIdPair>& id_pairs, 
                                           const bool use_margins,
                                           vector<PointPair>& closest_points)
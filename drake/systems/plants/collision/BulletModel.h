@@ -54,8 +54,6 @@ namespace DrakeCollision
 
       virtual void resize(int num_bodies) {};
 
-      virtual ElementId addElement(const Element& element);
-
       virtual bool updateElementWorldTransform(const ElementId, 
                                                const Eigen::Matrix4d& T_local_to_world);
 
@@ -63,6 +61,11 @@ namespace DrakeCollision
                                          const bool use_margins,
                                          std::vector<PointPair>& closest_points);
 
+      virtual bool closestPointsAllToAll(const std::vector<ElementId>& ids_to_check,
+                                         const bool use_margins,
+                                         const double max_distance,
+                                         std::vector<PointPair>& closest_points);
+
       virtual bool collisionPointsAllToAll(const bool use_margins,
                                            std::vector<PointPair>& points);
 
@@ -77,18 +80,21 @@ namespace DrakeCollision
 
       virtual bool collisionRaycast(const Eigen::Matrix3Xd &origins, 
               const Eigen::Matrix3Xd &ray_endpoints, bool use_margins, 
-              Eigen::VectorXd &distances);
+              Eigen::VectorXd &distances, int num_threads = 1);
 
       virtual std::vector<PointPair> potentialCollisionPoints(bool use_margins);
 
       virtual std::vector<size_t> collidingPoints(
           const std::vector<Eigen::Vector3d>& points, 
-          double collision_threshold);
+          double collision_threshold,
+          int num_threads = 1);
 
       // END Required member functions
       
     protected:
 
+      virtual ElementId insertElement(std::unique_ptr<Element> element);
+
       BulletCollisionWorldWrapper& getBulletWorld(bool use_margins);
 
       std::vector< std::unique_ptr<btCollisionShape> > bt_collision_shapes;
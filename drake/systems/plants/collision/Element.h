@@ -38,6 +38,9 @@ namespace DrakeCollision
     private:
       ElementId id;
 
+      // Model::addElementsFrom gives the copies it makes the ids of the originals
+      friend class Model;
+
     public:
       EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   };
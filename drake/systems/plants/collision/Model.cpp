@@ -9,9 +9,23 @@ namespace DrakeCollision
 {
   ElementId Model::addElement(const Element& element)
   {
-    unique_ptr<Element> element_local(element.clone());
-    ElementId id = element_local->getId();
-    this->elements.insert(make_pair(id, move(element_local)));
+    return insertElement(unique_ptr<Element>(element.clone()));
+  }
+
+  void Model::addElementsFrom(const Model& other)
+  {
+    for (const auto& item : other.elements) {
+      unique_ptr<Element> element_local(item.second->clone());
+      element_local->id = item.first;
+      insertElement(move(element_local));
+    }
+    updateModel();
+  }
+
+  ElementId Model::insertElement(unique_ptr<Element> element)
+  {
+    ElementId id = element->getId();
+    this->elements.insert(make_pair(id, move(element)));
     return id;
   }
 
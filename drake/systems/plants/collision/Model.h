@@ -23,6 +23,13 @@ namespace DrakeCollision
 
       virtual ElementId addElement(const Element& element);
 
+      //
+      // Adds copies of all the elements of other, which keep the ids of the
+      // originals. The two models can then be updated and queried
+      // independently (e.g. from different threads) using the same ids.
+      //
+      void addElementsFrom(const Model& other);
+
       virtual const Element* readElement(ElementId id);
       
       virtual void getTerrainContactPoints(ElementId id0, Eigen::Matrix3Xd &terrain_points);
@@ -37,6 +44,17 @@ namespace DrakeCollision
           std::vector<PointPair>& closest_points)
       { return false; };
 
+      //
+      // Like closestPointsAllToAll, but pairs whose closest distance is known
+      // to exceed max_distance may be omitted from closest_points. Pairs
+      // closer than max_distance are always reported.
+      //
+      virtual bool closestPointsAllToAll(const std::vector<ElementId>& ids_to_check,
+          const bool use_margins,
+          const double max_distance,
+          std::vector<PointPair>& closest_points)
+      { return closestPointsAllToAll(ids_to_check, use_margins, closest_points); };
+
       virtual bool collisionPointsAllToAll(const bool use_margins,
           std::vector<PointPair>& points)
       { return false; };
@@ -49,9 +67,15 @@ namespace DrakeCollision
       virtual std::vector<PointPair> potentialCollisionPoints(const bool use_margins) 
       { return std::vector<PointPair>(); };
 
+      //
+      // Returns the (sorted) indices of the points that are within
+      // collision_threshold of any element. The points may be split across
+      // num_threads threads.
+      //
       virtual std::vector<size_t> collidingPoints(
           const std::vector<Eigen::Vector3d>& points, 
-          double collision_threshold)
+          double collision_threshold,
+          int num_threads = 1)
       { return std::vector<size_t>(); };
 
       //
@@ -60,10 +84,18 @@ namespace DrakeCollision
       // @param origin Vector3d specifying the position of the ray's origin
       // @param ray_endpoint Vector3d specifying a second point on the ray in world coordinates
       // @param distance to the first collision, or -1 on no collision
+      // @param num_threads number of threads the rays are split across
       //
-      virtual bool collisionRaycast(const Eigen::Matrix3Xd &origin, const Eigen::Matrix3Xd &ray_endpoint, bool use_margins, Eigen::VectorXd &distances) { return false; };
+      virtual bool collisionRaycast(const Eigen::Matrix3Xd &origin, const Eigen::Matrix3Xd &ray_endpoint, bool use_margins, Eigen::VectorXd &distances, int num_threads = 1) { return false; };
 
     protected:
+      //
+      // Takes ownership of element and returns its id. Both addElement and
+      // addElementsFrom go through here, so models that keep their own
+      // per-element data override this instead of addElement.
+      //
+      virtual ElementId insertElement(std::unique_ptr<Element> element);
+
       std::unordered_map< ElementId, std::unique_ptr<Element> >  elements;
 
     private:
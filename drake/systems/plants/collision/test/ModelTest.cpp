@@ -97,6 +97,68 @@ int main()
     cout << "Check points[2] ..." << endl;
     out = testPointPair(points[2], 1.0, Vector3d(0, -1, 0), id2, id3);
   }
+  if (out != 0) {
+    return out;
+  }
+
+  // The bounding boxes of bodies 1 and 3 are farther apart than 1.2 m, so only
+  // the two pairs involving body 2 are within range
+  model->closestPointsAllToAll(ids_to_check, true, 1.2, points);
+  if (points.size() != 2) {
+    cerr << "Wrong number of points within 1.2 m: " << endl;
+    cerr << "  Expected 2, got " << points.size() << endl;
+    return 1;
+  }
+  cout << "Check distance-bounded points[0] ..." << endl;
+  out = testPointPair(points[0], 1.0, Vector3d(-1, 0, 0), id1, id2);
+  if (out == 0) {
+    cout << "Check distance-bounded points[1] ..." << endl;
+    out = testPointPair(points[1], 1.0, Vector3d(0, -1, 0), id2, id3);
+  }
+  if (out != 0) {
+    return out;
+  }
+
+  // Only the points inside the box and the sphere around body 3 collide
+  model->updateModel();
+  vector<Vector3d> query_points;
+  query_points.push_back(Vector3d(1, 0, 0));
+  query_points.push_back(Vector3d(0, 0, 0));
+  query_points.push_back(Vector3d(5, 5, 5));
+  query_points.push_back(Vector3d(2, 2.3, 0));
+  for (int num_threads = 1; num_threads <= 3; num_threads += 2) {
+    cout << "Check colliding points with " << num_threads << " thread(s) ..." << endl;
+    vector<size_t> colliding = model->collidingPoints(query_points, 0.1, num_threads);
+    if (colliding.size() != 2 || colliding[0] != 1 || colliding[1] != 3) {
+      cerr << "Wrong colliding points:" << endl;
+      cerr << "  Expected 1 3, got";
+      for (size_t i = 0; i < colliding.size(); ++i) {
+        cerr << " " << colliding[i];
+      }
+      cerr << endl;
+      return 1;
+    }
+  }
+
+  // Rays hitting the box and body 2 from 5 m away, and one missing everything
+  Matrix3Xd origins(3, 3), ray_endpoints(3, 3);
+  origins << -5, 2, 10,
+              0, -5, 10,
+              0, 0, 10;
+  ray_endpoints << 10, 2, 11,
+                    0, 10, 11,
+                    0, 0, 11;
+  Vector3d expected_distances(4.5, 4.5, -1);
+  for (int num_threads = 1; num_threads <= 3; num_threads += 2) {
+    cout << "Check raycast with " << num_threads << " thread(s) ..." << endl;
+    VectorXd distances;
+    model->collisionRaycast(origins, ray_endpoints, false, distances, num_threads);
+    if ((distances - expected_distances).lpNorm<Infinity>() > 1e-3) {
+      cerr << "Wrong ray distances:" << endl;
+      cerr << "  Expected " << expected_distances.transpose() << ", got " << distances.transpose() << endl;
+      return 1;
+    }
+  }
   cout << out << endl;
   return out;
 }
@@ -2148,17 +2148,18 @@ MinDistanceConstraint::eval(const double* t, KinematicsCache<double>& cache, Vec
     std::vector<int> idxA;
     std::vector<int> idxB;
 
+    // pairs farther apart than min_distance have zero penalty, so they need not be reported
     if (active_bodies_idx.size() > 0) {
       if (active_group_names.size() > 0) {
-        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB,active_bodies_idx,active_group_names);
+        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB,active_bodies_idx,active_group_names,true,min_distance);
       } else {
-        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB,active_bodies_idx);
+        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB,active_bodies_idx,true,min_distance);
       }
     } else {
       if (active_group_names.size() > 0) {
-        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB,active_group_names);
+        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB,active_group_names,true,min_distance);
       } else {
-        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB);
+        robot->collisionDetect(cache, dist,normal,xA,xB,idxA,idxB,true,min_distance);
       }
     }
 
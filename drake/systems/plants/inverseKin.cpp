@@ -13,7 +13,14 @@ drakeIK_DLLEXPORT void inverseKin(RigidBodyTree * model, const MatrixBase<Derive
   VectorXd qdot_dummy(model->num_velocities);
   VectorXd qddot_dummy(model->num_velocities);
   double* t = nullptr;
-  inverseKinBackend(model, 1,1,t,q_seed,q_nom,num_constraints,constraint_array,q_sol,qdot_dummy,qddot_dummy,&INFO, infeasible_constraint, ikoptions);
+#ifdef HAVE_SNOPT
+  if(ikoptions.getSolver() == IKoptions::SNOPT)
+  {
+    inverseKinBackend(model, 1,1,t,q_seed,q_nom,num_constraints,constraint_array,q_sol,qdot_dummy,qddot_dummy,&INFO, infeasible_constraint, ikoptions);
+    return;
+  }
+#endif
+  inverseKinSQPBackend(model,1,t,q_seed,q_nom,num_constraints,constraint_array,q_sol,&INFO,infeasible_constraint,ikoptions);
 }
 
 template drakeIK_DLLEXPORT void inverseKin(RigidBodyTree * model, const MatrixBase<VectorXd> &q_seed, const MatrixBase<VectorXd> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<VectorXd> &q_sol, int &INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
@@ -8,6 +8,8 @@
 #include <iostream>
 #include <limits>
 #include <cmath>
+#include <functional>
+#include <mutex>
 
 namespace snopt {
 #include "snopt.hh"
@@ -33,78 +35,103 @@ namespace snopt {
 using namespace Eigen;
 using namespace std;
 
-// NOTE: all snopt calls will use this shared memory... so this code is NOT THREAD SAFE
-static unique_ptr<snopt::doublereal []> rw;
-static unique_ptr<snopt::integer []> iw;
-static unique_ptr<char []> cw;
-static snopt::integer lenrw=0;
-static snopt::integer leniw=0;
-static snopt::integer lencw=0;
-
-static RigidBodyTree * model = nullptr;
-static SingleTimeKinematicConstraint** st_kc_array = nullptr;
-static MultipleTimeKinematicConstraint** mt_kc_array = nullptr;
-static QuasiStaticConstraint* qsc_ptr = nullptr;
-static MatrixXd q_nom;
-static VectorXd q_nom_i;
-static MatrixXd Q;
-static MatrixXd Qa;
-static MatrixXd Qv;
-static bool qscActiveFlag;
-static snopt::integer nx;
-static snopt::integer nF;
-static snopt::integer nG;
-static snopt::integer* nc_array;
-static snopt::integer* nG_array;
-static snopt::integer* nA_array;
-static int nq;
-static double *t = nullptr;
-static double *t_samples = nullptr;
-static double* ti = nullptr;
-static int num_st_kc;
-static int num_mt_kc;
-static int num_st_lpc;
-static int num_mt_lpc;
-static int* mt_kc_nc;
-static int* st_lpc_nc;
-static int* mt_lpc_nc;
-static int nT;
-static int num_qsc_pts;
-static bool fixInitialState;
-// The following variables are used in inverseKinTraj only
-static snopt::integer* qfree_idx;
-static snopt::integer* qdotf_idx;
-static snopt::integer* qdot0_idx;
-
-static VectorXd q0_fixed;
-static VectorXd qdot0_fixed;
-static snopt::integer qstart_idx;
-static snopt::integer num_qfree;
-static snopt::integer num_qdotfree;
-
-static MatrixXd velocity_mat;
-static MatrixXd velocity_mat_qd0;
-static MatrixXd velocity_mat_qdf;
-static MatrixXd accel_mat;
-static MatrixXd accel_mat_qd0;
-static MatrixXd accel_mat_qdf;
-
-static VectorXd* t_inbetween;
-static snopt::integer num_inbetween_tSamples;
-static MatrixXd* dqInbetweendqknot;
-static MatrixXd* dqInbetweendqd0;
-static MatrixXd* dqInbetweendqdf;
-static snopt::integer* qknot_qsamples_idx;
-
-/* Remeber to delete this*/
-static snopt::integer nF_tmp;
-static snopt::integer nG_tmp;
-static snopt::integer nx_tmp;
-
-static void gevalNumerical(void (*func_ptr)(const VectorXd &, VectorXd &),const VectorXd &x, VectorXd &c, MatrixXd &dc,int order = 2)
+// NOTE: snopt_c is f2c output and keeps SAVE'd locals and common blocks inside the library, so it isn't reentrant even
+// with a separate workspace per call. Every SNOPT call (sninit through snopta) holds snopt_mutex, which serializes
+// concurrent SNOPT solves. Use the SQP solver (IKoptions::SQP) to run IK solves in parallel.
+static std::mutex snopt_mutex;
+
+/*
+ * The state of one inverseKinBackend call: the SNOPT workspace and everything the user functions need to evaluate the
+ * problem. inverseKinBackend creates one per call and hands it to the user functions through the cu argument of
+ * snopta, so concurrent calls don't share any problem data. The SNOPT library itself still needs snopt_mutex.
+ */
+struct SNOPTIKContext
+{
+  unique_ptr<snopt::doublereal []> rw;
+  unique_ptr<snopt::integer []> iw;
+  unique_ptr<char []> cw;
+  snopt::integer lenrw=0;
+  snopt::integer leniw=0;
+  snopt::integer lencw=0;
+  // snopta passes the context to the user functions as their character workspace cu
+  snopt::integer lencu=1;
+
+  RigidBodyTree * model = nullptr;
+  SingleTimeKinematicConstraint** st_kc_array = nullptr;
+  MultipleTimeKinematicConstraint** mt_kc_array = nullptr;
+  QuasiStaticConstraint* qsc_ptr = nullptr;
+  MatrixXd q_nom;
+  VectorXd q_nom_i;
+  MatrixXd Q;
+  MatrixXd Qa;
+  MatrixXd Qv;
+  bool qscActiveFlag;
+  snopt::integer nx;
+  snopt::integer nF;
+  snopt::integer nG;
+  snopt::integer* nc_array;
+  snopt::integer* nG_array;
+  snopt::integer* nA_array;
+  int nq;
+  double *t = nullptr;
+  double *t_samples = nullptr;
+  double* ti = nullptr;
+  int num_st_kc;
+  int num_mt_kc;
+  int num_st_lpc;
+  int num_mt_lpc;
+  int* mt_kc_nc;
+  int* st_lpc_nc;
+  int* mt_lpc_nc;
+  int nT;
+  int num_qsc_pts;
+  bool fixInitialState;
+  // The following variables are used in inverseKinTraj only
+  snopt::integer* qfree_idx;
+  snopt::integer* qdotf_idx;
+  snopt::integer* qdot0_idx;
+
+  VectorXd q0_fixed;
+  VectorXd qdot0_fixed;
+  snopt::integer qstart_idx;
+  snopt::integer num_qfree;
+  snopt::integer num_qdotfree;
+
+  MatrixXd velocity_mat;
+  MatrixXd velocity_mat_qd0;
+  MatrixXd velocity_mat_qdf;
+  MatrixXd accel_mat;
+  MatrixXd accel_mat_qd0;
+  MatrixXd accel_mat_qdf;
+
+  VectorXd* t_inbetween;
+  snopt::integer num_inbetween_tSamples;
+  MatrixXd* dqInbetweendqknot;
+  MatrixXd* dqInbetweendqd0;
+  MatrixXd* dqInbetweendqdf;
+  snopt::integer* qknot_qsamples_idx;
+
+  /* Remeber to delete this*/
+  snopt::integer nF_tmp;
+  snopt::integer nG_tmp;
+  snopt::integer nx_tmp;
+
+  void IK_constraint_fun(KinematicsCache<double>& cache, double* x, double* c, double* G);
+  void IK_cost_fun(double* x, double &J, double* dJ);
+  void IKfun(double* x, double* F, double* G);
+  void IKtraj_cost_fun(MatrixXd q,const VectorXd &qdot0,const VectorXd &qdotf,double &J,double* dJ);
+  void IKtrajfun(double* x, double* F, double* G);
+  void IKtraj_userfun(const VectorXd &x_vec, VectorXd &c_vec, VectorXd &G_vec);
+  void IKtraj_fevalfun(const VectorXd &x, VectorXd &c);
+
+  template <typename DerivedA, typename DerivedB, typename DerivedC, typename DerivedD, typename DerivedE>
+  void solve(RigidBodyTree * model_input, const int mode, const int nT_input, const double* t_input, const MatrixBase<DerivedA> &q_seed, const MatrixBase<DerivedB> &q_nom_input, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<DerivedC> &q_sol, MatrixBase<DerivedD> &qdot_sol, MatrixBase<DerivedE> &qddot_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
+};
+
+static void gevalNumerical(const function<void(const VectorXd &, VectorXd &)> &func,const VectorXd &x, VectorXd &c, MatrixXd &dc,int order = 2)
 {
   int nx = static_cast<int>(x.rows());
-  (*func_ptr)(x,c);
+  func(x,c);
   int nc = static_cast<int>(c.rows());
   dc.resize(nc,nx);
   double err = 1e-10;
@@ -113,7 +140,7 @@ static void gevalNumerical(void (*func_ptr)(const VectorXd &, VectorXd &),const
     VectorXd dx = VectorXd::Zero(nx);
     dx(i) = err;
     VectorXd c1(nc);
-    (*func_ptr)(x+dx,c1);
+    func(x+dx,c1);
     if(order == 1)
     {
       for(int j = 0;j<nc;j++)
@@ -124,7 +151,7 @@ static void gevalNumerical(void (*func_ptr)(const VectorXd &, VectorXd &),const
     else if(order == 2)
     {
       VectorXd c2(nc);
-      (*func_ptr)(x-dx,c2);
+      func(x-dx,c2);
       for(int j = 0;j<nc;j++)
       {
         dc(j,i) = (c1(j)-c2(j))/(2*err);
@@ -134,7 +161,7 @@ static void gevalNumerical(void (*func_ptr)(const VectorXd &, VectorXd &),const
 }
 
 
-static void IK_constraint_fun(KinematicsCache<double>& cache, double* x, double* c, double* G)
+void SNOPTIKContext::IK_constraint_fun(KinematicsCache<double>& cache, double* x, double* c, double* G)
 {
   double* qsc_weights=nullptr;
   if(qscActiveFlag)
@@ -173,7 +200,7 @@ static void IK_constraint_fun(KinematicsCache<double>& cache, double* x, double*
   }
 }
 
-static void IK_cost_fun(double* x, double &J, double* dJ)
+void SNOPTIKContext::IK_cost_fun(double* x, double &J, double* dJ)
 {
   VectorXd q(nq);
   memcpy(q.data(),x,sizeof(double)*nq);
@@ -183,6 +210,14 @@ static void IK_cost_fun(double* x, double &J, double* dJ)
   memcpy(dJ, dJ_vec.data(),sizeof(double)*nq);
 }
 
+void SNOPTIKContext::IKfun(double* x, double* F, double* G)
+{
+  Map<VectorXd> q(x, nq);
+  KinematicsCache<double> cache = model->doKinematics(q); // TODO: pass this into the function?
+  IK_cost_fun(x,F[0],G);
+  IK_constraint_fun(cache, x, &F[1], &G[nq]);
+}
+
 static int snoptIKfun(snopt::integer *Status, snopt::integer *n, snopt::doublereal x[],
     snopt::integer *needF, snopt::integer *neF, snopt::doublereal F[],
     snopt::integer *needG, snopt::integer *neG, snopt::doublereal G[],
@@ -190,14 +225,11 @@ static int snoptIKfun(snopt::integer *Status, snopt::integer *n, snopt::doublere
     snopt::integer iu[], snopt::integer *leniu,
     snopt::doublereal ru[], snopt::integer *lenru)
 {
-  Map<VectorXd> q(x, nq);
-  KinematicsCache<double> cache = model->doKinematics(q); // TODO: pass this into the function?
-  IK_cost_fun(x,F[0],G);
-  IK_constraint_fun(cache, x, &F[1], &G[nq]);
+  reinterpret_cast<SNOPTIKContext*>(cu)->IKfun(x, F, G);
   return 0;
 }
 
-static void IKtraj_cost_fun(MatrixXd q,const VectorXd &qdot0,const VectorXd &qdotf,double &J,double* dJ)
+void SNOPTIKContext::IKtraj_cost_fun(MatrixXd q,const VectorXd &qdot0,const VectorXd &qdotf,double &J,double* dJ)
 {
   MatrixXd dJ_vec = MatrixXd::Zero(1,nq*(num_qfree+num_qdotfree));
   MatrixXd qdot(nq*nT,1);
@@ -247,12 +279,7 @@ static void IKtraj_cost_fun(MatrixXd q,const VectorXd &qdot0,const VectorXd &qdo
   memcpy(dJ,dJ_vec.data(),sizeof(double)*nq*(num_qfree+num_qdotfree));
 }
 
-static int snoptIKtrajfun(snopt::integer *Status, snopt::integer *n, snopt::doublereal x[],
-    snopt::integer *needF, snopt::integer *neF, snopt::doublereal F[],
-    snopt::integer *needG, snopt::integer *neG, snopt::doublereal G[],
-    char *cu, snopt::integer *lencu,
-    snopt::integer iu[], snopt::integer *leniu,
-    snopt::doublereal ru[], snopt::integer *lenru)
+void SNOPTIKContext::IKtrajfun(double* x, double* F, double* G)
 {
   VectorXd qdotf = VectorXd::Zero(nq);
   VectorXd qdot0 = VectorXd::Zero(nq);
@@ -381,11 +408,21 @@ static int snoptIKtrajfun(snopt::integer *Status, snopt::integer *n, snopt::doub
   {
     nf_cum += mt_lpc_nc[i];
   }
+}
+
+static int snoptIKtrajfun(snopt::integer *Status, snopt::integer *n, snopt::doublereal x[],
+    snopt::integer *needF, snopt::integer *neF, snopt::doublereal F[],
+    snopt::integer *needG, snopt::integer *neG, snopt::doublereal G[],
+    char *cu, snopt::integer *lencu,
+    snopt::integer iu[], snopt::integer *leniu,
+    snopt::doublereal ru[], snopt::integer *lenru)
+{
+  reinterpret_cast<SNOPTIKContext*>(cu)->IKtrajfun(x, F, G);
   return 0;
 }
 
 
-static void snoptIKtraj_userfun(const VectorXd &x_vec, VectorXd &c_vec, VectorXd &G_vec)
+void SNOPTIKContext::IKtraj_userfun(const VectorXd &x_vec, VectorXd &c_vec, VectorXd &G_vec)
 {
   snopt::doublereal* x = new snopt::doublereal[nx_tmp];
   for(int i = 0;i<nx_tmp;i++)
@@ -394,19 +431,7 @@ static void snoptIKtraj_userfun(const VectorXd &x_vec, VectorXd &c_vec, VectorXd
   }
   snopt::doublereal* F = new snopt::doublereal[nF_tmp];
   snopt::doublereal* G = new snopt::doublereal[nG_tmp];
-  snopt::integer Status = 0;
-  snopt::integer n = nx_tmp;
-  snopt::integer needF = 1;
-  snopt::integer neF = nF_tmp;
-  snopt::integer needG = 1;
-  snopt::integer neG = nG_tmp;
-  char *cu = nullptr;
-  snopt::integer lencu = 0;
-  snopt::integer *iu = nullptr;
-  snopt::integer leniu = 0;
-  snopt::doublereal *ru = nullptr;
-  snopt::integer lenru = 0;
-  snoptIKtrajfun(&Status,&n,x,&needF, &neF, F, &needG, &neG, G, cu, &lencu, iu, &leniu, ru, &lenru);
+  IKtrajfun(x, F, G);
   c_vec.resize(nF_tmp,1);
   for(int i = 0;i<nF_tmp;i++)
   {
@@ -422,14 +447,14 @@ static void snoptIKtraj_userfun(const VectorXd &x_vec, VectorXd &c_vec, VectorXd
   delete[] G;
 }
 
-static void snoptIKtraj_fevalfun(const VectorXd &x, VectorXd &c)
+void SNOPTIKContext::IKtraj_fevalfun(const VectorXd &x, VectorXd &c)
 {
   VectorXd G;
-  snoptIKtraj_userfun(x,c,G);
+  IKtraj_userfun(x,c,G);
 }
 
 template <typename DerivedA, typename DerivedB, typename DerivedC, typename DerivedD, typename DerivedE>
-void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT_input, const double* t_input, const MatrixBase<DerivedA> &q_seed, const MatrixBase<DerivedB> &q_nom_input, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<DerivedC> &q_sol, MatrixBase<DerivedD> &qdot_sol, MatrixBase<DerivedE> &qddot_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions)
+void SNOPTIKContext::solve(RigidBodyTree * model_input, const int mode, const int nT_input, const double* t_input, const MatrixBase<DerivedA> &q_seed, const MatrixBase<DerivedB> &q_nom_input, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<DerivedC> &q_sol, MatrixBase<DerivedD> &qdot_sol, MatrixBase<DerivedE> &qddot_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions)
 {
   model = model_input;
   nT = nT_input;
@@ -878,6 +903,7 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
       npname = strlen(Prob);
       snopenappend_(&iPrint,printname, &INFO_snopt[i], prnt_len);*/
 
+      std::unique_lock<std::mutex> snopt_lock(snopt_mutex);
       snopt::sninit_(&iPrint,&iSumm,cw.get(),&lencw,iw.get(),&leniw,rw.get(),&lenrw,8*lencw);
       snopt::snmema_(&INFO_snopt[i],&nF,&nx,&nxname,&nFname,&lenA,&nG,&mincw,&miniw,&minrw,cw.get(),&lencw,iw.get(),&leniw,rw.get(),&lenrw,8*lencw);
       if (minrw>lenrw) {
@@ -993,10 +1019,11 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
           x, xstate, xmul, F, Fstate, Fmul,
           &INFO_snopt[i], &mincw, &miniw, &minrw,
           &nS, &nInf, &sInf,
-          cw.get(), &lencw, iw.get(), &leniw, rw.get(), &lenrw,
+          reinterpret_cast<char*>(this), &lencu, iw.get(), &leniw, rw.get(), &lenrw,
           cw.get(), &lencw, iw.get(), &leniw, rw.get(), &lenrw,
           8*npname, 8*nxname, 8*nFname,
-          8*lencw, 8*lencw);
+          8*lencu, 8*lencw);
+      snopt_lock.unlock();
       //snclose_(&iPrint);
       //snclose_(&iSpecs);
       vector<string> Fname(Cname_array[i]);
@@ -1854,6 +1881,7 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
     snopt::integer nS, nInf;
     snopt::doublereal sInf;
 
+    std::unique_lock<std::mutex> snopt_lock(snopt_mutex);
     snopt::sninit_(&iPrint,&iSumm,cw.get(),&lencw,iw.get(),&leniw,rw.get(),&lenrw,8*lencw);
     snopt::snmema_(INFO_snopt,&nF,&nx,&nxname,&nFname,&lenA,&nG,&mincw,&miniw,&minrw,cw.get(),&lencw,iw.get(),&leniw,rw.get(),&lenrw,8*lencw);
     if (minrw>lenrw) {
@@ -1909,7 +1937,7 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
     {
       x_vec(i) = x[i];
     }
-    snoptIKtraj_userfun(x_vec,f_vec,G_vec);
+    IKtraj_userfun(x_vec,f_vec,G_vec);
     mxArray* f_ptr = mxCreateDoubleMatrix(nF,1,mxREAL);
     mxArray* G_ptr = mxCreateDoubleMatrix(nG,1,mxREAL);
     memcpy(mxGetPrSafe(f_ptr),f_vec.data(),sizeof(double)*(nF));
@@ -2050,10 +2078,11 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
         x, xstate, xmul, F, Fstate, Fmul,
         INFO_snopt, &mincw, &miniw, &minrw,
         &nS, &nInf, &sInf,
-        cw.get(), &lencw, iw.get(), &leniw, rw.get(), &lenrw,
+        reinterpret_cast<char*>(this), &lencu, iw.get(), &leniw, rw.get(), &lenrw,
         cw.get(), &lencw, iw.get(), &leniw, rw.get(), &lenrw,
         npname, 8*nxname, 8*nFname,
-        8*500, 8*500);
+        8*lencu, 8*500);
+    snopt_lock.unlock();
     if(*INFO_snopt == 41)
     {
       nx_tmp = nx;
@@ -2064,13 +2093,13 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
       memcpy(x_vec.data(),x,sizeof(double)*nx);
       VectorXd c_vec(nF_tmp);
       VectorXd G_vec(nG_tmp);
-      snoptIKtraj_userfun(x_vec,c_vec,G_vec);
+      IKtraj_userfun(x_vec,c_vec,G_vec);
       MatrixXd df_userfun = MatrixXd::Zero(nF,nx);
       for(int i = 0;i<nG;i++)
       {
         df_userfun(iGfun[i]-1,jGvar[i]-1) = G_vec(i);
       }
-      gevalNumerical(&snoptIKtraj_fevalfun,x_vec,c_vec,df_numerical);
+      gevalNumerical([this](const VectorXd &x, VectorXd &c) { IKtraj_fevalfun(x,c); },x_vec,c_vec,df_numerical);
       MatrixXd df_err = df_userfun-df_numerical;
       df_err = df_err.cwiseAbs();
       int max_err_row,max_err_col;
@@ -2078,7 +2107,7 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
       max_err = df_err.maxCoeff(&max_err_row,&max_err_col);
       printf("The maximum gradient numerical error is %e, in row %d, col %d\nuser gradient is %e\n2nd order numerical gradient is %e\n",max_err,max_err_row+1,max_err_col+1,df_userfun(max_err_row,max_err_col),df_numerical(max_err_row,max_err_col));
       MatrixXd df_numerical2;
-      gevalNumerical(&snoptIKtraj_fevalfun,x_vec,c_vec,df_numerical2,1);
+      gevalNumerical([this](const VectorXd &x, VectorXd &c) { IKtraj_fevalfun(x,c); },x_vec,c_vec,df_numerical2,1);
       printf("1st order numerical gradient is %e\n",df_numerical2(max_err_row,max_err_col));
 //      double err = 1e-10;
       VectorXd x_vec_err(nx_tmp);
@@ -2225,6 +2254,14 @@ void inverseKinBackend(RigidBodyTree * model_input, const int mode, const int nT
   delete[] st_lpc_array;
   delete[] mt_lpc_array;
 }
+
+template <typename DerivedA, typename DerivedB, typename DerivedC, typename DerivedD, typename DerivedE>
+void inverseKinBackend(RigidBodyTree * model, const int mode, const int nT, const double* t, const MatrixBase<DerivedA> &q_seed, const MatrixBase<DerivedB> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<DerivedC> &q_sol, MatrixBase<DerivedD> &qdot_sol, MatrixBase<DerivedE> &qddot_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions)
+{
+  SNOPTIKContext context;
+  context.solve(model,mode,nT,t,q_seed,q_nom,num_constraints,constraint_array,q_sol,qdot_sol,qddot_sol,INFO,infeasible_constraint,ikoptions);
+}
+
 template void inverseKinBackend(RigidBodyTree * model, const int mode, const int nT, const double* t, const MatrixBase<Map<MatrixXd>> &q_seed, const MatrixBase<Map<MatrixXd>> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<Map<MatrixXd>> &q_sol, MatrixBase<Map<MatrixXd>> &qdot_sol, MatrixBase<Map<MatrixXd>> &qddot_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
 template void inverseKinBackend(RigidBodyTree * model, const int mode, const int nT, const double* t, const MatrixBase<MatrixXd> &q_seed, const MatrixBase<MatrixXd> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<MatrixXd> &q_sol, MatrixBase<MatrixXd> &qdot_sol, MatrixBase<MatrixXd> &qddot_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
 template void inverseKinBackend(RigidBodyTree * model, const int mode, const int nT, const double* t, const MatrixBase<Map<MatrixXd>> &q_seed, const MatrixBase<Map<MatrixXd>> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<Map<MatrixXd>> &q_sol, MatrixBase<MatrixXd> &qdot_sol, MatrixBase<MatrixXd> &qddot_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
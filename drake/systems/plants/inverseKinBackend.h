@@ -10,5 +10,12 @@ class IKoptions;
 template <typename DerivedA, typename DerivedB, typename DerivedC, typename DerivedD, typename DerivedE>
 void inverseKinBackend(RigidBodyTree * model, const int mode, const int nT, const double* t, const Eigen::MatrixBase<DerivedA> &q_seed, const Eigen::MatrixBase<DerivedB> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, Eigen::MatrixBase<DerivedC> &q_sol, Eigen::MatrixBase<DerivedD> &qdot_sol, Eigen::MatrixBase<DerivedE> &qddot_sol, int* INFO, std::vector<std::string> &infeasible_constraint, const IKoptions &ikoptions);
 
+/*
+ * Solves nT independent single time IK problems (the mode 1 problems of inverseKinBackend) with the SQP solver. As with
+ * inverseKinBackend, every call owns its workspace, so this function is reentrant.
+ */
+template <typename DerivedA, typename DerivedB, typename DerivedC>
+void inverseKinSQPBackend(RigidBodyTree * model, const int nT, const double* t, const Eigen::MatrixBase<DerivedA> &q_seed, const Eigen::MatrixBase<DerivedB> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, Eigen::MatrixBase<DerivedC> &q_sol, int* INFO, std::vector<std::string> &infeasible_constraint, const IKoptions &ikoptions);
+
 #endif
 
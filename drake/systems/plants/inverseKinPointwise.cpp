@@ -13,7 +13,14 @@ drakeIK_DLLEXPORT void inverseKinPointwise(RigidBodyTree * model, const int nT,
   int nq = model->num_positions;
   MatrixXd qdot_dummy(nq,nT);
   MatrixXd qddot_dummy(nq,nT);
-  inverseKinBackend(model,1,nT,t,q_seed,q_nom,num_constraints,constraint_array,q_sol,qdot_dummy,qddot_dummy,INFO,infeasible_constraint,ikoptions);
+#ifdef HAVE_SNOPT
+  if(ikoptions.getSolver() == IKoptions::SNOPT)
+  {
+    inverseKinBackend(model,1,nT,t,q_seed,q_nom,num_constraints,constraint_array,q_sol,qdot_dummy,qddot_dummy,INFO,infeasible_constraint,ikoptions);
+    return;
+  }
+#endif
+  inverseKinSQPBackend(model,nT,t,q_seed,q_nom,num_constraints,constraint_array,q_sol,INFO,infeasible_constraint,ikoptions);
 }
 
 template drakeIK_DLLEXPORT void inverseKinPointwise(RigidBodyTree * model, const int nT, const double* t, const MatrixBase<Map<MatrixXd>> &q_seed, const MatrixBase<Map<MatrixXd>> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<Map<MatrixXd>> &q_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
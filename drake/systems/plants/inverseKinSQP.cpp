@@ -0,0 +1,580 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+#include "RigidBodyIK.h"
+#include "RigidBodyTree.h"
+#include "constraint/RigidBodyConstraint.h"
+#include "IKoptions.h"
+#include "inverseKinBackend.h"
+#include "eiquadprog.hpp"
+
+using namespace Eigen;
+using namespace std;
+
+/*
+ * Sequential quadratic programming backend for the single time IK problem
+ *
+ *   min_x (q - q_nom)' * Q * (q - q_nom)  s.t.  c_lb <= c(x) <= c_ub,  x_lb <= x <= x_ub
+ *
+ * where x = [q; quasi static weights]. Each major iteration solves the elastic QP subproblem
+ *
+ *   min_{dx, s} 1/2 dx' * H * dx + g' * dx + rho * sum(s) + 1/2 * eps * s' * s
+ *   s.t. c_lb - s <= c(x) + dc(x) * dx <= c_ub + s,  s >= 0,  x_lb <= x + dx <= x_ub,  |dx| <= trust region
+ *
+ * with eiquadprog, followed by a line search (with a second order correction) on the l1 merit function
+ * J(x) + mu * |violation(x)|_1.
+ * The slack variables s keep the subproblem feasible when the linearized constraints are inconsistent. H starts out
+ * as the cost Hessian and is refined with damped BFGS updates of the Lagrangian Hessian, using multipliers recovered
+ * from the constraints that are active at the QP solution.
+ *
+ * All the data of a solve lives in an IKSQPProblem owned by the call, no file-scope state is used, so the time samples
+ * of inverseKinPointwise can be solved in parallel (see IKoptions::setNumThreads). Collision constraints query a copy
+ * of the collision model of the tree that is leased to the query (see RigidBodyTree::collisionDetect), so concurrent
+ * solves on one model don't share any state.
+ */
+
+static const double SQP_TRUST_REGION = 0.5;
+static const double SQP_ELASTIC_PENALTY = 1e4;
+static const double SQP_HESSIAN_REGULARIZATION = 1e-6;
+static const double SQP_SLACK_REGULARIZATION = 1.0;
+static const double SQP_ARMIJO_PARAMETER = 1e-4;
+static const double SQP_MIN_STEP_LENGTH = 1e-10;
+
+struct IKSQPProblem
+{
+  RigidBodyTree* model;
+  const double* t;
+  int nq;
+  int nx;
+  MatrixXd Q;
+  VectorXd q_nom;
+  VectorXd x_lb;
+  VectorXd x_ub;
+
+  vector<SingleTimeKinematicConstraint*> st_kc;
+  QuasiStaticConstraint* qsc;
+  int num_qsc_pts;
+
+  // the linear constraints (single time linear posture constraints and the sum of the quasi static weights) are
+  // appended after the nonlinear ones
+  MatrixXd A;
+
+  VectorXd c_lb;
+  VectorXd c_ub;
+  vector<string> c_name;
+};
+
+static void evalIKSQPConstraints(const IKSQPProblem& prob, const VectorXd& x, VectorXd& c, MatrixXd& dc)
+{
+  int nc = static_cast<int>(prob.c_lb.size());
+  c.resize(nc);
+  dc.setZero(nc, prob.nx);
+
+  VectorXd q = x.head(prob.nq);
+  KinematicsCache<double> cache = prob.model->doKinematics(q);
+  int nc_accum = 0;
+  for (auto it = prob.st_kc.begin(); it != prob.st_kc.end(); ++it) {
+    int nc_i = (*it)->getNumConstraint(prob.t);
+    VectorXd cnst(nc_i);
+    MatrixXd dcnst(nc_i, prob.nq);
+    (*it)->eval(prob.t, cache, cnst, dcnst);
+    c.segment(nc_accum, nc_i) = cnst;
+    dc.block(nc_accum, 0, nc_i, prob.nq) = dcnst;
+    nc_accum += nc_i;
+  }
+  if (prob.qsc) {
+    int nc_i = prob.qsc->getNumConstraint(prob.t) - 1;
+    VectorXd cnst(nc_i);
+    MatrixXd dcnst(nc_i, prob.nq + prob.num_qsc_pts);
+    prob.qsc->eval(prob.t, cache, x.data() + prob.nq, cnst, dcnst);
+    c.segment(nc_accum, nc_i) = cnst;
+    dc.block(nc_accum, 0, nc_i, prob.nq + prob.num_qsc_pts) = dcnst;
+    nc_accum += nc_i;
+  }
+
+  c.tail(prob.A.rows()) = prob.A * x;
+  dc.bottomRows(prob.A.rows()) = prob.A;
+}
+
+static double IKSQPCost(const IKSQPProblem& prob, const VectorXd& x)
+{
+  VectorXd q_err = x.head(prob.nq) - prob.q_nom;
+  return q_err.dot(prob.Q * q_err);
+}
+
+static VectorXd IKSQPConstraintViolation(const IKSQPProblem& prob, const VectorXd& c)
+{
+  return (prob.c_lb - c).cwiseMax(c - prob.c_ub).cwiseMax(0.0);
+}
+
+static double maxCoeffOrZero(const VectorXd& v)
+{
+  return v.size() > 0 ? v.maxCoeff() : 0.0;
+}
+
+/*
+ * Solves the QP subproblem at x for the constraint values c and gradients dc. z = [dx; s] is the solution, lambda
+ * holds the multipliers of the linearized constraints, recovered from the QP stationarity condition restricted to the
+ * active constraints. Returns false if the QP is infeasible, which can only happen for inconsistent bounds on x.
+ */
+static bool solveIKSQPSubproblem(const IKSQPProblem& prob, const MatrixXd& H, const VectorXd& x, const VectorXd& g, const VectorXd& c, const MatrixXd& dc, VectorXd& z, VectorXd& lambda)
+{
+  const int nx = prob.nx;
+  const int nc = static_cast<int>(prob.c_lb.size());
+  const int nz = nx + nc;
+
+  // the first rows are the linearized bounds of the constraints, then s >= 0, then the bounds on dx
+  vector<int> bound_row_constraint;
+  vector<double> bound_row_sign;
+  for (int k = 0; k < nc; k++) {
+    if (std::isfinite(prob.c_lb(k))) {
+      bound_row_constraint.push_back(k);
+      bound_row_sign.push_back(1.0);
+    }
+    if (std::isfinite(prob.c_ub(k))) {
+      bound_row_constraint.push_back(k);
+      bound_row_sign.push_back(-1.0);
+    }
+  }
+  const int num_bound_rows = static_cast<int>(bound_row_constraint.size());
+  const int num_inequalities = num_bound_rows + nc + 2 * nx;
+
+  // eiquadprog minimizes 1/2 z' * G * z + g0' * z s.t. CE' * z + ce0 = 0, CI' * z + ci0 >= 0, and overwrites G
+  MatrixXd G = MatrixXd::Zero(nz, nz);
+  G.topLeftCorner(nx, nx) = H;
+  G.bottomRightCorner(nc, nc).diagonal().setConstant(SQP_SLACK_REGULARIZATION);
+  MatrixXd G_factored = G;
+  VectorXd g0(nz);
+  g0.head(nx) = g;
+  g0.tail(nc).setConstant(SQP_ELASTIC_PENALTY);
+  MatrixXd CE(nz, 0);
+  VectorXd ce0(0);
+  MatrixXd CI = MatrixXd::Zero(nz, num_inequalities);
+  VectorXd ci0(num_inequalities);
+  for (int row = 0; row < num_bound_rows; row++) {
+    int k = bound_row_constraint[row];
+    double sign = bound_row_sign[row];
+    CI.block(0, row, nx, 1) = sign * dc.row(k).transpose();
+    CI(nx + k, row) = 1.0;
+    ci0(row) = sign > 0.0 ? c(k) - prob.c_lb(k) : prob.c_ub(k) - c(k);
+  }
+  for (int k = 0; k < nc; k++) {
+    CI(nx + k, num_bound_rows + k) = 1.0;
+    ci0(num_bound_rows + k) = 0.0;
+  }
+  for (int k = 0; k < nx; k++) {
+    int row = num_bound_rows + nc + 2 * k;
+    CI(k, row) = 1.0;
+    ci0(row) = -std::max(prob.x_lb(k) - x(k), -SQP_TRUST_REGION);
+    CI(k, row + 1) = -1.0;
+    ci0(row + 1) = std::min(prob.x_ub(k) - x(k), SQP_TRUST_REGION);
+  }
+
+  z.resize(nz);
+  if (std::isinf(solve_quadprog(G_factored, g0, CE, ce0, CI, ci0, z))) {
+    return false;
+  }
+
+  VectorXd ci = CI.transpose() * z + ci0;
+  vector<int> active;
+  for (int j = 0; j < num_inequalities; j++) {
+    if (ci(j) <= 1e-9 * (1.0 + std::abs(ci0(j)))) active.push_back(j);
+  }
+  MatrixXd CI_active(nz, active.size());
+  for (size_t j = 0; j < active.size(); j++) {
+    CI_active.col(j) = CI.col(active[j]);
+  }
+  VectorXd lambda_active = CI_active.colPivHouseholderQr().solve(G * z + g0);
+  lambda = VectorXd::Zero(nc);
+  for (size_t j = 0; j < active.size(); j++) {
+    if (active[j] < num_bound_rows) {
+      lambda(bound_row_constraint[active[j]]) += bound_row_sign[active[j]] * lambda_active(j);
+    }
+  }
+  return true;
+}
+
+static VectorXd IKSQPCostGradient(const IKSQPProblem& prob, const VectorXd& x)
+{
+  VectorXd g = VectorXd::Zero(prob.nx);
+  g.head(prob.nq) = 2.0 * prob.Q * (x.head(prob.nq) - prob.q_nom);
+  return g;
+}
+
+/*
+ * Runs the SQP iterations starting from x. Returns an INFO code with the same meaning as the SNOPT ones used by
+ * inverseKinBackend: 1 on success, 3 if the line search cannot make progress, 13 if the constraints appear to be
+ * infeasible and 32 if the major iterations limit is reached.
+ */
+static int solveIKSQP(const IKSQPProblem& prob, const IKoptions& ikoptions, VectorXd& x)
+{
+  const int nx = prob.nx;
+  const int nc = static_cast<int>(prob.c_lb.size());
+  const double feasibility_tolerance = ikoptions.getMajorFeasibilityTolerance();
+  const double optimality_tolerance = ikoptions.getMajorOptimalityTolerance();
+  const int major_iterations_limit = ikoptions.getMajorIterationsLimit();
+
+  MatrixXd H = MatrixXd::Zero(nx, nx);
+  H.topLeftCorner(prob.nq, prob.nq) = 2.0 * prob.Q;
+  H.diagonal().array() += SQP_HESSIAN_REGULARIZATION;
+
+  VectorXd z, z_soc, lambda, lambda_soc;
+  VectorXd c, c_new;
+  MatrixXd dc, dc_new;
+
+  x = x.cwiseMax(prob.x_lb).cwiseMin(prob.x_ub);
+  evalIKSQPConstraints(prob, x, c, dc);
+  double J = IKSQPCost(prob, x);
+  double merit_penalty = 0.0;
+
+  for (int iter = 0; iter < major_iterations_limit; iter++) {
+    VectorXd violation = IKSQPConstraintViolation(prob, c);
+    double violation_l1 = violation.sum();
+    VectorXd g = IKSQPCostGradient(prob, x);
+
+    if (!solveIKSQPSubproblem(prob, H, x, g, c, dc, z, lambda)) {
+      return 13;
+    }
+    VectorXd dx = z.head(nx);
+    double slack_l1 = z.tail(nc).cwiseMax(0.0).sum();
+
+    if (dx.lpNorm<Infinity>() <= optimality_tolerance * (1.0 + x.lpNorm<Infinity>())) {
+      if (maxCoeffOrZero(violation) <= feasibility_tolerance) {
+        return 1;
+      }
+      if (slack_l1 > feasibility_tolerance) {
+        // the linearized constraints cannot be satisfied and no step reduces the violation
+        return 13;
+      }
+    }
+
+    // the l1 merit function J(x) + mu * |violation(x)|_1 is exact for mu larger than the multipliers. mu follows
+    // Powell's rule so that it can come back down after the elastic mode has driven the multipliers up
+    double lambda_max = lambda.lpNorm<Infinity>();
+    merit_penalty = std::max(1.1 * lambda_max + 1e-3, 0.5 * (merit_penalty + lambda_max));
+    double merit = J + merit_penalty * violation_l1;
+    // dx = 0, s = violation is feasible for the subproblem, so this bound on the directional derivative is negative
+    double directional_derivative = g.dot(dx) - merit_penalty * (violation_l1 - slack_l1);
+
+    VectorXd x_new = x + dx;
+    evalIKSQPConstraints(prob, x_new, c_new, dc_new);
+    double J_new = IKSQPCost(prob, x_new);
+    double merit_new = J_new + merit_penalty * IKSQPConstraintViolation(prob, c_new).sum();
+    if (merit_new > merit + SQP_ARMIJO_PARAMETER * directional_derivative) {
+      // second order correction: resolve the subproblem with the constraint values at x + dx to counter the
+      // curvature of the constraints (Maratos effect) before falling back to backtracking
+      VectorXd c_soc = c_new - dc * dx;
+      if (solveIKSQPSubproblem(prob, H, x, g, c_soc, dc, z_soc, lambda_soc)) {
+        VectorXd x_soc = x + z_soc.head(nx);
+        evalIKSQPConstraints(prob, x_soc, c_new, dc_new);
+        J_new = IKSQPCost(prob, x_soc);
+        merit_new = J_new + merit_penalty * IKSQPConstraintViolation(prob, c_new).sum();
+        x_new = x_soc;
+      }
+      double alpha = 1.0;
+      while (merit_new > merit + SQP_ARMIJO_PARAMETER * alpha * directional_derivative) {
+        alpha *= 0.5;
+        if (alpha < SQP_MIN_STEP_LENGTH) {
+          return maxCoeffOrZero(violation) <= feasibility_tolerance ? 3 : 13;
+        }
+        x_new = x + alpha * dx;
+        evalIKSQPConstraints(prob, x_new, c_new, dc_new);
+        J_new = IKSQPCost(prob, x_new);
+        merit_new = J_new + merit_penalty * IKSQPConstraintViolation(prob, c_new).sum();
+      }
+    }
+
+    // damped BFGS update (Powell) of the Hessian of the Lagrangian J(x) - lambda' * c(x)
+    VectorXd step = x_new - x;
+    VectorXd y = (IKSQPCostGradient(prob, x_new) - dc_new.transpose() * lambda) - (g - dc.transpose() * lambda);
+    VectorXd H_step = H * step;
+    double step_H_step = step.dot(H_step);
+    if (step_H_step > 1e-16) {
+      double step_y = step.dot(y);
+      if (step_y < 0.2 * step_H_step) {
+        double theta = 0.8 * step_H_step / (step_H_step - step_y);
+        y = theta * y + (1.0 - theta) * H_step;
+        step_y = step.dot(y);
+      }
+      H += y * y.transpose() / step_y - H_step * H_step.transpose() / step_H_step;
+    }
+
+    x = x_new;
+    J = J_new;
+    c.swap(c_new);
+    dc.swap(dc_new);
+  }
+  return 32;
+}
+
+template <typename DerivedA, typename DerivedB, typename DerivedC>
+void inverseKinSQPBackend(RigidBodyTree * model, const int nT, const double* t, const MatrixBase<DerivedA> &q_seed, const MatrixBase<DerivedB> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<DerivedC> &q_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions)
+{
+  int nq = model->num_positions;
+  if(q_seed.rows() != nq || q_seed.cols() != nT || q_nom.rows() != nq || q_nom.cols() != nT)
+  {
+    cerr<<"Drake:inverseKinSQPBackend: q_seed and q_nom must be of size nq x nT"<<endl;
+  }
+
+  vector<SingleTimeKinematicConstraint*> st_kc_array;
+  vector<SingleTimeLinearPostureConstraint*> st_lpc_array;
+  vector<PostureConstraint*> pc_array;
+  QuasiStaticConstraint* qsc_ptr = nullptr;
+  for(int i = 0;i<num_constraints;i++)
+  {
+    RigidBodyConstraint* constraint = constraint_array[i];
+    int constraint_category = constraint->getCategory();
+    if(constraint_category == RigidBodyConstraint::SingleTimeKinematicConstraintCategory)
+    {
+      st_kc_array.push_back(static_cast<SingleTimeKinematicConstraint*>(constraint));
+    }
+    else if(constraint_category == RigidBodyConstraint::QuasiStaticConstraintCategory)
+    {
+      if(qsc_ptr != nullptr)
+      {
+        cerr<<"Drake:inverseKinSQPBackend:current implementation supports at most one QuasiStaticConstraint"<<endl;
+      }
+      qsc_ptr = static_cast<QuasiStaticConstraint*>(constraint);
+    }
+    else if(constraint_category == RigidBodyConstraint::PostureConstraintCategory)
+    {
+      pc_array.push_back(static_cast<PostureConstraint*>(constraint));
+    }
+    else if(constraint_category == RigidBodyConstraint::SingleTimeLinearPostureConstraintCategory)
+    {
+      st_lpc_array.push_back(static_cast<SingleTimeLinearPostureConstraint*>(constraint));
+    }
+    // multiple time constraints only apply to inverseKinTraj, as in inverseKinBackend they are ignored here
+  }
+  bool qsc_active = qsc_ptr != nullptr && qsc_ptr->isActive();
+  int num_qsc_pts = qsc_active ? qsc_ptr->getNumWeights() : 0;
+  bool debug_mode = ikoptions.getDebug();
+  bool sequentialSeedFlag = ikoptions.getSequentialSeedFlag();
+
+  // With the sequential seed flag, sample i is seeded from the solution of sample i-1, so all the samples form one
+  // block that is solved in order. An explicit sequential seed block size restarts the seed chain at the block
+  // boundaries, so that the blocks can be handed out to the threads. The block boundaries don't depend on the number
+  // of threads, so neither does the solution.
+  int block_size = 1;
+  if(sequentialSeedFlag)
+  {
+    block_size = std::max(nT,1);
+    if(ikoptions.getSequentialSeedBlockSize()>0)
+    {
+      block_size = ikoptions.getSequentialSeedBlockSize();
+    }
+  }
+
+  q_sol.resize(nq,nT);
+  vector<vector<string>> infeasible_constraint_samples(nT);
+  auto solveSample = [&](int i)
+  {
+    IKSQPProblem prob;
+    prob.model = model;
+    prob.t = t == nullptr ? nullptr : &t[i];
+    prob.nq = nq;
+    prob.nx = nq+num_qsc_pts;
+    ikoptions.getQ(prob.Q);
+    prob.q_nom = q_nom.col(i);
+    prob.qsc = qsc_active ? qsc_ptr : nullptr;
+    prob.num_qsc_pts = num_qsc_pts;
+
+    prob.x_lb.resize(prob.nx);
+    prob.x_ub.resize(prob.nx);
+    prob.x_lb.head(nq) = model->joint_limit_min;
+    prob.x_ub.head(nq) = model->joint_limit_max;
+    prob.x_lb.tail(num_qsc_pts).setZero();
+    prob.x_ub.tail(num_qsc_pts).setOnes();
+    for(auto it = pc_array.begin();it != pc_array.end();++it)
+    {
+      VectorXd joint_min, joint_max;
+      (*it)->bounds(prob.t,joint_min,joint_max);
+      prob.x_lb.head(nq) = prob.x_lb.head(nq).cwiseMax(joint_min);
+      prob.x_ub.head(nq) = prob.x_ub.head(nq).cwiseMin(joint_max);
+    }
+    for(int k = 0;k<nq;k++)
+    {
+      if(prob.x_lb(k)>prob.x_ub(k))
+      {
+        cerr<<"Drake:inverseKinSQPBackend:BadInputs Some posture constraint has lower bound larger than the upper bound of other posture constraint for joint "<<k<< " at "<<i<<"'th time "<<endl;
+      }
+    }
+
+    // constraint bounds, in the order in which evalIKSQPConstraints stacks the constraints
+    vector<VectorXd> lb_blocks, ub_blocks;
+    int num_linear_constraints = 0;
+    for(auto it = st_kc_array.begin();it != st_kc_array.end();++it)
+    {
+      if((*it)->isTimeValid(prob.t))
+      {
+        prob.st_kc.push_back(*it);
+        int nc = (*it)->getNumConstraint(prob.t);
+        VectorXd lb(nc), ub(nc);
+        (*it)->bounds(prob.t,lb,ub);
+        lb_blocks.push_back(lb);
+        ub_blocks.push_back(ub);
+        if(debug_mode)
+        {
+          (*it)->name(prob.t,prob.c_name);
+        }
+      }
+    }
+    if(prob.qsc)
+    {
+      int nc = prob.qsc->getNumConstraint(prob.t)-1;
+      VectorXd lb(nc), ub(nc);
+      prob.qsc->bounds(prob.t,lb,ub);
+      lb_blocks.push_back(lb);
+      ub_blocks.push_back(ub);
+      if(debug_mode)
+      {
+        vector<string> constraint_name;
+        prob.qsc->name(prob.t,constraint_name);
+        prob.c_name.insert(prob.c_name.end(),constraint_name.begin(),constraint_name.begin()+nc);
+      }
+    }
+    int num_nonlinear_constraints = 0;
+    for(auto it = lb_blocks.begin();it != lb_blocks.end();++it)
+    {
+      num_nonlinear_constraints += static_cast<int>(it->size());
+    }
+    for(auto it = st_lpc_array.begin();it != st_lpc_array.end();++it)
+    {
+      num_linear_constraints += (*it)->getNumConstraint(prob.t);
+    }
+    if(prob.qsc)
+    {
+      num_linear_constraints++;
+    }
+    prob.A = MatrixXd::Zero(num_linear_constraints,prob.nx);
+    int lin_row = 0;
+    for(auto it = st_lpc_array.begin();it != st_lpc_array.end();++it)
+    {
+      int nc = (*it)->getNumConstraint(prob.t);
+      if(nc == 0)
+      {
+        continue;
+      }
+      VectorXd lb(nc), ub(nc);
+      (*it)->bounds(prob.t,lb,ub);
+      lb_blocks.push_back(lb);
+      ub_blocks.push_back(ub);
+      VectorXi iAfun, jAvar;
+      VectorXd A;
+      (*it)->geval(prob.t,iAfun,jAvar,A);
+      for(int k = 0;k<A.size();k++)
+      {
+        prob.A(lin_row+iAfun(k),jAvar(k)) += A(k);
+      }
+      lin_row += nc;
+      if(debug_mode)
+      {
+        (*it)->name(prob.t,prob.c_name);
+      }
+    }
+    if(prob.qsc)
+    {
+      prob.A.block(lin_row,nq,1,num_qsc_pts).setOnes();
+      lb_blocks.push_back(VectorXd::Ones(1));
+      ub_blocks.push_back(VectorXd::Ones(1));
+      if(debug_mode)
+      {
+        prob.c_name.push_back("quasi static constraint weights");
+      }
+    }
+    prob.c_lb.resize(num_nonlinear_constraints+num_linear_constraints);
+    prob.c_ub.resize(num_nonlinear_constraints+num_linear_constraints);
+    int nc_accum = 0;
+    for(size_t j = 0;j<lb_blocks.size();j++)
+    {
+      prob.c_lb.segment(nc_accum,lb_blocks[j].size()) = lb_blocks[j];
+      prob.c_ub.segment(nc_accum,ub_blocks[j].size()) = ub_blocks[j];
+      nc_accum += static_cast<int>(lb_blocks[j].size());
+    }
+
+    VectorXd x(prob.nx);
+    if(sequentialSeedFlag && i%block_size != 0 && INFO[i-1]<=10)
+    {
+      x.head(nq) = q_sol.col(i-1);
+    }
+    else
+    {
+      x.head(nq) = q_seed.col(i);
+    }
+    if(num_qsc_pts>0)
+    {
+      x.tail(num_qsc_pts).setConstant(1.0/num_qsc_pts);
+    }
+
+    INFO[i] = solveIKSQP(prob,ikoptions,x);
+
+    VectorXd c;
+    MatrixXd dc;
+    evalIKSQPConstraints(prob,x,c,dc);
+    VectorXd violation = IKSQPConstraintViolation(prob,c);
+    if(maxCoeffOrZero(violation)>1e-4)
+    {
+      if(debug_mode)
+      {
+        for(int j = 0;j<violation.size();j++)
+        {
+          if(violation(j)>5e-5)
+          {
+            infeasible_constraint_samples[i].push_back(prob.c_name[j]);
+          }
+        }
+      }
+    }
+    else if(INFO[i] == 13)
+    {
+      INFO[i] = 4;
+    }
+    else if(INFO[i] == 32)
+    {
+      INFO[i] = 6;
+    }
+    q_sol.col(i) = x.head(nq);
+    if(INFO[i]<10)
+    {
+      q_sol.col(i) = q_sol.col(i).cwiseMax(prob.x_lb.head(nq)).cwiseMin(prob.x_ub.head(nq));
+    }
+  };
+
+  int num_blocks = (nT+block_size-1)/block_size;
+  std::atomic<int> next_block(0);
+  auto solveBlocks = [&]()
+  {
+    for(int block = next_block++;block<num_blocks;block = next_block++)
+    {
+      for(int i = block*block_size;i<std::min((block+1)*block_size,nT);i++)
+      {
+        solveSample(i);
+      }
+    }
+  };
+  int num_threads = std::max(1,std::min(ikoptions.getNumThreads(),num_blocks));
+  vector<std::thread> threads;
+  for(int i = 1;i<num_threads;i++)
+  {
+    threads.push_back(std::thread(solveBlocks));
+  }
+  solveBlocks();
+  for(auto it = threads.begin();it != threads.end();++it)
+  {
+    it->join();
+  }
+
+  for(int i = 0;i<nT;i++)
+  {
+    infeasible_constraint.insert(infeasible_constraint.end(),infeasible_constraint_samples[i].begin(),infeasible_constraint_samples[i].end());
+  }
+}
+
+template void inverseKinSQPBackend(RigidBodyTree * model, const int nT, const double* t, const MatrixBase<Map<MatrixXd>> &q_seed, const MatrixBase<Map<MatrixXd>> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<Map<MatrixXd>> &q_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
+template void inverseKinSQPBackend(RigidBodyTree * model, const int nT, const double* t, const MatrixBase<MatrixXd> &q_seed, const MatrixBase<MatrixXd> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<MatrixXd> &q_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
+template void inverseKinSQPBackend(RigidBodyTree * model, const int nT, const double* t, const MatrixBase<Map<VectorXd>> &q_seed, const MatrixBase<Map<VectorXd>> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<Map<VectorXd>> &q_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
+template void inverseKinSQPBackend(RigidBodyTree * model, const int nT, const double* t, const MatrixBase<VectorXd> &q_seed, const MatrixBase<VectorXd> &q_nom, const int num_constraints, RigidBodyConstraint** const constraint_array, MatrixBase<VectorXd> &q_sol, int* INFO, vector<string> &infeasible_constraint, const IKoptions &ikoptions);
@@ -84,9 +84,9 @@ public:
   };
 
   template <typename DerivedV>
-  Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1> frictionTorque(const Eigen::MatrixBase<DerivedV> & v) const {
+  Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1, 0, DrakeJoint::MAX_NUM_VELOCITIES, 1> frictionTorque(const Eigen::MatrixBase<DerivedV> & v) const {
     typedef typename DerivedV::Scalar Scalar;
-    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> ret(getNumVelocities(), 1);
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1, 0, DrakeJoint::MAX_NUM_VELOCITIES, 1> ret(getNumVelocities(), 1);
     using std::abs;
     ret[0] = damping * v[0];
     Scalar coulomb_window_fraction = v[0] / coulomb_window;
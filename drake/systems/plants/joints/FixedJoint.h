@@ -69,9 +69,9 @@ public:
   };
 
   template <typename DerivedV>
-  Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1> frictionTorque(const Eigen::MatrixBase<DerivedV> &v) const
+  Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1, 0, MAX_NUM_VELOCITIES, 1> frictionTorque(const Eigen::MatrixBase<DerivedV> &v) const
   {
-    return Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1>(getNumVelocities(), 1);
+    return Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1, 0, MAX_NUM_VELOCITIES, 1>(getNumVelocities(), 1);
   }
 
     virtual std::string getPositionName(int index) const;
@@ -123,9 +123,9 @@ public:
   };
 
   template <typename DerivedV>
-  Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1> frictionTorque(const Eigen::MatrixBase<DerivedV> & v) const
+  Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1, 0, DrakeJoint::MAX_NUM_VELOCITIES, 1> frictionTorque(const Eigen::MatrixBase<DerivedV> & v) const
   {
-    return Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1>::Zero(getNumVelocities(), 1);
+    return Eigen::Matrix<typename DerivedV::Scalar, Eigen::Dynamic, 1, 0, DrakeJoint::MAX_NUM_VELOCITIES, 1>::Zero(getNumVelocities(), 1);
   }
 
   virtual bool isFloating() const { return true; };
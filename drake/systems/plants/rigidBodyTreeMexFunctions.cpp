@@ -53,10 +53,16 @@ void centerOfMassmex(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
   mexTryToCallFunctions(nlhs, plhs, nrhs, prhs, true, func_double, func_autodiff_fixed_max, func_autodiff_dynamic);
 }
 
+template <typename Scalar>
+Matrix<Scalar, SPACE_DIMENSION, Eigen::Dynamic> centerOfMassJacobianTemp(const RigidBodyTree &model, KinematicsCache<Scalar> &cache, const std::set<int> &robotnum, bool in_terms_of_qdot) {
+  // picks the overload that returns the Jacobian
+  return model.centerOfMassJacobian(cache, robotnum, in_terms_of_qdot);
+};
+
 void centerOfMassJacobianmex(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-  auto func_double = make_function(&RigidBodyTree::centerOfMassJacobian<double>);
-  auto func_autodiff_fixed_max = make_function(&RigidBodyTree::centerOfMassJacobian<AutoDiffFixedMaxSize>);
-  auto func_autodiff_dynamic = make_function(&RigidBodyTree::centerOfMassJacobian<AutoDiffDynamicSize>);
+  auto func_double = make_function(&centerOfMassJacobianTemp<double>);
+  auto func_autodiff_fixed_max = make_function(&centerOfMassJacobianTemp<AutoDiffFixedMaxSize>);
+  auto func_autodiff_dynamic = make_function(&centerOfMassJacobianTemp<AutoDiffDynamicSize>);
   mexTryToCallFunctions(nlhs, plhs, nrhs, prhs, true, func_double, func_autodiff_fixed_max, func_autodiff_dynamic);
 }
 
@@ -67,10 +73,16 @@ void centroidalMomentumMatrixDotTimesvmex(int nlhs, mxArray *plhs[], int nrhs, c
   mexTryToCallFunctions(nlhs, plhs, nrhs, prhs, true, func_double, func_autodiff_fixed_max, func_autodiff_dynamic);
 }
 
+template <typename Scalar>
+Matrix<Scalar, TWIST_SIZE, Eigen::Dynamic> centroidalMomentumMatrixTemp(const RigidBodyTree &model, KinematicsCache<Scalar> &cache, const std::set<int> &robotnum, bool in_terms_of_qdot) {
+  // picks the overload that returns the matrix
+  return model.centroidalMomentumMatrix(cache, robotnum, in_terms_of_qdot);
+};
+
 void centroidalMomentumMatrixmex(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-  auto func_double = make_function(&RigidBodyTree::centroidalMomentumMatrix<double>);
-  auto func_autodiff_fixed_max = make_function(&RigidBodyTree::centroidalMomentumMatrix<AutoDiffFixedMaxSize>);
-  auto func_autodiff_dynamic = make_function(&RigidBodyTree::centroidalMomentumMatrix<AutoDiffDynamicSize>);
+  auto func_double = make_function(&centroidalMomentumMatrixTemp<double>);
+  auto func_autodiff_fixed_max = make_function(&centroidalMomentumMatrixTemp<AutoDiffFixedMaxSize>);
+  auto func_autodiff_dynamic = make_function(&centroidalMomentumMatrixTemp<AutoDiffDynamicSize>);
   mexTryToCallFunctions(nlhs, plhs, nrhs, prhs, true, func_double, func_autodiff_fixed_max, func_autodiff_dynamic);
 }
 
@@ -158,10 +170,16 @@ void geometricJacobianmex(int nlhs, mxArray *plhs[], int nrhs, const mxArray *pr
   mexTryToCallFunctions(nlhs, plhs, nrhs, prhs, true, func_double, func_autodiff_fixed_max, func_autodiff_dynamic);
 }
 
+template <typename Scalar>
+Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> massMatrixTemp(const RigidBodyTree &model, KinematicsCache<Scalar> &cache) {
+  // picks the overload that returns the mass matrix
+  return model.massMatrix(cache);
+};
+
 void massMatrixmex(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-  auto func_double = make_function(&RigidBodyTree::massMatrix<double>);
-  auto func_autodiff_fixed_max = make_function(&RigidBodyTree::massMatrix<AutoDiffFixedMaxSize>);
-  auto func_autodiff_dynamic = make_function(&RigidBodyTree::massMatrix<AutoDiffDynamicSize>);
+  auto func_double = make_function(&massMatrixTemp<double>);
+  auto func_autodiff_fixed_max = make_function(&massMatrixTemp<AutoDiffFixedMaxSize>);
+  auto func_autodiff_dynamic = make_function(&massMatrixTemp<AutoDiffDynamicSize>);
   mexTryToCallFunctions(nlhs, plhs, nrhs, prhs, true, func_double, func_autodiff_fixed_max, func_autodiff_dynamic);
 }
 
@@ -0,0 +1,59 @@
+#include "RigidBodyTree.h"
+#include "testUtil.h"
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Casts a 100k ray depth image (like a simulated depth sensor 2 m in front of the robot) against the Atlas collision
+ * model, for increasing numbers of threads.
+ */
+void castRays(RigidBodyTree& model, const KinematicsCache<double>& cache, const Matrix3Xd& origins, const Matrix3Xd& ray_endpoints, VectorXd& distances, int num_threads) {
+  model.collisionRaycast(cache, origins, ray_endpoints, distances, false, num_threads);
+}
+
+int main() {
+  RigidBodyTree model("examples/Atlas/urdf/atlas_convex_hull.urdf");
+  VectorXd q = VectorXd::Zero(model.num_positions);
+  q(2) = 0.85;
+  KinematicsCache<double> cache = model.doKinematics(q);
+
+  int width = 400;
+  int height = 250;
+  int nrays = width * height;
+  double range = 10.0;
+  Vector3d sensor_position(2.0, 0.0, 1.0);
+  Matrix3Xd origins = sensor_position.replicate(1, nrays);
+  Matrix3Xd ray_endpoints(3, nrays);
+  for (int row = 0; row < height; row++) {
+    for (int col = 0; col < width; col++) {
+      double yaw = M_PI / 4 * (2.0 * col / (width - 1) - 1.0);
+      double pitch = M_PI / 6 * (2.0 * row / (height - 1) - 1.0);
+      Vector3d direction(-cos(pitch) * cos(yaw), -cos(pitch) * sin(yaw), sin(pitch));
+      ray_endpoints.col(row * width + col) = sensor_position + range * direction;
+    }
+  }
+
+  VectorXd distances_serial;
+  castRays(model, cache, origins, ray_endpoints, distances_serial, 1);
+  cout << "hits: " << (distances_serial.array() >= 0).count() << " of " << nrays << " rays" << endl;
+
+  int ntests = 10;
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    VectorXd distances;
+    auto time = measure<>::execution([&]() {
+      for (int i = 0; i < ntests; i++) {
+        castRays(model, cache, origins, ray_endpoints, distances, num_threads);
+      }
+    });
+    if (distances != distances_serial) {
+      cerr << "raycast with " << num_threads << " threads differs from the serial result" << endl;
+      return 1;
+    }
+    cout << num_threads << " thread(s): " << time / static_cast<double>(ntests) << " ms" << endl;
+  }
+
+  return 0;
+}
@@ -52,6 +52,42 @@ void scenario2(const RigidBodyTree &model, KinematicsCache<Scalar>& cache, const
   }
 }
 
+template <typename Scalar>
+void scenario3(const RigidBodyTree &model, KinematicsCache<Scalar>& cache, const vector<pair<Matrix<Scalar, Dynamic, 1>, Matrix<Scalar, Dynamic, 1>>>& states, bool articulated_body) {
+  const eigen_aligned_unordered_map<RigidBody const *, Matrix<Scalar, TWIST_SIZE, 1> > f_ext;
+  Matrix<Scalar, Dynamic, 1> tau = Matrix<Scalar, Dynamic, 1>::Zero(model.num_velocities);
+  for (const auto& state : states) {
+    cache.initialize(state.first, state.second);
+    model.doKinematics(cache, true);
+    Matrix<Scalar, Dynamic, 1> vd;
+    if (articulated_body) {
+      vd = model.forwardDynamics(cache, tau, f_ext);
+    }
+    else {
+      auto H = model.massMatrix(cache);
+      auto C = model.dynamicsBiasTerm(cache, f_ext);
+      vd = H.ldlt().solve(tau - C);
+    }
+    if (uniform(generator) < 1e-15) { // print with some probability to avoid optimizing away
+      printMatrix<decltype(vd)::RowsAtCompileTime, decltype(vd)::ColsAtCompileTime>(vd); // MSVC 2013 can't infer rows and cols (ICE)
+    }
+  }
+}
+
+template <typename Scalar>
+void scenario4(const RigidBodyTree &model, KinematicsCache<Scalar>& cache, const vector<pair<Matrix<Scalar, Dynamic, 1>, Matrix<Scalar, Dynamic, 1>>>& states) {
+  for (const auto& state : states) {
+    cache.initialize(state.first, state.second);
+    model.doKinematics(cache, true);
+    for (int body_index = 1; body_index < model.bodies.size(); body_index++) {
+      auto J = model.geometricJacobian(cache, 0, body_index, 0);
+      if (uniform(generator) < 1e-15) { // print with some probability to avoid optimizing away
+        printMatrix<decltype(J)::RowsAtCompileTime, decltype(J)::ColsAtCompileTime>(J); // MSVC 2013 can't infer rows and cols (ICE)
+      }
+    }
+  }
+}
+
 void testScenario1(const RigidBodyTree & model) {
 
   int ntests = 1000;
@@ -141,10 +177,75 @@ void testScenario2(const RigidBodyTree & model) {
   cout << endl;
 }
 
+void testScenario3(const RigidBodyTree & model) {
+  int ntests = 1000;
+
+  vector<pair<VectorXd, VectorXd>> states_double;
+  for (int i = 0; i < ntests; i++) {
+    VectorXd q = VectorXd::Random(model.num_positions);
+    VectorXd v = VectorXd::Random(model.num_velocities);
+    states_double.push_back(make_pair(q, v));
+  }
+
+  KinematicsCache<double> cache_double(model.bodies);
+
+  cout << "scenario 3:" << endl;
+  cout << "mass matrix + LDLT: " << measure<>::execution(scenario3<double>, model, cache_double, states_double, false) / static_cast<double>(ntests) << " ms" << endl;
+  cout << "articulated body algorithm: " << measure<>::execution(scenario3<double>, model, cache_double, states_double, true) / static_cast<double>(ntests) << " ms" << endl;
+  cout << endl;
+}
+
+void testScenario4(const RigidBodyTree & model) {
+  int ntests = 1000;
+
+  vector<pair<VectorXd, VectorXd>> states_double;
+  for (int i = 0; i < ntests; i++) {
+    VectorXd q = VectorXd::Random(model.num_positions);
+    VectorXd v = VectorXd::Random(model.num_velocities);
+    states_double.push_back(make_pair(q, v));
+  }
+
+  KinematicsCache<double> cache_double(model.bodies);
+
+  cout << "scenario 4:" << endl;
+  cout << "doKinematics + geometricJacobian for all bodies: " << measure<std::chrono::microseconds>::execution(scenario4<double>, model, cache_double, states_double) / static_cast<double>(ntests) << " us" << endl;
+  cout << endl;
+}
+
+void scenario5(const RigidBodyTree &model, KinematicsCache<double>& cache, const MatrixXd& qs) {
+  for (int i = 0; i < qs.cols(); i++) {
+    cache.initialize(qs.col(i));
+    model.doKinematics(cache, false);
+  }
+}
+
+void scenario5Batch(const RigidBodyTree &model, const MatrixXd& qs, int num_threads) {
+  vector<Matrix<double, Dynamic, 12>> body_transforms;
+  model.forwardKinBatch(qs, body_transforms, num_threads);
+  if (uniform(generator) < 1e-15) { // print with some probability to avoid optimizing away
+    cout << body_transforms.back().row(0) << endl;
+  }
+}
+
+void testScenario5(const RigidBodyTree & model) {
+  int ntests = 10000;
+  MatrixXd qs = MatrixXd::Random(model.num_positions, ntests);
+  KinematicsCache<double> cache_double(model.bodies);
+
+  cout << "scenario 5:" << endl;
+  cout << "doKinematics per configuration: " << measure<std::chrono::microseconds>::execution(scenario5, model, cache_double, qs) / static_cast<double>(ntests) << " us" << endl;
+  cout << "forwardKinBatch, 1 thread: " << measure<std::chrono::microseconds>::execution(scenario5Batch, model, qs, 1) / static_cast<double>(ntests) << " us" << endl;
+  cout << "forwardKinBatch, 4 threads: " << measure<std::chrono::microseconds>::execution(scenario5Batch, model, qs, 4) / static_cast<double>(ntests) << " us" << endl;
+  cout << endl;
+}
+
 int main() {
   RigidBodyTree model("examples/Atlas/urdf/atlas_minimal_contact.urdf");
   testScenario1(model);
   testScenario2(model);
+  testScenario3(model);
+  testScenario4(model);
+  testScenario5(model);
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "RigidBodyTree.h"
+#include "testUtil.h"
+#include <iostream>
+#include <memory>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Checks the compact Jacobians from forwardKinJacobian, geometricJacobian and computeContactJacobians against finite
+ * differences and their dense counterparts, and the compact products against the same products with the full Jacobian.
+ */
+
+MatrixXd forwardKinJacobianFiniteDifference(const RigidBodyTree& model, const VectorXd& q, const Matrix3Xd& points, int body, int rotation_type)
+{
+  const double h = 1e-7;
+  KinematicsCache<double> cache(model.bodies);
+  cache.initialize(q);
+  model.doKinematics(cache);
+  MatrixXd x = model.forwardKin(cache, points, body, 0, rotation_type);
+  MatrixXd J(x.size(), q.size());
+  for (int i = 0; i < q.size(); i++) {
+    VectorXd q_perturbed = q;
+    q_perturbed(i) += h;
+    cache.initialize(q_perturbed);
+    model.doKinematics(cache);
+    MatrixXd x_perturbed = model.forwardKin(cache, points, body, 0, rotation_type);
+    MatrixXd dx = (x_perturbed - x) / h;
+    J.col(i) = Map<VectorXd>(dx.data(), dx.size());
+  }
+  return J;
+}
+
+template <typename Scalar, int Rows>
+void checkProducts(const CompactJacobian<Scalar, Rows>& J)
+{
+  MatrixXd J_full = J.toFull();
+  VectorXd v = VectorXd::Random(J.cols());
+  MatrixXd V = MatrixXd::Random(J.cols(), 3);
+  VectorXd f = VectorXd::Random(J.rows());
+  valuecheckMatrix(J_full * v, J.times(v), 1e-12);
+  valuecheckMatrix(J_full * V, J.times(V), 1e-12);
+  valuecheckMatrix(J_full.transpose() * f, J.transposeTimes(f), 1e-12);
+
+  // accumulation into something larger than cols(), as in the QP controller
+  VectorXd g = VectorXd::Random(J.cols() + 4);
+  VectorXd g_expected = g;
+  g_expected.head(J.cols()) += J_full.transpose() * f;
+  J.addTransposeTimes(f, g);
+  valuecheckMatrix(g_expected, g, 1e-12);
+
+  MatrixXd W = MatrixXd::Random(J.rows(), J.rows());
+  W = W * W.transpose();
+  VectorXd w = VectorXd::Random(J.rows()).cwiseAbs();
+  MatrixXd H = MatrixXd::Random(J.cols() + 4, J.cols() + 4);
+  MatrixXd H_expected = H;
+  H_expected.topLeftCorner(J.cols(), J.cols()) += J_full.transpose() * W * J_full + J_full.transpose() * w.asDiagonal() * J_full;
+  J.addTransposeTimesWTimes(W, H);
+  J.addTransposeTimesWTimes(w.asDiagonal(), H);
+  valuecheckMatrix(H_expected, H, 1e-10);
+}
+
+int main()
+{
+  std::unique_ptr<RigidBodyTree> model(new RigidBodyTree("examples/Atlas/urdf/atlas_minimal_contact.urdf"));
+  int l_foot = model->findLinkId("l_foot");
+  int r_foot = model->findLinkId("r_foot");
+  int l_hand = model->findLinkId("l_hand");
+
+  VectorXd q = 0.5 * VectorXd::Random(model->num_positions);
+  KinematicsCache<double> cache(model->bodies);
+  cache.initialize(q);
+  model->doKinematics(cache);
+
+  Matrix3Xd points = Matrix3Xd::Random(3, 4);
+  for (int rotation_type = 0; rotation_type < 2; rotation_type++) {
+    CompactJacobian<double> J;
+    model->forwardKinJacobian(cache, points, l_foot, 0, rotation_type, true, J);
+    if (J.cols() != model->num_positions || J.value.cols() >= model->num_positions)
+      throw runtime_error("forwardKinJacobian: the compact Jacobian of a foot should have fewer columns than the full one");
+    valuecheckMatrix(forwardKinJacobianFiniteDifference(*model, q, points, l_foot, rotation_type), J.toFull(), 1e-5);
+    valuecheckMatrix(model->forwardKinJacobian(cache, points, l_foot, 0, rotation_type, true), J.toFull(), 1e-12);
+    checkProducts(J);
+  }
+
+  CompactJacobian<double, TWIST_SIZE> J_geometric;
+  model->geometricJacobian(cache, 0, l_hand, l_hand, false, J_geometric);
+  std::vector<int> v_indices;
+  auto J_geometric_expected = model->geometricJacobian(cache, 0, l_hand, l_hand, false, &v_indices);
+  valuecheckMatrix(J_geometric_expected, J_geometric.value, 1e-12);
+  if (J_geometric.indices != v_indices || J_geometric.cols() != model->num_velocities)
+    throw runtime_error("geometricJacobian: wrong compact column indices");
+  checkProducts(J_geometric);
+
+  // contact pairs between the feet, and between the feet and the world
+  VectorXi idxA(3), idxB(3);
+  idxA << l_foot, r_foot, l_foot;
+  idxB << r_foot, 0, 0;
+  Matrix3Xd xA = Matrix3Xd::Random(3, 3);
+  Matrix3Xd xB = Matrix3Xd::Random(3, 3);
+  CompactJacobian<double> J_contact;
+  model->computeContactJacobians(cache, idxA, idxB, xA, xB, J_contact);
+  MatrixXd J_contact_expected(3 * idxA.size(), model->num_positions);
+  for (int i = 0; i < idxA.size(); i++) {
+    J_contact_expected.middleRows<3>(3 * i) = model->forwardKinJacobian(cache, Vector3d(xA.col(i)), idxA(i), 0, 0, true) - model->forwardKinJacobian(cache, Vector3d(xB.col(i)), idxB(i), 0, 0, true);
+  }
+  valuecheckMatrix(J_contact_expected, J_contact.toFull(), 1e-12);
+  MatrixXd J_contact_dense;
+  model->computeContactJacobians(cache, idxA, idxB, xA, xB, J_contact_dense);
+  valuecheckMatrix(J_contact_expected, J_contact_dense, 1e-12);
+  checkProducts(J_contact);
+
+  return 0;
+}
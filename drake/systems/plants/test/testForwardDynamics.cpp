@@ -0,0 +1,67 @@
+#include "RigidBodyTree.h"
+#include "testUtil.h"
+#include <iostream>
+#include <memory>
+
+using namespace std;
+using namespace Eigen;
+
+typedef DrakeJoint::AutoDiffFixedMaxSize AutoDiffFixedMaxSize;
+
+/*
+ * Checks the articulated-body forward dynamics against solving H * vd = tau - C with the composite rigid body mass matrix.
+ */
+void checkForwardDynamics(RigidBodyTree& model, const eigen_aligned_unordered_map<RigidBody const *, Matrix<double, TWIST_SIZE, 1> >& f_ext) {
+  int ntests = 20;
+  for (int i = 0; i < ntests; i++) {
+    VectorXd q = VectorXd::Random(model.num_positions);
+    VectorXd v = VectorXd::Random(model.num_velocities);
+    VectorXd tau = VectorXd::Random(model.num_velocities);
+
+    KinematicsCache<double> cache = model.doKinematics(q, v, true);
+    auto H = model.massMatrix(cache);
+    auto C = model.dynamicsBiasTerm(cache, f_ext);
+    VectorXd vd_expected = H.ldlt().solve(tau - C);
+
+    VectorXd vd = model.forwardDynamics(cache, tau, f_ext);
+    valuecheckMatrix(vd_expected, vd, 1e-8);
+  }
+}
+
+void checkForwardDynamicsAutoDiff(RigidBodyTree& model) {
+  int nx = model.num_positions + model.num_velocities;
+  VectorXd x = VectorXd::Random(nx);
+  VectorXd tau = VectorXd::Random(model.num_velocities);
+
+  auto x_autodiff = x.cast<AutoDiffFixedMaxSize>().eval();
+  MatrixXd grad = MatrixXd::Identity(nx, nx);
+  gradientMatrixToAutoDiff(grad, x_autodiff);
+  Matrix<AutoDiffFixedMaxSize, Dynamic, 1> q = x_autodiff.topRows(model.num_positions);
+  Matrix<AutoDiffFixedMaxSize, Dynamic, 1> v = x_autodiff.bottomRows(model.num_velocities);
+  Matrix<AutoDiffFixedMaxSize, Dynamic, 1> tau_autodiff = tau.cast<AutoDiffFixedMaxSize>();
+
+  KinematicsCache<AutoDiffFixedMaxSize> cache = model.doKinematics(q, v, true);
+  const eigen_aligned_unordered_map<RigidBody const *, Matrix<AutoDiffFixedMaxSize, TWIST_SIZE, 1> > f_ext;
+  auto H = model.massMatrix(cache);
+  auto C = model.dynamicsBiasTerm(cache, f_ext);
+  Matrix<AutoDiffFixedMaxSize, Dynamic, 1> vd_expected = H.inverse() * (tau_autodiff - C);
+  auto vd = model.forwardDynamics(cache, tau_autodiff, f_ext);
+
+  valuecheckMatrix(autoDiffToValueMatrix(vd_expected), autoDiffToValueMatrix(vd), 1e-8);
+  valuecheckMatrix(autoDiffToGradientMatrix(vd_expected), autoDiffToGradientMatrix(vd), 1e-6);
+}
+
+int main() {
+  std::unique_ptr<RigidBodyTree> model(new RigidBodyTree("examples/Atlas/urdf/atlas_minimal_contact.urdf"));
+
+  eigen_aligned_unordered_map<RigidBody const *, Matrix<double, TWIST_SIZE, 1> > f_ext;
+  checkForwardDynamics(*model, f_ext);
+
+  f_ext[model->findLink("l_foot").get()] = Matrix<double, TWIST_SIZE, 1>::Random();
+  f_ext[model->findLink("r_hand").get()] = Matrix<double, TWIST_SIZE, 1>::Random();
+  checkForwardDynamics(*model, f_ext);
+
+  checkForwardDynamicsAutoDiff(*model);
+
+  return 0;
+}
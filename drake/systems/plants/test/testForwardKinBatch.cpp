@@ -0,0 +1,39 @@
+#include "RigidBodyTree.h"
+#include "testUtil.h"
+#include <iostream>
+#include <memory>
+
+using namespace std;
+using namespace Eigen;
+
+void checkForwardKinBatch(const RigidBodyTree& model, const MatrixXd& qs, int num_threads) {
+  vector<Matrix<double, Dynamic, 12>> body_transforms;
+  model.forwardKinBatch(qs, body_transforms, num_threads);
+
+  Vector3d point = Vector3d::Random();
+  int body_index = model.findLinkId("l_hand");
+  auto points = model.forwardKinBatchPoint(body_transforms, body_index, point);
+
+  KinematicsCache<double> cache(model.bodies);
+  for (int j = 0; j < qs.cols(); j++) {
+    cache.initialize(qs.col(j));
+    model.doKinematics(cache);
+    for (int i = 0; i < model.bodies.size(); i++) {
+      Matrix<double, 3, 4> expected = cache.getElement(*model.bodies[i]).transform_to_world.matrix().topRows<3>();
+      Matrix<double, 3, 4> actual = Map<const Matrix<double, 3, 4>>(Matrix<double, 1, 12>(body_transforms[i].row(j)).data());
+      valuecheckMatrix(expected, actual, 1e-12);
+    }
+    Vector3d point_expected = cache.getElement(*model.bodies[body_index]).transform_to_world * point;
+    valuecheckMatrix(point_expected, Vector3d(points.row(j).transpose()), 1e-12);
+  }
+}
+
+int main() {
+  std::unique_ptr<RigidBodyTree> model(new RigidBodyTree("examples/Atlas/urdf/atlas_minimal_contact.urdf"));
+
+  MatrixXd qs = MatrixXd::Random(model->num_positions, 101);
+  checkForwardKinBatch(*model, qs, 1);
+  checkForwardKinBatch(*model, qs, 4);
+
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include "RigidBodyTree.h"
+#include "drakeGeometryUtil.h"
+#include "testUtil.h"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <thread>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Checks geometricJacobian with cached kinematic paths against the Jacobian assembled from findKinematicPath, from
+ * several threads at once, and checks that the variant writing into caller-provided buffers doesn't allocate once the
+ * buffers have been used for the same path (heap allocations made through operator new are counted, Eigen's are
+ * caught by checking that J keeps its storage).
+ */
+
+static bool count_allocations = false;
+static int num_allocations = 0;
+
+void* operator new(size_t size)
+{
+  if (count_allocations)
+    num_allocations++;
+  void* ptr = malloc(size);
+  if (!ptr)
+    throw bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+Matrix<double, TWIST_SIZE, Dynamic> referenceGeometricJacobian(const RigidBodyTree& model, const KinematicsCache<double>& cache, int base, int end_effector, int expressed_in, bool in_terms_of_qdot, vector<int>& indices)
+{
+  KinematicPath path = model.findKinematicPath(base, end_effector);
+  Matrix<double, TWIST_SIZE, Dynamic> J(TWIST_SIZE, 0);
+  indices.clear();
+  for (size_t i = 0; i < path.joint_path.size(); i++) {
+    const RigidBody& body = *model.bodies[path.joint_path[i]];
+    const auto& element = cache.getElement(body);
+    MatrixXd block = path.joint_direction_signs[i] * element.motion_subspace_in_world;
+    if (in_terms_of_qdot)
+      block = block * element.qdot_to_v;
+    J.conservativeResize(NoChange, J.cols() + block.cols());
+    J.rightCols(block.cols()) = block;
+    int start = in_terms_of_qdot ? body.position_num_start : body.velocity_num_start;
+    for (int j = 0; j < block.cols(); j++)
+      indices.push_back(start + j);
+  }
+  return transformSpatialMotion(model.relativeTransform(cache, expressed_in, 0), J);
+}
+
+int main()
+{
+  std::unique_ptr<RigidBodyTree> model(new RigidBodyTree("examples/Atlas/urdf/atlas_minimal_contact.urdf"));
+  int nbodies = static_cast<int>(model->bodies.size());
+
+  KinematicsCache<double> cache(model->bodies);
+  VectorXd q = VectorXd::Random(model->num_positions);
+  cache.initialize(q);
+  model->doKinematics(cache);
+
+  int world = 0;
+  int pelvis = model->findLinkId("pelvis");
+  int l_foot = model->findLinkId("l_foot");
+  int r_hand = model->findLinkId("r_hand");
+  vector<array<int, 3>> cases = { {{world, l_foot, world}}, {{world, r_hand, pelvis}}, {{l_foot, r_hand, world}}, {{r_hand, l_foot, l_foot}}, {{pelvis, pelvis, world}} };
+
+  for (const auto& c : cases) {
+    for (bool in_terms_of_qdot : {false, true}) {
+      vector<int> indices, indices_expected;
+      auto J = model->geometricJacobian(cache, c[0], c[1], c[2], in_terms_of_qdot, &indices);
+      auto J_expected = referenceGeometricJacobian(*model, cache, c[0], c[1], c[2], in_terms_of_qdot, indices_expected);
+      valuecheckMatrix(J_expected, J, 1e-12);
+      if (indices != indices_expected)
+        throw runtime_error("geometricJacobian: wrong column indices");
+    }
+  }
+
+  // every pair of bodies, with the paths being computed and cached concurrently
+  vector<thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&]() {
+      vector<int> indices;
+      for (int base = 0; base < nbodies; base++) {
+        for (int body = 0; body < nbodies; body++) {
+          auto J = model->geometricJacobian(cache, base, body, 0, false, &indices);
+          const KinematicPath& path = model->cachedKinematicPath(base, body).path;
+          if (indices.size() != J.cols() || path.joint_path.size() != model->findKinematicPath(base, body).joint_path.size())
+            throw runtime_error("geometricJacobian: inconsistent cached path");
+        }
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  // steady state of a controller: the same Jacobians over and over
+  Matrix<double, TWIST_SIZE, Dynamic> J;
+  vector<int> indices;
+  model->geometricJacobian(cache, world, l_foot, pelvis, true, J, &indices);
+  const double* J_data = J.data();
+  count_allocations = true;
+  for (int i = 0; i < 10; i++)
+    model->geometricJacobian(cache, world, l_foot, pelvis, true, J, &indices);
+  count_allocations = false;
+  if (num_allocations > 0 || J.data() != J_data) {
+    cerr << num_allocations << " heap allocations in geometricJacobian with reused buffers" << endl;
+    return 1;
+  }
+
+  return 0;
+}
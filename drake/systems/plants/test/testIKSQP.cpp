@@ -0,0 +1,234 @@
+#include "RigidBodyIK.h"
+#include "RigidBodyTree.h"
+#include "../constraint/RigidBodyConstraint.h"
+#include "../IKoptions.h"
+#include "testUtil.h"
+#include <iostream>
+#include <set>
+#include <thread>
+#include <Eigen/Dense>
+
+using namespace std;
+using namespace Eigen;
+
+/*
+ * Exercises the SNOPT-free SQP solver, including several solves running concurrently on the same model.
+ */
+int main()
+{
+  RigidBodyTree model("examples/Atlas/urdf/atlas_minimal_contact.urdf");
+
+  Vector2d tspan;
+  tspan<<0,1;
+  VectorXd q0 = VectorXd::Zero(model.num_positions);
+  q0(2) = 0.8;
+
+  Vector3d com_lb = Vector3d::Zero();
+  Vector3d com_ub = Vector3d::Zero();
+  com_lb(2) = 0.9;
+  com_ub(2) = 1.0;
+  WorldCoMConstraint com_kc(&model,com_lb,com_ub,tspan);
+
+  int l_foot = model.findLinkId("l_foot");
+  Vector3d l_foot_pos(0.0,0.13,0.08);
+  WorldPositionConstraint lfoot_pos_kc(&model,l_foot,Vector3d::Zero(),l_foot_pos,l_foot_pos,tspan);
+
+  vector<RigidBodyConstraint*> constraint_array;
+  constraint_array.push_back(&com_kc);
+  constraint_array.push_back(&lfoot_pos_kc);
+  IKoptions ikoptions(&model);
+  ikoptions.setSolver(IKoptions::SQP);
+
+  // single solve
+  VectorXd q_sol(model.num_positions);
+  int info;
+  vector<string> infeasible_constraint;
+  inverseKin(&model,q0,q0,static_cast<int>(constraint_array.size()),constraint_array.data(),q_sol,info,infeasible_constraint,ikoptions);
+  printf("INFO = %d\n",info);
+  if(info != 1)
+  {
+    return 1;
+  }
+  KinematicsCache<double> cache = model.doKinematics(q_sol);
+  Vector3d com = model.centerOfMass(cache);
+  if(com(2)<0.9-1e-6 || com(2)>1.0+1e-6)
+  {
+    cerr<<"center of mass height "<<com(2)<<" violates the constraint"<<endl;
+    return 1;
+  }
+  auto l_foot_pos_sol = model.forwardKin(cache,Vector3d::Zero().eval(),l_foot,0,0);
+  valuecheckMatrix(l_foot_pos,l_foot_pos_sol,1e-6);
+  for(int i = 0;i<model.num_positions;i++)
+  {
+    if(q_sol(i)<model.joint_limit_min(i) || q_sol(i)>model.joint_limit_max(i))
+    {
+      cerr<<"joint "<<i<<" violates its joint limits"<<endl;
+      return 1;
+    }
+  }
+
+  // concurrent solves from different seeds must match the sequential results
+  int num_solves = 8;
+  vector<VectorXd> q_seeds;
+  vector<VectorXd> q_sols_sequential(num_solves,VectorXd(model.num_positions));
+  vector<VectorXd> q_sols_concurrent(num_solves,VectorXd(model.num_positions));
+  vector<int> infos(num_solves);
+  for(int i = 0;i<num_solves;i++)
+  {
+    VectorXd q_seed = q0;
+    q_seed.tail(model.num_positions-6) += 0.1*VectorXd::Random(model.num_positions-6);
+    q_seeds.push_back(q_seed);
+    vector<string> infeasible;
+    inverseKin(&model,q_seeds[i],q0,static_cast<int>(constraint_array.size()),constraint_array.data(),q_sols_sequential[i],infos[i],infeasible,ikoptions);
+  }
+  vector<thread> threads;
+  vector<int> infos_concurrent(num_solves);
+  for(int i = 0;i<num_solves;i++)
+  {
+    threads.push_back(thread([&, i]() {
+      vector<string> infeasible;
+      inverseKin(&model,q_seeds[i],q0,static_cast<int>(constraint_array.size()),constraint_array.data(),q_sols_concurrent[i],infos_concurrent[i],infeasible,ikoptions);
+    }));
+  }
+  for(auto& thread : threads)
+  {
+    thread.join();
+  }
+  for(int i = 0;i<num_solves;i++)
+  {
+    if(infos[i] != infos_concurrent[i])
+    {
+      cerr<<"concurrent solve "<<i<<" returned INFO = "<<infos_concurrent[i]<<", expected "<<infos[i]<<endl;
+      return 1;
+    }
+    valuecheckMatrix(q_sols_sequential[i],q_sols_concurrent[i],1e-12);
+  }
+
+  // collision constraints query leased copies of the collision model of the tree, concurrent solves with them must
+  // still match the sequential results. The right foot is confined to a box that it can only reach in part without
+  // coming closer to the left foot than min_distance
+  int r_foot = model.findLinkId("r_foot");
+  Vector3d r_foot_lb(-0.2,-0.3,0.08);
+  Vector3d r_foot_ub(0.2,-0.1,0.08);
+  WorldPositionConstraint rfoot_pos_kc(&model,r_foot,Vector3d::Zero(),r_foot_lb,r_foot_ub,tspan);
+  double min_distance = 0.2;
+  vector<int> feet_idx = {l_foot,r_foot};
+  MinDistanceConstraint min_distance_kc(&model,min_distance,feet_idx,set<string>(),tspan);
+  vector<RigidBodyConstraint*> collision_constraint_array = constraint_array;
+  collision_constraint_array.push_back(&rfoot_pos_kc);
+  collision_constraint_array.push_back(&min_distance_kc);
+  for(int i = 0;i<num_solves;i++)
+  {
+    vector<string> infeasible;
+    inverseKin(&model,q_seeds[i],q0,static_cast<int>(collision_constraint_array.size()),collision_constraint_array.data(),q_sols_sequential[i],infos[i],infeasible,ikoptions);
+    if(infos[i] != 1)
+    {
+      cerr<<"solve "<<i<<" with a MinDistanceConstraint returned INFO = "<<infos[i]<<endl;
+      return 1;
+    }
+    KinematicsCache<double> collision_cache = model.doKinematics(q_sols_sequential[i]);
+    VectorXd phi;
+    Matrix3Xd normal, xA, xB;
+    vector<int> idxA, idxB;
+    model.collisionDetect(collision_cache,phi,normal,xA,xB,idxA,idxB,feet_idx);
+    for(int j = 0;j<phi.size();j++)
+    {
+      if(phi(j)<min_distance-1e-3)
+      {
+        cerr<<"solve "<<i<<" leaves the feet "<<phi(j)<<" apart, closer than "<<min_distance<<endl;
+        return 1;
+      }
+    }
+  }
+  threads.clear();
+  for(int i = 0;i<num_solves;i++)
+  {
+    threads.push_back(thread([&, i]() {
+      vector<string> infeasible;
+      inverseKin(&model,q_seeds[i],q0,static_cast<int>(collision_constraint_array.size()),collision_constraint_array.data(),q_sols_concurrent[i],infos_concurrent[i],infeasible,ikoptions);
+    }));
+  }
+  for(auto& thread : threads)
+  {
+    thread.join();
+  }
+  for(int i = 0;i<num_solves;i++)
+  {
+    if(infos[i] != infos_concurrent[i])
+    {
+      cerr<<"concurrent solve "<<i<<" with a MinDistanceConstraint returned INFO = "<<infos_concurrent[i]<<", expected "<<infos[i]<<endl;
+      return 1;
+    }
+    valuecheckMatrix(q_sols_sequential[i],q_sols_concurrent[i],1e-12);
+  }
+
+  // pointwise
+  int nT = 3;
+  double t[3] = {0.0,0.5,1.0};
+  MatrixXd q0_pointwise = q0.replicate(1,nT);
+  MatrixXd q_sol_pointwise(model.num_positions,nT);
+  vector<int> info_pointwise(nT);
+  inverseKinPointwise(&model,nT,t,q0_pointwise,q0_pointwise,static_cast<int>(constraint_array.size()),constraint_array.data(),q_sol_pointwise,info_pointwise.data(),infeasible_constraint,ikoptions);
+  for(int i = 0;i<nT;i++)
+  {
+    printf("INFO[%d] = %d ",i,info_pointwise[i]);
+    if(info_pointwise[i] != 1)
+    {
+      return 1;
+    }
+  }
+  printf("\n");
+
+  // parallel pointwise solves must not depend on the number of threads, with or without sequential seeding. The
+  // collision constraint makes the samples share the collision model of the tree
+  nT = 40;
+  vector<double> t_long(nT);
+  MatrixXd q_seed_long(model.num_positions,nT);
+  for(int i = 0;i<nT;i++)
+  {
+    t_long[i] = static_cast<double>(i)/(nT-1);
+    q_seed_long.col(i) = q_seeds[i%num_solves];
+  }
+  MatrixXd q_nom_long = q0.replicate(1,nT);
+  int num_cnst = static_cast<int>(collision_constraint_array.size());
+  MatrixXd q_sol_unseeded(model.num_positions,nT);
+  for(int test_case = 0;test_case<3;test_case++)
+  {
+    // no sequential seeding, sequential seeding over all the samples, sequential seeding restarted every 8 samples
+    ikoptions.setSequentialSeedFlag(test_case>0);
+    ikoptions.setSequentialSeedBlockSize(test_case == 2 ? 8 : 0);
+    vector<MatrixXd> q_sols;
+    for(int num_threads = 1;num_threads<=4;num_threads *= 2)
+    {
+      MatrixXd q_sol_threads(model.num_positions,nT);
+      vector<int> info_threads(nT);
+      vector<string> infeasible_threads;
+      ikoptions.setNumThreads(num_threads);
+      inverseKinPointwise(&model,nT,t_long.data(),q_seed_long,q_nom_long,num_cnst,collision_constraint_array.data(),q_sol_threads,info_threads.data(),infeasible_threads,ikoptions);
+      for(int i = 0;i<nT;i++)
+      {
+        if(info_threads[i] != 1)
+        {
+          cerr<<"sample "<<i<<" returned INFO = "<<info_threads[i]<<" on "<<num_threads<<" threads"<<endl;
+          return 1;
+        }
+      }
+      q_sols.push_back(q_sol_threads);
+    }
+    if(test_case == 0)
+    {
+      q_sol_unseeded = q_sols[0];
+    }
+    valuecheckMatrix(q_sols[0],q_sols[1],1e-12);
+    valuecheckMatrix(q_sols[0],q_sols[2],1e-12);
+    if(test_case == 2)
+    {
+      // the first sample of every block is solved from its own seed, as without sequential seeding
+      for(int i = 0;i<nT;i += 8)
+      {
+        valuecheckMatrix(q_sol_unseeded.col(i),q_sols[0].col(i),1e-12);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+#include "RigidBodyTree.h"
+#include "testUtil.h"
+#include <iostream>
+#include <memory>
+
+using namespace std;
+using namespace Eigen;
+
+void checkElementsEqual(const RigidBodyTree& model, const KinematicsCache<double>& expected, const KinematicsCache<double>& actual, bool check_JdotV) {
+  for (const auto& body : model.bodies) {
+    const auto& element_expected = expected.getElement(*body);
+    const auto& element_actual = actual.getElement(*body);
+    valuecheckMatrix(element_expected.transform_to_world.matrix(), element_actual.transform_to_world.matrix(), 1e-12);
+    valuecheckMatrix(element_expected.motion_subspace_in_world, element_actual.motion_subspace_in_world, 1e-12);
+    valuecheckMatrix(element_expected.twist_in_world, element_actual.twist_in_world, 1e-12);
+    if (check_JdotV)
+      valuecheckMatrix(element_expected.motion_subspace_in_world_dot_times_v, element_actual.motion_subspace_in_world_dot_times_v, 1e-12);
+  }
+}
+
+int main() {
+  std::unique_ptr<RigidBodyTree> model(new RigidBodyTree("examples/Atlas/urdf/atlas_minimal_contact.urdf"));
+
+  KinematicsCache<double> cache_incremental(model->bodies);
+  cache_incremental.setIncrementalKinematics(true);
+
+  VectorXd q = VectorXd::Random(model->num_positions);
+  VectorXd v = VectorXd::Random(model->num_velocities);
+
+  int ntests = 50;
+  for (int i = 0; i < ntests; i++) {
+    // change only a few joints between calls
+    int num_changes = i % 3;
+    for (int j = 0; j < num_changes; j++) {
+      int index = rand() % model->num_positions;
+      q(index) += 0.1;
+      v(index % model->num_velocities) -= 0.1;
+    }
+    bool compute_JdotV = (i % 4) != 0;
+
+    cache_incremental.initialize(q, v);
+    // settings checks must still fail between initialize and doKinematics
+    try {
+      model->massMatrix(cache_incremental);
+      throw std::runtime_error("expected an error before doKinematics");
+    }
+    catch (std::runtime_error& e) {
+      if (std::string(e.what()).find("requires position kinematics") == std::string::npos)
+        throw;
+    }
+    model->doKinematics(cache_incremental, compute_JdotV);
+
+    KinematicsCache<double> cache_full = model->doKinematics(q, v, compute_JdotV);
+    checkElementsEqual(*model, cache_full, cache_incremental, compute_JdotV);
+  }
+
+  // switching between q only and q, v
+  cache_incremental.initialize(q);
+  model->doKinematics(cache_incremental);
+  KinematicsCache<double> cache_full = model->doKinematics(q);
+  for (const auto& body : model->bodies) {
+    valuecheckMatrix(cache_full.getElement(*body).transform_to_world.matrix(), cache_incremental.getElement(*body).transform_to_world.matrix(), 1e-12);
+  }
+
+  // exactly the bodies whose joint state changed, and their descendants, are recomputed
+  VectorXd q_single = VectorXd::Random(model->num_positions);
+  VectorXd v_single = VectorXd::Random(model->num_velocities);
+  cache_incremental.initialize(q_single, v_single);
+  model->doKinematics(cache_incremental);
+  if (cache_incremental.getNumUpdatedBodies() != static_cast<int>(model->bodies.size())) {
+    cerr << "the first call recomputed " << cache_incremental.getNumUpdatedBodies() << " of " << model->bodies.size() << " bodies" << endl;
+    return 1;
+  }
+  cache_incremental.initialize(q_single, v_single);
+  model->doKinematics(cache_incremental);
+  if (cache_incremental.getNumUpdatedBodies() != 0) {
+    cerr << "an unchanged q and v recomputed " << cache_incremental.getNumUpdatedBodies() << " bodies" << endl;
+    return 1;
+  }
+
+  for (const auto& changed_body : model->bodies) {
+    if (!changed_body->hasParent() || changed_body->getJoint().getNumPositions() == 0)
+      continue;
+
+    // the changed body and all bodies below it
+    auto isAffected = [&](const RigidBody& body) {
+      for (const RigidBody* ancestor = &body; ancestor != nullptr; ancestor = ancestor->parent.get()) {
+        if (ancestor == changed_body.get())
+          return true;
+      }
+      return false;
+    };
+    int num_affected = 0;
+    for (const auto& body : model->bodies) {
+      num_affected += isAffected(*body) ? 1 : 0;
+    }
+
+    for (int change_velocity = 0; change_velocity < 2; change_velocity++) {
+      if (change_velocity)
+        v_single(changed_body->velocity_num_start) += 0.1;
+      else
+        q_single(changed_body->position_num_start) += 0.1;
+      cache_incremental.initialize(q_single, v_single);
+      model->doKinematics(cache_incremental);
+      for (const auto& body : model->bodies) {
+        if (cache_incremental.wasBodyUpdated(*body) != isAffected(*body)) {
+          cerr << "changing the " << (change_velocity ? "velocity" : "position") << " of " << changed_body->linkname << (isAffected(*body) ? " did not recompute " : " recomputed ") << body->linkname << endl;
+          return 1;
+        }
+      }
+      if (cache_incremental.getNumUpdatedBodies() != num_affected) {
+        cerr << "changing the " << (change_velocity ? "velocity" : "position") << " of " << changed_body->linkname << " recomputed " << cache_incremental.getNumUpdatedBodies() << " bodies, expected " << num_affected << endl;
+        return 1;
+      }
+      checkElementsEqual(*model, model->doKinematics(q_single, v_single), cache_incremental, false);
+    }
+  }
+
+  return 0;
+}
@@ -51,13 +51,33 @@ void performChecks(RigidBodyTree &model, KinematicsCache<double> &cache, const C
 
   checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::centerOfMass<double>, cache, RigidBodyTree::default_robot_num_set);
   checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::forwardKin<double, PointsType>, cache, points, body_or_frame_ind, base_or_frame_ind, rotation_type);
-  checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::worldMomentumMatrix<double>, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot);
-  checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::centroidalMomentumMatrix<double>, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot);
-  checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::centerOfMassJacobian<double>, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot);
-  checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::geometricJacobian<double>, cache, base_or_frame_ind, body_or_frame_ind, expressed_in_frame_ind,
+  Matrix<double, TWIST_SIZE, Dynamic> (RigidBodyTree::*worldMomentumMatrix)(KinematicsCache<double>&, const std::set<int>&, bool) const = &RigidBodyTree::worldMomentumMatrix<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, worldMomentumMatrix, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot);
+  Matrix<double, TWIST_SIZE, Dynamic> A;
+  void (RigidBodyTree::*worldMomentumMatrixInPlace)(KinematicsCache<double>&, const std::set<int>&, bool, Matrix<double, TWIST_SIZE, Dynamic>&) const = &RigidBodyTree::worldMomentumMatrix<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, worldMomentumMatrixInPlace, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot, A);
+  Matrix<double, TWIST_SIZE, Dynamic> (RigidBodyTree::*centroidalMomentumMatrix)(KinematicsCache<double>&, const std::set<int>&, bool) const = &RigidBodyTree::centroidalMomentumMatrix<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, centroidalMomentumMatrix, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot);
+  void (RigidBodyTree::*centroidalMomentumMatrixInPlace)(KinematicsCache<double>&, const std::set<int>&, bool, Matrix<double, TWIST_SIZE, Dynamic>&) const = &RigidBodyTree::centroidalMomentumMatrix<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, centroidalMomentumMatrixInPlace, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot, A);
+  Matrix<double, SPACE_DIMENSION, Dynamic> (RigidBodyTree::*centerOfMassJacobian)(KinematicsCache<double>&, const std::set<int>&, bool) const = &RigidBodyTree::centerOfMassJacobian<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, centerOfMassJacobian, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot);
+  Matrix<double, SPACE_DIMENSION, Dynamic> Jcom;
+  void (RigidBodyTree::*centerOfMassJacobianInPlace)(KinematicsCache<double>&, const std::set<int>&, bool, Matrix<double, SPACE_DIMENSION, Dynamic>&) const = &RigidBodyTree::centerOfMassJacobian<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, centerOfMassJacobianInPlace, cache, RigidBodyTree::default_robot_num_set, in_terms_of_qdot, Jcom);
+  Matrix<double, TWIST_SIZE, Dynamic> (RigidBodyTree::*geometricJacobian)(const KinematicsCache<double>&, int, int, int, bool, std::vector<int>*) const = &RigidBodyTree::geometricJacobian<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, geometricJacobian, cache, base_or_frame_ind, body_or_frame_ind, expressed_in_frame_ind,
                  in_terms_of_qdot, &v_or_qdot_indices);
+  Matrix<double, TWIST_SIZE, Dynamic> J;
+  void (RigidBodyTree::*geometricJacobianInPlace)(const KinematicsCache<double>&, int, int, int, bool, Matrix<double, TWIST_SIZE, Dynamic>&, std::vector<int>*) const = &RigidBodyTree::geometricJacobian<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, geometricJacobianInPlace, cache, base_or_frame_ind, body_or_frame_ind, expressed_in_frame_ind,
+                 in_terms_of_qdot, J, &v_or_qdot_indices);
   checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::relativeTransform<double>, cache, base_or_frame_ind, body_or_frame_ind);
-  checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::massMatrix<double>, cache);
+  MatrixXd (RigidBodyTree::*massMatrix)(KinematicsCache<double>&) const = &RigidBodyTree::massMatrix<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, massMatrix, cache);
+  MatrixXd H;
+  void (RigidBodyTree::*massMatrixInPlace)(KinematicsCache<double>&, MatrixXd&) const = &RigidBodyTree::massMatrix<double>;
+  checkForErrors(settings.expect_error_on_configuration_methods, model, massMatrixInPlace, cache, H);
   checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::forwardKinPositionGradient<double>, cache, npoints, body_or_frame_ind, base_or_frame_ind);
   checkForErrors(settings.expect_error_on_configuration_methods, model, &RigidBodyTree::forwardKinJacobian<double, PointsType>, cache, points, body_or_frame_ind, base_or_frame_ind,
                  rotation_type, in_terms_of_qdot);
@@ -72,7 +92,11 @@ void performChecks(RigidBodyTree &model, KinematicsCache<double> &cache, const C
                  rotation_type);
   checkForErrors(settings.expect_error_on_jdot_times_v_methods, model, &RigidBodyTree::transformSpatialAcceleration<double>, cache, spatial_acceleration, base_or_frame_ind, body_or_frame_ind,
                  old_expressed_in_body_or_frame_ind, new_expressed_in_body_or_frame_ind);
-  checkForErrors(settings.expect_error_on_jdot_times_v_methods, model, &RigidBodyTree::dynamicsBiasTerm<double>, cache, f_ext);
+  VectorXd (RigidBodyTree::*dynamicsBiasTerm)(KinematicsCache<double>&, const eigen_aligned_unordered_map<RigidBody const *, Matrix<double, TWIST_SIZE, 1> >&) const = &RigidBodyTree::dynamicsBiasTerm<double>;
+  checkForErrors(settings.expect_error_on_jdot_times_v_methods, model, dynamicsBiasTerm, cache, f_ext);
+  VectorXd C;
+  void (RigidBodyTree::*dynamicsBiasTermInPlace)(KinematicsCache<double>&, const eigen_aligned_unordered_map<RigidBody const *, Matrix<double, TWIST_SIZE, 1> >&, VectorXd&) const = &RigidBodyTree::dynamicsBiasTerm<double>;
+  checkForErrors(settings.expect_error_on_jdot_times_v_methods, model, dynamicsBiasTermInPlace, cache, f_ext, C);
 }
 
 int main() {
@@ -119,5 +143,20 @@ int main() {
     performChecks(*model, cache, settings);
   }
 
+  // bodies of another tree, which has bodies with the same indices
+  {
+    RigidBodyTree other_model("examples/Atlas/urdf/atlas_minimal_contact.urdf");
+    KinematicsCache<double> cache = model->doKinematics(q);
+    bool caught = false;
+    try {
+      cache.getElement(*other_model.bodies[1]);
+    }
+    catch (out_of_range &e) {
+      caught = true;
+    }
+    if (!caught)
+      throw std::runtime_error("Expected an out_of_range error for a body of another tree, but did not catch one.");
+  }
+
   return 0;
 }
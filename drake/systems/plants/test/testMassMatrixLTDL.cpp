@@ -0,0 +1,55 @@
+#include "RigidBodyTree.h"
+#include "testUtil.h"
+#include <iostream>
+#include <memory>
+
+using namespace std;
+using namespace Eigen;
+
+void checkVelocityParents(const RigidBodyTree& model) {
+  auto velocity_parents = model.velocityParents();
+  for (int k = 0; k < model.num_velocities; k++) {
+    if (velocity_parents[k] >= k)
+      throw runtime_error("velocity parent must precede its child");
+  }
+}
+
+void checkMassMatrixLTDL(RigidBodyTree& model) {
+  int ntests = 20;
+  for (int i = 0; i < ntests; i++) {
+    VectorXd q = VectorXd::Random(model.num_positions);
+    KinematicsCache<double> cache = model.doKinematics(q);
+    auto H = model.massMatrix(cache);
+    auto factorization = model.massMatrixLTDL(cache);
+
+    // reconstruction
+    MatrixXd L = factorization.matrixL();
+    MatrixXd H_reconstructed = L.transpose() * factorization.vectorD().asDiagonal() * L;
+    valuecheckMatrix(H, H_reconstructed, 1e-10);
+
+    // L has the sparsity pattern of H
+    for (int row = 0; row < H.rows(); row++) {
+      for (int col = 0; col < row; col++) {
+        if (H(row, col) == 0.0 && L(row, col) != 0.0)
+          throw runtime_error("fill-in in L");
+      }
+    }
+
+    // solve
+    VectorXd b = VectorXd::Random(model.num_velocities);
+    valuecheckMatrix(H.ldlt().solve(b), factorization.solve(b), 1e-8);
+
+    // H^-1/2 products
+    MatrixXd identity = MatrixXd::Identity(model.num_velocities, model.num_velocities);
+    MatrixXd M = factorization.inverseSqrtTimes(identity);
+    valuecheckMatrix(H.inverse(), M * M.transpose(), 1e-8);
+    valuecheckMatrix(MatrixXd(M.transpose()), factorization.inverseSqrtTransposeTimes(identity), 1e-10);
+  }
+}
+
+int main() {
+  std::unique_ptr<RigidBodyTree> model(new RigidBodyTree("examples/Atlas/urdf/atlas_minimal_contact.urdf"));
+  checkVelocityParents(*model);
+  checkMassMatrixLTDL(*model);
+  return 0;
+}
@@ -475,8 +475,7 @@ void QPLocomotionPlan::updateSwingTrajectory(double t_plan, BodyMotionData& body
     x1.tail<3>() = quat2expmap(slerp(x0_quat, quat2_gradientvar.value(), 0.1), 0).value();
   }
 
-  // TODO: find a less expensive way of doing this
-  VectorXd xdf = trajectory.derivative().value(trajectory.getEndTime(landing_segment_index));
+  VectorXd xdf = trajectory.derivativeValue(trajectory.getEndTime(landing_segment_index));
 
   // Unwrap all of the knots in the trajectory to ensure we don't create a wraparound
   x1.tail<3>() = closestExpmap(x0.tail<3>(), x1.tail<3>(), 0).value();
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <iostream>
+#include "System.h"
+#include "Simulation.h"
+#include "testUtil.h"
+
+using namespace std;
+using namespace Drake;
+
+// undamped harmonic oscillator with state [q; v], q(t) = cos(omega t) for x0 = [1; 0]
+class Oscillator : public System<Oscillator,VectorBuilder<2>::VecType,UnusedVector,VectorBuilder<2>::VecType,false,false> {
+public:
+  Oscillator() : omega(2.0) {}
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> dynamicsImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    Eigen::Matrix<ScalarType,2,1> xdot;
+    xdot << x(1), -omega*omega*x(0);
+    return xdot;
+  }
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> outputImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    return x;
+  }
+
+  double omega;
+};
+
+// x2 tracks the slowly decaying x1 with a time constant of 1e-4 s, which makes explicit integrators unstable at
+// step sizes that resolve x1 easily
+class StiffDecay : public System<StiffDecay,VectorBuilder<2>::VecType,UnusedVector,VectorBuilder<2>::VecType,false,false> {
+public:
+  StiffDecay() : lambda(1e4) {}
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> dynamicsImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    Eigen::Matrix<ScalarType,2,1> xdot;
+    xdot << -x(0), -lambda*(x(1) - x(0));
+    return xdot;
+  }
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> outputImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    return x;
+  }
+
+  double lambda;
+};
+
+int main(int argc, char* argv[]) {
+  Oscillator sys;
+  Eigen::Vector2d x0(1.0, 0.0);
+  double tf = 10.0;
+  Eigen::Vector2d x_expected(cos(sys.omega*tf), -sys.omega*sin(sys.omega*tf));
+  auto energy = [&sys](const Eigen::Vector2d& x) { return 0.5*x(1)*x(1) + 0.5*sys.omega*sys.omega*x(0)*x(0); };
+
+  SimulationOptions options;
+  options.initial_step_size = 0.01;
+
+  options.integrator = RK4;
+  valuecheckMatrix(x_expected, simulate(sys,0,tf,x0,options), 1e-6);
+
+  options.integrator = RK45;
+  options.relative_tolerance = 1e-10;
+  options.absolute_tolerance = 1e-10;
+  options.max_step_size = 1.0;
+  valuecheckMatrix(x_expected, simulate(sys,0,tf,x0,options), 1e-6);
+
+  // semi-implicit Euler is only first order accurate, but it doesn't gain or lose energy over long horizons
+  options.integrator = SEMI_IMPLICIT_EULER;
+  Eigen::Vector2d xf = simulate(sys,0,100*tf,x0,options);
+  valuecheck(energy(x0), energy(xf), 0.05*energy(x0));
+
+  StiffDecay stiff;
+  Eigen::Vector2d x0_stiff(1.0, 0.0);
+  double tf_stiff = 1.0;
+  double a = stiff.lambda / (stiff.lambda - 1.0);
+  Eigen::Vector2d x_expected_stiff(exp(-tf_stiff), a*exp(-tf_stiff) - a*exp(-stiff.lambda*tf_stiff));
+  SimulationOptions stiff_options;
+  stiff_options.initial_step_size = 0.01;  // 100 times the fast time constant
+
+  stiff_options.integrator = BACKWARD_EULER;
+  valuecheckMatrix(x_expected_stiff, simulate(stiff,0,tf_stiff,x0_stiff,stiff_options), 1e-2);
+
+  stiff_options.integrator = BDF2;
+  valuecheckMatrix(x_expected_stiff, simulate(stiff,0,tf_stiff,x0_stiff,stiff_options), 1e-4);
+
+  return 0;
+}
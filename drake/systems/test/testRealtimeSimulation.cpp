@@ -0,0 +1,126 @@
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include "System.h"
+#include "Simulation.h"
+
+using namespace std;
+using namespace Drake;
+
+// first order decay that counts its output calls, and can be made to take a fixed amount of wall clock time per
+// dynamics evaluation
+class CountingDecay : public System<CountingDecay,VectorBuilder<1>::VecType,UnusedVector,VectorBuilder<1>::VecType,false,false> {
+public:
+  CountingDecay(double dynamics_time = 0.0) : dynamics_time(dynamics_time), num_outputs(0) {}
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,1,1> dynamicsImplementation(const Eigen::Matrix<ScalarType,1,1>& x) const {
+    if (dynamics_time > 0.0)
+      this_thread::sleep_for(chrono::duration<double>(dynamics_time));
+    return -x;
+  }
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,1,1> outputImplementation(const Eigen::Matrix<ScalarType,1,1>& x) const {
+    num_outputs++;
+    return x;
+  }
+
+  double dynamics_time;
+  mutable long num_outputs;
+};
+
+bool checkHistogram(const SimulationStats& stats, const string& name) {
+  long total = accumulate(stats.step_time_histogram.begin(),stats.step_time_histogram.end(),0L);
+  if (total != stats.num_steps) {
+    cerr << name << ": step time histogram counts " << total << " steps, but " << stats.num_steps << " were taken" << endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  Eigen::Matrix<double,1,1> x0;
+  x0 << 1.0;
+
+  {  // output rate decoupled from the step size
+    CountingDecay sys;
+    SimulationOptions options;
+    options.initial_step_size = 0.001;
+    options.output_period = 0.1;
+    SimulationStats stats;
+    simulate(sys,0.0,1.0,x0,options,stats);
+    if (stats.num_steps < 1000 || stats.num_steps > 1001 || !checkHistogram(stats,"output period"))
+      return 1;
+    if (stats.num_outputs != sys.num_outputs || stats.num_outputs < 10 || stats.num_outputs > 11) {
+      cerr << "output period: " << sys.num_outputs << " output calls (" << stats.num_outputs << " counted) for an output period of 0.1 over 1 second" << endl;
+      return 1;
+    }
+  }
+
+  // each step takes 2 ms, but has to be done in 1 ms to keep up
+  SimulationOptions options;
+  options.initial_step_size = 0.01;
+  options.realtime_factor = 10.0;
+  options.max_realtime_lag = 0.05;
+  double tf = 0.5;
+
+  {
+    CountingDecay sys(0.002);
+    options.realtime_overrun_policy = OVERRUN_THROW;
+    bool threw = false;
+    try {
+      simulate(sys,0.0,tf,x0,options);
+    } catch (const runtime_error&) {
+      threw = true;
+    }
+    if (!threw) {
+      cerr << "OVERRUN_THROW: no exception for a simulation that can't keep up" << endl;
+      return 1;
+    }
+  }
+
+  {
+    CountingDecay sys(0.002);
+    options.realtime_overrun_policy = OVERRUN_SKIP_OUTPUTS;
+    SimulationStats stats;
+    simulate(sys,0.0,tf,x0,options,stats);
+    if (!checkHistogram(stats,"OVERRUN_SKIP_OUTPUTS"))
+      return 1;
+    if (stats.num_overrun_steps == 0 || stats.num_outputs + stats.num_overrun_steps != stats.num_steps || sys.num_outputs != stats.num_outputs) {
+      cerr << "OVERRUN_SKIP_OUTPUTS: " << stats.num_outputs << " outputs and " << stats.num_overrun_steps << " overrun steps in " << stats.num_steps << " steps" << endl;
+      return 1;
+    }
+  }
+
+  {
+    CountingDecay sys(0.002);
+    options.realtime_overrun_policy = OVERRUN_SLOW_DOWN;
+    SimulationStats stats;
+    simulate(sys,0.0,tf,x0,options,stats);
+    if (!checkHistogram(stats,"OVERRUN_SLOW_DOWN"))
+      return 1;
+    // the lag is dropped every time it gets too large, so it stays bounded instead of growing for the whole run
+    if (stats.num_overrun_steps == 0 || stats.max_realtime_lag > 4*options.max_realtime_lag || stats.num_outputs != stats.num_steps) {
+      cerr << "OVERRUN_SLOW_DOWN: " << stats.num_overrun_steps << " overrun steps, max lag " << stats.max_realtime_lag << endl;
+      return 1;
+    }
+  }
+
+  {
+    CountingDecay sys(0.002);
+    options.realtime_overrun_policy = OVERRUN_LOG;
+    SimulationStats stats;
+    simulate(sys,0.0,tf,x0,options,stats);
+    if (!checkHistogram(stats,"OVERRUN_LOG"))
+      return 1;
+    if (stats.num_overrun_steps == 0 || stats.num_outputs != stats.num_steps) {
+      cerr << "OVERRUN_LOG: " << stats.num_overrun_steps << " overrun steps, " << stats.num_outputs << " outputs in " << stats.num_steps << " steps" << endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
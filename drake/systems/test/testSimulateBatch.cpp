@@ -0,0 +1,71 @@
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "System.h"
+#include "Simulation.h"
+#include "testUtil.h"
+
+using namespace std;
+using namespace Drake;
+
+// damped pendulum, with the damping as the perturbed parameter
+class DampedPendulum : public System<DampedPendulum,VectorBuilder<2>::VecType,UnusedVector,VectorBuilder<2>::VecType,false,false> {
+public:
+  DampedPendulum(double b) : b(b), num_output_calls(0) {}
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> dynamicsImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    Eigen::Matrix<ScalarType,2,1> xdot;
+    xdot << x(1), -9.81*sin(x(0)) - b*x(1);
+    return xdot;
+  }
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> outputImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    num_output_calls++;
+    return x;
+  }
+
+  double b;
+  mutable std::atomic<int> num_output_calls;
+};
+
+int main(int argc, char* argv[]) {
+  int num_runs = 100;
+  Eigen::MatrixXd x0s = Eigen::MatrixXd::Random(2, num_runs);
+  SimulationOptions options;
+  options.integrator = RK4;
+  options.initial_step_size = 0.005;
+
+  // shared system: every run has to match the serial simulation exactly
+  auto sys = make_shared<DampedPendulum>(0.1);
+  Eigen::MatrixXd xf = simulateBatch(sys,0,5,x0s,options,4);
+  for (int i = 0; i < num_runs; i++) {
+    Eigen::VectorXd x0 = x0s.col(i);
+    valuecheckMatrix(simulate(*sys,0,5,x0,options), xf.col(i), 0.0);
+  }
+
+  // perturbed parameters
+  vector<shared_ptr<DampedPendulum>> systems;
+  for (int i = 0; i < num_runs; i++)
+    systems.push_back(make_shared<DampedPendulum>(0.1 + 0.01*i));
+  xf = simulateBatch(systems,0,5,x0s,options);
+  for (int i = 0; i < num_runs; i++) {
+    Eigen::VectorXd x0 = x0s.col(i);
+    valuecheckMatrix(simulate(*systems[i],0,5,x0,options), xf.col(i), 0.0);
+  }
+
+  // skipped outputs: no output calls, same final states
+  SimulationOptions no_output_options = options;
+  no_output_options.skip_outputs = true;
+  sys->num_output_calls = 0;
+  xf = simulateBatch(sys,0,5,x0s,no_output_options,4);
+  valuecheck(0, sys->num_output_calls.load());
+  for (int i = 0; i < num_runs; i++) {
+    Eigen::VectorXd x0 = x0s.col(i);
+    valuecheckMatrix(simulate(*sys,0,5,x0,options), xf.col(i), 0.0);
+  }
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <cmath>
+#include "System.h"
+#include "Simulation.h"
+#include "testUtil.h"
+
+using namespace std;
+using namespace Drake;
+
+// ball bouncing on the ground with a coefficient of restitution, state [z; zdot], input is an extra vertical acceleration
+class BouncingBall : public System<BouncingBall,VectorBuilder<2>::VecType,VectorBuilder<1>::VecType,VectorBuilder<2>::VecType,false,false> {
+public:
+  BouncingBall() : g(9.81), restitution(0.8) {}
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> dynamicsImplementation(const Eigen::Matrix<ScalarType,2,1>& x, const Eigen::Matrix<ScalarType,1,1>& u) const {
+    Eigen::Matrix<ScalarType,2,1> xdot;
+    xdot << x(1), u(0) - g;
+    return xdot;
+  }
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> outputImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    return x;
+  }
+
+  Eigen::VectorXd zeroCrossingsImplementation(const double& t, const Eigen::Vector2d& x, const Eigen::Matrix<double,1,1>& u) const {
+    Eigen::VectorXd zcs(1);
+    zcs << x(0);
+    return zcs;
+  }
+
+  Eigen::Vector2d transitionUpdateImplementation(const double& t, const Eigen::Vector2d& x, const Eigen::Matrix<double,1,1>& u, int zero_crossing_index) const {
+    return Eigen::Vector2d(x(0), -restitution*x(1));
+  }
+
+  double g, restitution;
+};
+
+// integrates its input, to check that the zero crossings and transitions of a subsystem are passed through a cascade
+class Integrator : public System<Integrator,VectorBuilder<2>::VecType,VectorBuilder<2>::VecType,VectorBuilder<2>::VecType,false,false> {
+public:
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> dynamicsImplementation(const Eigen::Matrix<ScalarType,2,1>& x, const Eigen::Matrix<ScalarType,2,1>& u) const {
+    return u;
+  }
+
+  template <typename ScalarType>
+  Eigen::Matrix<ScalarType,2,1> outputImplementation(const Eigen::Matrix<ScalarType,2,1>& x) const {
+    return x;
+  }
+};
+
+int main(int argc, char* argv[]) {
+  auto ball = make_shared<BouncingBall>();
+  Eigen::Vector2d x0(1.0, 0.0);
+  double tf = 2.0;
+
+  // the flight phases are exact for any integrator of order >= 2, so only the impact times can introduce errors
+  Eigen::Vector2d x_expected;
+  double t = 0.0, v = sqrt(2*ball->g*x0(0));  // speed at the first impact
+  t = v / ball->g;
+  while (true) {
+    v *= ball->restitution;
+    double flight_time = 2*v / ball->g;
+    if (t + flight_time > tf) {
+      double s = tf - t;
+      x_expected << v*s - 0.5*ball->g*s*s, v - ball->g*s;
+      break;
+    }
+    t += flight_time;
+  }
+
+  SimulationOptions options;
+  options.initial_step_size = 0.05;
+  options.integrator = RK4;
+  valuecheckMatrix(x_expected, simulate(*ball,0,tf,x0,options), 1e-8);
+  Eigen::Vector4d x0_cascade;
+  x0_cascade << x0, 0.0, 0.0;
+  valuecheckMatrix(x_expected, simulate(*cascade(ball,make_shared<Integrator>()),0,tf,x0_cascade,options).head<2>(), 1e-8);
+
+  options.integrator = RK45;
+  options.max_step_size = 1.0;
+  valuecheckMatrix(x_expected, simulate(*ball,0,tf,x0,options), 1e-6);
+
+  return 0;
+}
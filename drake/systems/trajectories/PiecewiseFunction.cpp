@@ -1,4 +1,5 @@
 #include "PiecewiseFunction.h"
+#include <algorithm>
 #include <stdexcept>
 #include <sstream>
 #include <cmath>
@@ -50,15 +51,45 @@ double PiecewiseFunction::getEndTime() const {
 }
 
 int PiecewiseFunction::getSegmentIndex(double t) const {
-  // clip to min/max times
-  t = std::min(std::max(t, getStartTime()), getEndTime());
+  // times passed in by a control loop or a simulation mostly stay in the segment of the previous call or move on to
+  // the next one, so those are checked before searching all of them
+  int num_segments = getNumberOfSegments();
+  int segment_index = segment_index_hint.get();
+  if (segment_index >= num_segments || !segmentContains(segment_index, t)) {
+    segment_index++;
+    if (segment_index >= num_segments || !segmentContains(segment_index, t))
+      segment_index = findSegmentIndex(t);
+  }
+  segment_index_hint.set(segment_index);
+  return segment_index;
+}
 
+std::vector<int> PiecewiseFunction::getSegmentIndices(const std::vector<double>& t) const {
+  vector<int> segment_indices(t.size());
   int segment_index = 0;
-  // TODO: something smarter than this linear search
-  while (t >= getEndTime(segment_index) && segment_index < getNumberOfSegments() - 1)
-    segment_index++;
+  for (size_t i = 0; i < t.size(); i++) {
+    if (i == 0 || t[i] < t[i - 1])
+      segment_index = findSegmentIndex(t[i]);
+    else if (!segmentContains(segment_index, t[i]))
+      segment_index = findSegmentIndex(t[i], segment_index + 1);
+    segment_indices[i] = segment_index;
+  }
+  return segment_indices;
+}
 
-  return segment_index;
+bool PiecewiseFunction::segmentContains(int segment_index, double t) const {
+  // times before the start and after the end belong to the first and last segment, respectively
+  return (segment_index == 0 || segment_times[segment_index] <= t) &&
+         (segment_index == getNumberOfSegments() - 1 || t < segment_times[segment_index + 1]);
+}
+
+int PiecewiseFunction::findSegmentIndex(double t, int first_segment_index) const {
+  segmentNumberRangeCheck(first_segment_index);
+
+  // the segment index is the number of segment start times (except for the first one) that are <= t
+  auto start_times_begin = segment_times.begin() + 1;
+  auto start_times_end = segment_times.end() - 1;
+  return static_cast<int>(std::upper_bound(start_times_begin + first_segment_index, start_times_end, t) - start_times_begin);
 }
 
 const std::vector<double>& PiecewiseFunction::getSegmentTimes() const {
@@ -2,6 +2,7 @@
 #define DRAKE_SYSTEMS_TRAJECTORIES_PIECEWISEFUNCTION_H_
 
 #include <Eigen/Core>
+#include <atomic>
 #include <vector>
 #include <random>
 
@@ -44,6 +45,10 @@ public:
 
   int getSegmentIndex(double t) const;
 
+  // segment indices for each of the times in t, which are expected to be sorted in increasing order (unsorted times
+  // work, but are slower)
+  std::vector<int> getSegmentIndices(const std::vector<double>& t) const;
+
   const std::vector<double>& getSegmentTimes() const;
 
   void segmentNumberRangeCheck(int segment_number) const;
@@ -56,6 +61,28 @@ protected:
   void checkScalarValued() const;
 
   PiecewiseFunction();
+
+private:
+  bool segmentContains(int segment_index, double t) const;
+
+  int findSegmentIndex(double t, int first_segment_index = 0) const;
+
+  // std::atomic isn't copyable, but the hint doesn't need to be carried over exactly
+  class SegmentIndexHint
+  {
+  public:
+    SegmentIndexHint() : index(0) { }
+    SegmentIndexHint(const SegmentIndexHint& other) : index(other.get()) { }
+    SegmentIndexHint& operator=(const SegmentIndexHint& other) { set(other.get()); return *this; }
+    int get() const { return index.load(std::memory_order_relaxed); }
+    void set(int segment_index) { index.store(segment_index, std::memory_order_relaxed); }
+
+  private:
+    std::atomic<int> index;
+  };
+
+  // segment index found by the last call to getSegmentIndex, which is where the next lookup starts
+  mutable SegmentIndexHint segment_index_hint;
 };
 
 #endif /* DRAKE_SYSTEMS_TRAJECTORIES_PIECEWISEFUNCTION_H_ */
@@ -19,6 +19,7 @@ PiecewisePolynomial<CoefficientType>::PiecewisePolynomial(std::vector<Polynomial
     if (polynomials[i].cols() != polynomials[0].cols())
       throw std::runtime_error("The polynomial matrix for each segment must have the same number of columns.");
   }
+  updateDenseCoefficients();
 }
 
 template <typename CoefficientType>
@@ -32,11 +33,12 @@ PiecewisePolynomial<CoefficientType>::PiecewisePolynomial(std::vector<Polynomial
     matrix(0, 0) = polynomials[i];
     this->polynomials.push_back(matrix);
   }
+  updateDenseCoefficients();
 }
 
 template <typename CoefficientType>
 PiecewisePolynomial<CoefficientType>::PiecewisePolynomial() {
-  // empty
+  updateDenseCoefficients();
 }
 
 template <typename CoefficientType>
@@ -50,6 +52,7 @@ PiecewisePolynomial<CoefficientType> PiecewisePolynomial<CoefficientType>::deriv
       }
     }
   }
+  ret.updateDenseCoefficients();
   return ret;
 }
 
@@ -75,6 +78,7 @@ PiecewisePolynomial<CoefficientType> PiecewisePolynomial<CoefficientType>::integ
       }
     }
   }
+  ret.updateDenseCoefficients();
   return ret;
 }
 
@@ -86,13 +90,42 @@ double PiecewisePolynomial<CoefficientType>::scalarValue(double t, Eigen::DenseI
 
 template <typename CoefficientType>
 Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> PiecewisePolynomial<CoefficientType>::value(double t) const {
-  int segment_index = getSegmentIndex(t);
+  return segmentValue(getSegmentIndex(t), t);
+}
+
+template <typename CoefficientType>
+std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> PiecewisePolynomial<CoefficientType>::value(const std::vector<double>& t) const {
+  std::vector<int> segment_indices = getSegmentIndices(t);
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> ret;
+  ret.reserve(t.size());
+  for (size_t i = 0; i < t.size(); i++) {
+    ret.push_back(segmentValue(segment_indices[i], t[i]));
+  }
+  return ret;
+}
+
+template <typename CoefficientType>
+Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> PiecewisePolynomial<CoefficientType>::derivativeValue(double t, int derivative_order) const {
+  return segmentValue(getSegmentIndex(t), t, derivative_order);
+}
+
+template <typename CoefficientType>
+Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> PiecewisePolynomial<CoefficientType>::segmentValue(int segment_index, double t, int derivative_order) const {
+  assert(derivative_order >= 0);
+  if (dense_coefficients.cols() == 0)
+    throw std::runtime_error("PiecewisePolynomial can only be evaluated if all of its polynomials are univariate");
+
   t = std::min(std::max(t, getStartTime()), getEndTime());
-  Eigen::Matrix<double, PolynomialMatrix::RowsAtCompileTime, PolynomialMatrix::ColsAtCompileTime> ret(rows(), cols());
-  for (DenseIndex row = 0; row < rows(); row++) {
-    for (DenseIndex col = 0; col < cols(); col++) {
-      ret(row, col) = segmentValueAtGlobalAbscissa(segment_index, t, row, col);
-    }
+  double tau = t - segment_times[segment_index];
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> ret = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(rows(), cols());
+  Map<Matrix<double, Dynamic, 1>> ret_entries(ret.data(), ret.size());
+  auto segment_coefficients = dense_coefficients.middleCols(segment_index * (dense_degree + 1), dense_degree + 1);
+  for (int k = dense_degree; k >= derivative_order; k--) {
+    // d^n/dtau^n tau^k = k (k - 1) ... (k - n + 1) tau^(k - n)
+    double factor = 1.0;
+    for (int i = 0; i < derivative_order; i++)
+      factor *= k - i;
+    ret_entries = ret_entries * tau + factor * segment_coefficients.col(k);
   }
   return ret;
 }
@@ -120,6 +153,7 @@ PiecewisePolynomial<CoefficientType>& PiecewisePolynomial<CoefficientType>::oper
     throw runtime_error("Addition not yet implemented when segment times are not equal");
   for (int i = 0; i < polynomials.size(); i++)
     polynomials[i] += other.polynomials[i];
+  updateDenseCoefficients();
   return *this;
 }
 
@@ -129,6 +163,7 @@ PiecewisePolynomial<CoefficientType>& PiecewisePolynomial<CoefficientType>::oper
     throw runtime_error("Addition not yet implemented when segment times are not equal");
   for (int i = 0; i < polynomials.size(); i++)
     polynomials[i] -= other.polynomials[i];
+  updateDenseCoefficients();
   return *this;
 }
 
@@ -138,6 +173,7 @@ PiecewisePolynomial<CoefficientType>& PiecewisePolynomial<CoefficientType>::oper
     throw runtime_error("Multiplication not yet implemented when segment times are not equal");
   for (int i = 0; i < polynomials.size(); i++)
     polynomials[i] *= other.polynomials[i];
+  updateDenseCoefficients();
   return *this;
 }
 
@@ -145,6 +181,7 @@ template <typename CoefficientType>
 PiecewisePolynomial<CoefficientType>& PiecewisePolynomial<CoefficientType>::operator+=(const typename PiecewisePolynomial<CoefficientType>::CoefficientMatrix& offset) {
   for (int i = 0; i < polynomials.size(); i++)
     polynomials[i] += offset.template cast<PolynomialType>();
+  updateDenseCoefficients();
   return *this;
 }
 
@@ -152,6 +189,7 @@ template <typename CoefficientType>
 PiecewisePolynomial<CoefficientType>& PiecewisePolynomial<CoefficientType>::operator-=(const typename PiecewisePolynomial<CoefficientType>::CoefficientMatrix& offset) {
   for (int i = 0; i < polynomials.size(); i++)
     polynomials[i] -= offset.template cast<PolynomialType>();
+  updateDenseCoefficients();
   return *this;
 }
 
@@ -223,6 +261,7 @@ void PiecewisePolynomial<CoefficientType>::setPolynomialMatrixBlock(const typena
 {
   segmentNumberRangeCheck(segment_number);
   polynomials[segment_number].block(row_start, col_start, replacement.rows(), replacement.cols()) = replacement;
+  updateDenseCoefficients();
 }
 
 template<typename CoefficientType>
@@ -244,6 +283,36 @@ double PiecewisePolynomial<CoefficientType>::segmentValueAtGlobalAbscissa(int se
   return polynomials[segment_index](row, col).value(t - getStartTime(segment_index));
 }
 
+template <typename CoefficientType>
+void PiecewisePolynomial<CoefficientType>::updateDenseCoefficients() {
+  dense_degree = 0;
+  dense_coefficients.resize(0, 0);
+  if (polynomials.empty())
+    return;
+
+  for (auto it = polynomials.begin(); it != polynomials.end(); ++it) {
+    for (DenseIndex i = 0; i < it->size(); i++) {
+      const PolynomialType& polynomial = (*it)(i);
+      if (!polynomial.isUnivariate())
+        return;
+      dense_degree = std::max(dense_degree, polynomial.getDegree());
+    }
+  }
+
+  int num_segments = static_cast<int>(polynomials.size());
+  dense_coefficients.setZero(rows() * cols(), num_segments * (dense_degree + 1));
+  for (int segment_index = 0; segment_index < num_segments; segment_index++) {
+    const PolynomialMatrix& matrix = polynomials[segment_index];
+    for (DenseIndex i = 0; i < matrix.size(); i++) {
+      const std::vector<typename PolynomialType::Monomial>& monomials = matrix(i).getMonomials();
+      for (auto it = monomials.begin(); it != monomials.end(); ++it) {
+        int power = it->terms.empty() ? 0 : it->terms[0].power;
+        dense_coefficients(i, segment_index * (dense_degree + 1) + power) += it->coefficient;
+      }
+    }
+  }
+}
+
 template <typename CoefficientType>
 Eigen::DenseIndex PiecewisePolynomial<CoefficientType>::rows() const
 {
@@ -31,6 +31,13 @@ public:
 private:
   std::vector<PolynomialMatrix> polynomials; // a PolynomialMatrix for each piece
 
+  // copy of the coefficients of all polynomials, which is what value is computed from, using Horner's method. Column
+  // segment_index * (dense_degree + 1) + k holds the coefficients of (t - segment start time)^k of all entries of the
+  // segment's PolynomialMatrix in column major order, so that each Horner step is one vector operation over all
+  // entries. Has no columns if any of the polynomials is multivariate.
+  CoefficientMatrix dense_coefficients;
+  int dense_degree;
+
 public:
   virtual ~PiecewisePolynomial() { };
 
@@ -43,6 +50,7 @@ public:
     PiecewisePolynomialBase(std::vector<double>({ { 0.0, std::numeric_limits<double>::infinity() } }))
   {
     polynomials.push_back(value.template cast<PolynomialType>());
+    updateDenseCoefficients();
   }
 
   // Matrix constructor
@@ -61,6 +69,12 @@ public:
 
   Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> value(double t) const;
 
+  // values at each of the times in t, which should be sorted in increasing order
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>> value(const std::vector<double>& t) const;
+
+  // value of the derivative_order'th derivative at t, without constructing the derivative PiecewisePolynomial
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> derivativeValue(double t, int derivative_order = 1) const;
+
   const PolynomialMatrix& getPolynomialMatrix(int segment_index) const;
 
   const PolynomialType& getPolynomial(int segment_index, Eigen::DenseIndex row = 0, Eigen::DenseIndex col = 0) const;
@@ -104,7 +118,12 @@ public:
     const std::vector<double>& segment_times);
 
 protected:
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> segmentValue(int segment_index, double t, int derivative_order = 0) const;
+
   double segmentValueAtGlobalAbscissa(int segment_index, double t, Eigen::DenseIndex row, Eigen::DenseIndex col) const;
+
+  // has to be called whenever polynomials changes
+  void updateDenseCoefficients();
 };
 
 #endif /* DRAKE_SYSTEMS_TRAJECTORIES_PIECEWISEPOLYNOMIAL_H_ */
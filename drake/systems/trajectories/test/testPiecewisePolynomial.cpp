@@ -1,5 +1,6 @@
 #include "PiecewisePolynomial.h"
 #include <Eigen/Core>
+#include <algorithm>
 #include <random>
 #include <vector>
 #include "testUtil.h"
@@ -94,10 +95,107 @@ void testValueOutsideOfRange() {
   valuecheckMatrix(piecewise.value(piecewise.getEndTime()), piecewise.value(piecewise.getEndTime() + 1.0), 1e-10);
 }
 
+// the original linear search, as a reference
+int segmentIndexLinearSearch(const PiecewiseFunction& piecewise, double t) {
+  t = std::min(std::max(t, piecewise.getStartTime()), piecewise.getEndTime());
+  int segment_index = 0;
+  while (t >= piecewise.getEndTime(segment_index) && segment_index < piecewise.getNumberOfSegments() - 1)
+    segment_index++;
+  return segment_index;
+}
+
+template <typename CoefficientType>
+void testSegmentIndex() {
+  typedef PiecewisePolynomial<CoefficientType> PiecewisePolynomialType;
+
+  default_random_engine generator;
+  for (int num_segments = 1; num_segments < 50; num_segments += 7) {
+    vector<double> segment_times = PiecewiseFunction::randomSegmentTimes(num_segments, generator);
+    if (num_segments > 2)
+      segment_times[2] = segment_times[1]; // zero duration segment
+    PiecewisePolynomialType piecewise = PiecewisePolynomial<CoefficientType>::random(2, 3, 4, segment_times);
+
+    // segment times themselves, times in between, before the start and after the end, in increasing order
+    vector<double> t;
+    t.push_back(piecewise.getStartTime() - 1.0);
+    for (size_t i = 0; i < segment_times.size(); i++) {
+      t.push_back(segment_times[i]);
+      if (i + 1 < segment_times.size())
+        t.push_back(0.5 * (segment_times[i] + segment_times[i + 1]));
+    }
+    t.push_back(piecewise.getEndTime() + 1.0);
+
+    // increasing order, as in the batched version
+    vector<int> segment_indices = piecewise.getSegmentIndices(t);
+    vector<typename PiecewisePolynomialType::CoefficientMatrix> values = piecewise.value(t);
+    for (size_t i = 0; i < t.size(); i++) {
+      int expected = segmentIndexLinearSearch(piecewise, t[i]);
+      valuecheck(expected, piecewise.getSegmentIndex(t[i]));
+      valuecheck(expected, segment_indices[i]);
+      valuecheckMatrix(piecewise.value(t[i]), values[i], 1e-12);
+    }
+
+    // random order, which doesn't follow the segment index of the previous call
+    uniform_real_distribution<double> uniform(piecewise.getStartTime() - 0.5, piecewise.getEndTime() + 0.5);
+    for (size_t i = 0; i < t.size(); i++)
+      t[i] = uniform(generator);
+    segment_indices = piecewise.getSegmentIndices(t);
+    for (size_t i = 0; i < t.size(); i++) {
+      int expected = segmentIndexLinearSearch(piecewise, t[i]);
+      valuecheck(expected, piecewise.getSegmentIndex(t[i]));
+      valuecheck(expected, segment_indices[i]);
+    }
+  }
+}
+
+template <typename CoefficientType>
+void testDenseEvaluation() {
+  typedef PiecewisePolynomial<CoefficientType> PiecewisePolynomialType;
+
+  default_random_engine generator;
+  vector<double> segment_times = PiecewiseFunction::randomSegmentTimes(5, generator);
+  PiecewisePolynomialType piecewise = PiecewisePolynomial<CoefficientType>::random(3, 2, 6, segment_times);
+
+  // a segment with a lower degree than the others
+  typename PiecewisePolynomialType::PolynomialMatrix linear = PiecewisePolynomialType::PolynomialType::randomPolynomialMatrix(2, 3, 2);
+  piecewise.setPolynomialMatrixBlock(linear, 2);
+
+  uniform_real_distribution<double> uniform(piecewise.getStartTime(), piecewise.getEndTime());
+  for (int i = 0; i < 100; i++) {
+    double t = uniform(generator);
+    int segment_index = piecewise.getSegmentIndex(t);
+    double tau = t - piecewise.getStartTime(segment_index);
+
+    // against the general polynomial evaluation
+    typename PiecewisePolynomialType::CoefficientMatrix expected(piecewise.rows(), piecewise.cols());
+    for (DenseIndex row = 0; row < piecewise.rows(); row++) {
+      for (DenseIndex col = 0; col < piecewise.cols(); col++) {
+        expected(row, col) = piecewise.getPolynomial(segment_index, row, col).value(tau);
+      }
+    }
+    valuecheckMatrix(expected, piecewise.value(t), 1e-10);
+
+    valuecheckMatrix(expected, piecewise.derivativeValue(t, 0), 1e-10);
+    for (int derivative_order = 1; derivative_order < 8; derivative_order++) {
+      valuecheckMatrix(piecewise.derivative(derivative_order).value(t), piecewise.derivativeValue(t, derivative_order), 1e-8);
+    }
+  }
+
+  // values have to follow changes to the polynomials
+  typename PiecewisePolynomialType::CoefficientMatrix offset = PiecewisePolynomialType::CoefficientMatrix::Random(piecewise.rows(), piecewise.cols());
+  double t = uniform(generator);
+  auto value = piecewise.value(t);
+  piecewise += offset;
+  valuecheckMatrix(value + offset, piecewise.value(t), 1e-10);
+  valuecheckMatrix(piecewise.value(piecewise.getEndTime()), piecewise.derivativeValue(piecewise.getEndTime() + 1.0, 0), 1e-10);
+}
+
 int main(int argc, char **argv) {
   testIntegralAndDerivative<double>();
   testBasicFunctionality<double>();
   testValueOutsideOfRange<double>();
+  testSegmentIndex<double>();
+  testDenseEvaluation<double>();
 
   std::cout << "test passed";
 
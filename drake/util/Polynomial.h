@@ -96,6 +96,8 @@ public:
 
   int getDegree() const;
 
+  bool isUnivariate() const { return is_univariate; }
+
   // getSimpleVariable()
   // if the polynomial is "simple" -- e.g. just a single term with
   // coefficient 1 -- then return that variable.  otherwise return 0
@@ -862,16 +862,18 @@ template<typename Scalar>
 /*
  * spatial transform functions
  */
+// keeps the maximum number of columns of the argument, so that e.g. a motion subspace with at most 6 columns is
+// transformed without going through the heap
 template<typename Derived>
 struct TransformSpatial {
-  typedef typename Eigen::Matrix<typename Derived::Scalar, TWIST_SIZE, Derived::ColsAtCompileTime> type;
+  typedef typename Eigen::Matrix<typename Derived::Scalar, TWIST_SIZE, Derived::ColsAtCompileTime, 0, TWIST_SIZE, Derived::MaxColsAtCompileTime> type;
 };
 
 template<typename DerivedM>
 typename TransformSpatial<DerivedM>::type transformSpatialMotion(
     const Eigen::Transform<typename DerivedM::Scalar, 3, Eigen::Isometry>& T,
     const Eigen::MatrixBase<DerivedM>& M) {
-  Eigen::Matrix<typename DerivedM::Scalar, TWIST_SIZE, DerivedM::ColsAtCompileTime> ret(TWIST_SIZE, M.cols());
+  typename TransformSpatial<DerivedM>::type ret(TWIST_SIZE, M.cols());
   ret.template topRows<3>().noalias() = T.linear() * M.template topRows<3>();
   ret.template bottomRows<3>().noalias() = -ret.template topRows<3>().colwise().cross(T.translation());
   ret.template bottomRows<3>().noalias() += T.linear() * M.template bottomRows<3>();
@@ -925,7 +927,7 @@ template<typename DerivedF>
 typename TransformSpatial<DerivedF>::type transformSpatialForce(
     const Eigen::Transform<typename DerivedF::Scalar, 3, Eigen::Isometry>& T,
     const Eigen::MatrixBase<DerivedF>& F) {
-  Eigen::Matrix<typename DerivedF::Scalar, TWIST_SIZE, DerivedF::ColsAtCompileTime> ret(TWIST_SIZE, F.cols());
+  typename TransformSpatial<DerivedF>::type ret(TWIST_SIZE, F.cols());
   ret.template bottomRows<3>().noalias() = T.linear() * F.template bottomRows<3>().eval();
   ret.template topRows<3>() = -ret.template bottomRows<3>().colwise().cross(T.translation());
   ret.template topRows<3>().noalias() += T.linear() * F.template topRows<3>();
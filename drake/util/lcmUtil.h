@@ -2,7 +2,11 @@
 #define UTIL_LCMUTIL_H_
 
 #include <Eigen/Core>
+#include <algorithm>
+#include <cassert>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 #include "PiecewisePolynomial.h"
 #include "lcmtypes/drake/lcmt_polynomial.hpp"
 #include "lcmtypes/drake/lcmt_polynomial_matrix.hpp"
@@ -56,6 +60,42 @@ DLLEXPORT void encodePiecewisePolynomial(const PiecewisePolynomial<double>& piec
 
 DLLEXPORT PiecewisePolynomial<double> decodePiecewisePolynomial(const drake::lcmt_piecewise_polynomial& msg);
 
+/*
+ * Evaluates the derivative of order derivative_order (0 for the value) of the piecewise polynomial in msg at t, as
+ * decodePiecewisePolynomial(msg).derivativeValue(t, derivative_order) does, but straight from the message, so that
+ * nothing is allocated. value has to have the size of the polynomial matrices already.
+ */
+template <typename Derived>
+void evaluatePiecewisePolynomial(const drake::lcmt_piecewise_polynomial& msg, double t, int derivative_order, Eigen::MatrixBase<Derived>& value)
+{
+  assert(derivative_order >= 0);
+  if (msg.num_segments < 1)
+    throw std::runtime_error("can't evaluate a piecewise polynomial without segments");
+
+  // the segment index is the number of segment start times (except for the first one) that are <= t, see
+  // PiecewiseFunction::findSegmentIndex
+  int segment_index = static_cast<int>(std::upper_bound(msg.breaks.begin() + 1, msg.breaks.end() - 1, t) - (msg.breaks.begin() + 1));
+  t = std::min(std::max(t, msg.breaks.front()), msg.breaks.back());
+  double tau = t - msg.breaks[segment_index];
+
+  const drake::lcmt_polynomial_matrix& polynomial_matrix = msg.polynomial_matrices[segment_index];
+  assert(value.rows() == polynomial_matrix.rows && value.cols() == polynomial_matrix.cols);
+  for (int row = 0; row < polynomial_matrix.rows; ++row) {
+    for (int col = 0; col < polynomial_matrix.cols; ++col) {
+      const std::vector<double>& coefficients = polynomial_matrix.polynomials[row][col].coefficients;
+      double entry = 0.0;
+      for (int k = static_cast<int>(coefficients.size()) - 1; k >= derivative_order; k--) {
+        // d^n/dtau^n tau^k = k (k - 1) ... (k - n + 1) tau^(k - n)
+        double factor = 1.0;
+        for (int i = 0; i < derivative_order; i++)
+          factor *= k - i;
+        entry = entry * tau + factor * coefficients[k];
+      }
+      value(row, col) = entry;
+    }
+  }
+}
+
 DLLEXPORT void verifySubtypeSizes(drake::lcmt_support_data &support_data);
 DLLEXPORT void verifySubtypeSizes(drake::lcmt_qp_controller_input &qp_input);
 